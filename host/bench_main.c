@@ -0,0 +1,8 @@
+#include <stdbool.h>
+#include "bench.h"
+
+// Замеры одной группы bench.c: имя группы задается при сборке (BENCH_GROUP),
+// код завершения 0 - нарушений инвариантов нет
+int main(void) {
+    return bench_run(BENCH_GROUP) ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+# Формирование заголовков конфигурации хостовой сборки из файлов проекта.
+# Заголовки перезаписываются только при изменении содержимого, а CMake
+# перезапускается при изменении sdkconfig или partitions.csv
+
+function(bridge_write_if_changed path content)
+    if(EXISTS "${path}")
+        file(READ "${path}" old_content)
+        if(old_content STREQUAL content)
+            return()
+        endif()
+    endif()
+    file(WRITE "${path}" "${content}")
+endfunction()
+
+# sdkconfig.h из sdkconfig, как его формирует ESP-IDF: CONFIG_X=y -> 1,
+# остальные значения переносятся без изменений
+function(bridge_generate_sdkconfig sdkconfig output)
+    file(STRINGS "${sdkconfig}" lines REGEX "^CONFIG_[A-Za-z0-9_]+=")
+    set(content "/* Сформирован из ${sdkconfig}, не редактировать */\n#pragma once\n\n")
+    foreach(line IN LISTS lines)
+        if(line MATCHES "^(CONFIG_[A-Za-z0-9_]+)=(.*)$")
+            set(value "${CMAKE_MATCH_2}")
+            if(value STREQUAL "y")
+                set(value 1)
+            endif()
+            string(APPEND content "#define ${CMAKE_MATCH_1} ${value}\n")
+        endif()
+    endforeach()
+    bridge_write_if_changed("${output}" "${content}")
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS "${sdkconfig}")
+endfunction()
+
+# host_partitions.h из partitions.csv: таблица X-макросов
+# HOST_PARTITIONS(X) X(label, type, subtype, offset, size)
+function(bridge_generate_partitions csv output)
+    set(subtype_nvs 0x02)
+    set(subtype_phy 0x01)
+    set(subtype_factory 0x00)
+    set(subtype_ota 0x00)
+
+    file(STRINGS "${csv}" lines)
+    set(entries "")
+    foreach(line IN LISTS lines)
+        string(STRIP "${line}" line)
+        if(line STREQUAL "" OR line MATCHES "^#")
+            continue()
+        endif()
+        string(REPLACE " " "" line "${line}")
+        string(REPLACE "," ";" fields "${line}")
+        list(GET fields 0 label)
+        list(GET fields 1 type)
+        list(GET fields 2 subtype)
+        list(GET fields 3 offset)
+        list(GET fields 4 size)
+        if(type STREQUAL "app")
+            set(type ESP_PARTITION_TYPE_APP)
+        else()
+            set(type ESP_PARTITION_TYPE_DATA)
+        endif()
+        if(DEFINED subtype_${subtype})
+            set(subtype ${subtype_${subtype}})
+        endif()
+        string(APPEND entries " \\\n    X(\"${label}\", ${type}, ${subtype}, ${offset}, ${size})")
+    endforeach()
+
+    set(content "/* Сформирован из ${csv}, не редактировать */\n#pragma once\n\n#define HOST_PARTITIONS(X)${entries}\n")
+    bridge_write_if_changed("${output}" "${content}")
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS "${csv}")
+endfunction()
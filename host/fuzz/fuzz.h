@@ -0,0 +1,27 @@
+#ifndef HOST_FUZZ_H
+#define HOST_FUZZ_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Точка входа libFuzzer: каждый фаззер проверяет инварианты своего модуля
+// и останавливается через FUZZ_CHECK при их нарушении
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/**
+ * Формирует корректный входной пример номер index (начальный корпус).
+ * Возвращает его размер, 0 - примеры закончились. Используется
+ * автономным запуском (fuzz_driver.c) и для выгрузки корпуса libFuzzer
+ */
+size_t fuzz_seed(uint32_t index, uint8_t *buf, size_t max_size);
+
+#define FUZZ_CHECK(cond) do {                                                   \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: нарушен инвариант: %s\n", __FILE__, __LINE__, #cond); \
+            abort();                                                            \
+        }                                                                       \
+    } while (0)
+
+#endif /* HOST_FUZZ_H */
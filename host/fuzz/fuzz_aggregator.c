@@ -0,0 +1,61 @@
+#include <string.h>
+#include "fuzz.h"
+#include "aggregator.h"
+
+// Распаковка контейнера ESP-NOW: кадры выдаются только из границ пакета,
+// их число равно результату aggregator_unpack(), а принятый контейнер
+// собирается из выданных кадров обратно в те же байты
+
+typedef struct {
+    const uint8_t *start;
+    const uint8_t *end;
+    int frames;
+    aggregator_t repack;
+    bool repack_ok;
+} unpack_ctx_t;
+
+static void on_frame(const uint8_t *frame, size_t len, void *user_ctx) {
+    unpack_ctx_t *ctx = user_ctx;
+    FUZZ_CHECK(len > 0);
+    FUZZ_CHECK(frame >= ctx->start && frame + len <= ctx->end);
+    ctx->frames++;
+    ctx->repack_ok = ctx->repack_ok && aggregator_add(&ctx->repack, frame, len);
+}
+
+size_t fuzz_seed(uint32_t index, uint8_t *buf, size_t max_size) {
+    if (index >= 4 || max_size < AGGREGATOR_MAX_SIZE) {
+        return 0;
+    }
+    aggregator_t agg;
+    aggregator_reset(&agg);
+    uint8_t frame[AGGREGATOR_MAX_FRAME];
+    size_t frame_len = 9 + 29 * index;
+    for (size_t i = 0; i < frame_len; i++) {
+        frame[i] = (uint8_t)(i + index);
+    }
+    while (aggregator_add(&agg, frame, frame_len)) {
+    }
+    memcpy(buf, agg.buf, agg.len);
+    return agg.len;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    // Копия точного размера: выход за границу пакета заметит ASan
+    uint8_t *packet = malloc(size ? size : 1);
+    memcpy(packet, data, size);
+
+    unpack_ctx_t ctx = { .start = packet, .end = packet + size, .repack_ok = true };
+    aggregator_reset(&ctx.repack);
+    int count = aggregator_unpack(packet, size, on_frame, &ctx);
+    if (count < 0) {
+        FUZZ_CHECK(ctx.frames == 0);
+    } else {
+        FUZZ_CHECK(ctx.frames == count);
+        if (ctx.repack_ok && size <= AGGREGATOR_MAX_SIZE) {
+            FUZZ_CHECK(ctx.repack.len <= size);
+            FUZZ_CHECK(memcmp(ctx.repack.buf, packet, ctx.repack.len) == 0);
+        }
+    }
+    free(packet);
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fuzz.h"
+
+// Автономный запуск фаззера без libFuzzer (сборка GCC):
+//   fuzz_x                  - детерминированные мутации начального корпуса
+//   fuzz_x -runs=N          - то же, N входов
+//   fuzz_x FILE...          - воспроизведение найденных входов
+//   fuzz_x -write_corpus=DIR - выгрузка начального корпуса для libFuzzer
+
+#define FUZZ_DEFAULT_RUNS 200000
+#define FUZZ_MAX_INPUT    4096
+
+static uint8_t input[FUZZ_MAX_INPUT];
+static uint8_t seed[FUZZ_MAX_INPUT];
+static uint32_t rng_state = 0x9E3779B9;
+
+static uint32_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static int run_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    size_t size = fread(input, 1, sizeof(input), f);
+    fclose(f);
+    LLVMFuzzerTestOneInput(input, size);
+    return 0;
+}
+
+static int write_corpus(const char *dir) {
+    uint32_t index = 0;
+    size_t size;
+    while ((size = fuzz_seed(index, seed, sizeof(seed))) > 0) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/seed_%04u", dir, (unsigned)index);
+        FILE *f = fopen(path, "wb");
+        if (!f || fwrite(seed, 1, size, f) != size) {
+            perror(path);
+            return 1;
+        }
+        fclose(f);
+        index++;
+    }
+    printf("%u seeds written to %s\n", (unsigned)index, dir);
+    return 0;
+}
+
+// Мутация в духе libFuzzer: битовые ошибки, замена, вставка и удаление
+// байт, обрезка и склейка двух примеров
+static size_t mutate(size_t size, uint32_t seeds) {
+    int steps = 1 + rng_next() % 4;
+    for (int s = 0; s < steps; s++) {
+        uint32_t op = rng_next() % 6;
+        size_t pos = size ? rng_next() % size : 0;
+        switch (op) {
+            case 0:
+                if (size) input[pos] ^= (uint8_t)(1u << (rng_next() % 8));
+                break;
+            case 1:
+                if (size) input[pos] = (uint8_t)rng_next();
+                break;
+            case 2:
+                if (size < sizeof(input)) {
+                    memmove(input + pos + 1, input + pos, size - pos);
+                    input[pos] = (uint8_t)rng_next();
+                    size++;
+                }
+                break;
+            case 3:
+                if (size) {
+                    memmove(input + pos, input + pos + 1, size - pos - 1);
+                    size--;
+                }
+                break;
+            case 4:
+                size = pos;
+                break;
+            default: {
+                size_t other = fuzz_seed(rng_next() % seeds, seed, sizeof(seed));
+                size_t take = other ? rng_next() % (other + 1) : 0;
+                if (size + take > sizeof(input)) {
+                    take = sizeof(input) - size;
+                }
+                memcpy(input + size, seed, take);
+                size += take;
+                break;
+            }
+        }
+    }
+    return size;
+}
+
+int main(int argc, char **argv) {
+    unsigned long runs = FUZZ_DEFAULT_RUNS;
+    int files = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-runs=", 6) == 0) {
+            runs = strtoul(argv[i] + 6, NULL, 10);
+        } else if (strncmp(argv[i], "-write_corpus=", 14) == 0) {
+            return write_corpus(argv[i] + 14);
+        } else if (argv[i][0] != '-') {
+            if (run_file(argv[i]) != 0) {
+                return 1;
+            }
+            files++;
+        }
+    }
+    if (files > 0) {
+        printf("Executed %d inputs\n", files);
+        return 0;
+    }
+
+    uint32_t seeds = 0;
+    while (fuzz_seed(seeds, seed, sizeof(seed)) > 0) {
+        seeds++;
+    }
+    for (uint32_t i = 0; i < seeds; i++) {
+        size_t size = fuzz_seed(i, input, sizeof(input));
+        LLVMFuzzerTestOneInput(input, size);
+    }
+    for (unsigned long i = 0; i < runs; i++) {
+        size_t size = seeds ? fuzz_seed(rng_next() % seeds, input, sizeof(input)) : 0;
+        size = mutate(size, seeds ? seeds : 1);
+        LLVMFuzzerTestOneInput(input, size);
+    }
+    printf("Done %lu runs from %u seeds\n", runs, (unsigned)seeds);
+    return 0;
+}
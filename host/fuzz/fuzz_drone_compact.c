@@ -0,0 +1,70 @@
+#include <string.h>
+#include "fuzz.h"
+#include "drone_message.h"
+#include "drone_compact.h"
+
+// Компактный декодер: вход - последовательность кадров [длина][кадр],
+// которые декодируются одним декодером, как поток одного дрона. Принятый
+// кадр дает сообщение, которое снова кодируется в полный формат
+
+#define SEED_FRAMES 12
+
+size_t fuzz_seed(uint32_t index, uint8_t *buf, size_t max_size) {
+    if (index >= 4) {
+        return 0;
+    }
+    // Поток с ключевым кадром каждые (index + 1) кадров
+    drone_compact_encoder_t enc;
+    drone_compact_encoder_init(&enc, (uint16_t)(index + 1));
+    size_t len = 0;
+    for (uint32_t i = 0; i < SEED_FRAMES; i++) {
+        drone_message_t msg;
+        drone_msg_init(&msg);
+        msg.msg_type = MSG_TYPE_TELEMETRY;
+        msg.msg_id = (uint8_t)i;
+        msg.timestamp = 20u * i;
+        msg.latitude = 55.751244f + 0.00001f * i;
+        msg.longitude = 37.618423f;
+        msg.altitude = 150.0f + 0.1f * i;
+        msg.roll = 1.5f * (i % 3);
+        msg.yaw = 91.0f;
+        msg.vx = 3.1f;
+        msg.battery_voltage = 15.2f - 0.01f * (index * i);
+        if (len + 1 + 64 > max_size) {
+            break;
+        }
+        int n = drone_compact_encode(&enc, &msg, buf + len + 1, 64);
+        if (n <= 0) {
+            break;
+        }
+        buf[len] = (uint8_t)n;
+        len += 1 + n;
+    }
+    return len;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    drone_compact_decoder_t dec;
+    drone_compact_decoder_init(&dec);
+
+    size_t pos = 0;
+    while (pos < size) {
+        size_t len = data[pos++];
+        if (len > size - pos) {
+            len = size - pos;
+        }
+        // Копия точного размера: выход за границу кадра заметит ASan
+        uint8_t *frame = malloc(len ? len : 1);
+        memcpy(frame, data + pos, len);
+        drone_message_t msg;
+        if (drone_compact_decode(&dec, frame, (int)len, &msg) == 0) {
+            FUZZ_CHECK(drone_compact_is_compact(frame, (int)len));
+            FUZZ_CHECK(msg.version == DRONE_MSG_VERSION);
+            uint8_t full[DRONE_MSG_PACKET_SIZE];
+            FUZZ_CHECK(drone_msg_encode(&msg, full, sizeof(full)) == DRONE_MSG_PACKET_SIZE);
+        }
+        free(frame);
+        pos += len;
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+#include <string.h>
+#include "fuzz.h"
+#include "drone_message.h"
+#include "drone_msg_view.h"
+
+// drone_msg_decode(): любой вход без выхода за границы буфера; принятый
+// полный пакет любой версии проходит проверку drone_msg_verify(), пакет
+// версии 2 кодируется обратно в те же байты
+
+static void make_seed_message(drone_message_t *msg, uint32_t index) {
+    drone_msg_init(msg);
+    msg->msg_type = (uint8_t)(MSG_TYPE_TELEMETRY + index % 4);
+    msg->msg_id = (uint8_t)index;
+    msg->timestamp = 1000u * index;
+    msg->latitude = 55.75f + 0.001f * index;
+    msg->longitude = 37.61f;
+    msg->altitude = 150.0f + index;
+    msg->roll = 1.5f;
+    msg->yaw = 91.0f;
+    msg->status_flags = DRONE_FLAG_ARMED | DRONE_FLAG_FLYING;
+    msg->satellites = 11;
+}
+
+size_t fuzz_seed(uint32_t index, uint8_t *buf, size_t max_size) {
+    if (index >= 8 || max_size < DRONE_MSG_PACKET_SIZE) {
+        return 0;
+    }
+    drone_message_t msg;
+    make_seed_message(&msg, index);
+    uint8_t version = index < 6 ? DRONE_MSG_VERSION : DRONE_MSG_VERSION_LEGACY;
+    return (size_t)drone_msg_encode_version(&msg, buf, (int)max_size, version);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    drone_message_t msg;
+    if (drone_msg_decode(data, (int)size, &msg) != 0) {
+        return 0;
+    }
+    if (size >= DRONE_MSG_PACKET_SIZE) {
+        FUZZ_CHECK(drone_msg_verify(data, DRONE_MSG_PACKET_SIZE) >= 0);
+    }
+    if (size >= DRONE_MSG_PACKET_SIZE && data[DRONE_MSG_VERSION_OFFSET] == DRONE_MSG_VERSION) {
+        uint8_t encoded[DRONE_MSG_PACKET_SIZE];
+        FUZZ_CHECK(drone_msg_encode(&msg, encoded, sizeof(encoded)) == DRONE_MSG_PACKET_SIZE);
+        FUZZ_CHECK(memcmp(encoded, data, DRONE_MSG_PACKET_SIZE) == 0);
+        FUZZ_CHECK(drone_msg_verify(data, DRONE_MSG_PACKET_SIZE) == DRONE_MSG_VERSION);
+    }
+    return 0;
+}
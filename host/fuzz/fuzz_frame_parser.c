@@ -0,0 +1,104 @@
+#include <string.h>
+#include "fuzz.h"
+#include "frame_parser.h"
+#include "drone_message.h"
+
+// Разборщик кадров UART: первый байт входа выбирает формат и разбиение,
+// остальное - поток с линии. Поток разбирается целиком через
+// frame_parser_feed() и блоками случайной длины через кольцевой буфер
+// (frame_parser_write/next); оба пути должны выдать одни и те же кадры
+
+#define MAX_FRAMES 256
+
+typedef struct {
+    uint32_t count;
+    size_t lens[MAX_FRAMES];
+    uint32_t digests[MAX_FRAMES];
+} frame_log_t;
+
+static frame_parser_t whole;
+static frame_parser_t split;
+
+static uint32_t digest(const uint8_t *data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    return h;
+}
+
+static void log_frame(frame_log_t *log, const uint8_t *frame, size_t len) {
+    FUZZ_CHECK(len <= FRAME_PARSER_MAX_FRAME);
+    if (log->count < MAX_FRAMES) {
+        log->lens[log->count] = len;
+        log->digests[log->count] = digest(frame, len);
+    }
+    log->count++;
+}
+
+static void on_frame(const uint8_t *frame, size_t len, void *user_ctx) {
+    log_frame(user_ctx, frame, len);
+}
+
+size_t fuzz_seed(uint32_t index, uint8_t *buf, size_t max_size) {
+    if (index >= 4 || max_size < 1 + 3 * (DRONE_MSG_PACKET_SIZE + FRAME_LEN_HEADER_SIZE + 2)) {
+        return 0;
+    }
+    frame_mode_t mode = index & 1 ? FRAME_MODE_LENGTH : FRAME_MODE_MARKERS;
+    size_t len = 0;
+    buf[len++] = (uint8_t)(index * 37);
+    for (int i = 0; i < 3; i++) {
+        drone_message_t msg;
+        drone_msg_init(&msg);
+        msg.msg_id = (uint8_t)(i + index);
+        len += frame_encode_header(mode, DRONE_MSG_PACKET_SIZE, buf + len);
+        len += drone_msg_encode(&msg, buf + len, DRONE_MSG_PACKET_SIZE);
+        len += frame_encode_trailer(mode, buf + len - DRONE_MSG_PACKET_SIZE, DRONE_MSG_PACKET_SIZE, buf + len);
+    }
+    return len;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < 1) {
+        return 0;
+    }
+    frame_mode_t mode = data[0] & 1 ? FRAME_MODE_LENGTH : FRAME_MODE_MARKERS;
+    uint32_t split_state = data[0] | 1u;
+    data++;
+    size--;
+
+    static frame_log_t whole_log;
+    static frame_log_t split_log;
+    memset(&whole_log, 0, sizeof(whole_log));
+    memset(&split_log, 0, sizeof(split_log));
+
+    frame_parser_init(&whole, mode);
+    frame_parser_feed(&whole, data, size, on_frame, &whole_log);
+
+    frame_parser_init(&split, mode);
+    size_t pos = 0;
+    while (pos < size) {
+        split_state = split_state * 1103515245u + 12345u;
+        size_t chunk = 1 + (split_state >> 16) % 97;
+        if (chunk > size - pos) {
+            chunk = size - pos;
+        }
+        FUZZ_CHECK(frame_parser_write(&split, data + pos, chunk) == chunk);
+        pos += chunk;
+
+        const uint8_t *frame;
+        size_t len;
+        while (frame_parser_next(&split, &frame, &len)) {
+            log_frame(&split_log, frame, len);
+        }
+    }
+
+    FUZZ_CHECK(whole_log.count == split_log.count);
+    uint32_t logged = whole_log.count < MAX_FRAMES ? whole_log.count : MAX_FRAMES;
+    for (uint32_t i = 0; i < logged; i++) {
+        FUZZ_CHECK(whole_log.lens[i] == split_log.lens[i]);
+        FUZZ_CHECK(whole_log.digests[i] == split_log.digests[i]);
+    }
+    FUZZ_CHECK(whole.overflows == split.overflows);
+    return 0;
+}
@@ -0,0 +1,358 @@
+// Нагрузочный стенд хостовых узлов: запускает наземную станцию (узел 0) и
+// дроны (узлы 1..N) программой bridge_node, передает в псевдотерминал
+// каждого дрона поток сообщений drone_message_t и принимает их из
+// псевдотерминала наземной станции.
+//   bridge_loadgen --node build/host/bridge_node [--drones 3] [--rate 50]
+//                  [--seconds 10] [--loss 20] [--command-every 20] [--alert-every 50]
+// Результат - строка "LOADGEN {...}" в формате JSON: доставка, пропускная
+// способность и гистограммы задержки от записи в порт дрона до чтения из
+// порта наземной станции
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <termios.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "drone_message.h"
+#include "drone_msg_view.h"
+#include "drone_typed.h"
+#include "frame_parser.h"
+#include "latency_hist.h"
+#include "transport_udp.h"
+
+#define LOADGEN_MAX_DRONES 8
+
+// Время записи сообщения по номеру: номер сообщения дрона и сам дрон
+// передаются в поле timestamp, которое есть во всех форматах
+#define LOADGEN_SEQ_BITS 24
+#define LOADGEN_HISTORY  4096
+
+typedef struct {
+    pid_t pid;
+    int output;                    // Вывод узла
+    int pty;                       // Порт полетного контроллера
+} loadgen_node_t;
+
+typedef struct {
+    uint32_t sent;
+    uint32_t delivered;
+    latency_hist_t latency;
+} loadgen_class_t;
+
+static loadgen_node_t nodes[LOADGEN_MAX_DRONES + 1];
+static int64_t sent_us[LOADGEN_MAX_DRONES + 1][LOADGEN_HISTORY];
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static loadgen_class_t classes[3];  // Телеметрия, команды, тревоги
+static uint32_t corrupted;
+static uint64_t delivered_bytes;
+static volatile bool receiving = true;
+
+static int64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int message_class(uint8_t msg_type) {
+    return msg_type == MSG_TYPE_COMMAND ? 1 : msg_type == MSG_TYPE_ALERT ? 2 : 0;
+}
+
+// Запускает узел и ждет строку "PTY <путь>"
+static bool spawn_node(const char *program, loadgen_node_t *node, char *const args[]) {
+    int out[2];
+    if (pipe(out) < 0) {
+        return false;
+    }
+    node->pid = fork();
+    if (node->pid == 0) {
+        dup2(out[1], STDOUT_FILENO);
+        close(out[0]);
+        close(out[1]);
+        execv(program, args);
+        _exit(127);
+    }
+    close(out[1]);
+    node->output = out[0];
+
+    FILE *output = fdopen(dup(node->output), "r");
+    char line[256];
+    bool found = false;
+    while (!found && output && fgets(line, sizeof(line), output)) {
+        if (strncmp(line, "PTY ", 4) == 0) {
+            line[strcspn(line, "\n")] = 0;
+            node->pty = open(line + 4, O_RDWR | O_NOCTTY);
+            found = node->pty >= 0;
+        }
+    }
+    if (output) {
+        fclose(output);
+    }
+    if (!found) {
+        fprintf(stderr, "Узел %s не сообщил порт\n", args[2]);
+        return false;
+    }
+    struct termios tio;
+    if (tcgetattr(node->pty, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(node->pty, TCSANOW, &tio);
+    }
+    return true;
+}
+
+// Вывод узлов читается до конца, чтобы лог не остановил узел на записи
+static void *drain_thread(void *arg) {
+    char buf[4096];
+    int fd = *(const int *)arg;
+    while (read(fd, buf, sizeof(buf)) > 0) {
+    }
+    return NULL;
+}
+
+static void ground_frame(const uint8_t *frame, size_t len, void *user_ctx) {
+    int64_t now = monotonic_us();
+    if (drone_msg_verify(frame, len) < 0) {
+        pthread_mutex_lock(&stats_lock);
+        corrupted++;
+        pthread_mutex_unlock(&stats_lock);
+        return;
+    }
+    uint32_t timestamp = drone_msg_get_timestamp(frame);
+    uint32_t drone = timestamp >> LOADGEN_SEQ_BITS;
+    uint32_t seq = timestamp & ((1u << LOADGEN_SEQ_BITS) - 1);
+    if (drone == 0 || drone > LOADGEN_MAX_DRONES) {
+        return;
+    }
+
+    pthread_mutex_lock(&stats_lock);
+    loadgen_class_t *cls = &classes[message_class(drone_msg_get_msg_type(frame))];
+    latency_hist_record(&cls->latency, now - sent_us[drone][seq % LOADGEN_HISTORY]);
+    cls->delivered++;
+    delivered_bytes += len;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+static void *ground_thread(void *arg) {
+    int fd = *(const int *)arg;
+    frame_parser_t parser;
+    frame_parser_init(&parser, HOST_FRAME_MODE);
+    uint8_t buf[512];
+    while (receiving) {
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if (len <= 0) {
+            if (len < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        frame_parser_feed(&parser, buf, (size_t)len, ground_frame, NULL);
+    }
+    return NULL;
+}
+
+static void send_message(int drone, uint32_t seq, uint32_t command_every, uint32_t alert_every) {
+    drone_message_t msg;
+    drone_msg_init(&msg);
+    if (alert_every && seq % alert_every == alert_every - 1) {
+        msg.msg_type = MSG_TYPE_ALERT;
+    } else if (command_every && seq % command_every == command_every - 1) {
+        msg.msg_type = MSG_TYPE_COMMAND;
+    }
+    msg.msg_id = (uint8_t)seq;
+    msg.timestamp = (uint32_t)drone << LOADGEN_SEQ_BITS | (seq & ((1u << LOADGEN_SEQ_BITS) - 1));
+    msg.latitude = 55.75f + drone * 0.01f + seq * 1e-6f;
+    msg.longitude = 37.61f + seq * 1e-6f;
+    msg.altitude = 120.0f + (seq % 100) * 0.1f;
+    msg.yaw = (float)(seq % 360);
+    msg.vx = 5.0f;
+    msg.satellites = 12;
+    msg.fix_type = 2;
+    drone_typed_clear_unused(&msg);
+
+    uint8_t wire[FRAME_LEN_HEADER_SIZE + DRONE_MSG_PACKET_SIZE + 2];
+    size_t len = frame_encode_header(HOST_FRAME_MODE, DRONE_MSG_PACKET_SIZE, wire);
+    len += drone_msg_encode(&msg, wire + len, DRONE_MSG_PACKET_SIZE);
+    len += frame_encode_trailer(HOST_FRAME_MODE, wire + len - DRONE_MSG_PACKET_SIZE, DRONE_MSG_PACKET_SIZE, wire + len);
+
+    pthread_mutex_lock(&stats_lock);
+    sent_us[drone][seq % LOADGEN_HISTORY] = monotonic_us();
+    classes[message_class(msg.msg_type)].sent++;
+    pthread_mutex_unlock(&stats_lock);
+    if (write(nodes[drone].pty, wire, len) != (ssize_t)len) {
+        fprintf(stderr, "Запись в порт дрона %d: %s\n", drone, strerror(errno));
+    }
+}
+
+static void print_class(const char *name, const loadgen_class_t *cls, bool last) {
+    printf("\"%s\":{\"sent\":%u,\"delivered\":%u,\"p50_us\":%u,\"p90_us\":%u,\"p99_us\":%u,\"max_us\":%u,\"hist\":[",
+           name, cls->sent, cls->delivered, latency_hist_percentile(&cls->latency, 50),
+           latency_hist_percentile(&cls->latency, 90), latency_hist_percentile(&cls->latency, 99),
+           cls->latency.max_us);
+    bool first = true;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        if (cls->latency.buckets[i]) {
+            printf("%s[%u,%u]", first ? "" : ",", latency_hist_bucket_limit(i), cls->latency.buckets[i]);
+            first = false;
+        }
+    }
+    printf("]}%s", last ? "" : ",");
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Использование: %s --node ПУТЬ [--drones N] [--rate HZ] [--seconds S] [--loss PERMILLE]"
+            " [--command-every N] [--alert-every N] [--port-base PORT]\n", name);
+}
+
+int main(int argc, char **argv) {
+    const char *program = NULL;
+    int drones = 3;
+    uint32_t rate_hz = 50;
+    uint32_t seconds = 10;
+    uint32_t loss_permille = 0;
+    uint32_t command_every = 20;
+    uint32_t alert_every = 50;
+    unsigned port_base = HOST_NODE_PORT_BASE;
+
+    static const struct option options[] = {
+        {"node", required_argument, NULL, 'n'},
+        {"drones", required_argument, NULL, 'd'},
+        {"rate", required_argument, NULL, 'r'},
+        {"seconds", required_argument, NULL, 's'},
+        {"loss", required_argument, NULL, 'l'},
+        {"command-every", required_argument, NULL, 'c'},
+        {"alert-every", required_argument, NULL, 'a'},
+        {"port-base", required_argument, NULL, 'b'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': program = optarg; break;
+            case 'd': drones = atoi(optarg); break;
+            case 'r': rate_hz = (uint32_t)atoi(optarg); break;
+            case 's': seconds = (uint32_t)atoi(optarg); break;
+            case 'l': loss_permille = (uint32_t)atoi(optarg); break;
+            case 'c': command_every = (uint32_t)atoi(optarg); break;
+            case 'a': alert_every = (uint32_t)atoi(optarg); break;
+            case 'b': port_base = (unsigned)atoi(optarg); break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (!program || drones < 1 || drones > LOADGEN_MAX_DRONES || !rate_hz || !seconds) {
+        usage(argv[0]);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    // Наземная станция - эталон времени, ее кадры с подтверждением идут первому дрону
+    char loss_arg[16], port_arg[16], id_args[LOADGEN_MAX_DRONES + 1][4];
+    snprintf(loss_arg, sizeof(loss_arg), "%u", loss_permille);
+    snprintf(port_arg, sizeof(port_arg), "%u", port_base);
+    for (int i = 0; i <= drones; i++) {
+        snprintf(id_args[i], sizeof(id_args[i]), "%d", i);
+    }
+    char *ground_args[16 + 2 * LOADGEN_MAX_DRONES] = {
+        (char *)program, "--id", id_args[0], "--route", id_args[1], "--reference",
+        "--loss", loss_arg, "--port-base", port_arg,
+    };
+    int argi = 10;
+    for (int i = 2; i <= drones; i++) {
+        ground_args[argi++] = "--peer";
+        ground_args[argi++] = id_args[i];
+    }
+
+    bool started = spawn_node(program, &nodes[0], ground_args);
+    for (int i = 1; started && i <= drones; i++) {
+        char *drone_args[] = {
+            (char *)program, "--id", id_args[i], "--route", id_args[0],
+            "--loss", loss_arg, "--port-base", port_arg, NULL,
+        };
+        started = spawn_node(program, &nodes[i], drone_args);
+    }
+
+    pthread_t drains[LOADGEN_MAX_DRONES + 1];
+    pthread_t ground;
+    int running = 0;
+    if (started) {
+        for (; running <= drones; running++) {
+            pthread_create(&drains[running], NULL, drain_thread, &nodes[running].output);
+        }
+        pthread_create(&ground, NULL, ground_thread, &nodes[0].pty);
+
+        // Сообщения каждого дрона с периодом 1/rate, дроны сдвинуты по фазе
+        int64_t period = 1000000 / rate_hz;
+        int64_t start = monotonic_us() + 200000;
+        int64_t end = start + (int64_t)seconds * 1000000;
+        uint32_t seq[LOADGEN_MAX_DRONES + 1] = {0};
+        int64_t next[LOADGEN_MAX_DRONES + 1];
+        for (int i = 1; i <= drones; i++) {
+            next[i] = start + period * (i - 1) / drones;
+        }
+        while (1) {
+            int drone = 1;
+            for (int i = 2; i <= drones; i++) {
+                if (next[i] < next[drone]) {
+                    drone = i;
+                }
+            }
+            if (next[drone] >= end) {
+                break;
+            }
+            int64_t wait = next[drone] - monotonic_us();
+            if (wait > 0) {
+                usleep((useconds_t)wait);
+            }
+            send_message(drone, seq[drone]++, command_every, alert_every);
+            next[drone] += period;
+        }
+        // Кадры в пути и повторы
+        usleep(1000000);
+    }
+
+    receiving = false;
+    for (int i = 0; i <= drones; i++) {
+        if (nodes[i].pid > 0) {
+            kill(nodes[i].pid, SIGTERM);
+            waitpid(nodes[i].pid, NULL, 0);
+        }
+    }
+    if (!started) {
+        return 1;
+    }
+    for (int i = 0; i < running; i++) {
+        pthread_join(drains[i], NULL);
+    }
+    // Порт наземной станции закрыт вместе с ее псевдотерминалом
+    pthread_join(ground, NULL);
+    close(nodes[0].pty);
+
+    uint32_t sent = classes[0].sent + classes[1].sent + classes[2].sent;
+    uint32_t delivered = classes[0].delivered + classes[1].delivered + classes[2].delivered;
+    loadgen_class_t all = {.sent = sent, .delivered = delivered};
+    for (int c = 0; c < 3; c++) {
+        for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+            all.latency.buckets[i] += classes[c].latency.buckets[i];
+        }
+        all.latency.count += classes[c].latency.count;
+        if (classes[c].latency.max_us > all.latency.max_us) {
+            all.latency.max_us = classes[c].latency.max_us;
+        }
+    }
+
+    printf("LOADGEN {\"drones\":%d,\"rate_hz\":%u,\"seconds\":%u,\"loss_permille\":%u,\"sent\":%u,"
+           "\"delivered\":%u,\"dropped\":%u,\"corrupted\":%u,\"delivered_bytes_s\":%u,",
+           drones, rate_hz, seconds, loss_permille, sent, delivered, sent > delivered ? sent - delivered : 0,
+           corrupted, (uint32_t)(delivered_bytes / seconds));
+    print_class("all", &all, false);
+    print_class("telemetry", &classes[0], false);
+    print_class("command", &classes[1], false);
+    print_class("alert", &classes[2], true);
+    printf("}\n");
+    return delivered > 0 ? 0 : 1;
+}
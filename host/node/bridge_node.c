@@ -0,0 +1,285 @@
+// Мост прошивки как процесс Linux: псевдотерминал вместо UART полетного
+// контроллера, канал UDP вместо ESP-NOW. Путь данных - bridge.c без
+// изменений: разборщик кадров UART, bridge_forward, bridge_receive.
+//   bridge_node --id 1 --route 0 [--peer N]... [--reference] [--loss 20]
+// Первая строка вывода - "PTY <путь>": полетный контроллер (или
+// bridge_loadgen) открывает этот путь как последовательный порт
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include <pthread.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "bridge.h"
+#include "frame_parser.h"
+#include "transport_udp.h"
+
+static const char *TAG = "NODE";
+
+static bridge_t bridge;
+static int pty_master = -1;
+static pthread_mutex_t pty_write_lock = PTHREAD_MUTEX_INITIALIZER;
+static esp_timer_handle_t aggregate_timer = NULL;
+static esp_timer_handle_t telemetry_timer = NULL;
+// Канал, которым таймеры сроков будят стадию пересылки: байт - номер таймера
+static int deadline_wake[2] = {-1, -1};
+#define WAKE_AGGREGATE 1
+#define WAKE_TELEMETRY 2
+#if CONFIG_BRIDGE_FRAGMENT
+static fragment_slot_t rx_fragment_slots[CONFIG_BRIDGE_FRAGMENT_SLOTS];
+#endif
+
+static int64_t node_clock(void *ctx) {
+    return esp_timer_get_time();
+}
+
+// Кадр для полетного контроллера: заголовок, данные и завершение, как uart_send_data
+static int node_uart_send(const uint8_t *frame, size_t len, void *ctx) {
+    uint8_t wire[FRAME_LEN_HEADER_SIZE + FRAME_PARSER_MAX_FRAME + 2];
+    if (len > FRAME_PARSER_MAX_FRAME) {
+        return -1;
+    }
+    size_t wire_len = frame_encode_header(HOST_FRAME_MODE, len, wire);
+    memcpy(wire + wire_len, frame, len);
+    wire_len += len;
+    wire_len += frame_encode_trailer(HOST_FRAME_MODE, frame, len, wire + wire_len);
+
+    pthread_mutex_lock(&pty_write_lock);
+    ssize_t written = write(pty_master, wire, wire_len);
+    pthread_mutex_unlock(&pty_write_lock);
+    return written == (ssize_t)wire_len ? 0 : -1;
+}
+
+// Контейнер и придержанную телеметрию отправляет стадия пересылки, как в
+// прошивке: постановка в очередь может ждать места, а поток таймеров
+// обслуживает все таймеры
+static void deadline_cb(void *arg) {
+    const uint8_t wake = (uint8_t)(uintptr_t)arg;
+    (void)!write(deadline_wake[1], &wake, 1);
+}
+
+static void node_aggregate_timer(uint32_t delay_us, void *ctx) {
+    esp_timer_stop(aggregate_timer);
+    if (delay_us) {
+        esp_timer_start_once(aggregate_timer, delay_us);
+    }
+}
+
+static void node_telemetry_timer(uint32_t delay_us, void *ctx) {
+    esp_timer_stop(telemetry_timer);
+    if (delay_us) {
+        esp_timer_start_once(telemetry_timer, delay_us);
+    }
+}
+
+static void reliable_poll_cb(void *arg) {
+    bridge_reliable_poll(&bridge);
+}
+
+#if CONFIG_BRIDGE_TIMESYNC
+static void clock_sync_ping_cb(void *arg) {
+    bridge_clock_sync_ping(&bridge);
+}
+#endif
+
+static void periodic_timer(esp_timer_cb_t callback, const char *name, uint64_t period_us) {
+    esp_timer_handle_t timer;
+    const esp_timer_create_args_t args = {
+        .callback = callback,
+        .name = name,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(timer, period_us));
+}
+
+// Прием из канала: одна задача, как espnow_to_uart_task
+static void radio_rx_task(void *arg) {
+    while (1) {
+        const transport_packet_t *packet = transport_udp.receive(portMAX_DELAY);
+        if (!packet) {
+            continue;
+        }
+        bridge_receive(&bridge, packet);
+        transport_udp.release();
+    }
+}
+
+static void forward_frame_cb(const uint8_t *frame, size_t len, void *user_ctx) {
+    bridge_forward(&bridge, frame, len, *(const int64_t *)user_ctx);
+}
+
+// Псевдотерминал в сыром режиме: байты без обработки строк и эха
+static int open_pty(void) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+        return -1;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Использование: %s --id N --route M [--peer K]... [--reference] [--loss PERMILLE]"
+            " [--phy-rate KBPS] [--port-base PORT]\n", name);
+}
+
+int main(int argc, char **argv) {
+    transport_udp_config_t udp = {0};
+    int route_id = -1;
+    bool reference = false;
+    uint8_t peer_ids[PEER_TABLE_CAPACITY];
+    int peer_count = 0;
+    bool have_id = false;
+
+    static const struct option options[] = {
+        {"id", required_argument, NULL, 'i'},
+        {"route", required_argument, NULL, 'r'},
+        {"peer", required_argument, NULL, 'p'},
+        {"reference", no_argument, NULL, 'R'},
+        {"loss", required_argument, NULL, 'l'},
+        {"phy-rate", required_argument, NULL, 'k'},
+        {"port-base", required_argument, NULL, 'b'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 'i': udp.node_id = (uint8_t)atoi(optarg); have_id = true; break;
+            case 'r': route_id = atoi(optarg); break;
+            case 'p':
+                if (peer_count < PEER_TABLE_CAPACITY) {
+                    peer_ids[peer_count++] = (uint8_t)atoi(optarg);
+                }
+                break;
+            case 'R': reference = true; break;
+            case 'l': udp.loss_permille = (uint32_t)atoi(optarg); break;
+            case 'k': udp.phy_rate_kbps = (uint32_t)atoi(optarg); break;
+            case 'b': udp.port_base = (uint16_t)atoi(optarg); break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (!have_id || route_id < 0 || route_id > UINT8_MAX) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    transport_udp_configure(&udp);
+    transport_udp.init();
+    transport_dest_t route = {.mode = TRANSPORT_DEST_UNICAST};
+    transport_udp_mac((uint8_t)route_id, route.mac);
+    transport_udp.add_peer(route.mac, 0);
+    for (int i = 0; i < peer_count; i++) {
+        uint8_t mac[TRANSPORT_ADDR_LEN];
+        transport_udp_mac(peer_ids[i], mac);
+        transport_udp.add_peer(mac, 0);
+    }
+
+    if (pipe(deadline_wake) < 0) {
+        ESP_LOGE(TAG, "Канал таймера недоступен: %s", strerror(errno));
+        return 1;
+    }
+    pty_master = open_pty();
+    if (pty_master < 0) {
+        ESP_LOGE(TAG, "Псевдотерминал недоступен: %s", strerror(errno));
+        return 1;
+    }
+
+    bridge_config_t config;
+    bridge_default_config(&config);
+    config.timesync_reference = reference;
+#if CONFIG_BRIDGE_FRAGMENT
+    config.fragment_slots = rx_fragment_slots;
+    config.fragment_slot_count = CONFIG_BRIDGE_FRAGMENT_SLOTS;
+#endif
+    const bridge_hooks_t hooks = {
+        .now = node_clock,
+        .uart_send = node_uart_send,
+        .aggregate_timer = node_aggregate_timer,
+        .telemetry_timer = node_telemetry_timer,
+    };
+    const esp_timer_create_args_t aggregate_args = {
+        .callback = deadline_cb,
+        .arg = (void *)(uintptr_t)WAKE_AGGREGATE,
+        .name = "aggregate_deadline",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&aggregate_args, &aggregate_timer));
+    const esp_timer_create_args_t telemetry_args = {
+        .callback = deadline_cb,
+        .arg = (void *)(uintptr_t)WAKE_TELEMETRY,
+        .name = "telemetry_deadline",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&telemetry_args, &telemetry_timer));
+    bridge_init(&bridge, &config, &transport_udp, &route, &hooks);
+
+    if (config.reliable) {
+        periodic_timer(reliable_poll_cb, "reliable_poll", config.reliable_config.rto_min_us / 2);
+    }
+#if CONFIG_BRIDGE_TIMESYNC
+    if (!reference) {
+        periodic_timer(clock_sync_ping_cb, "clock_sync", CONFIG_BRIDGE_TIMESYNC_INTERVAL_MS * 1000);
+    }
+#endif
+    xTaskCreate(radio_rx_task, "radio_rx", 4096, NULL, 5, NULL);
+
+    printf("PTY %s\n", ptsname(pty_master));
+    fflush(stdout);
+
+    // Стадия приема UART и пересылки: время приема - момент чтения байтов
+    frame_parser_t parser;
+    frame_parser_init(&parser, HOST_FRAME_MODE);
+    uint8_t buf[512];
+    struct pollfd fds[2] = {
+        {.fd = pty_master, .events = POLLIN},
+        {.fd = deadline_wake[0], .events = POLLIN},
+    };
+    while (1) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            uint8_t wake[16];
+            ssize_t count = read(deadline_wake[0], wake, sizeof(wake));
+            for (ssize_t i = 0; i < count; i++) {
+                if (wake[i] == WAKE_AGGREGATE) {
+                    bridge_aggregate_deadline(&bridge);
+                } else if (wake[i] == WAKE_TELEMETRY) {
+                    bridge_telemetry_deadline(&bridge);
+                }
+            }
+        }
+        if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            continue;
+        }
+        ssize_t len = read(pty_master, buf, sizeof(buf));
+        if (len < 0 && errno == EIO) {
+            // Полетный контроллер еще не открыл или закрыл порт
+            usleep(10000);
+            continue;
+        }
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            break;
+        }
+        int64_t rx_time = esp_timer_get_time();
+        frame_parser_feed(&parser, buf, (size_t)len, forward_frame_cb, &rx_time);
+    }
+    return 0;
+}
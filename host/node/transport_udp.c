@@ -0,0 +1,357 @@
+#include "transport_udp.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "espnow_handler.h"
+#include "peer_table.h"
+#include "spsc_ring.h"
+
+static const char *TAG = "UDP";
+
+// Модель эфира, как в loopback_sim.c: заголовок PLCP, служебные поля
+// action-кадра и подтверждение
+#define UDP_PLCP_US      192
+#define UDP_MAC_OVERHEAD 43
+#define UDP_ACK_US       (10 + 304)
+
+// Датаграмма: MAC отправителя, затем данные пакета
+#define UDP_DATAGRAM_MAX (TRANSPORT_ADDR_LEN + TRANSPORT_MAX_DATA_LEN)
+
+typedef struct {
+    uint8_t peer_mac[TRANSPORT_ADDR_LEN];
+    uint16_t len;
+    uint8_t data[TRANSPORT_MAX_DATA_LEN];
+} udp_tx_slot_t;
+
+static transport_udp_config_t udp_config = {
+    .port_base = HOST_NODE_PORT_BASE,
+    .phy_rate_kbps = 1000,
+};
+static uint8_t own_mac[TRANSPORT_ADDR_LEN];
+static int udp_socket = -1;
+
+static udp_tx_slot_t tx_slots[ESPNOW_TX_QUEUE_LEN];
+static tx_sched_t tx_sched;
+static StaticSemaphore_t tx_mutex_buf;
+static StaticSemaphore_t tx_space_sem_buf;
+static SemaphoreHandle_t tx_mutex = NULL;
+static SemaphoreHandle_t tx_space_sem = NULL;
+static TaskHandle_t tx_task_handle = NULL;
+
+static transport_packet_t rx_packets[ESPNOW_RX_RING_LEN];
+static spsc_ring_t rx_ring;
+static TaskHandle_t rx_consumer_task = NULL;
+static transport_rx_stats_t rx_stats;
+
+static peer_table_t peers;
+static portMUX_TYPE peer_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void transport_udp_mac(uint8_t node_id, uint8_t mac[TRANSPORT_ADDR_LEN]) {
+    const uint8_t base[TRANSPORT_ADDR_LEN] = {0x02, 0, 0, 0, 0, node_id};
+    memcpy(mac, base, TRANSPORT_ADDR_LEN);
+}
+
+void transport_udp_configure(const transport_udp_config_t *config) {
+    udp_config = *config;
+    if (!udp_config.port_base) {
+        udp_config.port_base = HOST_NODE_PORT_BASE;
+    }
+    if (!udp_config.phy_rate_kbps) {
+        udp_config.phy_rate_kbps = 1000;
+    }
+}
+
+static struct sockaddr_in udp_address(uint8_t node_id) {
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons((uint16_t)(udp_config.port_base + node_id)),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    return addr;
+}
+
+// Передает датаграмму узлу mac. Потеря в эфире решается у отправителя:
+// получатель пакет не видит, отправитель считает его неподтвержденным
+static bool udp_transmit(const uint8_t *mac, const uint8_t *datagram, size_t len) {
+    if (esp_random() % 1000 < udp_config.loss_permille) {
+        return false;
+    }
+    struct sockaddr_in addr = udp_address(mac[5]);
+    return sendto(udp_socket, datagram, len, 0, (const struct sockaddr *)&addr, sizeof(addr)) == (ssize_t)len;
+}
+
+static void udp_record_result(const uint8_t *mac, bool ok) {
+    portENTER_CRITICAL(&peer_lock);
+    peer_entry_t *peer = peer_table_find(&peers, mac);
+    if (peer && ok) {
+        peer->stats.tx_ok++;
+    } else if (peer) {
+        peer->stats.tx_fail++;
+    }
+    portEXIT_CRITICAL(&peer_lock);
+}
+
+static void udp_tx_task(void *arg) {
+    uint8_t datagram[UDP_DATAGRAM_MAX];
+    memcpy(datagram, own_mac, TRANSPORT_ADDR_LEN);
+
+    while (1) {
+        xSemaphoreTake(tx_mutex, portMAX_DELAY);
+        int index = tx_sched_peek(&tx_sched) >= 0 ? tx_sched_pop(&tx_sched, esp_timer_get_time()) : -1;
+        xSemaphoreGive(tx_mutex);
+        if (index < 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        udp_tx_slot_t *slot = &tx_slots[index];
+        memcpy(datagram + TRANSPORT_ADDR_LEN, slot->data, slot->len);
+        size_t len = TRANSPORT_ADDR_LEN + slot->len;
+        // Пакет занимает эфир на время передачи
+        usleep(UDP_PLCP_US + (slot->len + UDP_MAC_OVERHEAD) * 8 * 1000 / udp_config.phy_rate_kbps + UDP_ACK_US);
+
+        if (memcmp(slot->peer_mac, PEER_BROADCAST_MAC, TRANSPORT_ADDR_LEN) == 0) {
+            // Широковещательный пакет без подтверждения получателями
+            uint8_t macs[PEER_TABLE_CAPACITY][PEER_MAC_LEN];
+            portENTER_CRITICAL(&peer_lock);
+            size_t count = peer_table_collect(&peers, UINT32_MAX, macs, PEER_TABLE_CAPACITY);
+            portEXIT_CRITICAL(&peer_lock);
+            for (size_t i = 0; i < count; i++) {
+                udp_transmit(macs[i], datagram, len);
+            }
+        } else {
+            udp_record_result(slot->peer_mac, udp_transmit(slot->peer_mac, datagram, len));
+        }
+
+        xSemaphoreTake(tx_mutex, portMAX_DELAY);
+        tx_sched_release(&tx_sched, index);
+        xSemaphoreGive(tx_mutex);
+        xSemaphoreGive(tx_space_sem);
+    }
+}
+
+static void udp_rx_task(void *arg) {
+    uint8_t datagram[UDP_DATAGRAM_MAX];
+
+    while (1) {
+        ssize_t len = recv(udp_socket, datagram, sizeof(datagram), 0);
+        int64_t now = esp_timer_get_time();
+        if (len <= TRANSPORT_ADDR_LEN) {
+            if (len < 0 && errno != EINTR) {
+                ESP_LOGE(TAG, "recv: %s", strerror(errno));
+                return;
+            }
+            continue;
+        }
+
+        transport_packet_t *packet = spsc_ring_acquire(&rx_ring);
+        if (!packet) {
+            rx_stats.dropped++;
+            continue;
+        }
+        memcpy(packet->src_mac, datagram, TRANSPORT_ADDR_LEN);
+        packet->rssi = 0;
+        packet->len = len - TRANSPORT_ADDR_LEN;
+        packet->rx_time = now;
+        memcpy(packet->data, datagram + TRANSPORT_ADDR_LEN, packet->len);
+
+        portENTER_CRITICAL(&peer_lock);
+        peer_entry_t *peer = peer_table_find(&peers, packet->src_mac);
+        if (peer) {
+            peer_stats_record_rx(&peer->stats, packet->len, 0, now);
+        }
+        portEXIT_CRITICAL(&peer_lock);
+
+        // Уведомление на каждый пакет: потребитель мог проверить буфер до
+        // публикации и еще не уснуть
+        spsc_ring_publish(&rx_ring);
+        if (rx_consumer_task) {
+            xTaskNotifyGive(rx_consumer_task);
+        }
+        rx_stats.received++;
+    }
+}
+
+static void udp_init(void) {
+    transport_udp_mac(udp_config.node_id, own_mac);
+
+    udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = udp_address(udp_config.node_id);
+    if (udp_socket < 0 || bind(udp_socket, (const struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "Порт %u недоступен: %s", ntohs(addr.sin_port), strerror(errno));
+        abort();
+    }
+
+    tx_mutex = xSemaphoreCreateMutexStatic(&tx_mutex_buf);
+    tx_space_sem = xSemaphoreCreateBinaryStatic(&tx_space_sem_buf);
+    const tx_sched_config_t sched_config = {
+        .capacity = ESPNOW_TX_QUEUE_LEN,
+        .reserve = CONFIG_BRIDGE_ESPNOW_URGENT_RESERVE,
+        .weight = {
+            [TX_CLASS_TELEMETRY] = CONFIG_BRIDGE_TX_WEIGHT_TELEMETRY,
+            [TX_CLASS_BULK] = CONFIG_BRIDGE_TX_WEIGHT_BULK,
+        },
+    };
+    tx_sched_init(&tx_sched, &sched_config);
+    spsc_ring_init(&rx_ring, rx_packets, sizeof(transport_packet_t), ESPNOW_RX_RING_LEN);
+    peer_table_init(&peers);
+
+    xTaskCreate(udp_tx_task, "udp_tx", 4096, NULL, 5, &tx_task_handle);
+    xTaskCreate(udp_rx_task, "udp_rx", 4096, NULL, 5, NULL);
+    ESP_LOGI(TAG, "Узел %u, порт %u, потери %u промилле", udp_config.node_id, ntohs(addr.sin_port),
+             (unsigned)udp_config.loss_permille);
+}
+
+static esp_err_t udp_add_peer(const uint8_t *mac, uint32_t groups) {
+    portENTER_CRITICAL(&peer_lock);
+    peer_entry_t *entry = peer_table_find(&peers, mac);
+    if (entry) {
+        entry->groups |= groups;
+    } else {
+        entry = peer_table_add(&peers, mac, groups);
+    }
+    portEXIT_CRITICAL(&peer_lock);
+    return entry ? ESP_OK : ESP_ERR_ESPNOW_FULL;
+}
+
+static bool udp_has_peer(const uint8_t *mac) {
+    portENTER_CRITICAL(&peer_lock);
+    bool found = peer_table_find(&peers, mac) != NULL;
+    portEXIT_CRITICAL(&peer_lock);
+    return found;
+}
+
+static uint8_t udp_peer_count(void) {
+    return peers.count;
+}
+
+// Ставит пакет в очередь. Вызывается под tx_mutex
+static transport_tx_status_t udp_push(const uint8_t *mac, const uint8_t *data, size_t len, tx_class_t cls) {
+    bool dropped;
+    int index = tx_sched_push(&tx_sched, cls, len, tx_evictable(data, len), esp_timer_get_time(), &dropped);
+    if (index < 0) {
+        return TRANSPORT_TX_FULL;
+    }
+    udp_tx_slot_t *slot = &tx_slots[index];
+    memcpy(slot->peer_mac, mac, TRANSPORT_ADDR_LEN);
+    memcpy(slot->data, data, len);
+    slot->len = len;
+    return dropped ? TRANSPORT_TX_QUEUED_DROPPED : TRANSPORT_TX_QUEUED;
+}
+
+static transport_tx_status_t udp_send(const transport_dest_t *dest, const uint8_t *data, size_t len,
+                                      tx_class_t cls) {
+    if (!dest || !data || len == 0 || len > TRANSPORT_MAX_DATA_LEN || !tx_mutex) {
+        return TRANSPORT_TX_INVALID;
+    }
+    uint8_t macs[PEER_TABLE_CAPACITY][PEER_MAC_LEN];
+    size_t count = 1;
+    if (dest->mode == TRANSPORT_DEST_UNICAST) {
+        memcpy(macs[0], dest->mac, PEER_MAC_LEN);
+    } else if (dest->mode == TRANSPORT_DEST_BROADCAST) {
+        memcpy(macs[0], PEER_BROADCAST_MAC, PEER_MAC_LEN);
+    } else {
+        // Копия каждому узлу группы, все или ни одной, как в espnow_send_dest
+        portENTER_CRITICAL(&peer_lock);
+        count = peer_table_collect(&peers, dest->groups, macs, PEER_TABLE_CAPACITY);
+        portEXIT_CRITICAL(&peer_lock);
+        if (count == 0) {
+            return TRANSPORT_TX_INVALID;
+        }
+    }
+
+    transport_tx_status_t result = TRANSPORT_TX_QUEUED;
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    if (tx_sched_room(&tx_sched, cls, tx_evictable(data, len)) < count) {
+        result = TRANSPORT_TX_FULL;
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            if (udp_push(macs[i], data, len, cls) == TRANSPORT_TX_QUEUED_DROPPED) {
+                result = TRANSPORT_TX_QUEUED_DROPPED;
+            }
+        }
+    }
+    xSemaphoreGive(tx_mutex);
+    if (result != TRANSPORT_TX_FULL) {
+        xTaskNotifyGive(tx_task_handle);
+    }
+    return result;
+}
+
+static bool udp_wait_space(TickType_t ticks_to_wait) {
+    return tx_space_sem && xSemaphoreTake(tx_space_sem, ticks_to_wait) == pdTRUE;
+}
+
+static void udp_get_class_stats(tx_class_t cls, tx_sched_class_stats_t *stats) {
+    if (!stats || (unsigned)cls >= TX_CLASS_COUNT || !tx_mutex) {
+        return;
+    }
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    *stats = tx_sched.stats[cls];
+    xSemaphoreGive(tx_mutex);
+}
+
+static bool udp_get_link_stats(const transport_dest_t *dest, peer_link_stats_t *stats) {
+    if (!dest || !stats) {
+        return false;
+    }
+    bool found = false;
+    portENTER_CRITICAL(&peer_lock);
+    if (dest->mode == TRANSPORT_DEST_UNICAST) {
+        peer_entry_t *peer = peer_table_find(&peers, dest->mac);
+        if (peer) {
+            *stats = peer->stats;
+            found = true;
+        }
+    } else if (dest->mode == TRANSPORT_DEST_GROUP) {
+        found = peer_table_group_stats(&peers, dest->groups, stats) > 0;
+    }
+    portEXIT_CRITICAL(&peer_lock);
+    return found;
+}
+
+static const transport_packet_t *udp_receive(TickType_t ticks_to_wait) {
+    if (!rx_consumer_task) {
+        rx_consumer_task = xTaskGetCurrentTaskHandle();
+    }
+    const transport_packet_t *packet = spsc_ring_peek(&rx_ring);
+    if (!packet && ulTaskNotifyTake(pdTRUE, ticks_to_wait) > 0) {
+        packet = spsc_ring_peek(&rx_ring);
+    }
+    return packet;
+}
+
+static void udp_release(void) {
+    spsc_ring_release(&rx_ring);
+}
+
+static void udp_get_rx_stats(transport_rx_stats_t *stats) {
+    if (stats) {
+        *stats = rx_stats;
+    }
+}
+
+const transport_t transport_udp = {
+    .name = "udp",
+    .init = udp_init,
+    .add_peer = udp_add_peer,
+    .has_peer = udp_has_peer,
+    .peer_count = udp_peer_count,
+    .send = udp_send,
+    .wait_space = udp_wait_space,
+    .get_class_stats = udp_get_class_stats,
+    .get_link_stats = udp_get_link_stats,
+    .receive = udp_receive,
+    .release = udp_release,
+    .get_rx_stats = udp_get_rx_stats,
+};
@@ -0,0 +1,45 @@
+#ifndef TRANSPORT_UDP_H
+#define TRANSPORT_UDP_H
+
+#include <stdint.h>
+#include "transport.h"
+#include "frame_parser.h"
+#include "sdkconfig.h"
+
+// Узлы хостовой сборки: мост прошивки за псевдотерминалом вместо UART и
+// каналом UDP на localhost вместо ESP-NOW. Узел id имеет MAC
+// 02:00:00:00:00:id и принимает пакеты на порт port_base + id
+
+// Формат кадров UART, как в uart_handler.h
+#if CONFIG_BRIDGE_UART_FRAMING_LENGTH
+#define HOST_FRAME_MODE FRAME_MODE_LENGTH
+#else
+#define HOST_FRAME_MODE FRAME_MODE_MARKERS
+#endif
+
+#define HOST_NODE_PORT_BASE 47000
+
+// Параметры канала
+typedef struct {
+    uint8_t node_id;
+    uint16_t port_base;
+    uint32_t loss_permille;        // Вероятность потери пакета: отправитель видит FAIL, как в espnow_send_cb
+    uint32_t phy_rate_kbps;        // Скорость эфира: передача пакета занимает время, как в loopback_sim
+} transport_udp_config_t;
+
+/**
+ * MAC узла id
+ */
+void transport_udp_mac(uint8_t node_id, uint8_t mac[TRANSPORT_ADDR_LEN]);
+
+/**
+ * Задает параметры канала. Вызывается до transport_udp.init
+ */
+void transport_udp_configure(const transport_udp_config_t *config);
+
+// Очередь передачи на планировщике tx_sched и прием в кольцевой буфер,
+// как в espnow_handler.c. Общий эфир между процессами не моделируется:
+// каждый узел занимает только свое время передачи
+extern const transport_t transport_udp;
+
+#endif /* TRANSPORT_UDP_H */
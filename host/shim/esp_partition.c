@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "esp_partition.h"
+#include "host_partitions.h"
+
+#define FLASH_SECTOR_SIZE 4096
+
+// Раздел и его содержимое. Память выделяется при первом обращении к разделу
+typedef struct {
+    esp_partition_t info;
+    uint8_t *data;
+} host_partition_t;
+
+static host_partition_t partitions[] = {
+#define HOST_PARTITION_ENTRY(label, type, subtype, offset, size) \
+    { { (type), (subtype), (offset), (size), FLASH_SECTOR_SIZE, label }, NULL },
+    HOST_PARTITIONS(HOST_PARTITION_ENTRY)
+#undef HOST_PARTITION_ENTRY
+};
+
+static pthread_mutex_t partition_lock = PTHREAD_MUTEX_INITIALIZER;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+    for (size_t i = 0; i < sizeof(partitions) / sizeof(partitions[0]); i++) {
+        host_partition_t *p = &partitions[i];
+        if (p->info.type != type ||
+            (subtype != ESP_PARTITION_SUBTYPE_ANY && p->info.subtype != subtype) ||
+            (label && strcmp(p->info.label, label) != 0)) {
+            continue;
+        }
+        pthread_mutex_lock(&partition_lock);
+        if (!p->data) {
+            // Новая флеш-память стерта
+            p->data = malloc(p->info.size);
+            if (p->data) {
+                memset(p->data, 0xFF, p->info.size);
+            }
+        }
+        pthread_mutex_unlock(&partition_lock);
+        return p->data ? &p->info : NULL;
+    }
+    return NULL;
+}
+
+// Раздел по адресу: вызывающий может передать копию esp_partition_t
+// с уменьшенным размером, как делает проверка журнала полетов
+static uint8_t *partition_data(const esp_partition_t *partition) {
+    for (size_t i = 0; i < sizeof(partitions) / sizeof(partitions[0]); i++) {
+        if (partitions[i].info.address == partition->address) {
+            return partitions[i].data;
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t partition_check(const esp_partition_t *partition, size_t offset, size_t size, uint8_t **data) {
+    if (!partition || offset > partition->size || size > partition->size - offset) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *data = partition_data(partition);
+    return *data ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+    uint8_t *data;
+    esp_err_t rc = partition_check(partition, src_offset, size, &data);
+    if (rc == ESP_OK) {
+        memcpy(dst, data + src_offset, size);
+    }
+    return rc;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size) {
+    uint8_t *data;
+    esp_err_t rc = partition_check(partition, dst_offset, size, &data);
+    if (rc != ESP_OK) {
+        return rc;
+    }
+    // Запись в NOR-флеш может только сбросить биты
+    const uint8_t *bytes = src;
+    for (size_t i = 0; i < size; i++) {
+        data[dst_offset + i] &= bytes[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+    if (offset % FLASH_SECTOR_SIZE || size % FLASH_SECTOR_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t *data;
+    esp_err_t rc = partition_check(partition, offset, size, &data);
+    if (rc == ESP_OK) {
+        memset(data + offset, 0xFF, size);
+    }
+    return rc;
+}
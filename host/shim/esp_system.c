@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+
+#define LOG_TAG_OVERRIDES 16
+
+static int64_t start_us = -1;
+
+static int64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+__attribute__((constructor))
+static void esp_system_start(void) {
+    start_us = monotonic_us();
+}
+
+int64_t esp_timer_get_time(void) {
+    return monotonic_us() - start_us;
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:                  return "ESP_OK";
+        case ESP_FAIL:                return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:          return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:     return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:   return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:    return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:       return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:   return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:         return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_ESPNOW_NO_MEM:   return "ESP_ERR_ESPNOW_NO_MEM";
+        case ESP_ERR_ESPNOW_FULL:     return "ESP_ERR_ESPNOW_FULL";
+        case ESP_ERR_ESPNOW_NOT_FOUND: return "ESP_ERR_ESPNOW_NOT_FOUND";
+        case ESP_ERR_ESPNOW_EXIST:    return "ESP_ERR_ESPNOW_EXIST";
+        default:                      return "UNKNOWN ERROR";
+    }
+}
+
+void esp_error_check_failed(esp_err_t rc, const char *file, int line, const char *expr) {
+    fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\nexpression: %s\n",
+            rc, esp_err_to_name(rc), file, line, expr);
+    abort();
+}
+
+// Уровни лога по тегам, заданные esp_log_level_set
+static struct {
+    const char *tag;
+    esp_log_level_t level;
+} log_overrides[LOG_TAG_OVERRIDES];
+static int log_override_count = 0;
+static esp_log_level_t log_default_level = CONFIG_LOG_DEFAULT_LEVEL;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    pthread_mutex_lock(&log_lock);
+    if (strcmp(tag, "*") == 0) {
+        log_default_level = level;
+        log_override_count = 0;
+    } else {
+        int i = 0;
+        while (i < log_override_count && strcmp(log_overrides[i].tag, tag) != 0) {
+            i++;
+        }
+        if (i < LOG_TAG_OVERRIDES) {
+            log_overrides[i].tag = tag;
+            log_overrides[i].level = level;
+            if (i == log_override_count) {
+                log_override_count++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&log_lock);
+}
+
+static esp_log_level_t log_level_for(const char *tag) {
+    for (int i = 0; i < log_override_count; i++) {
+        if (strcmp(log_overrides[i].tag, tag) == 0) {
+            return log_overrides[i].level;
+        }
+    }
+    return log_default_level;
+}
+
+uint32_t esp_log_timestamp(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char letters[] = "NEWIDV";
+
+    pthread_mutex_lock(&log_lock);
+    if (level > log_level_for(tag)) {
+        pthread_mutex_unlock(&log_lock);
+        return;
+    }
+    // Строки выводятся целиком, даже если пишут несколько задач
+    printf("%c (%u) %s: ", letters[level], (unsigned)esp_log_timestamp(), tag);
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    putchar('\n');
+    fflush(stdout);
+    pthread_mutex_unlock(&log_lock);
+}
+
+// Детерминированный генератор (xorshift32), чтобы запуски на хосте повторялись
+static uint32_t random_state = 0x2545F491;
+static pthread_mutex_t random_lock = PTHREAD_MUTEX_INITIALIZER;
+
+uint32_t esp_random(void) {
+    pthread_mutex_lock(&random_lock);
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    uint32_t value = random_state;
+    pthread_mutex_unlock(&random_lock);
+    return value;
+}
+
+void esp_fill_random(void *buf, size_t len) {
+    uint8_t *out = buf;
+    for (size_t i = 0; i < len; i++) {
+        out[i] = (uint8_t)esp_random();
+    }
+}
+
+// Таймеры esp_timer: список активных таймеров обслуживает один поток,
+// поэтому обратные вызовы, как и в ESP-IDF, выполняются последовательно
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    int64_t alarm_us;
+    uint64_t period_us;
+    bool active;
+    struct esp_timer *next;
+};
+
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond;
+static pthread_once_t timer_once = PTHREAD_ONCE_INIT;
+static struct esp_timer *timers = NULL;
+
+static void *timer_thread(void *arg) {
+    pthread_mutex_lock(&timer_lock);
+    while (1) {
+        struct esp_timer *due = NULL;
+        for (struct esp_timer *t = timers; t; t = t->next) {
+            if (t->active && (!due || t->alarm_us < due->alarm_us)) {
+                due = t;
+            }
+        }
+        int64_t now = esp_timer_get_time();
+        if (!due) {
+            pthread_cond_wait(&timer_cond, &timer_lock);
+            continue;
+        }
+        if (due->alarm_us > now) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            int64_t ns = deadline.tv_nsec + (due->alarm_us - now) * 1000;
+            deadline.tv_sec += (time_t)(ns / 1000000000);
+            deadline.tv_nsec = (long)(ns % 1000000000);
+            pthread_cond_timedwait(&timer_cond, &timer_lock, &deadline);
+            continue;
+        }
+        if (due->period_us) {
+            due->alarm_us += (int64_t)due->period_us;
+            if (due->alarm_us < now) {
+                due->alarm_us = now;
+            }
+        } else {
+            due->active = false;
+        }
+        esp_timer_cb_t callback = due->callback;
+        void *cb_arg = due->arg;
+        pthread_mutex_unlock(&timer_lock);
+        callback(cb_arg);
+        pthread_mutex_lock(&timer_lock);
+    }
+    return NULL;
+}
+
+static void timer_service_start(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, timer_thread, NULL);
+    pthread_detach(thread);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle) {
+    if (!args || !args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_once(&timer_once, timer_service_start);
+
+    struct esp_timer *timer = calloc(1, sizeof(*timer));
+    if (!timer) {
+        return ESP_ERR_NO_MEM;
+    }
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->name = args->name;
+
+    pthread_mutex_lock(&timer_lock);
+    timer->next = timers;
+    timers = timer;
+    pthread_mutex_unlock(&timer_lock);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t timer_start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us) {
+    pthread_mutex_lock(&timer_lock);
+    if (timer->active) {
+        pthread_mutex_unlock(&timer_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->alarm_us = esp_timer_get_time() + (int64_t)timeout_us;
+    timer->period_us = period_us;
+    timer->active = true;
+    pthread_cond_signal(&timer_cond);
+    pthread_mutex_unlock(&timer_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    return timer_start(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    pthread_mutex_lock(&timer_lock);
+    esp_err_t rc = timer->active ? ESP_OK : ESP_ERR_INVALID_STATE;
+    timer->active = false;
+    pthread_mutex_unlock(&timer_lock);
+    return rc;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    pthread_mutex_lock(&timer_lock);
+    if (timer->active) {
+        pthread_mutex_unlock(&timer_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    struct esp_timer **link = &timers;
+    while (*link && *link != timer) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = timer->next;
+    }
+    pthread_mutex_unlock(&timer_lock);
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    pthread_mutex_lock(&timer_lock);
+    bool active = timer->active;
+    pthread_mutex_unlock(&timer_lock);
+    return active;
+}
@@ -0,0 +1,469 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_cpu.h"
+
+// Блок управления задачей: поток и счетчик уведомлений
+struct tskTaskControlBlock {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    char name[16];
+    UBaseType_t prio;
+    int core;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify_value;
+    struct tskTaskControlBlock *next;
+};
+
+// Очередь (и семафор при item_size == 0) фиксированной длины
+struct QueueDefinition {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint8_t *storage;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+static pthread_mutex_t tasks_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct tskTaskControlBlock *tasks = NULL;
+static pthread_key_t current_key;
+static pthread_once_t current_once = PTHREAD_ONCE_INIT;
+
+static pthread_mutex_t critical_lock;
+static pthread_once_t critical_once = PTHREAD_ONCE_INIT;
+
+static int64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Абсолютный срок ожидания для pthread_cond_timedwait (условные переменные
+// создаются с часами CLOCK_MONOTONIC)
+static struct timespec deadline_after(TickType_t ticks) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t)ticks * (1000000000ULL / configTICK_RATE_HZ);
+    ts.tv_sec += (time_t)(ns / 1000000000ULL);
+    ts.tv_nsec += (long)(ns % 1000000000ULL);
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static void cond_init(pthread_cond_t *cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Ждет сигнала не дольше deadline. Возвращает false по истечении срока
+static bool cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks, const struct timespec *deadline) {
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+static void current_key_init(void) {
+    pthread_key_create(&current_key, NULL);
+}
+
+static struct tskTaskControlBlock *task_alloc(TaskFunction_t fn, const char *name, void *arg,
+                                              UBaseType_t prio, int core) {
+    struct tskTaskControlBlock *task = calloc(1, sizeof(*task));
+    if (!task) {
+        return NULL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    task->prio = prio;
+    task->core = core == tskNO_AFFINITY ? 0 : core;
+    strncpy(task->name, name ? name : "", sizeof(task->name) - 1);
+    pthread_mutex_init(&task->lock, NULL);
+    cond_init(&task->cond);
+
+    pthread_mutex_lock(&tasks_lock);
+    task->next = tasks;
+    tasks = task;
+    pthread_mutex_unlock(&tasks_lock);
+    return task;
+}
+
+static void *task_entry(void *arg) {
+    struct tskTaskControlBlock *task = arg;
+    pthread_setspecific(current_key, task);
+    task->fn(task->arg);
+    return NULL;
+}
+
+static TaskHandle_t task_start(TaskFunction_t fn, const char *name, void *arg, UBaseType_t prio, int core) {
+    pthread_once(&current_once, current_key_init);
+    struct tskTaskControlBlock *task = task_alloc(fn, name, arg, prio, core);
+    if (!task) {
+        return NULL;
+    }
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&task->thread, &attr, task_entry, task);
+    pthread_attr_destroy(&attr);
+    return rc == 0 ? task : NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *handle, BaseType_t core) {
+    TaskHandle_t task = task_start(fn, name, arg, prio, core);
+    if (handle) {
+        *handle = task;
+    }
+    return task ? pdPASS : pdFAIL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t prio, TaskHandle_t *handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, prio, handle, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                           UBaseType_t prio, StackType_t *stack, StaticTask_t *tcb,
+                                           BaseType_t core) {
+    return task_start(fn, name, arg, prio, core);
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                               UBaseType_t prio, StackType_t *stack, StaticTask_t *tcb) {
+    return task_start(fn, name, arg, prio, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    pthread_once(&current_once, current_key_init);
+    struct tskTaskControlBlock *task = pthread_getspecific(current_key);
+    if (!task) {
+        // Поток, созданный не через FreeRTOS (main): блок создается при первом обращении
+        task = task_alloc(NULL, "main", NULL, 1, 0);
+        task->thread = pthread_self();
+        pthread_setspecific(current_key, task);
+    }
+    return task;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    // Блок управления остается в списке: на него могут ссылаться другие задачи
+    if (!task || task == xTaskGetCurrentTaskHandle()) {
+        pthread_exit(NULL);
+    }
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(monotonic_us() / (1000000 / configTICK_RATE_HZ));
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        sched_yield();
+        return;
+    }
+    struct timespec deadline = deadline_after(ticks);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+    }
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t increment) {
+    *previous_wake += increment;
+    TickType_t left = *previous_wake - xTaskGetTickCount();
+    if ((int32_t)left > 0) {
+        vTaskDelay(left);
+    }
+}
+
+TaskHandle_t xTaskGetHandle(const char *name) {
+    pthread_mutex_lock(&tasks_lock);
+    struct tskTaskControlBlock *task = tasks;
+    while (task && strcmp(task->name, name) != 0) {
+        task = task->next;
+    }
+    pthread_mutex_unlock(&tasks_lock);
+    return task;
+}
+
+void vTaskGetInfo(TaskHandle_t task, TaskStatus_t *status, BaseType_t get_free_stack, eTaskState state) {
+    memset(status, 0, sizeof(*status));
+    status->xHandle = task;
+    status->pcTaskName = task->name;
+    status->eCurrentState = eRunning;
+    status->uxCurrentPriority = task->prio;
+    status->uxBasePriority = task->prio;
+    status->xCoreID = task->core;
+    // Время выполнения по задачам на хосте не учитывается
+    status->ulRunTimeCounter = 0;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return 0;
+}
+
+int esp_cpu_get_core_id(void) {
+    pthread_once(&current_once, current_key_init);
+    struct tskTaskControlBlock *task = pthread_getspecific(current_key);
+    return task ? task->core % portNUM_PROCESSORS : 0;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    pthread_mutex_lock(&task->lock);
+    switch (action) {
+        case eSetBits:
+            task->notify_value |= value;
+            break;
+        case eIncrement:
+            task->notify_value++;
+            break;
+        case eSetValueWithOverwrite:
+            task->notify_value = value;
+            break;
+        default:
+            break;
+    }
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_prio_woken) {
+    xTaskNotify(task, 0, eIncrement);
+    if (higher_prio_woken) {
+        *higher_prio_woken = pdFALSE;
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    struct tskTaskControlBlock *task = xTaskGetCurrentTaskHandle();
+    struct timespec deadline = deadline_after(ticks_to_wait);
+
+    pthread_mutex_lock(&task->lock);
+    while (task->notify_value == 0 && ticks_to_wait != 0) {
+        if (!cond_wait(&task->cond, &task->lock, ticks_to_wait, &deadline)) {
+            break;
+        }
+    }
+    uint32_t value = task->notify_value;
+    if (value) {
+        task->notify_value = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+void vTaskSetTimeOutState(TimeOut_t *timeout) {
+    timeout->start = xTaskGetTickCount();
+}
+
+BaseType_t xTaskCheckForTimeOut(TimeOut_t *timeout, TickType_t *ticks_to_wait) {
+    if (*ticks_to_wait == portMAX_DELAY) {
+        return pdFALSE;
+    }
+    TickType_t now = xTaskGetTickCount();
+    TickType_t elapsed = now - timeout->start;
+    if (elapsed >= *ticks_to_wait) {
+        *ticks_to_wait = 0;
+        return pdTRUE;
+    }
+    *ticks_to_wait -= elapsed;
+    timeout->start = now;
+    return pdFALSE;
+}
+
+static void critical_init(void) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&critical_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux) {
+    pthread_once(&critical_once, critical_init);
+    pthread_mutex_lock(&critical_lock);
+    mux->count++;
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) {
+    mux->count--;
+    pthread_mutex_unlock(&critical_lock);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    struct QueueDefinition *queue = calloc(1, sizeof(*queue));
+    if (!queue) {
+        return NULL;
+    }
+    if (item_size > 0) {
+        queue->storage = calloc(length, item_size);
+        if (!queue->storage) {
+            free(queue);
+            return NULL;
+        }
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    pthread_mutex_init(&queue->lock, NULL);
+    cond_init(&queue->not_empty);
+    cond_init(&queue->not_full);
+    return queue;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage,
+                                 StaticQueue_t *queue_buffer) {
+    return xQueueCreate(length, item_size);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if (!queue) {
+        return;
+    }
+    free(queue->storage);
+    free(queue);
+}
+
+static BaseType_t queue_put(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait, bool front) {
+    struct timespec deadline = deadline_after(ticks_to_wait);
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->length) {
+        if (ticks_to_wait == 0 || !cond_wait(&queue->not_full, &queue->lock, ticks_to_wait, &deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFALSE;
+        }
+    }
+    if (item && queue->item_size > 0) {
+        UBaseType_t index;
+        if (front) {
+            queue->head = (queue->head + queue->length - 1) % queue->length;
+            index = queue->head;
+        } else {
+            index = (queue->head + queue->count) % queue->length;
+        }
+        memcpy(queue->storage + (size_t)index * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+    return queue_put(queue, item, ticks_to_wait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+    return queue_put(queue, item, ticks_to_wait, true);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higher_prio_woken) {
+    if (higher_prio_woken) {
+        *higher_prio_woken = pdFALSE;
+    }
+    return queue_put(queue, item, 0, false);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait) {
+    struct timespec deadline = deadline_after(ticks_to_wait);
+
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0) {
+        if (ticks_to_wait == 0 || !cond_wait(&queue->not_empty, &queue->lock, ticks_to_wait, &deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFALSE;
+        }
+    }
+    if (item && queue->item_size > 0) {
+        memcpy(item, queue->storage + (size_t)queue->head * queue->item_size, queue->item_size);
+        queue->head = (queue->head + 1) % queue->length;
+    }
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->head = 0;
+    queue->count = 0;
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t spaces = queue->length - queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return spaces;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    SemaphoreHandle_t sem = xQueueCreate(max_count, 0);
+    if (sem) {
+        sem->count = initial_count;
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    // Наследование приоритета на хосте не нужно: мьютекс - двоичный семафор
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer) {
+    return xSemaphoreCreateMutex();
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer) {
+    return xSemaphoreCreateBinary();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait) {
+    return xQueueReceive(sem, NULL, ticks_to_wait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    return xQueueSend(sem, NULL, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *higher_prio_woken) {
+    return xQueueSendFromISR(sem, NULL, higher_prio_woken);
+}
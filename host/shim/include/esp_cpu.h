@@ -0,0 +1,13 @@
+#ifndef ESP_CPU_H
+#define ESP_CPU_H
+
+#include <stdint.h>
+
+/**
+ * Номер ядра для счетчиков по ядрам. На хосте задачи не закреплены за
+ * ядрами, поэтому номер берется из xTaskCreatePinnedToCore при создании
+ * задачи (0 для потоков, созданных не через FreeRTOS)
+ */
+int esp_cpu_get_core_id(void);
+
+#endif /* ESP_CPU_H */
@@ -0,0 +1,52 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+
+// Подмножество API FreeRTOS для хостовой сборки: задачи - потоки pthread,
+// очереди и семафоры - на мьютексе и условной переменной (host/shim/freertos.c)
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint8_t StackType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+
+#define portMAX_DELAY       ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ  CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS  ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000U))
+#define tskNO_AFFINITY      0x7fffffff
+#define portNUM_PROCESSORS  2
+#define configMAX_PRIORITIES 25
+
+// Все критические секции хоста защищены одним рекурсивным мьютексом
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)     vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)      vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)  vPortExitCritical(mux)
+#define portYIELD_FROM_ISR(woken)   ((void)(woken))
+
+// Статические буферы принимаются для совместимости, объекты хоста
+// выделяются в куче
+typedef struct { uint8_t reserved[16]; } StaticTask_t;
+typedef struct { uint8_t reserved[16]; } StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+
+#endif /* FREERTOS_H */
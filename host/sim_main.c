@@ -0,0 +1,9 @@
+#include <stdbool.h>
+#include "loopback_sim.h"
+
+// Модель нескольких мостов с общим эфиром (loopback_sim.c): строки "SIM {...}"
+// по сценариям, код завершения 0 - все сценарии доставили данные без
+// поврежденных кадров
+int main(void) {
+    return loopback_sim_run_suite() ? 0 : 1;
+}
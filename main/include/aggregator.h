@@ -0,0 +1,61 @@
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Формат контейнера: [MAGIC][COUNT] затем COUNT записей [LEN][DATA]
+#define AGGREGATOR_MAGIC        0xA6
+#define AGGREGATOR_HEADER_SIZE  2
+
+// Максимальный размер контейнера (MTU ESP-NOW)
+#define AGGREGATOR_MAX_SIZE     250
+
+// Максимальный размер одного кадра в контейнере
+#define AGGREGATOR_MAX_FRAME    (AGGREGATOR_MAX_SIZE - AGGREGATOR_HEADER_SIZE - 1)
+
+// Контейнер, в который упаковываются несколько кадров
+typedef struct {
+    uint8_t buf[AGGREGATOR_MAX_SIZE];
+    size_t len;                 // Заполнено байт, включая заголовок
+    uint8_t count;              // Кадров в контейнере
+    size_t last_frame_len;      // Размер последнего добавленного кадра
+} aggregator_t;
+
+// Обработчик кадра, извлеченного из контейнера
+typedef void (*aggregator_frame_cb_t)(const uint8_t *frame, size_t len, void *user_ctx);
+
+/**
+ * Очищает контейнер
+ */
+void aggregator_reset(aggregator_t *agg);
+
+/**
+ * Проверяет, поместится ли кадр длины len в контейнер
+ */
+bool aggregator_fits(const aggregator_t *agg, size_t len);
+
+/**
+ * Добавляет кадр в контейнер. Возвращает false, если кадр не помещается
+ */
+bool aggregator_add(aggregator_t *agg, const uint8_t *frame, size_t len);
+
+/**
+ * Проверяет, стоит ли отправить контейнер сейчас: следующий кадр
+ * такого же размера, как последний, в него уже не поместится
+ */
+bool aggregator_should_flush(const aggregator_t *agg);
+
+/**
+ * Проверяет, является ли пакет контейнером
+ */
+bool aggregator_is_container(const uint8_t *data, size_t len);
+
+/**
+ * Извлекает кадры из контейнера и вызывает cb для каждого.
+ * Возвращает количество кадров или -1, если контейнер поврежден
+ */
+int aggregator_unpack(const uint8_t *data, size_t len, aggregator_frame_cb_t cb, void *user_ctx);
+
+#endif /* AGGREGATOR_H */
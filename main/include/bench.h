@@ -0,0 +1,22 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+
+/**
+ * Выполняет замеры производительности и фаззинг-проверки кодеков и разборщика
+ * кадров (только в сборке TEST_BUILD). Результаты выводятся в лог строками
+ * "BENCH {...}" и "FUZZ {...}" в формате JSON.
+ * Возвращает true, если нарушений инвариантов не обнаружено
+ */
+bool bench_run_all(void);
+
+/**
+ * Выполняет замеры и фаззинг-проверки одной группы (модуля): "codecs",
+ * "parser", "aggregator", "tx_sched", "peer_table", "fleet", "fragment",
+ * "flightrec", "timesync", "rate_ctrl", "metrics"; NULL - все группы.
+ * Возвращает false при нарушениях или неизвестной группе
+ */
+bool bench_run(const char *group);
+
+#endif /* BENCH_H */
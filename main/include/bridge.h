@@ -0,0 +1,225 @@
+#ifndef BRIDGE_H
+#define BRIDGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "transport.h"
+#include "aggregator.h"
+#include "drone_compact.h"
+#include "reliable.h"
+#include "fragment.h"
+#include "timesync.h"
+#include "rate_ctrl.h"
+#include "fleet_table.h"
+#include "flightrec.h"
+#include "latency_hist.h"
+#include "peer_table.h"
+
+// Путь данных моста между UART и каналом передачи. В эфир: классификация,
+// прореживание телеметрии, компактный формат, формат типа, метки времени,
+// фрагментация, доставка с подтверждением, агрегация и очередь передачи.
+// Из эфира: синхронизация часов, подтверждения, сборка фрагментов,
+// распаковка контейнеров и восстановление полного формата для UART.
+// Мост не создает задач и таймеров: прошивка вызывает его из задач
+// конвейера и таймеров, модель loopback_sim и хостовый узел - из своих
+// циклов событий с тем же каналом передачи через transport_t
+
+// Параметры моста. Значения по умолчанию - из menuconfig
+typedef struct {
+    bool aggregation;                  // Агрегация кадров в контейнеры
+    uint32_t aggregation_deadline_us;  // Срок ожидания неполного контейнера
+    bool compact;                      // Компактный формат телеметрии
+    uint16_t keyframe_interval;        // Период ключевых кадров компактного формата
+    bool typed;                        // Команды и тревоги в формате своего типа
+    bool reliable;                     // Команды и тревоги с подтверждением
+    reliable_config_t reliable_config;
+    bool fragment;                     // Фрагментация кадров длиннее MTU
+    fragment_slot_t *fragment_slots;   // Слоты сборки, выделяет вызывающий (NULL - только отправка)
+    uint8_t fragment_slot_count;
+    int64_t fragment_timeout_us;
+    bool timesync;                     // Синхронизация часов с эталоном
+    bool timesync_reference;           // Узел - эталон времени
+    int64_t timesync_holdover_us;      // Синхронизация теряется без ответов дольше этого
+    uint32_t stamp_every;              // Метка времени на каждом N-м сообщении (0 - без меток)
+    bool rate_ctrl;                    // Предел частоты телеметрии по качеству канала
+    rate_ctrl_config_t rate_ctrl_config;
+    fleet_table_t *fleet;              // Таблица состояния дронов (NULL - телеметрия в UART)
+} bridge_config_t;
+
+// Состояние приема от одного отправителя. Только прием
+typedef struct {
+    reliable_rx_t reliable;            // Прием с подтверждением
+    drone_compact_decoder_t compact;   // Ключевой кадр телеметрии отправителя
+    int64_t last_rx_us;                // Последний пакет, для вытеснения давно молчащих
+} bridge_peer_t;
+
+// Связь моста с узлом: часы, UART и журнал полета
+typedef struct {
+    /**
+     * Время узла, мкс (прошивка - esp_timer_get_time)
+     */
+    int64_t (*now)(void *ctx);
+
+    /**
+     * Выдает кадр полетному контроллеру. Возвращает < 0 при ошибке
+     */
+    int (*uart_send)(const uint8_t *frame, size_t len, void *ctx);
+
+    /**
+     * Запускает таймер срока контейнера: по его истечении вызывается
+     * bridge_aggregate_deadline. 0 - остановить таймер
+     */
+    void (*aggregate_timer)(uint32_t delay_us, void *ctx);
+
+    /**
+     * Запускает таймер срока придержанной телеметрии: по его истечении
+     * вызывается bridge_telemetry_deadline. 0 - остановить таймер
+     */
+    void (*telemetry_timer)(uint32_t delay_us, void *ctx);
+
+    /**
+     * Запрос чтения журнала полета. src_mac - отправитель запроса по
+     * радиоканалу, NULL - запрос из UART. NULL - журнала нет, запросы
+     * передаются как обычные кадры
+     */
+    void (*flightrec_request)(const flightrec_request_t *req, const uint8_t *src_mac, void *ctx);
+
+    void *ctx;
+} bridge_hooks_t;
+
+// Счетчики моста
+typedef struct {
+    uint32_t tx_queued;                // Пакетов поставлено в очередь передачи
+    uint32_t tx_dropped;               // Пакетов не принято очередью или вытеснено
+    uint32_t decimated;                // Сообщений телеметрии заменено более новыми до срока предела частоты
+    uint32_t uart_frames;              // Кадров выдано в UART
+    uint32_t decode_errors;            // Отброшено контейнеров, фрагментов и кадров сжатых форматов
+    latency_hist_t one_way_us;         // По меткам времени: прием по UART отправителя -> прием пакета
+} bridge_stats_t;
+
+typedef struct {
+    bridge_config_t config;
+    const transport_t *transport;
+    transport_dest_t route;            // Получатель кадров, принятых по UART
+    bridge_hooks_t hooks;
+    bridge_stats_t stats;
+
+    // Контейнер, в котором кадры ждут отправки одним пакетом
+    aggregator_t aggregator;
+    bool aggregator_urgent;
+    StaticSemaphore_t aggregator_mutex_buf;
+    SemaphoreHandle_t aggregator_mutex;
+
+    // Кодер используется только стадией пересылки. Декодеры - у каждого
+    // отправителя в peer_state
+    drone_compact_encoder_t compact_encoder;
+
+    // Передача с подтверждением получателю кадров. Доступ из стадии
+    // пересылки, приема подтверждений и таймера повторов под мьютексом
+    reliable_link_t link;
+    StaticSemaphore_t link_mutex_buf;
+    SemaphoreHandle_t link_mutex;
+
+    // Отправители по MAC: запись peer_state[i] относится к peers.entries[i].
+    // Только прием
+    peer_table_t peers;
+    bridge_peer_t peer_state[PEER_TABLE_CAPACITY];
+
+    // Нумерация фрагментов - только стадия пересылки, сборка - только прием
+    fragment_tx_t tx_fragments;
+    fragment_rx_t rx_fragments;
+    uint32_t rx_fragments_reported_lost;
+
+    // Общее время узлов. Доступ из стадий пересылки и приема, задачи метрик
+    // и таймера запросов под мьютексом
+    timesync_t clock_sync;
+    StaticSemaphore_t clock_sync_mutex_buf;
+    SemaphoreHandle_t clock_sync_mutex;
+    uint32_t stamp_countdown;          // Сообщений с последней метки, только стадия пересылки
+
+    // Предел частоты телеметрии. Доступ только из стадии пересылки;
+    // задача метрик читает предел и долю доставки атомарно
+    rate_ctrl_t telemetry_rate;
+    // Сообщение, придержанное до срока telemetry_rate.next_us, и время его
+    // приема по UART
+    uint8_t telemetry_held[DRONE_MSG_PACKET_SIZE];
+    int64_t telemetry_held_time;
+
+    // Пакет, кадры которого выдаются в UART, и его отправитель. Только прием
+    const uint8_t *rx_mac;
+    bridge_peer_t *rx_peer;
+    int64_t rx_packet_time;
+} bridge_t;
+
+/**
+ * Заполняет параметры значениями из menuconfig (без слотов сборки и
+ * таблицы дронов)
+ */
+void bridge_default_config(bridge_config_t *config);
+
+/**
+ * Инициализирует мост с каналом transport и получателем кадров route
+ */
+void bridge_init(bridge_t *bridge, const bridge_config_t *config, const transport_t *transport,
+                 const transport_dest_t *route, const bridge_hooks_t *hooks);
+
+/**
+ * Передает в эфир кадр, принятый по UART в rx_time (часы узла, мкс).
+ * Вызывается одной задачей - стадией пересылки
+ */
+void bridge_forward(bridge_t *bridge, const uint8_t *frame, size_t len, int64_t rx_time);
+
+/**
+ * Ставит готовый пакет в очередь передачи его класса. Тревоги и команды
+ * ждут места в очереди, телеметрию можно вытеснить более свежей
+ */
+void bridge_send(bridge_t *bridge, const uint8_t *packet, size_t len);
+
+/**
+ * Как bridge_send, но получатель пакета - dest (ответ отправителю запроса)
+ */
+void bridge_send_to(bridge_t *bridge, const transport_dest_t *dest, const uint8_t *packet, size_t len);
+
+/**
+ * Обрабатывает пакет, принятый из эфира: служебные кадры, сборку и
+ * распаковку, выдачу кадров в UART. Вызывается одной задачей - приемом
+ */
+void bridge_receive(bridge_t *bridge, const transport_packet_t *packet);
+
+/**
+ * Срок контейнера истек: отправляет неполный контейнер
+ */
+void bridge_aggregate_deadline(bridge_t *bridge);
+
+/**
+ * Срок предела частоты телеметрии истек: передает придержанное сообщение.
+ * Вызывается стадией пересылки
+ */
+void bridge_telemetry_deadline(bridge_t *bridge);
+
+/**
+ * Повторяет передачу неподтвержденных кадров. Вызывается периодически с
+ * шагом не больше половины минимального тайм-аута, в том числе из задачи
+ * таймеров: если канал занят другой задачей, вызов пропускается без ожидания
+ */
+void bridge_reliable_poll(bridge_t *bridge);
+
+/**
+ * Отправляет получателю кадров запрос синхронизации часов
+ */
+void bridge_clock_sync_ping(bridge_t *bridge);
+
+/**
+ * Общее время для времени узла local_us; false, если узел не синхронизирован
+ */
+bool bridge_clock_now(bridge_t *bridge, int64_t local_us, int64_t *shared_us);
+
+/**
+ * Уровень синхронизации и задержка обмена, по которому оценено смещение
+ */
+void bridge_clock_state(bridge_t *bridge, uint8_t *stratum, uint32_t *delay_us);
+
+#endif /* BRIDGE_H */
@@ -0,0 +1,60 @@
+#ifndef BRIDGE_TASKS_H
+#define BRIDGE_TASKS_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+// Ядра конвейера. Задача Wi-Fi работает на ядре 0, поэтому передача в
+// радиоканал остается рядом с ней, а прием и разбор UART вынесены на
+// другое ядро и не конкурируют со стеком Wi-Fi
+#if CONFIG_FREERTOS_UNICORE
+#define BRIDGE_UART_CORE  0
+#define BRIDGE_RADIO_CORE 0
+#else
+#define BRIDGE_UART_CORE  CONFIG_BRIDGE_UART_CORE
+#define BRIDGE_RADIO_CORE CONFIG_BRIDGE_RADIO_CORE
+#endif
+
+// Имена задач-стадий конвейера. По ним metrics_task находит задачи для
+// учета загрузки процессора, поэтому у обоих каналов передачи одно имя
+#define BRIDGE_TASK_UART_RX  "uart_rx"
+#define BRIDGE_TASK_FORWARD  "forward"
+#define BRIDGE_TASK_RADIO_TX "radio_tx"
+
+// Задачи моста: стек (байт), приоритет, ядро
+#define UART_RX_TASK_STACK     2560
+#define UART_RX_TASK_PRIO      7
+#define FORWARD_TASK_STACK     3072
+#define FORWARD_TASK_PRIO      5
+#define RADIO_TX_TASK_STACK    3072
+#define RADIO_TX_TASK_PRIO     6
+#define RADIO_RX_TASK_STACK    3072
+#define RADIO_RX_TASK_PRIO     6
+#define UART_TX_TASK_STACK     3072
+#define UART_TX_TASK_PRIO      5
+#define METRICS_TASK_STACK     2048
+#define METRICS_TASK_PRIO      2
+#define FLIGHTREC_TASK_STACK   3072
+#define FLIGHTREC_TASK_PRIO    3
+#define DLOG_TASK_STACK        3072
+#define DLOG_TASK_PRIO         1
+
+/**
+ * Создает задачу со статически выделенными стеком и блоком управления,
+ * закрепленную за ядром core. Память резервируется при компиляции в месте
+ * вызова, поэтому каждый вызов создает не больше одной задачи. handle
+ * может быть NULL
+ */
+#define BRIDGE_TASK_CREATE_STATIC(fn, name, stack_size, arg, prio, handle, core) do { \
+    static StackType_t fn##_stack[(stack_size) / sizeof(StackType_t)];                \
+    static StaticTask_t fn##_tcb;                                                       \
+    TaskHandle_t *fn##_handle_out = (handle);                                           \
+    TaskHandle_t fn##_handle = xTaskCreateStaticPinnedToCore((fn), (name), (stack_size), (arg), (prio), \
+                                                             fn##_stack, &fn##_tcb, (core)); \
+    if (fn##_handle_out) {                                                              \
+        *fn##_handle_out = fn##_handle;                                                 \
+    }                                                                                   \
+} while (0)
+
+#endif /* BRIDGE_TASKS_H */
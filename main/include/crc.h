@@ -0,0 +1,31 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Начальное значение CRC-16/CCITT-FALSE
+#define CRC16_CCITT_INIT 0xFFFF
+
+/**
+ * CRC-16/CCITT-FALSE (полином 0x1021, начальное значение 0xFFFF, без отражения).
+ * Контрольное значение для "123456789": 0x29B1
+ */
+uint16_t crc16_ccitt(const uint8_t *data, size_t len);
+
+/**
+ * Продолжает вычисление CRC-16/CCITT-FALSE для следующего фрагмента данных
+ */
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t *data, size_t len);
+
+/**
+ * CRC-32/IEEE 802.3 (как в zlib). Контрольное значение для "123456789": 0xCBF43926
+ */
+uint32_t crc32_ieee(const uint8_t *data, size_t len);
+
+/**
+ * Продолжает вычисление CRC-32 для следующего фрагмента (crc - результат предыдущего вызова)
+ */
+uint32_t crc32_ieee_update(uint32_t crc, const uint8_t *data, size_t len);
+
+#endif /* CRC_H */
@@ -0,0 +1,68 @@
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "dlog_events.h"
+
+// Уровни отложенного лога (совпадают с esp_log_level_t)
+#define DLOG_LEVEL_NONE  0
+#define DLOG_LEVEL_ERROR 1
+#define DLOG_LEVEL_WARN  2
+#define DLOG_LEVEL_INFO  3
+#define DLOG_LEVEL_DEBUG 4
+
+// Уровень, выше которого вызовы DLOGx удаляются при компиляции
+#define DLOG_LEVEL CONFIG_BRIDGE_DLOG_LEVEL
+
+// Максимальное количество аргументов в записи
+#define DLOG_MAX_ARGS 4
+
+typedef enum {
+#define DLOG_EVENT_ID(id, tag, fmt) id,
+    DLOG_EVENTS(DLOG_EVENT_ID)
+#undef DLOG_EVENT_ID
+    DLOG_EVENT_COUNT
+} dlog_event_t;
+
+// Состояние ограничителя частоты для одного места вызова
+typedef struct {
+    uint32_t window_start;     // Начало текущего окна (мс)
+    uint16_t count;            // Записей в текущем окне
+    uint16_t suppressed;       // Подавлено записей с момента последней выдачи
+} dlog_site_t;
+
+/**
+ * Инициализирует кольцевой буфер и запускает фоновую задачу вывода
+ */
+void dlog_init(void);
+
+/**
+ * Записывает событие в кольцевой буфер без форматирования и блокировок.
+ * Используйте макросы DLOGE/DLOGW/DLOGI/DLOGD
+ */
+void dlog_write(dlog_site_t *site, uint8_t level, dlog_event_t event, const uint32_t *args, int argc);
+
+/**
+ * Количество записей, потерянных из-за заполненного буфера
+ */
+uint32_t dlog_get_dropped(void);
+
+#define DLOG_AT(level, event, ...) do {                                          \
+        if ((level) <= DLOG_LEVEL) {                                             \
+            static dlog_site_t dlog_site_;                                       \
+            const uint32_t dlog_args_[] = { 0, ##__VA_ARGS__ };                  \
+            _Static_assert(sizeof(dlog_args_) / sizeof(dlog_args_[0]) - 1        \
+                           <= DLOG_MAX_ARGS, "Слишком много аргументов DLOG");  \
+            dlog_write(&dlog_site_, (level), (event), dlog_args_ + 1,            \
+                       sizeof(dlog_args_) / sizeof(dlog_args_[0]) - 1);          \
+        }                                                                        \
+    } while (0)
+
+#define DLOGE(event, ...) DLOG_AT(DLOG_LEVEL_ERROR, event, ##__VA_ARGS__)
+#define DLOGW(event, ...) DLOG_AT(DLOG_LEVEL_WARN, event, ##__VA_ARGS__)
+#define DLOGI(event, ...) DLOG_AT(DLOG_LEVEL_INFO, event, ##__VA_ARGS__)
+#define DLOGD(event, ...) DLOG_AT(DLOG_LEVEL_DEBUG, event, ##__VA_ARGS__)
+
+#endif /* DLOG_H */
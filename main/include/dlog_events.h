@@ -0,0 +1,38 @@
+#ifndef DLOG_EVENTS_H
+#define DLOG_EVENTS_H
+
+// Таблица событий отложенного лога: идентификатор, тег и строка формата.
+// Формат может содержать не более DLOG_MAX_ARGS целочисленных аргументов
+// (%d, %u, %x, %X) - они форматируются в фоновой задаче
+#define DLOG_EVENTS(X) \
+    X(DLOG_MSG_DECODED,        "DRONE_MSG",    "Сообщение декодировано: размер=%u, тип=%u, id=%u") \
+    X(DLOG_MSG_TOO_SHORT,      "DRONE_MSG",    "Буфер слишком мал для декодирования: %u < %u") \
+    X(DLOG_MSG_PARTIAL,        "DRONE_MSG",    "Размер буфера меньше ожидаемого: %u < %u, декодирование неполное") \
+    X(DLOG_MSG_CHECKSUM,       "DRONE_MSG",    "Ошибка контрольной суммы: получено 0x%04X, вычислено 0x%04X, размер %u") \
+    X(DLOG_MSG_CRC,            "DRONE_MSG",    "Ошибка CRC: получено 0x%04X, вычислено 0x%04X, сообщение отброшено") \
+    X(DLOG_MSG_BAD_VERSION,    "DRONE_MSG",    "Неподдерживаемая версия формата %u (максимум %u)") \
+    X(DLOG_MSG_LEGACY_REJECTED, "DRONE_MSG",   "Сообщение версии %u (%u байт) отклонено: прием версии 1 выключен") \
+    X(DLOG_MSG_DUMP,           "DRONE_MSG",    "Начало буфера: %08X %08X %08X %08X") \
+    X(DLOG_MSG_RECEIVED,       "DRONE_MSG",    "Принято сообщение: тип=%u, id=%u, время=%u мс") \
+    X(DLOG_UART_PARSER_OVF,    "UART_HANDLER", "Переполнение буфера данных, всего отброшено кадров: %u") \
+    X(DLOG_UART_OUT_TOO_SMALL, "UART_HANDLER", "Выходной буфер слишком мал: %u > %u") \
+    X(DLOG_UART_DRIVER_OVF,    "UART_HANDLER", "Переполнение буфера драйвера UART (событие %u), сброс приема") \
+    X(DLOG_UART_BAUD_FALLBACK, "UART_HANDLER", "Скорость %u не подтверждена, возврат к %u") \
+    X(DLOG_UART_BAUD_LOST,     "UART_HANDLER", "Ошибки кадра на скорости %u, возврат к %u") \
+    X(DLOG_UART_TX_FAILED,     "MAIN",         "Не удалось передать в UART %u байт") \
+    X(DLOG_ESPNOW_NO_ACK,      "ESPNOW",       "Нет подтверждения отправки за %u мс, сброс счетчика") \
+    X(DLOG_ESPNOW_SEND_ERROR,  "ESPNOW",       "esp_now_send error: 0x%x") \
+    X(DLOG_ESPNOW_TRUNCATED,   "ESPNOW",       "Передача превышает лимит ESP-NOW (%u > %u байт), данные усечены") \
+    X(DLOG_ESPNOW_BAD_CONTAINER, "MAIN",       "Поврежденный контейнер, %u байт") \
+    X(DLOG_AGGREGATE_ESCAPE_FAILED, "MAIN",    "Кадр %u байт с первым байтом служебного пакета не помещается в контейнер, отброшен") \
+    X(DLOG_FRAGMENT_INVALID,   "MAIN",         "Поврежденный фрагмент, %u байт") \
+    X(DLOG_COMPACT_DROPPED,    "MAIN",         "Компактный кадр отброшен (%u байт): ошибка CRC или нет ключевого кадра") \
+    X(DLOG_TYPED_DROPPED,      "MAIN",         "Кадр формата типа отброшен (%u байт): ошибка CRC") \
+    X(DLOG_ESPNOW_PEER_ADD_FAILED, "MAIN",     "Не удалось добавить узел: 0x%x") \
+    X(DLOG_RELIABLE_FOREIGN,   "MAIN",         "Подтверждение не от получателя кадров отброшено (%u байт)") \
+    X(DLOG_RELIABLE_OUT_OF_WINDOW, "MAIN",     "Кадр с подтверждением вне окна приема: номер %u, ожидался %u") \
+    X(DLOG_FLEET_FULL,         "MAIN",         "Таблица дронов заполнена (%u), телеметрия нового дрона отброшена") \
+    X(DLOG_MESH_SEND_ERROR,    "MESH",         "esp_mesh_send error: 0x%x") \
+    X(DLOG_MESH_RECV_ERROR,    "MESH",         "esp_mesh_recv error: 0x%x")
+
+#endif /* DLOG_EVENTS_H */
@@ -0,0 +1,114 @@
+#ifndef DRONE_COMPACT_H
+#define DRONE_COMPACT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "drone_message.h"
+
+// Версия компактного формата телеметрии (байт 1 кадра)
+#define DRONE_MSG_VERSION_COMPACT 3
+
+// Размеры компактного кадра
+#define DRONE_COMPACT_HEADER_SIZE 4    // msg_type, version, msg_id, флаги
+#define DRONE_COMPACT_MAX_SIZE    49   // Ключевой кадр со всеми группами полей
+
+// Флаги кадра
+#define DRONE_COMPACT_FLAG_DELTA    0x80   // Поля позиции заданы разностью с ключевым кадром
+#define DRONE_COMPACT_KEY_SEQ_MASK  0x7F   // Номер ключевого кадра
+
+// Группы полей (битовая карта присутствия)
+typedef enum {
+    DRONE_COMPACT_POSITION  = (1 << 0),    // Широта, долгота, высота
+    DRONE_COMPACT_REL_ALT   = (1 << 1),    // Относительная высота
+    DRONE_COMPACT_ATTITUDE  = (1 << 2),    // Крен, тангаж, рысканье
+    DRONE_COMPACT_VELOCITY  = (1 << 3),    // Скорости vx, vy, vz
+    DRONE_COMPACT_BATTERY   = (1 << 4),    // Заряд, напряжение, ток
+    DRONE_COMPACT_FLIGHT    = (1 << 5),    // Время полета
+    DRONE_COMPACT_STATUS    = (1 << 6),    // Флаги состояния
+    DRONE_COMPACT_SYSTEM    = (1 << 7)     // Загрузка CPU, RSSI, GPS
+} drone_compact_group_t;
+
+#define DRONE_COMPACT_ALL_GROUPS 0xFF
+
+// Поля телеметрии в фиксированной точке
+typedef struct {
+    int32_t latitude;          // 1e-7 градуса
+    int32_t longitude;         // 1e-7 градуса
+    int32_t altitude;          // см
+    int16_t relative_altitude; // дм
+    int16_t roll;              // 0.01 градуса
+    int16_t pitch;             // 0.01 градуса
+    int16_t yaw;               // 0.02 градуса
+    int16_t vx;                // см/с
+    int16_t vy;                // см/с
+    int16_t vz;                // см/с
+    uint8_t battery_percentage;
+    uint16_t battery_voltage;  // мВ
+    int16_t battery_current;   // 10 мА
+    uint16_t flight_time;      // с
+    uint16_t status_flags;
+    uint8_t cpu_load;
+    uint8_t rssi;
+    uint8_t gps;               // Спутники (биты 0-5) и тип фиксации (биты 6-7)
+} drone_compact_fields_t;
+
+// Состояние кодера (одно на поток телеметрии)
+typedef struct {
+    drone_compact_fields_t key;    // Последний ключевой кадр
+    uint32_t key_timestamp;        // Временная метка ключевого кадра (мс)
+    uint8_t key_seq;               // Номер ключевого кадра
+    uint16_t since_key;            // Разностных кадров после ключевого
+    uint16_t interval;             // Ключевой кадр не реже, чем раз в interval кадров
+    bool has_key;
+} drone_compact_encoder_t;
+
+// Состояние декодера (одно на поток телеметрии)
+typedef struct {
+    drone_compact_fields_t key;
+    uint32_t key_timestamp;
+    uint8_t key_seq;
+    bool has_key;
+    uint32_t missing_key;          // Разностных кадров отброшено без ключевого
+} drone_compact_decoder_t;
+
+/**
+ * Инициализирует кодер. interval - период ключевых кадров (1 - только ключевые)
+ */
+void drone_compact_encoder_init(drone_compact_encoder_t *enc, uint16_t interval);
+
+/**
+ * Следующий кадр будет ключевым (например, после смены получателя)
+ */
+void drone_compact_force_keyframe(drone_compact_encoder_t *enc);
+
+/**
+ * Сообщение источника не передано (прорежено). Период ключевых кадров
+ * считается в сообщениях источника и во времени от прореживания не зависит
+ */
+void drone_compact_skip(drone_compact_encoder_t *enc);
+
+/**
+ * Кодирует телеметрию в компактный формат.
+ * Возвращает длину кадра или -1 (не телеметрия либо мал буфер)
+ */
+int drone_compact_encode(drone_compact_encoder_t *enc, const drone_message_t *msg,
+                         uint8_t *buffer, int buf_size);
+
+/**
+ * Инициализирует декодер
+ */
+void drone_compact_decoder_init(drone_compact_decoder_t *dec);
+
+/**
+ * Проверяет, похож ли кадр на компактный (по версии и длине), без проверки CRC
+ */
+bool drone_compact_is_compact(const uint8_t *buffer, int len);
+
+/**
+ * Декодирует компактный кадр в полную структуру (version = DRONE_MSG_VERSION).
+ * Возвращает 0 или -1 (ошибка CRC, неверная длина, нет ключевого кадра)
+ */
+int drone_compact_decode(drone_compact_decoder_t *dec, const uint8_t *buffer, int len,
+                         drone_message_t *msg);
+
+#endif /* DRONE_COMPACT_H */
@@ -2,6 +2,7 @@
 #define DRONE_MESSAGE_H
 
 #include <stdint.h>
+#include "drone_schema.h"
 
 // Тип сообщения
 typedef enum {
@@ -24,53 +25,22 @@ typedef enum {
 } drone_status_flags_t;
 
 // Версия формата сообщения для контроля совместимости
-#define DRONE_MSG_VERSION 1
+#define DRONE_MSG_VERSION 2
 
-// Основная структура сообщения дрона
+// Версия 1: аддитивная контрольная сумма (поддерживается только при приеме)
+#define DRONE_MSG_VERSION_LEGACY 1
+
+// Смещение поля version в пакете
+#define DRONE_MSG_VERSION_OFFSET 63
+
+// Основная структура сообщения дрона: поля схемы DRONE_MSG_FIELDS
+// (drone_schema.h) и контрольная сумма
+#define DRONE_MSG_STRUCT_FIELD(name, type, def, min, max, label) DRONE_FIELD_TYPE_##type name;
 typedef struct {
-    uint8_t msg_type;                  // Тип сообщения
-    uint8_t msg_id;                    // ID сообщения для подтверждений
-    uint32_t timestamp;                // Временная метка (мс с момента включения)
-    
-    // Геолокация
-    float latitude;                    // Широта (градусы)
-    float longitude;                   // Долгота (градусы)
-    float altitude;                    // Высота (м)
-    float relative_altitude;           // Относительная высота от точки взлета (м)
-    
-    // Ориентация
-    float roll;                        // Крен (градусы)
-    float pitch;                       // Тангаж (градусы)
-    float yaw;                         // Рысканье (градусы)
-    
-    // Скорость
-    float vx;                          // Скорость по X (м/с)
-    float vy;                          // Скорость по Y (м/с)
-    float vz;                          // Скорость по Z (м/с)
-    
-    // Состояние батареи
-    uint8_t battery_percentage;        // Процент заряда батареи
-    float battery_voltage;             // Напряжение батареи (В)
-    float battery_current;             // Ток потребления (А)
-    
-    // Информация о полете
-    uint16_t flight_time;              // Время полета (с)
-    uint16_t status_flags;             // Флаги состояния дрона
-    
-    // Системная информация
-    uint8_t cpu_load;                  // Загрузка процессора (%)
-    uint8_t rssi;                      // Уровень сигнала (%)
-    
-    // Дополнительная информация
-    uint8_t satellites;                // Количество спутников GPS
-    uint8_t fix_type;                  // Тип фиксации GPS (0-нет, 1-2D, 2-3D)
-    
-    // Маркер версии формата
-    uint8_t version;                   // Версия формата сообщения
-    uint8_t reserved;                  // Зарезервировано для выравнивания
-
-    uint16_t checksum;                 // Контрольная сумма
+    DRONE_MSG_FIELDS(DRONE_MSG_STRUCT_FIELD)
+    uint16_t checksum;                 // Контрольная сумма (v1) или CRC-16 (v2)
 } __attribute__((packed)) drone_message_t;  // Для правильной упаковки
+#undef DRONE_MSG_STRUCT_FIELD
 
 // Фактический размер структуры
 #define EXPECTED_DRONE_MSG_SIZE 67
@@ -87,15 +57,29 @@ typedef struct {
 int drone_msg_encode(const drone_message_t *msg, uint8_t *buffer, int buf_size);
 
 /**
- * Декодирует бинарные данные в структуру сообщения
+ * Кодирует сообщение в формате указанной версии (DRONE_MSG_VERSION_LEGACY
+ * или DRONE_MSG_VERSION) для обмена с устройствами старого формата
+ */
+int drone_msg_encode_version(const drone_message_t *msg, uint8_t *buffer, int buf_size,
+                             uint8_t version);
+
+/**
+ * Декодирует бинарные данные в структуру сообщения.
+ * Способ проверки целостности выбирается по полю version: для версии 2
+ * требуется полный пакет и совпадение CRC-16, иначе возвращается -1
  */
 int drone_msg_decode(const uint8_t *buffer, int buf_size, drone_message_t *msg);
 
 /**
- * Вычисляет контрольную сумму сообщения
+ * Вычисляет контрольную сумму сообщения (версия 1)
  */
 uint16_t drone_msg_calculate_checksum(const uint8_t *buffer, int length);
 
+/**
+ * Вычисляет CRC-16/CCITT-FALSE сообщения (версия 2)
+ */
+uint16_t drone_msg_calculate_crc(const uint8_t *buffer, int length);
+
 /**
  * Инициализирует структуру сообщения дрона значениями по умолчанию
  */
@@ -0,0 +1,91 @@
+#ifndef DRONE_MSG_VIEW_H
+#define DRONE_MSG_VIEW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "drone_message.h"
+
+// Прямой доступ к полям сообщения в буфере пакета без копирования в
+// drone_message_t. Все многобайтные поля - little-endian независимо от
+// порядка байт процессора, кроме checksum (старший байт первым)
+
+// Смещение поля в пакете: упакованная структура совпадает с пакетом
+#define DRONE_MSG_OFF(field) offsetof(drone_message_t, field)
+
+#define DRONE_MSG_OFF_VERSION  DRONE_MSG_OFF(version)
+#define DRONE_MSG_OFF_RESERVED DRONE_MSG_OFF(reserved)
+#define DRONE_MSG_OFF_CHECKSUM DRONE_MSG_OFF(checksum)
+
+static inline uint16_t drone_msg_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t drone_msg_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline float drone_msg_lef(const uint8_t *p) {
+    uint32_t bits = drone_msg_le32(p);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline void drone_msg_put_le16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static inline void drone_msg_put_le32(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static inline void drone_msg_put_lef(uint8_t *p, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    drone_msg_put_le32(p, bits);
+}
+
+// Чтение и запись значения по типу поля схемы
+static inline uint8_t drone_field_get_U8(const uint8_t *p) { return p[0]; }
+static inline uint16_t drone_field_get_U16(const uint8_t *p) { return drone_msg_le16(p); }
+static inline uint32_t drone_field_get_U32(const uint8_t *p) { return drone_msg_le32(p); }
+static inline float drone_field_get_F32(const uint8_t *p) { return drone_msg_lef(p); }
+static inline void drone_field_put_U8(uint8_t *p, uint8_t v) { p[0] = v; }
+static inline void drone_field_put_U16(uint8_t *p, uint16_t v) { drone_msg_put_le16(p, v); }
+static inline void drone_field_put_U32(uint8_t *p, uint32_t v) { drone_msg_put_le32(p, v); }
+static inline void drone_field_put_F32(uint8_t *p, float v) { drone_msg_put_lef(p, v); }
+
+// Чтение и запись полей: drone_msg_get_<поле>() и drone_msg_set_<поле>()
+// для каждого поля схемы
+#define DRONE_MSG_ACCESSORS(name, type, def, min, max, label) \
+    static inline DRONE_FIELD_TYPE_##type drone_msg_get_##name(const uint8_t *b) { \
+        return drone_field_get_##type(b + DRONE_MSG_OFF(name)); \
+    } \
+    static inline void drone_msg_set_##name(uint8_t *b, DRONE_FIELD_TYPE_##type v) { \
+        drone_field_put_##type(b + DRONE_MSG_OFF(name), v); \
+    }
+DRONE_MSG_FIELDS(DRONE_MSG_ACCESSORS)
+#undef DRONE_MSG_ACCESSORS
+
+// Контрольная сумма - старшим байтом вперед
+static inline uint16_t drone_msg_get_checksum(const uint8_t *b) {
+    return (uint16_t)((b[DRONE_MSG_OFF_CHECKSUM] << 8) | b[DRONE_MSG_OFF_CHECKSUM + 1]);
+}
+static inline void drone_msg_set_checksum(uint8_t *b, uint16_t v) {
+    b[DRONE_MSG_OFF_CHECKSUM] = v >> 8;
+    b[DRONE_MSG_OFF_CHECKSUM + 1] = v & 0xFF;
+}
+
+/**
+ * Проверяет целостность пакета без декодирования: длину, версию и
+ * CRC-16 (версия 2) или контрольную сумму (версия 1).
+ * Возвращает версию формата или -1
+ */
+int drone_msg_verify(const uint8_t *buffer, int len);
+
+#endif /* DRONE_MSG_VIEW_H */
@@ -0,0 +1,79 @@
+#ifndef DRONE_SCHEMA_H
+#define DRONE_SCHEMA_H
+
+#include <stdint.h>
+#include <float.h>
+
+// Схема сообщения дрона. Из таблиц ниже строятся структура drone_message_t,
+// функции доступа к полям пакета (drone_msg_view.h), кодирование и
+// декодирование, значения по умолчанию, проверка диапазонов в журнале и
+// форматы команд, подтверждений и тревог (drone_typed.h). Новое поле
+// добавляется только здесь
+
+// Типы полей: в пакете little-endian, float - IEEE 754
+#define DRONE_FIELD_TYPE_U8  uint8_t
+#define DRONE_FIELD_TYPE_U16 uint16_t
+#define DRONE_FIELD_TYPE_U32 uint32_t
+#define DRONE_FIELD_TYPE_F32 float
+
+// Поля в порядке пакета, без контрольной суммы:
+// X(имя, тип, значение по умолчанию, минимум, максимум, подпись в журнале).
+// Значение вне диапазона журнал отмечает как поврежденное
+#define DRONE_MSG_FIELDS(X) \
+    X(msg_type,           U8,  MSG_TYPE_TELEMETRY, 1, 4, "Тип") \
+    X(msg_id,             U8,  0, 0, UINT8_MAX, "ID") \
+    X(timestamp,          U32, 0, 0, UINT32_MAX, "Время, мс") \
+    X(latitude,           F32, 0, -90, 90, "Широта, градусы") \
+    X(longitude,          F32, 0, -180, 180, "Долгота, градусы") \
+    X(altitude,           F32, 0, -1000, 10000, "Высота, м") \
+    X(relative_altitude,  F32, 0, -FLT_MAX, FLT_MAX, "Относительная высота, м") \
+    X(roll,               F32, 0, -180, 180, "Крен, градусы") \
+    X(pitch,              F32, 0, -90, 90, "Тангаж, градусы") \
+    X(yaw,                F32, 0, -360, 360, "Рысканье, градусы") \
+    X(vx,                 F32, 0, -100, 100, "Скорость X, м/с") \
+    X(vy,                 F32, 0, -100, 100, "Скорость Y, м/с") \
+    X(vz,                 F32, 0, -50, 50, "Скорость Z, м/с") \
+    X(battery_percentage, U8,  100, 0, 100, "Заряд батареи, %") \
+    X(battery_voltage,    F32, 12.6f, -FLT_MAX, FLT_MAX, "Напряжение батареи, В") \
+    X(battery_current,    F32, 0, -FLT_MAX, FLT_MAX, "Ток потребления, А") \
+    X(flight_time,        U16, 0, 0, UINT16_MAX, "Время полета, с") \
+    X(status_flags,       U16, 0, 0, UINT16_MAX, "Флаги состояния") \
+    X(cpu_load,           U8,  0, 0, 100, "Загрузка процессора, %") \
+    X(rssi,               U8,  99, 0, 100, "Уровень сигнала, %") \
+    X(satellites,         U8,  0, 0, UINT8_MAX, "Спутников GPS") \
+    X(fix_type,           U8,  0, 0, 2, "Тип фиксации GPS") \
+    X(version,            U8,  DRONE_MSG_VERSION, 1, DRONE_MSG_VERSION, "Версия формата") \
+    X(reserved,           U8,  0, 0, UINT8_MAX, "Зарезервировано")
+
+// Номера полей и битовые маски наборов полей
+#define DRONE_FIELD_ENUM(name, type, def, min, max, label) DRONE_FIELD_##name,
+typedef enum { DRONE_MSG_FIELDS(DRONE_FIELD_ENUM) DRONE_FIELD_COUNT } drone_field_t;
+#undef DRONE_FIELD_ENUM
+
+_Static_assert(DRONE_FIELD_COUNT <= 32, "Маска полей не помещается в uint32_t");
+
+#define DRONE_FIELD_BIT(name) (1u << DRONE_FIELD_##name)
+#define DRONE_FIELD_MASK_OR(name) DRONE_FIELD_BIT(name) |
+
+// Поля заголовка: передаются в каждом формате
+#define DRONE_FIELDS_HEADER (DRONE_FIELD_BIT(msg_type) | DRONE_FIELD_BIT(msg_id) | \
+                             DRONE_FIELD_BIT(version) | DRONE_FIELD_BIT(reserved))
+
+// Форматы команд, подтверждений и тревог (версия 4): поля после заголовка
+// следуют в порядке пакета. Сообщение, у которого поле вне формата его типа
+// не равно нулю, передается в полном формате
+#define DRONE_TYPED_COMMAND(X) X(timestamp) X(latitude) X(longitude) X(altitude) X(yaw) X(status_flags)
+#define DRONE_TYPED_ACK(X)     X(timestamp)
+#define DRONE_TYPED_ALERT(X)   X(timestamp) X(latitude) X(longitude) X(altitude) \
+                               X(battery_percentage) X(battery_voltage) X(status_flags)
+
+// X(тип сообщения, формат)
+#define DRONE_TYPED_LAYOUTS(X) \
+    X(MSG_TYPE_COMMAND, COMMAND) \
+    X(MSG_TYPE_ACK,     ACK) \
+    X(MSG_TYPE_ALERT,   ALERT)
+
+// Маска полей формата, например DRONE_TYPED_MASK(ACK)
+#define DRONE_TYPED_MASK(layout) (DRONE_TYPED_##layout(DRONE_FIELD_MASK_OR) 0)
+
+#endif /* DRONE_SCHEMA_H */
@@ -0,0 +1,57 @@
+#ifndef DRONE_TYPED_H
+#define DRONE_TYPED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "drone_message.h"
+
+// Форматы команд, подтверждений и тревог (байт 1 кадра). Поля каждого
+// формата заданы в DRONE_TYPED_LAYOUTS (drone_schema.h)
+#define DRONE_MSG_VERSION_TYPED 4
+
+// Заголовок кадра: msg_type, версия, msg_id; в конце - CRC-16
+#define DRONE_TYPED_HEADER_SIZE 3
+
+// Размеры кадров: DRONE_TYPED_SIZE_COMMAND, DRONE_TYPED_SIZE_ACK, ...
+#define DRONE_TYPED_FIELD_SIZE(name) sizeof(((drone_message_t *)0)->name) +
+#define DRONE_TYPED_SIZE_ENUM(msg_type, layout) \
+    DRONE_TYPED_SIZE_##layout = DRONE_TYPED_HEADER_SIZE + DRONE_TYPED_##layout(DRONE_TYPED_FIELD_SIZE) sizeof(uint16_t),
+enum { DRONE_TYPED_LAYOUTS(DRONE_TYPED_SIZE_ENUM) };
+#undef DRONE_TYPED_SIZE_ENUM
+
+// Наибольший кадр среди форматов
+#define DRONE_TYPED_SIZE_MEMBER(msg_type, layout) uint8_t layout[DRONE_TYPED_SIZE_##layout];
+typedef union { DRONE_TYPED_LAYOUTS(DRONE_TYPED_SIZE_MEMBER) } drone_typed_frame_t;
+#undef DRONE_TYPED_SIZE_MEMBER
+#define DRONE_TYPED_MAX_SIZE sizeof(drone_typed_frame_t)
+
+/**
+ * Длина кадра в формате типа msg_type или 0, если у типа нет своего формата
+ */
+int drone_typed_size(uint8_t msg_type);
+
+/**
+ * Перекодирует полный пакет версии 2 в формат его типа.
+ * Возвращает длину кадра или -1: у типа нет формата, пакет поврежден или
+ * поле вне формата не равно нулю (такой пакет передается без изменений)
+ */
+int drone_typed_encode(const uint8_t *frame, int len, uint8_t *out, int buf_size);
+
+/**
+ * Проверяет, похож ли кадр на кадр формата типа (по версии и длине), без проверки CRC
+ */
+bool drone_typed_is_typed(const uint8_t *buffer, int len);
+
+/**
+ * Восстанавливает полный пакет версии 2; поля вне формата равны нулю.
+ * Возвращает DRONE_MSG_PACKET_SIZE или -1 (ошибка CRC, неверная длина)
+ */
+int drone_typed_expand(const uint8_t *buffer, int len, uint8_t *out, int buf_size);
+
+/**
+ * Обнуляет поля вне формата типа сообщения, чтобы оно передавалось в этом
+ * формате. Телеметрию не изменяет
+ */
+void drone_typed_clear_unused(drone_message_t *msg);
+
+#endif /* DRONE_TYPED_H */
@@ -2,7 +2,117 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "latency_hist.h"
+#include "tx_sched.h"
+#include "peer_table.h"
+#include "esp_err.h"
+#include "transport.h"
+
+#define ESPNOW_MAX_DATA_LEN TRANSPORT_MAX_DATA_LEN
+
+#define ESPNOW_TX_QUEUE_LEN CONFIG_BRIDGE_ESPNOW_TX_QUEUE_LEN
+#define ESPNOW_MAX_INFLIGHT CONFIG_BRIDGE_ESPNOW_MAX_INFLIGHT
+#define ESPNOW_RX_RING_LEN  CONFIG_BRIDGE_ESPNOW_RX_RING_LEN
+
+// Счетчики очереди передачи
+typedef struct {
+    uint32_t enqueued;         // Принято в очередь
+    uint32_t dropped;          // Вытеснено более приоритетными или свежими пакетами
+    uint32_t rejected;         // Отклонено из-за заполненной очереди
+    uint32_t send_ok;          // Подтверждено в espnow_send_cb
+    uint32_t send_fail;        // Ошибок доставки в espnow_send_cb
+    uint32_t send_errors;      // Ошибок esp_now_send
+    uint32_t no_mem_retries;   // Повторов после ESP_ERR_ESPNOW_NO_MEM
+    uint32_t late_acks;        // Подтверждений после тайм-аута ожидания
+    uint32_t queue_depth;      // Текущая длина очереди
+} espnow_tx_stats_t;
 
 void espnow_init(void);
-void espnow_add_peer(const uint8_t *peer_mac);
-void espnow_send(const uint8_t *peer_mac, const uint8_t *data, size_t len);
\ No newline at end of file
+
+/**
+ * Регистрирует узел в ESP-NOW и в таблице узлов с группами groups. Для
+ * существующего узла добавляет группы. Для широковещательной передачи
+ * нужно зарегистрировать PEER_BROADCAST_MAC. Возвращает
+ * ESP_ERR_ESPNOW_FULL, если таблица заполнена
+ */
+esp_err_t espnow_add_peer(const uint8_t *peer_mac, uint32_t groups);
+
+/**
+ * Удаляет узел из ESP-NOW и таблицы узлов
+ */
+esp_err_t espnow_remove_peer(const uint8_t *peer_mac);
+
+/**
+ * Проверяет, зарегистрирован ли узел
+ */
+bool espnow_has_peer(const uint8_t *peer_mac);
+
+/**
+ * Возвращает снимок статистики канала с узлом или false, если узла нет
+ */
+bool espnow_get_peer_stats(const uint8_t *peer_mac, peer_link_stats_t *stats);
+
+/**
+ * Возвращает статистику канала к получателю dest; для группы - сумму по
+ * узлам группы. Широковещательные пакеты не подтверждаются: false
+ */
+bool espnow_get_link_stats(const transport_dest_t *dest, peer_link_stats_t *stats);
+
+/**
+ * Количество зарегистрированных узлов
+ */
+uint8_t espnow_peer_count(void);
+
+/**
+ * Ставит пакет в очередь класса cls без блокировки (класс определяет
+ * tx_class_of). Тревоги и команды передаются раньше остальных пакетов и
+ * не вытесняются; при нехватке места вытесняется самый старый пакет
+ * менее приоритетного класса. Данные копируются, буфер можно
+ * переиспользовать сразу после возврата
+ */
+transport_tx_status_t espnow_send_async(const uint8_t *peer_mac, const uint8_t *data, size_t len,
+                                     tx_class_t cls);
+
+/**
+ * Ставит пакет в очередь для получателя dest. Для группы пакет копируется
+ * каждому узлу: ставятся все копии или ни одной. TRANSPORT_TX_FULL - места
+ * на всю группу нет и ни одна копия не поставлена, пакет можно повторить
+ * целиком; TRANSPORT_TX_INVALID - группа пуста
+ */
+transport_tx_status_t espnow_send_dest(const transport_dest_t *dest, const uint8_t *data, size_t len,
+                                    tx_class_t cls);
+
+/**
+ * Ожидает освобождения места в очереди передачи не дольше ticks_to_wait
+ */
+bool espnow_tx_wait_space(TickType_t ticks_to_wait);
+
+/**
+ * Возвращает снимок счетчиков очереди передачи
+ */
+void espnow_tx_get_stats(espnow_tx_stats_t *stats);
+
+/**
+ * Возвращает снимок счетчиков и гистограммы времени ожидания в очереди класса
+ */
+void espnow_tx_get_class_stats(tx_class_t cls, tx_sched_class_stats_t *stats);
+
+/**
+ * Возвращает следующий принятый пакет, ожидая его не дольше ticks_to_wait.
+ * Пакет действителен до вызова espnow_rx_release. Допускается только одна
+ * задача-потребитель
+ */
+const transport_packet_t *espnow_rx_receive(TickType_t ticks_to_wait);
+
+/**
+ * Освобождает пакет, полученный от espnow_rx_receive
+ */
+void espnow_rx_release(void);
+
+/**
+ * Возвращает снимок счетчиков приема
+ */
+void espnow_rx_get_stats(transport_rx_stats_t *stats);
@@ -0,0 +1,103 @@
+#ifndef FLEET_TABLE_H
+#define FLEET_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "peer_table.h"
+#include "drone_message.h"
+
+// Максимальное число дронов в таблице состояния наземной станции. Прием
+// ESP-NOW не требует регистрации узла, поэтому ограничение в 20 узлов
+// на таблицу не распространяется
+#define FLEET_MAX_DRONES 64
+
+// Размер хеш-таблицы индексов (степень двойки, заполнение не больше половины)
+#define FLEET_BUCKETS 128
+
+// Формат снимка: [MAGIC][SEQ][PART][COUNT] затем COUNT записей
+// [MAC 6][AGE_MS LE16][COALESCED][сообщение 67 байт]
+#define FLEET_SNAPSHOT_MAGIC    0xA9
+#define FLEET_SNAPSHOT_HEADER   4
+#define FLEET_RECORD_SIZE       (PEER_MAC_LEN + 3 + EXPECTED_DRONE_MSG_SIZE)
+
+// Максимальный размер кадра снимка (ограничение кадра UART)
+#define FLEET_SNAPSHOT_MAX_SIZE 1024
+
+#define FLEET_RECORDS_PER_FRAME ((FLEET_SNAPSHOT_MAX_SIZE - FLEET_SNAPSHOT_HEADER) / FLEET_RECORD_SIZE)
+
+#define FLEET_BITMAP_WORDS ((FLEET_MAX_DRONES + 31) / 32)
+
+typedef enum {
+    FLEET_UPDATED,                 // Состояние дрона обновлено
+    FLEET_ADDED,                   // Дрон добавлен в таблицу
+    FLEET_FULL,                    // Таблица заполнена, сообщение отброшено
+    FLEET_INVALID                  // Не телеметрия или неверная длина
+} fleet_status_t;
+
+// Счетчики таблицы
+typedef struct {
+    uint32_t updates;              // Принято сообщений телеметрии
+    uint32_t coalesced;            // Сообщений, замененных более свежими до снимка
+    uint32_t rejected;             // Отброшено из-за заполненной таблицы
+    uint32_t expired;              // Удалено дронов без обновлений
+    uint32_t snapshots;            // Выдано кадров снимков
+    uint32_t records;              // Выдано записей в снимках
+} fleet_stats_t;
+
+// Обработчик готового кадра снимка
+typedef void (*fleet_emit_fn_t)(const uint8_t *frame, size_t len, void *user_ctx);
+
+// Таблица последних состояний дронов. Данные разнесены по массивам:
+// поиск читает только индексы и MAC, снимок - только битовую карту
+// измененных записей и их сообщения. Функции не потокобезопасны
+typedef struct {
+    int8_t buckets[FLEET_BUCKETS];                  // Индекс записи или -1
+    uint8_t mac[FLEET_MAX_DRONES][PEER_MAC_LEN];
+    uint32_t used[FLEET_BITMAP_WORDS];              // Занятые записи
+    uint32_t dirty[FLEET_BITMAP_WORDS];             // Обновлены после последнего снимка
+    uint8_t coalesced[FLEET_MAX_DRONES];            // Сообщений после последнего снимка
+    int64_t updated_us[FLEET_MAX_DRONES];
+    uint8_t state[FLEET_MAX_DRONES][EXPECTED_DRONE_MSG_SIZE];  // Последнее сообщение
+    uint8_t frame[FLEET_SNAPSHOT_MAX_SIZE];         // Формируемый кадр снимка (не в стеке задачи)
+    uint8_t count;
+    uint8_t seq;                                    // Номер снимка
+    fleet_stats_t stats;
+} fleet_table_t;
+
+/**
+ * Очищает таблицу
+ */
+void fleet_init(fleet_table_t *fleet);
+
+/**
+ * Записывает сообщение телеметрии дрона mac поверх его предыдущего
+ * состояния. Кадр сохраняется вместе с контрольной суммой, проверка
+ * целостности остается получателю снимка
+ */
+fleet_status_t fleet_update(fleet_table_t *fleet, const uint8_t *mac,
+                            const uint8_t *frame, size_t len, int64_t now_us);
+
+/**
+ * Формирует снимок из дронов, обновленных после предыдущего снимка, и
+ * передает его кадрами не длиннее FLEET_SNAPSHOT_MAX_SIZE в emit.
+ * Возвращает число записей
+ */
+int fleet_snapshot(fleet_table_t *fleet, int64_t now_us, fleet_emit_fn_t emit, void *user_ctx);
+
+/**
+ * Удаляет дронов без обновлений дольше max_age_us. Возвращает их число
+ */
+int fleet_expire(fleet_table_t *fleet, int64_t now_us, int64_t max_age_us);
+
+/**
+ * Последнее сообщение дрона или NULL, если дрона нет в таблице
+ */
+const uint8_t *fleet_get_state(const fleet_table_t *fleet, const uint8_t *mac);
+
+/**
+ * Проверяет, является ли кадр снимком
+ */
+bool fleet_is_snapshot(const uint8_t *data, size_t len);
+
+#endif /* FLEET_TABLE_H */
@@ -0,0 +1,169 @@
+#ifndef FLIGHTREC_H
+#define FLIGHTREC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_partition.h"
+#include "drone_message.h"
+#include "drone_compact.h"
+
+// Раздел журнала в таблице разделов (partitions.csv)
+#define FLIGHTREC_PARTITION_LABEL   "flightrec"
+#define FLIGHTREC_PARTITION_SUBTYPE 0x40
+
+// Журнал - кольцо секторов флеш-памяти. Сектор стирается только перед
+// записью в него, то есть один раз за проход кольца, поэтому износ
+// распределяется по разделу равномерно. Формат сектора:
+// [MAGIC LE32][SEQ LE32][MIN_MS LE32][MAX_MS LE32] затем записи
+// [LEN][TIMESTAMP_MS LE32][кадр LEN байт]. SEQ - сквозной номер сектора,
+// MIN_MS/MAX_MS дописываются при закрытии сектора (до этого 0xFF).
+// Байт 0xFF на месте LEN - конец записей
+#define FLIGHTREC_SECTOR_SIZE   4096
+#define FLIGHTREC_PAGE_SIZE     256
+#define FLIGHTREC_MAGIC_WORD    0x43455246u   // "FREC"
+#define FLIGHTREC_HEADER_SIZE   16
+#define FLIGHTREC_RECORD_HEADER 5
+#define FLIGHTREC_MAX_SECTORS   256
+
+// Телеметрия записывается в компактном формате; ключевой кадр - в начале
+// каждого сектора, поэтому любой сектор читается независимо
+#define FLIGHTREC_KEYFRAME_INTERVAL 32
+
+// Запрос и ответ чтения журнала. Запрос принимается по UART или радиоканалу,
+// ответ уходит тем же путем. OP_REQUEST из UART выполняется на этом мосту,
+// OP_REQUEST_REMOTE передается по радиоканалу и выполняется на другом:
+// запрос [MAGIC][OP_REQUEST][REQ_ID][FROM_MS LE32][TO_MS LE32],
+// данные [MAGIC][OP_DATA][REQ_ID][N] затем N записей [LEN][сообщение],
+// конец  [MAGIC][OP_END][REQ_ID][COUNT LE32]
+#define FLIGHTREC_MAGIC          0xAE
+#define FLIGHTREC_OP_REQUEST     0x01
+#define FLIGHTREC_OP_DATA        0x02
+#define FLIGHTREC_OP_END         0x03
+#define FLIGHTREC_OP_REQUEST_REMOTE 0x04
+#define FLIGHTREC_REQUEST_SIZE   11
+#define FLIGHTREC_DATA_HEADER    4
+#define FLIGHTREC_END_SIZE       7
+#define FLIGHTREC_BATCH_MAX      1024
+
+// Индекс сектора в памяти: номер (0 - пустой) и диапазон меток времени
+typedef struct {
+    uint32_t seq;
+    uint32_t min_ms;
+    uint32_t max_ms;
+} flightrec_sector_t;
+
+// Счетчики журнала
+typedef struct {
+    uint32_t records;              // Записано сообщений
+    uint32_t compact;              // Из них в компактном формате
+    uint32_t bytes;                // Байт записей
+    uint32_t page_writes;          // Операций записи во флеш-память
+    uint32_t erases;               // Стерто секторов
+    uint32_t overwritten;          // Стерто секторов с данными (кольцо заполнено)
+    uint32_t errors;               // Ошибок флеш-памяти и поврежденных записей
+} flightrec_stats_t;
+
+// Обработчик прочитанной записи: полное сообщение drone_message_t
+typedef void (*flightrec_cb_t)(const uint8_t *frame, size_t len, uint32_t timestamp_ms, void *user_ctx);
+
+// Журнал на разделе флеш-памяти. Записи накапливаются в странице в памяти
+// и пишутся во флеш-память страницами по 256 байт. Функции не
+// потокобезопасны: журналом владеет одна задача
+typedef struct {
+    const esp_partition_t *part;
+    uint16_t sector_count;
+    uint16_t head;                 // Сектор, в который идет запись
+    uint32_t head_seq;             // Его номер (0 - журнал пуст)
+    bool head_open;                // Сектор стерт и принимает записи
+    uint16_t write_off;            // Смещение следующей записи в секторе
+    uint16_t page_base;            // Смещение страницы в секторе
+    uint16_t page_flushed;         // Байт страницы, уже записанных во флеш-память
+    uint8_t page[FLIGHTREC_PAGE_SIZE];
+    flightrec_sector_t index[FLIGHTREC_MAX_SECTORS];
+    drone_compact_encoder_t encoder;
+    uint8_t sector_buf[FLIGHTREC_SECTOR_SIZE];   // Сектор при чтении
+    flightrec_stats_t stats;
+} flightrec_t;
+
+// Разобранный запрос чтения
+typedef struct {
+    uint8_t req_id;
+    bool remote;                   // Выполняется на другом конце радиоканала
+    uint32_t from_ms;
+    uint32_t to_ms;
+} flightrec_request_t;
+
+// Кадр ответа с записями, накапливаемый до заполнения
+typedef struct {
+    uint8_t buf[FLIGHTREC_BATCH_MAX];
+    size_t len;
+    size_t cap;
+} flightrec_batch_t;
+
+/**
+ * Открывает журнал на разделе: читает заголовки секторов, строит индекс и
+ * находит место продолжения записи. Возвращает 0 или -1 (раздел меньше
+ * двух секторов, ошибка чтения)
+ */
+int flightrec_open(flightrec_t *rec, const esp_partition_t *part);
+
+/**
+ * Добавляет сообщение drone_message_t. Метка времени записи - поле
+ * timestamp сообщения. Возвращает 0 или -1 (не сообщение, ошибка записи)
+ */
+int flightrec_append(flightrec_t *rec, const uint8_t *frame, size_t len);
+
+/**
+ * Записывает во флеш-память накопленную часть страницы
+ */
+int flightrec_flush(flightrec_t *rec);
+
+/**
+ * Номер самого старого сектора, с которого начинается чтение
+ */
+uint32_t flightrec_first_seq(const flightrec_t *rec);
+
+/**
+ * Читает сектор с номером *seq и вызывает cb для записей с меткой времени
+ * в [from_ms, to_ms]. Сектор без таких записей по индексу не читается.
+ * Если сектор уже стерт, чтение продолжается с самого старого. Переводит
+ * *seq на следующий сектор. Возвращает количество записей или -1, если
+ * секторов больше нет
+ */
+int flightrec_read_sector(flightrec_t *rec, uint32_t *seq, uint32_t from_ms, uint32_t to_ms,
+                          flightrec_cb_t cb, void *user_ctx);
+
+/**
+ * Читает все записи из диапазона в порядке записи. Возвращает их количество
+ */
+uint32_t flightrec_read(flightrec_t *rec, uint32_t from_ms, uint32_t to_ms, flightrec_cb_t cb, void *user_ctx);
+
+/**
+ * Проверяет, является ли кадр запросом чтения, и разбирает его
+ */
+bool flightrec_parse_request(const uint8_t *frame, size_t len, flightrec_request_t *req);
+
+/**
+ * Начинает кадр ответа емкостью cap байт (не больше FLIGHTREC_BATCH_MAX)
+ */
+void flightrec_batch_init(flightrec_batch_t *batch, uint8_t req_id, size_t cap);
+
+/**
+ * Добавляет запись в кадр ответа. Возвращает false, если она не помещается
+ */
+bool flightrec_batch_add(flightrec_batch_t *batch, const uint8_t *frame, size_t len);
+
+/**
+ * Количество записей в кадре ответа
+ */
+static inline uint8_t flightrec_batch_count(const flightrec_batch_t *batch) {
+    return batch->buf[3];
+}
+
+/**
+ * Формирует кадр конца ответа. Возвращает его длину
+ */
+size_t flightrec_encode_end(uint8_t req_id, uint32_t count, uint8_t *out);
+
+#endif /* FLIGHTREC_H */
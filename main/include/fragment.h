@@ -0,0 +1,103 @@
+#ifndef FRAGMENT_H
+#define FRAGMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "frame_parser.h"
+
+// Формат фрагмента: [MAGIC][TYPE][STREAM][INDEX << 4 | COUNT - 1] + данные.
+// TYPE - первый байт исходного кадра: по нему фрагмент получает класс
+// трафика кадра. STREAM отличает кадры одного отправителя, поэтому фрагменты
+// нескольких кадров могут приходить вперемешку
+#define FRAGMENT_MAGIC        0xAD
+#define FRAGMENT_HEADER_SIZE  4
+
+// Максимальный размер фрагмента (MTU ESP-NOW) и его данных
+#define FRAGMENT_MAX_PACKET   250
+#define FRAGMENT_PAYLOAD      (FRAGMENT_MAX_PACKET - FRAGMENT_HEADER_SIZE)
+
+// Максимальный размер кадра - как у кадров UART
+#define FRAGMENT_MAX_FRAME    FRAME_PARSER_MAX_FRAME
+#define FRAGMENT_MAX_COUNT    ((FRAGMENT_MAX_FRAME + FRAGMENT_PAYLOAD - 1) / FRAGMENT_PAYLOAD)
+
+// Обработчик фрагмента при разбиении или собранного кадра при сборке
+typedef void (*fragment_cb_t)(const uint8_t *data, size_t len, void *user_ctx);
+
+// Состояние отправителя
+typedef struct {
+    uint8_t next_stream;
+} fragment_tx_t;
+
+// Слот сборки одного кадра. Фрагменты копируются сразу на свое место в data.
+// Собранный кадр держит слот до тайм-аута, чтобы запоздавшие повторы его
+// фрагментов не собрали кадр второй раз; такой слот занимается первым
+typedef struct {
+    bool used;
+    bool done;                     // Кадр собран и передан обработчику
+    uint8_t mac[6];                // Отправитель
+    uint8_t stream;
+    uint8_t count;                 // Фрагментов в кадре
+    uint16_t received;             // Битовая маска принятых фрагментов
+    uint16_t last_len;             // Данных в последнем фрагменте
+    int64_t updated_us;            // Время приема последнего фрагмента
+    uint8_t data[FRAGMENT_MAX_FRAME];
+} fragment_slot_t;
+
+// Счетчики сборки
+typedef struct {
+    uint32_t completed;            // Собрано кадров
+    uint32_t duplicates;           // Повторно принятых фрагментов
+    uint32_t timeouts;             // Кадров отброшено по тайм-ауту
+    uint32_t evicted;              // Кадров вытеснено новыми при нехватке слотов
+    uint32_t invalid;              // Поврежденных фрагментов
+} fragment_stats_t;
+
+// Сборка кадров от нескольких отправителей. Слоты выделяет вызывающий.
+// Функции не потокобезопасны
+typedef struct {
+    fragment_slot_t *slots;
+    uint8_t slot_count;
+    int64_t timeout_us;
+    fragment_stats_t stats;
+} fragment_rx_t;
+
+/**
+ * Инициализирует отправителя. first_stream лучше выбирать случайно, чтобы
+ * после перезапуска фрагменты не попали в незавершенные слоты получателя
+ */
+void fragment_tx_init(fragment_tx_t *tx, uint8_t first_stream);
+
+/**
+ * Разбивает кадр на фрагменты и вызывает cb для каждого в порядке индексов.
+ * Возвращает количество фрагментов или -1, если кадр пустой или длиннее
+ * FRAGMENT_MAX_FRAME
+ */
+int fragment_split(fragment_tx_t *tx, const uint8_t *frame, size_t len, fragment_cb_t cb, void *user_ctx);
+
+/**
+ * Инициализирует сборку со слотами slots. Незавершенный кадр отбрасывается,
+ * если его фрагменты не приходят дольше timeout_us
+ */
+void fragment_rx_init(fragment_rx_t *rx, fragment_slot_t *slots, uint8_t slot_count, int64_t timeout_us);
+
+/**
+ * Проверяет, является ли пакет фрагментом
+ */
+bool fragment_is_fragment(const uint8_t *data, size_t len);
+
+/**
+ * Принимает фрагмент от отправителя mac. Когда приняты все фрагменты кадра,
+ * вызывает cb с кадром прямо из слота. Если свободных слотов нет, вытесняется
+ * кадр, дольше всех не получавший фрагментов. Возвращает 1, если кадр
+ * собран, 0, если фрагмент принят, -1, если фрагмент поврежден
+ */
+int fragment_receive(fragment_rx_t *rx, const uint8_t *mac, const uint8_t *data, size_t len, int64_t now_us,
+                     fragment_cb_t cb, void *user_ctx);
+
+/**
+ * Отбрасывает кадры, не получавшие фрагментов дольше тайм-аута
+ */
+void fragment_expire(fragment_rx_t *rx, int64_t now_us);
+
+#endif /* FRAGMENT_H */
@@ -0,0 +1,137 @@
+#ifndef FRAME_PARSER_H
+#define FRAME_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Маркеры начала и конца пакета
+#define FRAME_START_MARKER_1 0xAA
+#define FRAME_START_MARKER_2 0x55
+#define FRAME_END_MARKER_1   0x55
+#define FRAME_END_MARKER_2   0xAA
+
+// Синхрослово, размеры заголовка и завершения кадра с префиксом длины:
+// SYNC_1 SYNC_2 LEN_LO LEN_HI CRC8(LEN) <данные> CRC16_LO CRC16_HI
+// (CRC-16/CCITT-FALSE по данным)
+#define FRAME_SYNC_1           0xA5
+#define FRAME_SYNC_2           0x5A
+#define FRAME_LEN_HEADER_SIZE  5
+#define FRAME_LEN_TRAILER_SIZE 2
+
+// Максимальный размер полезной нагрузки кадра
+#define FRAME_PARSER_MAX_FRAME 1024
+
+// Размер кольцевого буфера необработанных байт (степень двойки)
+#define FRAME_PARSER_RING_SIZE 2048
+
+// Формат кадров на линии
+typedef enum {
+    FRAME_MODE_MARKERS,    // Маркеры 0xAA55 ... 0x55AA вокруг данных
+    FRAME_MODE_LENGTH      // Синхрослово, длина и CRC заголовка перед данными
+} frame_mode_t;
+
+// Состояния конечного автомата разбора кадров
+typedef enum {
+    FRAME_WAIT_START_1,    // Ожидаем первого маркера начала
+    FRAME_WAIT_START_2,    // Ожидаем второго маркера начала
+    FRAME_RECEIVING_DATA,  // Прием данных
+    FRAME_WAIT_END_2,      // Получен первый маркер конца, ожидаем второй
+    FRAME_WAIT_SYNC_1,     // Ожидаем первого байта синхрослова
+    FRAME_WAIT_SYNC_2,     // Ожидаем второго байта синхрослова
+    FRAME_RECEIVING_HEADER,// Прием длины и CRC заголовка
+    FRAME_RECEIVING_PAYLOAD,// Прием данных известной длины
+    FRAME_RECEIVING_CRC    // Прием CRC данных
+} frame_parser_state_t;
+
+// Контекст потокового разбора кадров
+typedef struct {
+    uint8_t ring[FRAME_PARSER_RING_SIZE];    // Байты, еще не прошедшие разбор
+    uint32_t ring_head;                      // Позиция записи (монотонная)
+    uint32_t ring_tail;                      // Позиция чтения (монотонная)
+    uint32_t scan_base;                      // Позиция первого байта разбираемого участка
+    uint32_t frame_start;                    // Позиция первого байта обрамления кадра
+
+    uint8_t frame[FRAME_PARSER_MAX_FRAME];   // Собираемый кадр
+    size_t frame_len;                        // Текущая длина кадра
+    frame_parser_state_t state;              // Состояние конечного автомата
+    frame_mode_t mode;                       // Формат кадров
+
+    uint8_t header[FRAME_LEN_HEADER_SIZE];   // Заголовок кадра с префиксом длины
+    size_t header_len;                       // Принято байт заголовка
+    size_t expected_len;                     // Длина данных из заголовка
+    uint8_t trailer[FRAME_LEN_TRAILER_SIZE]; // CRC данных кадра с префиксом длины
+    size_t trailer_len;                      // Принято байт CRC данных
+
+    // Байты после ложного синхрослова, кадр которого не прошел проверку CRC
+    // данных: разбираются заново раньше новых данных
+    uint8_t replay[FRAME_LEN_HEADER_SIZE - 1 + FRAME_PARSER_MAX_FRAME + FRAME_LEN_TRAILER_SIZE];
+    size_t replay_len;                       // Байт в буфере повторного разбора
+    size_t replay_pos;                       // Из них уже разобрано
+    uint32_t replay_base;                    // Позиция replay[0] на линии
+    bool resync;                             // CRC данных не сошлась, нужен повторный разбор
+
+    uint32_t frames;                         // Собрано кадров
+    uint32_t overflows;                      // Кадров отброшено из-за переполнения
+    uint32_t header_errors;                  // Заголовков с неверной CRC или длиной
+    uint32_t payload_errors;                 // Кадров с неверной CRC данных
+} frame_parser_t;
+
+// Обработчик собранного кадра
+typedef void (*frame_parser_cb_t)(const uint8_t *frame, size_t len, void *user_ctx);
+
+/**
+ * Инициализирует контекст разбора для заданного формата кадров
+ */
+void frame_parser_init(frame_parser_t *parser, frame_mode_t mode);
+
+/**
+ * Сбрасывает состояние разбора и очищает кольцевой буфер
+ */
+void frame_parser_reset(frame_parser_t *parser);
+
+/**
+ * Возвращает указатель на непрерывную свободную область кольцевого буфера
+ * и ее размер, чтобы данные можно было прочитать в буфер без копирования
+ */
+uint8_t *frame_parser_write_ptr(frame_parser_t *parser, size_t *contiguous);
+
+/**
+ * Подтверждает запись len байт в область, полученную от frame_parser_write_ptr
+ */
+void frame_parser_commit(frame_parser_t *parser, size_t len);
+
+/**
+ * Копирует данные в кольцевой буфер, возвращает количество принятых байт
+ */
+size_t frame_parser_write(frame_parser_t *parser, const uint8_t *data, size_t len);
+
+/**
+ * Извлекает из кольцевого буфера следующий кадр.
+ * Возвращает 1 и указатель на кадр (действителен до следующего вызова),
+ * либо 0, если для кадра пока недостаточно данных. Позиция первого байта
+ * кадра на линии (в счете ring_head) - в parser->frame_start
+ */
+int frame_parser_next(frame_parser_t *parser, const uint8_t **frame, size_t *len);
+
+/**
+ * Разбирает блок данных, минуя кольцевой буфер, и вызывает cb для каждого
+ * собранного кадра. Незавершенный кадр сохраняется до следующего вызова.
+ * Возвращает количество собранных кадров
+ */
+int frame_parser_feed(frame_parser_t *parser, const uint8_t *data, size_t len,
+                      frame_parser_cb_t cb, void *user_ctx);
+
+/**
+ * Формирует заголовок кадра с данными длины len.
+ * Возвращает размер заголовка (не более FRAME_LEN_HEADER_SIZE)
+ */
+size_t frame_encode_header(frame_mode_t mode, size_t len, uint8_t *out);
+
+/**
+ * Формирует завершение кадра с данными data длины len (маркер конца или
+ * CRC данных). Возвращает размер завершения (не более 2 байт)
+ */
+size_t frame_encode_trailer(frame_mode_t mode, const uint8_t *data, size_t len, uint8_t *out);
+
+#endif /* FRAME_PARSER_H */
@@ -0,0 +1,41 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdint.h>
+
+// Количество корзин гистограммы: 4 корзины на каждую степень двойки до 2^32 мкс
+#define LATENCY_HIST_BUCKETS 128
+
+// Гистограмма задержек с фиксированными логарифмическими корзинами
+typedef struct {
+    uint32_t buckets[LATENCY_HIST_BUCKETS];  // Счетчики по корзинам
+    uint32_t count;                          // Всего измерений
+    uint32_t max_us;                         // Максимальная задержка (мкс)
+} latency_hist_t;
+
+/**
+ * Сбрасывает гистограмму
+ */
+void latency_hist_reset(latency_hist_t *hist);
+
+/**
+ * Добавляет измерение задержки в микросекундах
+ */
+void latency_hist_record(latency_hist_t *hist, int64_t latency_us);
+
+/**
+ * Возвращает верхнюю границу корзины, содержащей заданный перцентиль (0-100)
+ */
+uint32_t latency_hist_percentile(const latency_hist_t *hist, int percentile);
+
+/**
+ * Номер корзины для значения value (мкс)
+ */
+int latency_hist_bucket(uint32_t value);
+
+/**
+ * Верхняя граница значений, попадающих в корзину bucket
+ */
+uint32_t latency_hist_bucket_limit(int bucket);
+
+#endif /* LATENCY_HIST_H */
@@ -0,0 +1,123 @@
+#ifndef LOOPBACK_SIM_H
+#define LOOPBACK_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "latency_hist.h"
+#include "tx_sched.h"
+#include "bridge.h"
+
+// Максимальное число моделируемых дронов
+#define LOOPBACK_SIM_MAX_NODES 8
+
+// Максимальное число прыжков от дрона до наземной станции
+#define LOOPBACK_SIM_MAX_HOPS 4
+
+// Параметры моделирования
+typedef struct {
+    uint8_t nodes;                 // Дронов, передающих на одну наземную станцию
+    uint32_t duration_ms;          // Модельное время
+    uint32_t telemetry_hz;         // Частота телеметрии на каждом дроне
+    uint32_t command_every;        // Каждое N-е сообщение - команда (0 - без команд)
+    uint32_t alert_every;          // Каждое N-е сообщение - тревога (0 - без тревог)
+    uint32_t uart_baud;            // Скорость UART полетного контроллера
+    uint32_t phy_rate_kbps;        // Скорость передачи ESP-NOW в эфире
+    uint32_t loss_permille;        // Вероятность потери пакета в эфире, промилле
+    uint8_t hops;                  // Прыжков до наземной станции: 1 - ESP-NOW, больше - через ретрансляторы ESP-MESH
+    uint32_t tx_queue_len;         // Длина очереди передачи каждого дрона
+    bool priority;                 // Очереди по классам трафика (иначе одна очередь)
+    tx_sched_config_t tx_sched;    // Резерв и веса классов (емкость - tx_queue_len)
+    bridge_config_t bridge;        // Параметры мостов всех узлов (слоты сборки выделяет модель)
+    uint16_t bulk_len;             // Длина кадров массовой передачи, фрагментируются при > 250 (0 - без них)
+    uint32_t bulk_hz;              // Частота кадров массовой передачи на каждом дроне
+    bool bulk_reserved;            // Кадры массовой передачи начинаются с байтов служебных пакетов 0xA6-0xAF
+    uint32_t sync_interval_ms;     // Период запросов синхронизации часов (0 - без синхронизации)
+    int32_t clock_skew_ppm;        // Уход часов дронов относительно наземной станции: от -skew до +skew
+    int32_t clock_offset_us;       // Смещение часов первого дрона, у следующих - кратное
+    uint8_t mac_retries;           // Повторов передачи на уровне MAC при потере пакета
+    uint8_t fade_nodes;            // Дронов, канал которых ухудшается
+    uint32_t fade_loss_permille;   // Вероятность потери в их канале во время ухудшения
+    uint32_t fade_start_ms;        // Начало ухудшения
+    uint32_t fade_end_ms;          // Конец ухудшения
+    uint32_t seed;                 // Начальное значение генератора
+} loopback_sim_config_t;
+
+// Результаты моделирования
+typedef struct {
+    uint32_t generated;            // Сообщений сформировано
+    uint32_t delivered;            // Доставлено в UART наземной станции
+    uint32_t queue_drops;          // Вытеснено из очередей передачи
+    uint32_t air_losses;           // Пакетов потеряно в эфире
+    uint32_t decode_errors;        // Отброшено мостами при разборе и распаковке
+    uint32_t corrupted;            // Выдано в UART наземной станции с ошибкой проверки
+    uint32_t misframed;            // Кадров неверной длины от разборщика UART дронов
+    uint32_t commands;             // Команд сформировано
+    uint32_t commands_delivered;   // Команд доставлено (без дубликатов)
+    uint32_t retransmits;          // Повторных передач кадров с подтверждением
+    uint32_t alerts;               // Тревог сформировано
+    uint32_t alerts_delivered;     // Тревог доставлено
+    uint32_t packets;              // Пакетов ESP-NOW отправлено
+    uint32_t relayed;              // Пакетов переслано ретрансляторами
+    uint32_t bulk_frames;          // Кадров массовой передачи сформировано
+    uint32_t bulk_delivered;       // Собрано и проверено на наземной станции
+    uint32_t bulk_dropped;         // Несобранных кадров отброшено по тайм-ауту или вытеснено
+    uint64_t bulk_bytes;           // Байт массовой передачи доставлено
+    uint32_t stamped;              // Принято наземной станцией сообщений с меткой времени
+    uint32_t telemetry_delivered;  // Доставлено сообщений телеметрии
+    uint32_t decimated;            // Сообщений телеметрии не передано: предел частоты
+    uint32_t mac_retries;          // Повторов передачи на уровне MAC
+    uint32_t send_failed;          // Пакетов дронов не доставлено после всех повторов
+    uint32_t min_limit_hz;         // Наименьший предел частоты телеметрии (0 - не ограничивалась)
+    uint64_t age_area;             // Интеграл возраста последней доставленной телеметрии по времени (мкс * мкс)
+    int64_t age_time_us;           // Время, за которое считается возраст, по всем дронам
+    uint32_t age_max_us;           // Наибольший возраст последней доставленной телеметрии
+    uint64_t air_bytes;            // Байт данных ESP-NOW отправлено
+    uint64_t airtime_us;           // Суммарное время занятости эфира
+    latency_hist_t latency;        // Задержка от формирования на дроне до выдачи в UART (мкс)
+    latency_hist_t command_latency;// То же только для команд
+    latency_hist_t alert_latency;  // То же только для тревог
+    latency_hist_t hop_latency;    // От постановки пакета в очередь узла до приема следующим узлом (мкс)
+    latency_hist_t sync_error;     // Ошибка общего времени дрона при приеме сообщения по UART (мкс, по модулю)
+    latency_hist_t one_way;        // Задержка по меткам, измеренная мостом наземной станции (мкс)
+    latency_hist_t one_way_actual; // Модельная задержка: прием по UART дрона -> прием наземной станцией (мкс)
+} loopback_sim_result_t;
+
+/**
+ * Заполняет параметры значениями по умолчанию из menuconfig
+ */
+void loopback_sim_default_config(loopback_sim_config_t *config);
+
+/**
+ * Моделирует работу нескольких мостов в модельном времени с общим эфиром.
+ * Каждый дрон и наземная станция - bridge_t прошивки: кадры полетного
+ * контроллера проходят разборщик UART и bridge_forward, принятые пакеты -
+ * bridge_receive, выдача в UART проверяется моделью. Радиоканал заменен
+ * каналом transport_t модели: очередь передачи каждого узла на
+ * планировщике tx_sched, MTU 250 байт, время передачи и случайные потери.
+ * При hops > 1 дроны и наземная станция связаны цепочкой ретрансляторов
+ * ESP-MESH на том же канале: каждый прыжок занимает общий эфир.
+ * У каждого дрона свои часы со смещением и уходом; при sync_interval_ms > 0
+ * дроны синхронизируют их с наземной станцией и ставят метки времени на
+ * сообщения, а точность сравнивается с модельным временем.
+ * Потерянный пакет повторяется на уровне MAC до mac_retries раз, каждый
+ * повтор занимает эфир. Канал fade_nodes дронов на время ухудшения теряет
+ * больше пакетов; возраст последней доставленной телеметрии каждого дрона
+ * показывает, насколько свежие данные видит наземная станция
+ */
+void loopback_sim_run(const loopback_sim_config_t *config, loopback_sim_result_t *result);
+
+/**
+ * Выводит результаты в лог строкой "SIM {...}" в формате JSON
+ */
+void loopback_sim_report(const loopback_sim_config_t *config, const loopback_sim_result_t *result);
+
+/**
+ * Выполняет набор сценариев (потери, перегрузка эфира, форматы, прыжки
+ * ESP-MESH, массовая передача, синхронизация часов, ухудшение канала) и
+ * выводит результаты каждого. Возвращает false, если в каком-либо
+ * сценарии ничего не доставлено или в UART выдан поврежденный кадр,
+ * который не объясняется ошибкой разбора UART на дроне
+ */
+bool loopback_sim_run_suite(void);
+
+#endif /* LOOPBACK_SIM_H */
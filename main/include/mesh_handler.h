@@ -0,0 +1,37 @@
+#ifndef MESH_HANDLER_H
+#define MESH_HANDLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "transport.h"
+
+// Идентификатор mesh-сети, общий для всех узлов
+#define MESH_NETWORK_ID {0x77, 0x77, 0x77, 0x77, 0x77, 0x77}
+
+// Счетчики передачи
+typedef struct {
+    uint32_t enqueued;         // Принято в очередь
+    uint32_t dropped;          // Вытеснено более приоритетными или свежими пакетами
+    uint32_t rejected;         // Отклонено из-за заполненной очереди
+    uint32_t send_ok;          // Передано esp_mesh_send
+    uint32_t send_errors;      // Ошибок esp_mesh_send
+    uint32_t no_route;         // Пакетов без маршрута (нет родителя)
+} mesh_tx_stats_t;
+
+/**
+ * Запускает Wi-Fi и ESP-MESH с параметрами из меню "mesh network
+ * configuration", задачи передачи и приема
+ */
+void mesh_init(void);
+
+/**
+ * Слой узла в дереве (1 - корень), 0 - узел не подключен к сети
+ */
+int mesh_get_layer(void);
+
+/**
+ * Возвращает снимок счетчиков передачи
+ */
+void mesh_tx_get_stats(mesh_tx_stats_t *stats);
+
+#endif /* MESH_HANDLER_H */
@@ -0,0 +1,145 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_cpu.h"
+#include "sdkconfig.h"
+#include "latency_hist.h"
+
+// Счетчики событий: идентификатор и имя (накапливаются с запуска)
+#define METRICS_COUNTERS(X) \
+    X(METRIC_UART_RX_FRAMES,   "uart_rx_frames")   /* Кадров принято от полетного контроллера */ \
+    X(METRIC_UART_TX_FRAMES,   "uart_tx_frames")   /* Кадров выдано полетному контроллеру */ \
+    X(METRIC_UART_OVERFLOWS,   "uart_overflows")   /* Переполнений FIFO, буфера драйвера и разборщика */ \
+    X(METRIC_CHECKSUM_ERRORS,  "checksum_errors")  /* Ошибок контрольной суммы и CRC сообщений */ \
+    X(METRIC_DECODE_ERRORS,    "decode_errors")    /* Отброшенных контейнеров, компактных кадров и кадров формата типа */ \
+    X(METRIC_TX_QUEUED,        "tx_queued")        /* Пакетов поставлено в очередь передачи */ \
+    X(METRIC_TX_DROPPED,       "tx_dropped")       /* Пакетов вытеснено или не принято очередью */ \
+    X(METRIC_SEND_ERRORS,      "send_errors")      /* Ошибок передачи пакета в стек Wi-Fi */ \
+    X(METRIC_SEND_FAILED,      "send_failed")      /* Передач без подтверждения получателем */ \
+    X(METRIC_RX_PACKETS,       "rx_packets")       /* Пакетов принято из радиоканала */ \
+    X(METRIC_UART_RING_FULL,   "uart_ring_full")   /* Ожиданий места в кольце между стадиями приема и пересылки */ \
+    X(METRIC_FRAGMENT_DROPPED, "fragment_dropped") /* Несобранных кадров, отброшенных по тайм-ауту или вытесненных */ \
+    X(METRIC_FLIGHTREC_RECORDS, "flightrec_records") /* Сообщений записано в журнал */ \
+    X(METRIC_FLIGHTREC_DROPPED, "flightrec_dropped") /* Сообщений не записано: кольцо журнала заполнено */ \
+    X(METRIC_FLIGHTREC_REPLAYED, "flightrec_replayed") /* Записей журнала отправлено в ответах на запросы */ \
+    X(METRIC_TELEMETRY_DECIMATED, "telemetry_decimated") /* Сообщений телеметрии не передано: предел частоты */
+
+// Мгновенные значения, снимаемые при формировании снимка
+#define METRICS_GAUGES(X) \
+    X(METRIC_GAUGE_TX_QUEUE_DEPTH, "tx_queue_depth") /* Пакетов в очереди передачи */ \
+    X(METRIC_GAUGE_RX_RING_DROPS,  "rx_ring_drops")  /* Отброшено из-за заполненного буфера приема */ \
+    X(METRIC_GAUGE_UART_BAUD,      "uart_baud")      /* Текущая скорость UART */ \
+    X(METRIC_GAUGE_FLEET_DRONES,   "fleet_drones")   /* Дронов в таблице наземной станции */ \
+    X(METRIC_GAUGE_UART_RING_PEAK, "uart_ring_peak") /* Наибольшее заполнение кольца кадров UART за интервал */ \
+    X(METRIC_GAUGE_CPU_UART_RX,    "cpu_uart_rx")    /* Загрузка ядра стадией приема UART, промилле */ \
+    X(METRIC_GAUGE_CPU_FORWARD,    "cpu_forward")    /* Загрузка ядра стадией пересылки, промилле */ \
+    X(METRIC_GAUGE_CPU_RADIO_TX,   "cpu_radio_tx")   /* Загрузка ядра стадией передачи в радиоканал, промилле */ \
+    X(METRIC_GAUGE_SYNC_STRATUM,   "sync_stratum")   /* Уровень синхронизации часов: 0 - эталон, 255 - нет */ \
+    X(METRIC_GAUGE_SYNC_DELAY,     "sync_delay_us")  /* Задержка обмена, по которому оценено смещение часов */ \
+    X(METRIC_GAUGE_TELEMETRY_LIMIT, "telemetry_limit_hz") /* Предел частоты телеметрии, 0 - без ограничения */ \
+    X(METRIC_GAUGE_LINK_DELIVERY,  "link_delivery")  /* Сглаженная доля подтвержденных передач, промилле */
+
+// Гистограммы задержек по участкам пути кадра
+#define METRICS_HISTS(X) \
+    X(METRIC_HIST_UART_TO_QUEUE, "uart_to_queue")  /* Прием кадра по UART -> передача в очередь */ \
+    X(METRIC_HIST_QUEUE_TO_SEND, "queue_to_send")  /* Очередь -> esp_now_send */ \
+    X(METRIC_HIST_SEND_TO_ACK,   "send_to_ack")    /* esp_now_send -> espnow_send_cb */ \
+    X(METRIC_HIST_RX_TO_UART,    "rx_to_uart")     /* Прием из радиоканала -> выдача в UART */ \
+    X(METRIC_HIST_ONE_WAY_RADIO, "one_way_radio")  /* Прием по UART на отправителе -> прием из радиоканала (общее время) */ \
+    X(METRIC_HIST_ONE_WAY_UART,  "one_way_uart")   /* Прием по UART на отправителе -> выдача в UART (общее время) */
+
+#define METRICS_ID(id, name) id,
+
+typedef enum { METRICS_COUNTERS(METRICS_ID) METRIC_COUNT } metric_counter_t;
+typedef enum { METRICS_GAUGES(METRICS_ID) METRIC_GAUGE_COUNT } metric_gauge_t;
+typedef enum { METRICS_HISTS(METRICS_ID) METRIC_HIST_COUNT } metric_hist_t;
+
+#undef METRICS_ID
+
+// Формат снимка: [MAGIC][VERSION][SEQ][MAC 6][UPTIME_MS LE32]
+// [N][N счетчиков LE32][N][N значений LE32]
+// [N][N гистограмм: COUNT, P50, P99, MAX - LE32, мкс, за интервал]
+#define METRICS_MAGIC          0xAC
+#define METRICS_VERSION        1
+#define METRICS_HEADER_SIZE    13
+#define METRICS_HIST_SIZE      16
+#define METRICS_FRAME_SIZE     (METRICS_HEADER_SIZE + 3 + (METRIC_COUNT + METRIC_GAUGE_COUNT) * 4 + \
+                                METRIC_HIST_COUNT * METRICS_HIST_SIZE)
+
+// Выравнивание массива ядра: не меньше строки кэша ESP32-S3 и хоста
+#define METRICS_CORE_ALIGN     64
+
+// Счетчики и корзины гистограмм каждого ядра. Запись - атомарное
+// увеличение в массиве своего ядра без блокировок. Массив ядра выровнен
+// и дополнен до строки кэша, поэтому ядра не делят ни слов, ни строк.
+// Снимок суммирует массивы всех ядер
+typedef struct {
+    uint32_t counters[METRIC_COUNT];
+    uint32_t hists[METRIC_HIST_COUNT][LATENCY_HIST_BUCKETS];
+} __attribute__((aligned(METRICS_CORE_ALIGN))) metrics_core_t;
+
+extern metrics_core_t metrics_cores[portNUM_PROCESSORS];
+
+// Состояние формирования снимков: корзины на момент предыдущего снимка,
+// чтобы перцентили считались за интервал без сброса гистограмм
+typedef struct {
+    uint32_t prev[METRIC_HIST_COUNT][LATENCY_HIST_BUCKETS];
+    uint32_t gauges[METRIC_GAUGE_COUNT];
+    uint8_t seq;
+} metrics_snapshot_t;
+
+#if CONFIG_BRIDGE_METRICS
+
+static inline void metrics_add(metric_counter_t id, uint32_t value) {
+    __atomic_fetch_add(&metrics_cores[esp_cpu_get_core_id()].counters[id], value, __ATOMIC_RELAXED);
+}
+
+static inline void metrics_inc(metric_counter_t id) {
+    metrics_add(id, 1);
+}
+
+/**
+ * Учитывает задержку latency_us участка id
+ */
+static inline void metrics_record(metric_hist_t id, int64_t latency_us) {
+    uint32_t value = latency_us <= 0 ? 0 : latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+    __atomic_fetch_add(&metrics_cores[esp_cpu_get_core_id()].hists[id][latency_hist_bucket(value)], 1,
+                       __ATOMIC_RELAXED);
+}
+
+#else
+
+static inline void metrics_add(metric_counter_t id, uint32_t value) {}
+static inline void metrics_inc(metric_counter_t id) {}
+static inline void metrics_record(metric_hist_t id, int64_t latency_us) {}
+
+#endif
+
+/**
+ * Сумма счетчика id по всем ядрам
+ */
+uint32_t metrics_get(metric_counter_t id);
+
+/**
+ * Гистограмма участка id по всем ядрам с запуска
+ */
+void metrics_get_hist(metric_hist_t id, latency_hist_t *hist);
+
+/**
+ * Формирует снимок узла mac в out (не меньше METRICS_FRAME_SIZE байт).
+ * Перцентили считаются по измерениям после предыдущего вызова с тем же
+ * snapshot. Значения снимаются из snapshot->gauges. Возвращает длину кадра
+ */
+size_t metrics_encode(metrics_snapshot_t *snapshot, const uint8_t *mac, uint32_t uptime_ms,
+                      uint8_t *out, size_t max_len);
+
+/**
+ * Проверяет, является ли кадр снимком метрик
+ */
+bool metrics_is_snapshot(const uint8_t *data, size_t len);
+
+#endif /* METRICS_H */
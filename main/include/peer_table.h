@@ -0,0 +1,102 @@
+#ifndef PEER_TABLE_H
+#define PEER_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define PEER_MAC_LEN 6
+
+// Максимальное число узлов: ограничение ESP-NOW (ESP_NOW_MAX_TOTAL_PEER_NUM)
+#define PEER_TABLE_CAPACITY 20
+
+// Размер хеш-таблицы индексов (степень двойки, заполнение не больше трети)
+#define PEER_TABLE_BUCKETS 64
+
+// Группа, в которую входят все узлы, если не задано иное
+#define PEER_GROUP_ALL 0x00000001u
+
+extern const uint8_t PEER_BROADCAST_MAC[PEER_MAC_LEN];
+
+// Статистика канала с узлом
+typedef struct {
+    uint32_t tx_ok;                // Подтверждено в espnow_send_cb
+    uint32_t tx_fail;              // Не подтверждено получателем
+    uint32_t rx_packets;           // Принято пакетов
+    uint32_t rx_bytes;             // Принято байт
+    int8_t rssi_last;              // Уровень сигнала последнего пакета (дБм)
+    int16_t rssi_avg_x16;          // Сглаженный уровень сигнала (дБм * 16)
+    int64_t last_rx_us;            // Время последнего приема (esp_timer)
+} peer_link_stats_t;
+
+typedef struct {
+    uint8_t mac[PEER_MAC_LEN];
+    bool used;
+    uint32_t groups;               // Битовая маска групп
+    int inflight;                  // Пакетов передано в стек Wi-Fi без подтверждения
+    peer_link_stats_t stats;
+} peer_entry_t;
+
+// Таблица узлов фиксированной емкости. Поиск по MAC - хеш-таблица с
+// линейным пробированием, время не зависит от числа узлов. Записи не
+// перемещаются, указатель действителен до удаления узла. Функции не
+// потокобезопасны
+typedef struct {
+    peer_entry_t entries[PEER_TABLE_CAPACITY];
+    int8_t buckets[PEER_TABLE_BUCKETS];    // Индекс записи или -1
+    uint8_t count;
+} peer_table_t;
+
+/**
+ * Очищает таблицу
+ */
+void peer_table_init(peer_table_t *table);
+
+/**
+ * Ищет узел по MAC. Возвращает NULL, если узла нет
+ */
+peer_entry_t *peer_table_find(peer_table_t *table, const uint8_t *mac);
+
+/**
+ * Добавляет узел в группы groups или возвращает существующий.
+ * Возвращает NULL, если таблица заполнена
+ */
+peer_entry_t *peer_table_add(peer_table_t *table, const uint8_t *mac, uint32_t groups);
+
+/**
+ * Удаляет узел. Возвращает false, если узла нет
+ */
+bool peer_table_remove(peer_table_t *table, const uint8_t *mac);
+
+/**
+ * Копирует в macs адреса узлов, входящих хотя бы в одну из групп groups
+ * (широковещательный адрес не включается). Возвращает число адресов
+ */
+size_t peer_table_collect(const peer_table_t *table, uint32_t groups,
+                          uint8_t (*macs)[PEER_MAC_LEN], size_t max);
+
+/**
+ * Суммирует статистику узлов, входящих хотя бы в одну из групп groups, в
+ * total. Уровень сигнала - худший из узлов, по которым он известен.
+ * Возвращает число узлов
+ */
+size_t peer_table_group_stats(const peer_table_t *table, uint32_t groups, peer_link_stats_t *total);
+
+/**
+ * Учитывает принятый пакет в статистике узла
+ */
+void peer_stats_record_rx(peer_link_stats_t *stats, size_t len, int8_t rssi, int64_t now_us);
+
+// Хеш MAC для таблиц с открытой адресацией: младшие байты MAC различаются
+// у устройств одного производителя, мультипликативное хеширование
+// перемешивает их в старших битах результата
+static inline uint32_t peer_mac_hash(const uint8_t *mac) {
+    uint32_t low = (uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5];
+    return (low ^ ((uint32_t)mac[0] << 8 | mac[1])) * 0x9E3779B1u;
+}
+
+static inline bool peer_is_broadcast(const uint8_t *mac) {
+    return (mac[0] & mac[1] & mac[2] & mac[3] & mac[4] & mac[5]) == 0xFF;
+}
+
+#endif /* PEER_TABLE_H */
@@ -0,0 +1,101 @@
+#ifndef RATE_CTRL_H
+#define RATE_CTRL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Управление частотой телеметрии по качеству канала. Раз в период
+// контроллер берет разность накопительных счетчиков канала: подтвержденные
+// и неподтвержденные передачи, вытеснения телеметрии из очереди, и
+// сглаживает долю доставки. При плохом канале или вытеснениях предел
+// частоты уменьшается вдвое, при хорошем растет на шаг, пока не перестанет
+// ограничивать входной поток. Сообщение до срока придерживается, более
+// новое заменяет его; придержанное уходит в срок, поэтому последнее
+// состояние перед паузой потока не теряется.
+// Команды и тревоги контроллер не ограничивает: он вызывается только для
+// телеметрии
+
+// Полная доля доставки, промилле
+#define RATE_CTRL_PERMILLE 1000
+
+// Передач, достаточных для оценки доли доставки. При меньшем числе за
+// период счетчики копятся до следующих периодов
+#define RATE_CTRL_MIN_SAMPLES 4
+
+typedef struct {
+    uint32_t period_us;            // Период оценки канала
+    uint16_t min_hz;               // Нижний предел частоты телеметрии
+    uint16_t step_hz;              // Рост предела за период при хорошем канале
+    uint16_t good_permille;        // Доля доставки, начиная с которой предел растет
+    uint16_t poor_permille;        // Доля доставки, ниже которой предел уменьшается вдвое
+    int8_t rssi_poor_dbm;          // При более слабом сигнале предел не растет (0 - не учитывать)
+} rate_ctrl_config_t;
+
+// Накопительные счетчики канала на момент оценки
+typedef struct {
+    uint32_t tx_ok;                // Передач подтверждено получателем
+    uint32_t tx_fail;              // Передач не подтверждено
+    uint32_t queue_drops;          // Телеметрии вытеснено из очереди передачи
+    int8_t rssi_dbm;               // Сглаженный уровень сигнала, 0 - неизвестен
+} rate_ctrl_sample_t;
+
+// Счетчики контроллера
+typedef struct {
+    uint32_t offered;              // Сообщений телеметрии предложено
+    uint32_t decimated;            // Из них отброшено: заменено более новым до срока
+    uint32_t decreases;            // Уменьшений предела
+    uint32_t increases;            // Увеличений предела
+} rate_ctrl_stats_t;
+
+// Состояние контроллера одного потока телеметрии. Функции не
+// потокобезопасны
+typedef struct {
+    rate_ctrl_config_t config;
+    bool started;
+    int64_t last_update_us;
+    uint32_t last_ok;              // Счетчики передач, учтенные в доле доставки
+    uint32_t last_fail;
+    uint32_t last_drops;
+    uint16_t delivery_permille;    // Сглаженная доля доставки
+    uint32_t period_offered;       // Телеметрии предложено с прошлой оценки
+    uint32_t input_hz;             // Входная частота телеметрии за прошлый период
+    uint32_t limit_hz;             // Предел частоты, 0 - без ограничения
+    int64_t next_us;               // Время, с которого допускается следующее сообщение
+    bool held;                     // Сообщение придержано до next_us
+    rate_ctrl_stats_t stats;
+} rate_ctrl_t;
+
+/**
+ * Инициализирует контроллер без ограничения частоты
+ */
+void rate_ctrl_init(rate_ctrl_t *rc, const rate_ctrl_config_t *config);
+
+/**
+ * Оценивает канал по счетчикам sample и пересчитывает предел частоты.
+ * Вызывается раз в config.period_us; первый вызов только запоминает
+ * счетчики
+ */
+void rate_ctrl_update(rate_ctrl_t *rc, const rate_ctrl_sample_t *sample, int64_t now_us);
+
+/**
+ * Проверяет, пора ли оценивать канал
+ */
+static inline bool rate_ctrl_due(const rate_ctrl_t *rc, int64_t now_us) {
+    return !rc->started || now_us - rc->last_update_us >= (int64_t)rc->config.period_us;
+}
+
+/**
+ * Решает, передавать ли сообщение телеметрии, принятое в now_us. Ранее
+ * придержанное сообщение в любом случае отбрасывается: новое свежее.
+ * Возвращает false, если сообщение нужно придержать до next_us
+ */
+bool rate_ctrl_admit(rate_ctrl_t *rc, int64_t now_us);
+
+/**
+ * Срок придержанного сообщения: true, если его пора передать. Вызывается
+ * по таймеру на next_us
+ */
+bool rate_ctrl_release(rate_ctrl_t *rc, int64_t now_us);
+
+#endif /* RATE_CTRL_H */
@@ -0,0 +1,154 @@
+#ifndef RELIABLE_H
+#define RELIABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "latency_hist.h"
+
+// Служебные кадры уровня надежной доставки (первый байт не совпадает с msg_type)
+#define RELIABLE_DATA_MAGIC   0xA7     // [A7][epoch][seq][base] + кадр
+#define RELIABLE_ACK_MAGIC    0xA8     // [A8][epoch][cum][bitmap LE32]
+#define RELIABLE_DATA_HEADER  4
+#define RELIABLE_ACK_SIZE     7
+
+// Максимальный размер кадра, передаваемого с подтверждением
+#define RELIABLE_MAX_FRAME    96
+
+// Кадров, ожидающих подтверждения или отправки (степень двойки, не более 32)
+#define RELIABLE_QUEUE_LEN    16
+
+// Максимальное окно: не более половины очереди
+#define RELIABLE_MAX_WINDOW   (RELIABLE_QUEUE_LEN / 2)
+
+// Результат постановки кадра в очередь
+typedef enum {
+    RELIABLE_OK,                   // Кадр принят, будет доставлен с подтверждением
+    RELIABLE_FULL,                 // Очередь заполнена
+    RELIABLE_INVALID               // Кадр слишком велик или неверные параметры
+} reliable_status_t;
+
+// Результат обработки кадра данных
+typedef enum {
+    RELIABLE_RX_DELIVER,           // Новый кадр, выдается получателю
+    RELIABLE_RX_DUPLICATE,         // Кадр уже принят
+    RELIABLE_RX_OUT_OF_WINDOW      // Номер дальше окна приема, кадр отброшен
+} reliable_rx_status_t;
+
+// Отправка кадра данных партнеру (без блокировки)
+typedef void (*reliable_send_fn_t)(const uint8_t *data, size_t len, void *user_ctx);
+
+// Параметры канала
+typedef struct {
+    uint8_t window;                // Кадров в полете без подтверждения (1..RELIABLE_MAX_WINDOW)
+    uint32_t rto_min_us;           // Границы тайм-аута повторной передачи
+    uint32_t rto_max_us;
+    uint8_t max_retries;           // Повторов до отказа от доставки
+} reliable_config_t;
+
+// Счетчики передачи
+typedef struct {
+    uint32_t sent;                 // Кадров принято к доставке
+    uint32_t retransmits;          // Повторных передач
+    uint32_t acked;                // Подтверждено
+    uint32_t failed;               // Не доставлено за max_retries повторов
+    uint32_t rejected;             // Отклонено из-за заполненной очереди
+    uint32_t srtt_us;              // Сглаженное время кругового обхода
+    uint32_t rto_us;               // Текущий тайм-аут повторной передачи
+    latency_hist_t ack_time_us;    // Время от первой передачи до подтверждения
+} reliable_stats_t;
+
+typedef struct {
+    uint8_t data[RELIABLE_MAX_FRAME];
+    uint8_t len;
+    uint8_t retries;
+    bool sent;                     // Передан хотя бы раз
+    bool done;                     // Подтвержден или отброшен
+    int64_t first_sent_us;
+    int64_t sent_us;
+    int64_t deadline_us;
+    uint32_t rto_us;               // Тайм-аут этого кадра с учетом удвоения
+} reliable_slot_t;
+
+// Передача кадров одному партнеру. Функции не потокобезопасны:
+// вызывающий код сериализует доступ
+typedef struct {
+    reliable_config_t config;
+    reliable_send_fn_t send;
+    void *user_ctx;
+
+    // Передача
+    reliable_slot_t slots[RELIABLE_QUEUE_LEN];
+    uint8_t epoch;                 // Случайный номер сеанса отправителя
+    uint8_t tx_base;               // Самый старый неподтвержденный
+    uint8_t tx_next;               // Следующий номер
+    uint32_t srtt_us;
+    uint32_t rttvar_us;
+    uint32_t rto_us;
+    bool rtt_valid;
+
+    reliable_stats_t stats;
+} reliable_link_t;
+
+// Прием кадров от одного отправителя. У каждого отправителя своя нумерация,
+// поэтому состояние приема хранится отдельно для каждого из них
+typedef struct {
+    bool synced;
+    uint8_t epoch;                 // Номер сеанса отправителя
+    uint8_t next;                  // Первый не принятый номер
+    uint32_t bitmap;               // Бит i: принят номер next + i
+    uint32_t delivered;            // Выдано принятых кадров
+    uint32_t duplicates;           // Отброшено дубликатов
+    uint32_t out_of_window;        // Отброшено кадров с номером дальше окна
+} reliable_rx_t;
+
+/**
+ * Инициализирует передачу. epoch - случайное ненулевое значение, новое при
+ * каждом запуске, чтобы партнер сбросил состояние приема после перезагрузки
+ */
+void reliable_init(reliable_link_t *link, const reliable_config_t *config, uint8_t epoch,
+                   reliable_send_fn_t send, void *user_ctx);
+
+/**
+ * Ставит кадр в очередь доставки с подтверждением и передает его,
+ * если окно позволяет
+ */
+reliable_status_t reliable_send(reliable_link_t *link, const uint8_t *frame, size_t len, int64_t now_us);
+
+/**
+ * Проверяет, является ли кадр служебным кадром надежной доставки
+ */
+bool reliable_is_link_frame(const uint8_t *data, size_t len);
+
+/**
+ * Учитывает подтверждение от партнера (кадр RELIABLE_ACK_MAGIC)
+ */
+void reliable_on_ack(reliable_link_t *link, const uint8_t *data, size_t len, int64_t now_us);
+
+/**
+ * Очищает состояние приема
+ */
+void reliable_rx_init(reliable_rx_t *rx);
+
+/**
+ * Обрабатывает кадр данных (RELIABLE_DATA_MAGIC) от отправителя rx.
+ * В ack формируется подтверждение, которое нужно отправить отправителю
+ * при любом результате. При RELIABLE_RX_DELIVER frame и frame_len
+ * указывают на кадр внутри data
+ */
+reliable_rx_status_t reliable_rx_data(reliable_rx_t *rx, const uint8_t *data, size_t len,
+                                      const uint8_t **frame, size_t *frame_len,
+                                      uint8_t ack[RELIABLE_ACK_SIZE]);
+
+/**
+ * Повторяет передачу кадров с истекшим тайм-аутом. Вызывается периодически
+ * с шагом не больше rto_min_us
+ */
+void reliable_poll(reliable_link_t *link, int64_t now_us);
+
+/**
+ * Кадров в очереди (в полете и ожидающих окна)
+ */
+uint8_t reliable_pending(const reliable_link_t *link);
+
+#endif /* RELIABLE_H */
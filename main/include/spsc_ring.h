@@ -0,0 +1,49 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Кольцевой буфер фиксированных элементов без блокировок для одного
+// производителя и одного потребителя. Память под элементы выделяет вызывающий
+typedef struct {
+    uint8_t *storage;          // Элементы буфера
+    size_t elem_size;          // Размер элемента
+    uint32_t mask;             // Емкость - 1 (емкость - степень двойки)
+    uint32_t head;             // Позиция записи, изменяет только производитель
+    uint32_t tail;             // Позиция чтения, изменяет только потребитель
+} spsc_ring_t;
+
+/**
+ * Инициализирует буфер. capacity должна быть степенью двойки,
+ * storage - не меньше capacity * elem_size байт
+ */
+int spsc_ring_init(spsc_ring_t *ring, void *storage, size_t elem_size, uint32_t capacity);
+
+/**
+ * Производитель: возвращает свободный элемент для заполнения или NULL, если буфер полон
+ */
+void *spsc_ring_acquire(spsc_ring_t *ring);
+
+/**
+ * Производитель: публикует элемент, полученный от spsc_ring_acquire.
+ * Возвращает количество элементов в буфере до публикации
+ */
+uint32_t spsc_ring_publish(spsc_ring_t *ring);
+
+/**
+ * Потребитель: возвращает самый старый элемент или NULL, если буфер пуст
+ */
+void *spsc_ring_peek(spsc_ring_t *ring);
+
+/**
+ * Потребитель: освобождает элемент, полученный от spsc_ring_peek
+ */
+void spsc_ring_release(spsc_ring_t *ring);
+
+/**
+ * Количество элементов в буфере (приблизительно, если вызвано третьей стороной)
+ */
+uint32_t spsc_ring_count(const spsc_ring_t *ring);
+
+#endif /* SPSC_RING_H */
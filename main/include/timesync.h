@@ -0,0 +1,158 @@
+#ifndef TIMESYNC_H
+#define TIMESYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Синхронизация часов узлов обменом метками времени, как в NTP. Узел-эталон
+// (наземная станция) отвечает по своим часам esp_timer, остальные узлы
+// оценивают смещение и уход своих часов относительно эталона и тоже
+// отвечают, уже по общему времени, - так время доходит через ретрансляторы.
+// Форматы кадров (метки времени - мкс, LE):
+// запрос [MAGIC][OP_PING][SEQ][T1 64],
+// ответ  [MAGIC][OP_PONG][SEQ][STRATUM][T1 64][T2 64][T3 64],
+// метка  [MAGIC][OP_STAMP][T 32] затем исходный кадр.
+// T1 - отправка запроса по часам узла, T2 и T3 - прием запроса и отправка
+// ответа по общему времени отвечающего. Метка - общее время приема кадра по
+// UART на отправителе, младшие 32 бита
+#define TIMESYNC_MAGIC          0xAF
+#define TIMESYNC_OP_PING        0x01
+#define TIMESYNC_OP_PONG        0x02
+#define TIMESYNC_OP_STAMP       0x03
+#define TIMESYNC_PING_SIZE      11
+#define TIMESYNC_PONG_SIZE      28
+#define TIMESYNC_STAMP_HEADER   6
+
+// Уровень узла: 0 - эталон, N - синхронизирован через N обменов
+#define TIMESYNC_STRATUM_NONE   0xFF
+
+// Обменов в окне выбора: смещение берется по обмену с наименьшей
+// задержкой, на него меньше всего влияют очереди передачи
+#define TIMESYNC_SAMPLES        8
+
+// Точки оценки ухода часов: не чаще одной за TIMESYNC_POINT_SPACING_US,
+// уход - наклон прямой по точкам
+#define TIMESYNC_POINTS         8
+#define TIMESYNC_POINT_SPACING_US 4000000
+
+// Предел оценки ухода часов, миллиардные доли (кварц - десятки ppm)
+#define TIMESYNC_DRIFT_MAX_PPB  500000
+
+// Расхождение первого обмена после потери синхронизации с устаревшей
+// моделью, выше которого часы эталона считаются переставленными
+#define TIMESYNC_STEP_US        50000
+
+// Результат одного обмена
+typedef struct {
+    int64_t local_us;              // Прием ответа по часам узла (T4)
+    int64_t offset_us;             // Общее время минус время узла
+    int64_t delay_us;              // Время в пути туда и обратно
+} timesync_sample_t;
+
+// Счетчики синхронизации
+typedef struct {
+    uint32_t pings;                // Отправлено запросов
+    uint32_t answered;             // Отвечено на запросы
+    uint32_t samples;              // Принято ответов
+    uint32_t rejected;             // Отброшено ответов: устаревших, от другого узла, с отрицательной задержкой
+    uint32_t lost_sync;            // Потерь синхронизации по тайм-ауту
+} timesync_stats_t;
+
+// Состояние синхронизации узла. Функции не потокобезопасны
+typedef struct {
+    bool reference;
+    uint8_t stratum;
+    int64_t holdover_us;           // Синхронизация теряется без ответов дольше этого времени
+    // Последний запрос
+    uint8_t ping_seq;
+    int64_t ping_t1;
+    // Узел, по которому идет синхронизация
+    bool has_server;
+    uint8_t server[6];
+    uint8_t server_stratum;
+    int64_t last_sample_us;
+    // Окно обменов
+    timesync_sample_t samples[TIMESYNC_SAMPLES];
+    uint8_t sample_count;
+    uint8_t sample_next;
+    // Точки для оценки ухода часов
+    timesync_sample_t points[TIMESYNC_POINTS];
+    uint8_t point_count;
+    uint8_t point_next;
+    // Модель: offset(t) = base_offset + (t - base_local) * drift / 1e9.
+    // После потери синхронизации модель сохраняется как устаревшая
+    bool has_model;
+    int64_t base_local_us;
+    int64_t base_offset_us;
+    int64_t base_delay_us;
+    int32_t drift_ppb;
+    timesync_stats_t stats;
+} timesync_t;
+
+/**
+ * Инициализирует состояние. Эталон синхронизирован всегда
+ */
+void timesync_init(timesync_t *ts, bool reference, int64_t holdover_us);
+
+/**
+ * Проверяет, является ли кадр запросом или ответом синхронизации
+ */
+bool timesync_is_sync_frame(const uint8_t *data, size_t len);
+
+/**
+ * Формирует запрос в out (TIMESYNC_PING_SIZE байт). local_us - время
+ * отправки по часам узла. Возвращает длину или 0 для эталона
+ */
+size_t timesync_ping(timesync_t *ts, int64_t local_us, uint8_t *out);
+
+/**
+ * Формирует в out ответ (TIMESYNC_PONG_SIZE байт) на запрос, принятый в
+ * rx_local_us и отправляемый в tx_local_us по часам узла. Возвращает длину
+ * или 0, если кадр не запрос или узел не синхронизирован
+ */
+size_t timesync_answer(timesync_t *ts, const uint8_t *frame, size_t len, int64_t rx_local_us,
+                       int64_t tx_local_us, uint8_t *out);
+
+/**
+ * Принимает ответ от узла mac, принятый в rx_local_us по часам узла, и
+ * уточняет смещение и уход часов. Возвращает true, если ответ принят
+ */
+bool timesync_on_pong(timesync_t *ts, const uint8_t *mac, const uint8_t *frame, size_t len, int64_t rx_local_us);
+
+/**
+ * Теряет синхронизацию, если ответов нет дольше holdover_us. Смещение и
+ * уход часов сохраняются и только помечаются устаревшими
+ */
+void timesync_expire(timesync_t *ts, int64_t local_us);
+
+static inline bool timesync_synced(const timesync_t *ts) {
+    return ts->stratum != TIMESYNC_STRATUM_NONE;
+}
+
+/**
+ * Синхронизация потеряна, общее время - по последней модели
+ */
+static inline bool timesync_stale(const timesync_t *ts) {
+    return ts->has_model && !timesync_synced(ts);
+}
+
+/**
+ * Общее время для времени local_us по часам узла. После потери
+ * синхронизации - по последней модели, без модели - время узла
+ */
+int64_t timesync_now(const timesync_t *ts, int64_t local_us);
+
+/**
+ * Записывает в out кадр frame с меткой stamp_us. Возвращает длину или 0,
+ * если кадр с меткой длиннее cap
+ */
+size_t timesync_stamp(uint32_t stamp_us, const uint8_t *frame, size_t len, uint8_t *out, size_t cap);
+
+/**
+ * Если кадр с меткой, переводит *frame и *len на исходный кадр, записывает
+ * метку в *stamp_us и возвращает true
+ */
+bool timesync_unstamp(const uint8_t **frame, size_t *len, uint32_t *stamp_us);
+
+#endif /* TIMESYNC_H */
@@ -0,0 +1,111 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "latency_hist.h"
+#include "tx_sched.h"
+#include "peer_table.h"
+
+// Максимальная длина пакета: MTU ESP-NOW. ESP-MESH допускает больше, но
+// контейнеры и служебные кадры рассчитаны на 250 байт
+#define TRANSPORT_MAX_DATA_LEN 250
+
+#define TRANSPORT_ADDR_LEN 6
+
+// Результат постановки пакета в очередь
+typedef enum {
+    TRANSPORT_TX_QUEUED,          // Пакет поставлен в очередь
+    TRANSPORT_TX_QUEUED_DROPPED,  // Пакет поставлен, старый пакет вытеснен
+    TRANSPORT_TX_FULL,            // Очередь заполнена, пакет не принят
+    TRANSPORT_TX_INVALID          // Неверные параметры
+} transport_tx_status_t;
+
+// Способ адресации пакета
+typedef enum {
+    TRANSPORT_DEST_UNICAST,       // Одному узлу
+    TRANSPORT_DEST_BROADCAST,     // Всем узлам
+    TRANSPORT_DEST_GROUP          // Копия каждому узлу из групп
+} transport_dest_mode_t;
+
+// Получатель пакета
+typedef struct {
+    transport_dest_mode_t mode;
+    uint8_t mac[TRANSPORT_ADDR_LEN];  // Для TRANSPORT_DEST_UNICAST
+    uint32_t groups;                  // Маска групп для TRANSPORT_DEST_GROUP
+} transport_dest_t;
+
+// Принятый пакет
+typedef struct {
+    uint8_t src_mac[TRANSPORT_ADDR_LEN]; // Отправитель
+    int8_t rssi;               // Уровень сигнала (дБм), 0 - неизвестен
+    uint16_t len;              // Длина данных
+    int64_t rx_time;           // Время приема (esp_timer, мкс)
+    uint8_t data[TRANSPORT_MAX_DATA_LEN];
+} transport_packet_t;
+
+// Счетчики приема
+typedef struct {
+    uint32_t received;         // Принято пакетов
+    uint32_t dropped;          // Отброшено из-за заполненного буфера
+    latency_hist_t cb_time_us; // Время переноса пакета в буфер приема (мкс)
+} transport_rx_stats_t;
+
+// Канал передачи моста. Владение буферами одинаково для всех реализаций:
+// - send копирует данные в очередь передачи, буфер вызывающего свободен
+//   сразу после возврата;
+// - receive отдает пакет из кольцевого буфера реализации без копирования,
+//   пакет действителен до release. Потребитель - одна задача.
+// Функции send и wait_space можно вызывать из нескольких задач
+typedef struct {
+    const char *name;
+
+    void (*init)(void);
+
+    /**
+     * Регистрирует узел с группами groups; для существующего добавляет группы
+     */
+    esp_err_t (*add_peer)(const uint8_t *mac, uint32_t groups);
+    bool (*has_peer)(const uint8_t *mac);
+    uint8_t (*peer_count)(void);
+
+    /**
+     * Ставит пакет класса cls в очередь без блокировки. Копии нескольким
+     * получателям (группа, широковещание корня mesh) ставятся все или ни
+     * одной: TRANSPORT_TX_FULL - не поставлена ни одна копия
+     */
+    transport_tx_status_t (*send)(const transport_dest_t *dest, const uint8_t *data, size_t len,
+                                  tx_class_t cls);
+
+    /**
+     * Ожидает освобождения места в очереди передачи не дольше ticks_to_wait
+     */
+    bool (*wait_space)(TickType_t ticks_to_wait);
+    void (*get_class_stats)(tx_class_t cls, tx_sched_class_stats_t *stats);
+
+    /**
+     * Возвращает статистику канала к получателю dest: для группы - сумму по
+     * узлам группы. false, если передачи к получателю не подтверждаются
+     */
+    bool (*get_link_stats)(const transport_dest_t *dest, peer_link_stats_t *stats);
+
+    /**
+     * Возвращает следующий принятый пакет, ожидая его не дольше ticks_to_wait
+     */
+    const transport_packet_t *(*receive)(TickType_t ticks_to_wait);
+    void (*release)(void);
+    void (*get_rx_stats)(transport_rx_stats_t *stats);
+} transport_t;
+
+extern const transport_t transport_espnow;
+extern const transport_t transport_mesh;
+
+/**
+ * Канал, выбранный в menuconfig (CONFIG_BRIDGE_TRANSPORT)
+ */
+const transport_t *transport_get(void);
+
+#endif /* TRANSPORT_H */
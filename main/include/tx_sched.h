@@ -0,0 +1,141 @@
+#ifndef TX_SCHED_H
+#define TX_SCHED_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "latency_hist.h"
+
+// Классы трафика в порядке убывания приоритета
+typedef enum {
+    TX_CLASS_ALERT,                // Тревоги: строгий приоритет
+    TX_CLASS_CONTROL,              // Команды и подтверждения: строгий приоритет после тревог
+    TX_CLASS_TELEMETRY,            // Телеметрия: доля полосы по весу, вытесняется
+    TX_CLASS_BULK,                 // Прочие данные: доля полосы по весу, вытесняются
+    TX_CLASS_COUNT
+} tx_class_t;
+
+// Первый класс, который обслуживается по весу и может вытесняться
+#define TX_CLASS_FIRST_WEIGHTED TX_CLASS_TELEMETRY
+
+// Максимальное число слотов планировщика
+#define TX_SCHED_MAX_SLOTS 64
+
+// Параметры планировщика
+typedef struct {
+    uint8_t capacity;              // Слотов всего (не более TX_SCHED_MAX_SLOTS)
+    uint8_t reserve;               // Слотов, недоступных вытесняемым классам
+    uint8_t weight[TX_CLASS_COUNT];// Вес классов с долей полосы (для остальных не используется)
+} tx_sched_config_t;
+
+// Счетчики класса
+typedef struct {
+    uint32_t enqueued;             // Принято в очередь
+    uint32_t dropped;              // Вытеснено
+    uint32_t rejected;             // Отклонено из-за заполненной очереди
+    uint32_t depth;                // Текущая длина очереди класса
+    latency_hist_t queue_delay_us; // Время от постановки в очередь до извлечения
+} tx_sched_class_stats_t;
+
+// Очереди классов над общим набором слотов. Планировщик хранит только
+// индексы слотов, данные пакетов хранит вызывающий код в массиве той же
+// емкости. Функции не потокобезопасны
+typedef struct {
+    tx_sched_config_t config;
+    uint8_t order[TX_CLASS_COUNT][TX_SCHED_MAX_SLOTS]; // Кольца индексов по классам
+    uint8_t head[TX_CLASS_COUNT];
+    uint8_t count[TX_CLASS_COUNT];
+    uint8_t free_slots[TX_SCHED_MAX_SLOTS];
+    uint8_t free_count;
+    uint8_t weighted_count;        // Слотов в очередях вытесняемых классов
+    uint8_t pinned_count;          // Из них слотов с невытесняемыми пакетами
+    bool pinned[TX_SCHED_MAX_SLOTS];// Пакет слота не вытесняется
+    uint16_t len[TX_SCHED_MAX_SLOTS];
+    int64_t enqueued_us[TX_SCHED_MAX_SLOTS];
+    int32_t deficit[TX_CLASS_COUNT]; // Дефицит взвешенного циклического обслуживания, байт
+    uint8_t drr_class;             // Класс, обслуживаемый по весу в текущем раунде
+    int8_t selected;               // Класс, выбранный tx_sched_peek
+    uint8_t selected_pos;          // Позиция выбранного пакета в очереди класса
+    tx_sched_class_stats_t stats[TX_CLASS_COUNT];
+} tx_sched_t;
+
+/**
+ * Инициализирует планировщик. Резерв ограничивается так, чтобы вытесняемым
+ * классам оставался хотя бы один слот
+ */
+void tx_sched_init(tx_sched_t *sched, const tx_sched_config_t *config);
+
+/**
+ * Определяет класс пакета ESP-NOW по первому байту без декодирования:
+ * тип сообщения, контейнер (класс самого приоритетного кадра) или
+ * служебный кадр надежной доставки (класс вложенного кадра) или фрагмент
+ * (класс исходного кадра)
+ */
+tx_class_t tx_class_of(const uint8_t *packet, size_t len);
+
+/**
+ * Можно ли вытеснить пакет из очереди. Фрагменты не вытесняются: потеря
+ * одного фрагмента делает бесполезными остальные фрагменты кадра. Ответы
+ * на запросы чтения журнала полета тоже не вытесняются
+ */
+bool tx_evictable(const uint8_t *packet, size_t len);
+
+/**
+ * Выделяет слот для пакета класса cls длины len. При нехватке места
+ * вытесняет самый старый вытесняемый пакет наименее приоритетного
+ * вытесняемого класса (не выше cls для вытесняемых классов); dropped
+ * устанавливается в true. Невытесняемые пакеты (evictable = false) занимают
+ * не больше половины слотов вытесняемых классов, чтобы не вытеснять из
+ * очереди телеметрию. Возвращает индекс слота или -1, если места нет и
+ * вытеснить нечего
+ */
+int tx_sched_push(tx_sched_t *sched, tx_class_t cls, uint16_t len, bool evictable, int64_t now_us,
+                  bool *dropped);
+
+/**
+ * Сколько пакетов класса cls tx_sched_push примет сейчас, с учетом
+ * вытеснения. Копии одного пакета нескольким получателям ставятся, только
+ * если места хватает всем: иначе повтор поставил бы часть копий дважды
+ */
+uint32_t tx_sched_room(const tx_sched_t *sched, tx_class_t cls, bool evictable);
+
+/**
+ * Выбирает следующий пакет: тревоги, затем команды, затем классы с долей
+ * полосы по алгоритму deficit round robin. Возвращает индекс слота или -1.
+ * Выбранный пакет остается в очереди до tx_sched_pop
+ */
+int tx_sched_peek(tx_sched_t *sched);
+
+/**
+ * Пакет слота slot можно передать сейчас (например, у получателя есть
+ * место "в полете")
+ */
+typedef bool (*tx_sched_eligible_fn)(int slot, void *ctx);
+
+/**
+ * Как tx_sched_peek, но выбирает только пакеты, для которых eligible
+ * возвращает true. Пакет, который нельзя передать, не задерживает другие
+ * классы и пакеты своего класса другим получателям: в классе выбирается
+ * самый старый подходящий пакет, порядок пакетов одному получателю
+ * сохраняется. eligible = NULL - все пакеты подходят
+ */
+int tx_sched_peek_eligible(tx_sched_t *sched, tx_sched_eligible_fn eligible, void *ctx);
+
+/**
+ * Извлекает пакет, выбранный tx_sched_peek, и учитывает время ожидания.
+ * Очередь не должна изменяться между вызовами. Возвращает индекс слота,
+ * который остается занятым до tx_sched_release
+ */
+int tx_sched_pop(tx_sched_t *sched, int64_t now_us);
+
+/**
+ * Освобождает слот извлеченного пакета
+ */
+void tx_sched_release(tx_sched_t *sched, int slot);
+
+/**
+ * Пакетов во всех очередях
+ */
+uint32_t tx_sched_depth(const tx_sched_t *sched);
+
+#endif /* TX_SCHED_H */
@@ -3,14 +3,58 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include "driver/uart.h"
 #include "driver/gpio.h"
+#include "sdkconfig.h"
+#include "frame_parser.h"
 
-#define UART_PORT           UART_NUM_0  // Можно использовать UART_NUM_1 или UART_NUM_2
-#define UART_BAUD_RATE      115200
-#define UART_BUF_SIZE       1024
-#define UART_TX_PIN         GPIO_NUM_1  // Настройте под свою плату
-#define UART_RX_PIN         GPIO_NUM_3  // Настройте под свою плату
+#define UART_PORT           CONFIG_BRIDGE_UART_PORT_NUM
+#define UART_BAUD_RATE      CONFIG_BRIDGE_UART_BAUD_RATE
+#define UART_RX_BUF_SIZE    CONFIG_BRIDGE_UART_RX_BUF_SIZE
+#define UART_TX_BUF_SIZE    CONFIG_BRIDGE_UART_TX_BUF_SIZE
+#define UART_TX_PIN         GPIO_NUM_1  // Выводы UART0, для другого порта настройте под свою плату
+#define UART_RX_PIN         GPIO_NUM_3  // Выводы UART0, для другого порта настройте под свою плату
+#define UART_RTS_PIN        GPIO_NUM_22 // Используется при CONFIG_BRIDGE_UART_FLOW_CTRL
+#define UART_CTS_PIN        GPIO_NUM_19 // Используется при CONFIG_BRIDGE_UART_FLOW_CTRL
+
+#define UART_EVENT_QUEUE_LEN    CONFIG_BRIDGE_UART_EVENT_QUEUE_LEN
+#define UART_RX_TIMEOUT_SYMBOLS CONFIG_BRIDGE_UART_RX_TIMEOUT
+
+#if CONFIG_BRIDGE_UART_FRAMING_LENGTH
+#define UART_FRAME_MODE     FRAME_MODE_LENGTH
+#else
+#define UART_FRAME_MODE     FRAME_MODE_MARKERS
+#endif
+
+// Порт полетного контроллера выводит и журнал консоли
+#if defined(CONFIG_ESP_CONSOLE_UART_NUM) && CONFIG_ESP_CONSOLE_UART_NUM == CONFIG_BRIDGE_UART_PORT_NUM
+#define UART_PORT_IS_CONSOLE 1
+#else
+#define UART_PORT_IS_CONSOLE 0
+#endif
+
+// Кадр согласования скорости: [MAGIC][OP][BAUD LE32]
+#define UART_BAUD_MAGIC      0xAB
+#define UART_BAUD_FRAME_SIZE 6
+
+typedef enum {
+    UART_BAUD_REQUEST = 1,         // Мост -> контроллер: предлагаемая скорость
+    UART_BAUD_ACCEPT = 2,          // Контроллер -> мост: принятая скорость (0 - отказ)
+    UART_BAUD_CHECK = 3,           // Мост -> контроллер на новой скорости
+    UART_BAUD_CHECK_ACK = 4        // Контроллер -> мост на новой скорости
+} uart_baud_op_t;
+
+// Счетчики приема
+typedef struct {
+    uint32_t frames;               // Выдано кадров
+    uint32_t bytes;                // Прочитано байт из драйвера
+    uint32_t fifo_overflows;       // Переполнений аппаратного FIFO
+    uint32_t buffer_overflows;     // Переполнений кольцевого буфера драйвера
+    uint32_t frame_errors;         // Ошибок кадра UART (стоп-бит)
+    uint32_t parser_overflows;     // Кадров, отброшенных разборщиком
+    uint32_t baud_rate;            // Текущая скорость
+} uart_stats_t;
 
 /**
  * Функция инициализации
@@ -23,8 +67,46 @@ int uart_init(int baud_rate);
 int uart_send_data(const uint8_t *data, size_t len);
 
 /**
- * Получение данных
+ * Получение данных: возвращает следующий собранный кадр, при необходимости
+ * ожидая события драйвера UART не дольше ticks_to_wait.
+ * Несколько кадров из одного чтения выдаются последовательными вызовами.
+ * В rx_time (может быть NULL) - время (esp_timer, мкс) события UART, с
+ * которым пришел первый байт кадра.
+ * Возвращает длину кадра (0 - кадра нет, -1 - ошибка)
+ */
+int uart_receive_data(uint8_t *data, size_t max_len, int64_t *rx_time, TickType_t ticks_to_wait);
+
+/**
+ * Включает согласование скорости target_baud с полетным контроллером.
+ * Согласование начинается после первого принятого кадра и выполняется
+ * внутри uart_receive_data: ответы контроллера, которых мост ждет,
+ * вызывающему не выдаются. Если контроллер не отвечает, мост остается на
+ * начальной скорости. На порту консоли скорость не меняется
+ */
+void uart_negotiate_baud(uint32_t target_baud);
+
+/**
+ * Возвращает снимок счетчиков приема
+ */
+void uart_get_stats(uart_stats_t *stats);
+
+#ifdef TEST_BUILD
+// Результат проверки пропускной способности
+typedef struct {
+    uint32_t baud_rate;
+    uint32_t frames_sent;
+    uint32_t frames_received;
+    uint32_t overruns;             // Переполнения FIFO и буфера драйвера, потери разборщика
+    uint32_t bytes_per_s;          // Принято байт в секунду
+} uart_loopback_result_t;
+
+/**
+ * Непрерывно передает кадры размера сообщения дрона через внутреннюю
+ * петлю порта port (TX -> RX, RTS -> CTS) с настройками моста на скорости
+ * baud в течение duration_ms и считает принятые кадры и переполнения.
+ * Порт не должен использоваться консолью
  */
-int uart_receive_data(uint8_t *data, size_t max_len);
+void uart_loopback_test(uart_port_t port, uint32_t baud, uint32_t duration_ms, uart_loopback_result_t *result);
+#endif
 
 #endif /* UART_HANDLER_H */
\ No newline at end of file
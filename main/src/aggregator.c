@@ -0,0 +1,64 @@
+#include <string.h>
+#include "aggregator.h"
+
+void aggregator_reset(aggregator_t *agg) {
+    if (!agg) return;
+    
+    agg->buf[0] = AGGREGATOR_MAGIC;
+    agg->buf[1] = 0;
+    agg->len = AGGREGATOR_HEADER_SIZE;
+    agg->count = 0;
+    agg->last_frame_len = 0;
+}
+
+bool aggregator_fits(const aggregator_t *agg, size_t len) {
+    return len > 0 && len <= AGGREGATOR_MAX_FRAME && agg->len + 1 + len <= AGGREGATOR_MAX_SIZE;
+}
+
+bool aggregator_add(aggregator_t *agg, const uint8_t *frame, size_t len) {
+    if (!agg || !frame || !aggregator_fits(agg, len)) {
+        return false;
+    }
+    
+    agg->buf[agg->len++] = (uint8_t)len;
+    memcpy(agg->buf + agg->len, frame, len);
+    agg->len += len;
+    agg->count++;
+    agg->buf[1] = agg->count;
+    agg->last_frame_len = len;
+    return true;
+}
+
+bool aggregator_should_flush(const aggregator_t *agg) {
+    return agg->count > 0 && !aggregator_fits(agg, agg->last_frame_len);
+}
+
+bool aggregator_is_container(const uint8_t *data, size_t len) {
+    return data && len >= AGGREGATOR_HEADER_SIZE && data[0] == AGGREGATOR_MAGIC;
+}
+
+int aggregator_unpack(const uint8_t *data, size_t len, aggregator_frame_cb_t cb, void *user_ctx) {
+    if (!aggregator_is_container(data, len)) {
+        return -1;
+    }
+    
+    // Сначала проверяем целостность всех записей, чтобы не выдать часть кадров
+    uint8_t count = data[1];
+    size_t pos = AGGREGATOR_HEADER_SIZE;
+    for (int i = 0; i < count; i++) {
+        if (pos >= len || data[pos] == 0 || pos + 1 + data[pos] > len) {
+            return -1;
+        }
+        pos += 1 + data[pos];
+    }
+    
+    pos = AGGREGATOR_HEADER_SIZE;
+    for (int i = 0; i < count; i++) {
+        size_t frame_len = data[pos];
+        if (cb) {
+            cb(data + pos + 1, frame_len, user_ctx);
+        }
+        pos += 1 + frame_len;
+    }
+    return count;
+}
@@ -0,0 +1,1710 @@
+#include "bench.h"
+
+#ifdef TEST_BUILD
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "drone_message.h"
+#include "drone_msg_view.h"
+#include "drone_compact.h"
+#include "drone_typed.h"
+#include "frame_parser.h"
+#include "aggregator.h"
+#include "crc.h"
+#include "tx_sched.h"
+#include "peer_table.h"
+#include "fleet_table.h"
+#include "fragment.h"
+#include "flightrec.h"
+#include "transport.h"
+#include "timesync.h"
+#include "rate_ctrl.h"
+#include "metrics.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "BENCH";
+
+// Поток для разбора: кадры drone_message_t с обрамлением
+#define STREAM_FRAMES 32
+#define STREAM_FRAME_SIZE (DRONE_MSG_PACKET_SIZE + FRAME_LEN_HEADER_SIZE + 2)
+
+// Поток для фаззинга разборщика: случайные байты вперемешку с кадрами
+#define FUZZ_STREAM_SIZE 4096
+
+static uint8_t stream[STREAM_FRAMES * STREAM_FRAME_SIZE];
+static tx_sched_t bench_sched;
+static peer_table_t bench_peers;
+static uint8_t bench_macs[PEER_TABLE_CAPACITY][PEER_MAC_LEN];
+static fleet_table_t bench_fleet_table;
+static uint8_t fuzz_stream[FUZZ_STREAM_SIZE];
+static frame_parser_t bench_parser;
+static frame_parser_t bench_parser_ref;
+
+// Результаты вычислений, чтобы компилятор не удалил измеряемый код
+static volatile uint32_t sink;
+
+static uint32_t benchmarks;
+static uint32_t violations;
+
+// Детерминированный генератор (xorshift32): фаззинг воспроизводится между запусками
+static uint32_t rng_state;
+
+static uint32_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void report_bench(const char *name, uint32_t ops, int64_t elapsed_us, size_t bytes_per_op) {
+    if (elapsed_us <= 0) {
+        elapsed_us = 1;
+    }
+    uint32_t ns_per_op = (uint32_t)(elapsed_us * 1000 / ops);
+    uint32_t kb_s = (uint32_t)((uint64_t)ops * bytes_per_op * 1000000 / 1024 / elapsed_us);
+
+    ESP_LOGI(TAG, "BENCH {\"name\":\"%s\",\"ops\":%" PRIu32 ",\"ns_per_op\":%" PRIu32 ",\"kb_s\":%" PRIu32 "}",
+             name, ops, ns_per_op, kb_s);
+    benchmarks++;
+
+    // Даем поработать задаче IDLE, иначе сработает сторожевой таймер
+    vTaskDelay(1);
+}
+
+static void report_fuzz(const char *name, uint32_t iterations, uint32_t accepted, uint32_t failed) {
+    ESP_LOGI(TAG, "FUZZ {\"name\":\"%s\",\"iterations\":%" PRIu32 ",\"accepted\":%" PRIu32 ",\"violations\":%" PRIu32 "}",
+             name, iterations, accepted, failed);
+    violations += failed;
+    vTaskDelay(1);
+}
+
+// Тело замера передается последним аргументом и может содержать запятые
+#define BENCH(name, ops, bytes_per_op, ...) do {                        \
+        int64_t bench_start = esp_timer_get_time();                     \
+        for (uint32_t bench_i = 0; bench_i < (ops); bench_i++) {        \
+            __VA_ARGS__;                                                \
+        }                                                               \
+        report_bench(name, ops, esp_timer_get_time() - bench_start, bytes_per_op); \
+    } while (0)
+
+static void make_message(drone_message_t *msg, uint8_t id) {
+    drone_msg_init(msg);
+    msg->msg_id = id;
+    msg->timestamp = 1000u * id;
+    msg->latitude = 55.751244f;
+    msg->longitude = 37.618423f;
+    msg->altitude = 152.4f;
+    msg->relative_altitude = 12.5f;
+    msg->roll = 1.5f;
+    msg->pitch = -2.25f;
+    msg->yaw = 91.0f;
+    msg->vx = 3.1f;
+    msg->battery_current = 4.2f;
+    msg->flight_time = id;
+    msg->status_flags = DRONE_FLAG_ARMED | DRONE_FLAG_FLYING | DRONE_FLAG_GPS_FIX;
+    msg->satellites = 11;
+    msg->fix_type = 2;
+}
+
+static size_t build_stream(frame_mode_t mode) {
+    size_t len = 0;
+    for (int i = 0; i < STREAM_FRAMES; i++) {
+        drone_message_t msg;
+        make_message(&msg, i);
+        len += frame_encode_header(mode, DRONE_MSG_PACKET_SIZE, stream + len);
+        len += drone_msg_encode(&msg, stream + len, DRONE_MSG_PACKET_SIZE);
+        len += frame_encode_trailer(mode, stream + len - DRONE_MSG_PACKET_SIZE, DRONE_MSG_PACKET_SIZE, stream + len);
+    }
+    return len;
+}
+
+static void count_frame(const uint8_t *frame, size_t len, void *user_ctx) {
+    (*(uint32_t *)user_ctx)++;
+}
+
+static void bench_codecs(void) {
+    drone_message_t msg;
+    drone_message_t decoded;
+    uint8_t packet[DRONE_MSG_PACKET_SIZE];
+    static uint8_t crc_block[1024];
+
+    make_message(&msg, 1);
+    drone_msg_encode(&msg, packet, sizeof(packet));
+    for (int i = 0; i < sizeof(crc_block); i++) {
+        crc_block[i] = (uint8_t)rng_next();
+    }
+
+    BENCH("checksum_v1", 20000, DRONE_MSG_PAYLOAD_SIZE,
+          sink += drone_msg_calculate_checksum(packet, DRONE_MSG_PAYLOAD_SIZE));
+    BENCH("crc16_v2", 20000, DRONE_MSG_PAYLOAD_SIZE,
+          sink += drone_msg_calculate_crc(packet, DRONE_MSG_PAYLOAD_SIZE));
+    BENCH("crc32_1k", 500, sizeof(crc_block),
+          sink += crc32_ieee(crc_block, sizeof(crc_block)));
+    BENCH("encode_v2", 10000, DRONE_MSG_PACKET_SIZE,
+          sink += drone_msg_encode(&msg, packet, sizeof(packet)));
+    BENCH("decode_v2", 10000, DRONE_MSG_PACKET_SIZE,
+          sink += drone_msg_decode(packet, sizeof(packet), &decoded));
+    BENCH("verify_v2", 10000, DRONE_MSG_PACKET_SIZE,
+          sink += drone_msg_verify(packet, sizeof(packet)));
+    // Те же поля через разбор в структуру и из кадра по смещениям
+    BENCH("decode_inspect", 10000, 0, {
+        drone_msg_decode(packet, sizeof(packet), &decoded);
+        sink += decoded.msg_type + decoded.msg_id + decoded.timestamp;
+    });
+    BENCH("view_inspect", 100000, 0,
+          sink += drone_msg_get_msg_type(packet) + drone_msg_get_msg_id(packet) + drone_msg_get_timestamp(packet));
+
+    drone_compact_encoder_t enc;
+    drone_compact_decoder_t dec;
+    uint8_t compact[DRONE_COMPACT_MAX_SIZE];
+    int compact_len = 0;
+
+    drone_compact_encoder_init(&enc, 10);
+    BENCH("compact_encode", 10000, sizeof(drone_message_t), {
+        msg.timestamp += 100;
+        msg.latitude += 1e-5f;
+        compact_len = drone_compact_encode(&enc, &msg, compact, sizeof(compact));
+    });
+
+    drone_compact_decoder_init(&dec);
+    drone_compact_force_keyframe(&enc);
+    compact_len = drone_compact_encode(&enc, &msg, compact, sizeof(compact));
+    BENCH("compact_decode_key", 10000, compact_len,
+          sink += drone_compact_decode(&dec, compact, compact_len, &decoded));
+
+    // Подтверждение: формат типа против полного пакета
+    uint8_t typed[DRONE_TYPED_MAX_SIZE];
+    drone_msg_init(&msg);
+    msg.msg_type = MSG_TYPE_ACK;
+    msg.timestamp = 123456;
+    drone_typed_clear_unused(&msg);
+    drone_msg_encode(&msg, packet, sizeof(packet));
+    BENCH("typed_encode_ack", 10000, DRONE_MSG_PACKET_SIZE,
+          sink += drone_typed_encode(packet, sizeof(packet), typed, sizeof(typed)));
+    BENCH("typed_expand_ack", 10000, DRONE_TYPED_SIZE_ACK,
+          sink += drone_typed_expand(typed, DRONE_TYPED_SIZE_ACK, packet, sizeof(packet)));
+}
+
+static void bench_parsers(frame_mode_t mode, const char *feed_name, const char *ring_name) {
+    size_t len = build_stream(mode);
+    // Проход потока занимает около 10 мкс на хосте: меньшее число проходов
+    // измеряет в основном дрожание таймера
+    const uint32_t rounds = 1000;
+    uint32_t frames = 0;
+
+    // Прямой разбор блоками случайной длины, как при чтении из драйвера UART
+    frame_parser_init(&bench_parser, mode);
+    rng_state = 0x2545F491;
+    BENCH(feed_name, rounds, len, {
+        size_t pos = 0;
+        while (pos < len) {
+            size_t chunk = 1 + rng_next() % 128;
+            if (chunk > len - pos) chunk = len - pos;
+            frame_parser_feed(&bench_parser, stream + pos, chunk, count_frame, &frames);
+            pos += chunk;
+        }
+    });
+    if (frames != rounds * STREAM_FRAMES) {
+        ESP_LOGE(TAG, "%s: собрано %" PRIu32 " кадров из %" PRIu32, feed_name, frames, rounds * STREAM_FRAMES);
+        violations++;
+    }
+
+    // Разбор через кольцевой буфер (путь uart_receive_data)
+    frames = 0;
+    frame_parser_init(&bench_parser, mode);
+    BENCH(ring_name, rounds, len, {
+        size_t pos = 0;
+        const uint8_t *frame;
+        size_t frame_len;
+        while (pos < len) {
+            size_t chunk = 1 + rng_next() % 128;
+            if (chunk > len - pos) chunk = len - pos;
+            pos += frame_parser_write(&bench_parser, stream + pos, chunk);
+            while (frame_parser_next(&bench_parser, &frame, &frame_len) > 0) {
+                frames++;
+            }
+        }
+    });
+    if (frames != rounds * STREAM_FRAMES) {
+        ESP_LOGE(TAG, "%s: собрано %" PRIu32 " кадров из %" PRIu32, ring_name, frames, rounds * STREAM_FRAMES);
+        violations++;
+    }
+}
+
+// Мутирует пакет: 1-3 инвертированных бита
+static void flip_bits(uint8_t *buf, size_t len) {
+    int flips = 1 + rng_next() % 3;
+    for (int i = 0; i < flips; i++) {
+        uint32_t bit = rng_next() % (len * 8);
+        buf[bit / 8] ^= 1 << (bit % 8);
+    }
+}
+
+static void fuzz_decode(void) {
+    const uint32_t iterations = 20000;
+    drone_message_t msg;
+    drone_message_t decoded;
+    uint8_t original[DRONE_MSG_PACKET_SIZE];
+    uint8_t packet[DRONE_MSG_PACKET_SIZE];
+    uint8_t reencoded[DRONE_MSG_PACKET_SIZE];
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+
+    make_message(&msg, 7);
+    drone_msg_encode(&msg, original, sizeof(original));
+
+    // CRC-16 обнаруживает любые 1-3 битовые ошибки в пакете версии 2;
+    // искажение поля version не переводит пакет на проверку версии 1
+    for (uint32_t i = 0; i < iterations; i++) {
+        memcpy(packet, original, sizeof(packet));
+        flip_bits(packet, sizeof(packet));
+        if (drone_msg_decode(packet, sizeof(packet), &decoded) == 0) {
+            accepted++;
+            if ((drone_msg_get_version(packet) == DRONE_MSG_VERSION &&
+                 memcmp(packet, original, sizeof(packet)) != 0) ||
+                drone_msg_verify(packet, sizeof(packet)) < 0) {
+                failed++;
+            }
+        }
+    }
+    report_fuzz("decode_bitflip", iterations, accepted, failed);
+
+    // Случайные данные случайной длины: принятый полный пакет проходит
+    // drone_msg_verify, пакет версии 2 кодируется обратно в те же байты
+    accepted = 0;
+    failed = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        int len = rng_next() % (DRONE_MSG_PACKET_SIZE + 1);
+        for (int j = 0; j < len; j++) {
+            packet[j] = (uint8_t)rng_next();
+        }
+        if (len == DRONE_MSG_PACKET_SIZE && (rng_next() & 1)) {
+            packet[DRONE_MSG_OFF_VERSION] = DRONE_MSG_VERSION;
+        }
+        if (drone_msg_decode(packet, len, &decoded) == 0) {
+            accepted++;
+            if (len == DRONE_MSG_PACKET_SIZE && drone_msg_verify(packet, len) < 0) {
+                failed++;
+            }
+            if (len == DRONE_MSG_PACKET_SIZE && decoded.version == DRONE_MSG_VERSION &&
+                (drone_msg_encode(&decoded, reencoded, sizeof(reencoded)) != DRONE_MSG_PACKET_SIZE ||
+                 memcmp(packet, reencoded, DRONE_MSG_PAYLOAD_SIZE - 1) != 0)) {
+                failed++;
+            }
+        }
+    }
+    report_fuzz("decode_random", iterations, accepted, failed);
+}
+
+static void fuzz_compact(void) {
+    const uint32_t iterations = 20000;
+    drone_compact_encoder_t enc;
+    drone_compact_decoder_t dec;
+    drone_message_t msg;
+    drone_message_t decoded;
+    uint8_t original[DRONE_COMPACT_MAX_SIZE];
+    uint8_t frame[DRONE_COMPACT_MAX_SIZE];
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+
+    make_message(&msg, 3);
+    drone_compact_encoder_init(&enc, 10);
+    drone_compact_decoder_init(&dec);
+    int len = drone_compact_encode(&enc, &msg, original, sizeof(original));
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        memcpy(frame, original, len);
+        flip_bits(frame, len);
+        if (drone_compact_decode(&dec, frame, len, &decoded) == 0) {
+            accepted++;
+            if (memcmp(frame, original, len) != 0) {
+                failed++;
+            }
+        }
+        // Случайный кадр произвольной длины не должен приводить к сбою
+        int random_len = rng_next() % (DRONE_COMPACT_MAX_SIZE + 1);
+        for (int j = 0; j < random_len; j++) {
+            frame[j] = (uint8_t)rng_next();
+        }
+        frame[1] = DRONE_MSG_VERSION_COMPACT;
+        sink += drone_compact_decode(&dec, frame, random_len, &decoded);
+    }
+    report_fuzz("compact_bitflip", iterations, accepted, failed);
+}
+
+// Случайные пакеты всех типов: формат типа получается, только если поля
+// вне формата нулевые, и восстанавливается в исходные байты; битовые
+// ошибки в кадре формата типа обнаруживаются
+static void fuzz_typed(void) {
+    const uint32_t iterations = 20000;
+    drone_message_t msg;
+    uint8_t packet[DRONE_MSG_PACKET_SIZE];
+    uint8_t expanded[DRONE_MSG_PACKET_SIZE];
+    uint8_t typed[DRONE_TYPED_MAX_SIZE];
+    uint8_t frame[DRONE_TYPED_MAX_SIZE];
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (int j = 0; j < DRONE_MSG_PAYLOAD_SIZE; j++) {
+            packet[j] = (uint8_t)rng_next();
+        }
+        drone_msg_set_msg_type(packet, 1 + rng_next() % 5);
+        drone_msg_set_version(packet, DRONE_MSG_VERSION);
+        drone_msg_set_reserved(packet, 0);
+        drone_msg_set_checksum(packet, drone_msg_calculate_crc(packet, DRONE_MSG_PAYLOAD_SIZE));
+        bool cleared = rng_next() & 1;
+        if (cleared) {
+            drone_msg_decode(packet, sizeof(packet), &msg);
+            drone_typed_clear_unused(&msg);
+            drone_msg_encode(&msg, packet, sizeof(packet));
+        }
+
+        int size = drone_typed_size(drone_msg_get_msg_type(packet));
+        int len = drone_typed_encode(packet, sizeof(packet), typed, sizeof(typed));
+        if (len < 0) {
+            // Без формата типа или с ненулевыми полями вне его
+            if (cleared && size) {
+                failed++;
+            }
+            continue;
+        }
+        accepted++;
+        if (len != size || !drone_typed_is_typed(typed, len) ||
+            drone_typed_expand(typed, len, expanded, sizeof(expanded)) != DRONE_MSG_PACKET_SIZE ||
+            memcmp(expanded, packet, sizeof(packet)) != 0) {
+            failed++;
+            continue;
+        }
+
+        // CRC-16 обнаруживает любые 1-3 битовые ошибки; кадр, переставший
+        // быть кадром формата типа, не восстанавливается
+        memcpy(frame, typed, len);
+        flip_bits(frame, len);
+        if (drone_typed_expand(frame, len, expanded, sizeof(expanded)) >= 0 && memcmp(frame, typed, len) != 0) {
+            failed++;
+        }
+    }
+    report_fuzz("typed", iterations, accepted, failed);
+}
+
+typedef struct {
+    uint32_t frames;
+    uint32_t hash;
+} parser_digest_t;
+
+static void digest_frame(const uint8_t *frame, size_t len, void *user_ctx) {
+    parser_digest_t *digest = user_ctx;
+    uint8_t len_bytes[2] = { len & 0xFF, len >> 8 };
+    digest->hash = crc32_ieee_update(digest->hash, len_bytes, sizeof(len_bytes));
+    digest->hash = crc32_ieee_update(digest->hash, frame, len);
+    digest->frames++;
+}
+
+// Случайный поток: мусор, обрывки и корректные кадры произвольной длины
+static size_t build_fuzz_stream(frame_mode_t mode) {
+    size_t len = 0;
+    while (len + FRAME_LEN_HEADER_SIZE + 2 + 300 < FUZZ_STREAM_SIZE) {
+        uint32_t kind = rng_next() % 4;
+        size_t n = 1 + rng_next() % 300;
+        if (kind == 0) {
+            for (size_t i = 0; i < n; i++) {
+                fuzz_stream[len++] = (uint8_t)rng_next();
+            }
+        } else {
+            len += frame_encode_header(mode, n, fuzz_stream + len);
+            for (size_t i = 0; i < n; i++) {
+                fuzz_stream[len++] = (uint8_t)rng_next();
+            }
+            if (kind != 1) {
+                len += frame_encode_trailer(mode, fuzz_stream + len - n, n, fuzz_stream + len);
+            }
+        }
+    }
+    return len;
+}
+
+// Результат разбора не должен зависеть от того, как поток разбит на блоки
+static void fuzz_parser(frame_mode_t mode, const char *name) {
+    const uint32_t iterations = 50;
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        size_t len = build_fuzz_stream(mode);
+        parser_digest_t whole = {0};
+        parser_digest_t split = {0};
+
+        frame_parser_init(&bench_parser_ref, mode);
+        frame_parser_feed(&bench_parser_ref, fuzz_stream, len, digest_frame, &whole);
+
+        frame_parser_init(&bench_parser, mode);
+        size_t pos = 0;
+        while (pos < len) {
+            size_t chunk = 1 + rng_next() % 200;
+            if (chunk > len - pos) chunk = len - pos;
+            pos += frame_parser_write(&bench_parser, fuzz_stream + pos, chunk);
+
+            const uint8_t *frame;
+            size_t frame_len;
+            while (frame_parser_next(&bench_parser, &frame, &frame_len) > 0) {
+                if (frame_len == 0 || frame_len > FRAME_PARSER_MAX_FRAME) {
+                    failed++;
+                }
+                digest_frame(frame, frame_len, &split);
+            }
+        }
+
+        accepted += whole.frames;
+        if (whole.frames != split.frames || whole.hash != split.hash) {
+            failed++;
+        }
+    }
+    report_fuzz(name, iterations, accepted, failed);
+}
+
+// Разбирает fuzz_stream целиком и через кольцевой буфер блоками случайной
+// длины. Все кадры должны собраться, позиция начала каждого - его
+// синхрослово, а не ложное перед ним. Возвращает количество ошибок
+static uint32_t check_parser_resync(size_t len, const uint32_t *starts, uint32_t count,
+                                    uint32_t payload_errors, uint32_t *accepted) {
+    uint32_t failed = 0;
+    parser_digest_t digest = {0};
+    frame_parser_init(&bench_parser, FRAME_MODE_LENGTH);
+    frame_parser_feed(&bench_parser, fuzz_stream, len, digest_frame, &digest);
+    *accepted += digest.frames;
+    if (digest.frames != count || bench_parser.payload_errors != payload_errors) {
+        failed++;
+    }
+
+    frame_parser_init(&bench_parser, FRAME_MODE_LENGTH);
+    uint32_t found = 0;
+    size_t pos = 0;
+    while (pos < len) {
+        size_t chunk = 1 + rng_next() % 128;
+        if (chunk > len - pos) chunk = len - pos;
+        pos += frame_parser_write(&bench_parser, fuzz_stream + pos, chunk);
+        const uint8_t *frame;
+        size_t frame_len;
+        while (frame_parser_next(&bench_parser, &frame, &frame_len) > 0) {
+            if (found >= count || bench_parser.frame_start != starts[found]) {
+                failed++;
+            }
+            found++;
+        }
+    }
+    if (found != count) {
+        failed++;
+    }
+    return failed;
+}
+
+// Дописывает в fuzz_stream кадр с сообщением номер seq, возвращает новую длину
+static size_t append_message_frame(size_t len, uint8_t seq) {
+    drone_message_t msg;
+    make_message(&msg, seq);
+    len += frame_encode_header(FRAME_MODE_LENGTH, DRONE_MSG_PACKET_SIZE, fuzz_stream + len);
+    len += drone_msg_encode(&msg, fuzz_stream + len, DRONE_MSG_PACKET_SIZE);
+    len += frame_encode_trailer(FRAME_MODE_LENGTH, fuzz_stream + len - DRONE_MSG_PACKET_SIZE,
+                                DRONE_MSG_PACKET_SIZE, fuzz_stream + len);
+    return len;
+}
+
+// Перед каждым кадром - ложное синхрослово с 1-3 байтами, заголовок из
+// которых не проходит проверку. Настоящий кадр начинается внутри ложного
+// заголовка, и ни один кадр не должен потеряться
+static void fuzz_parser_resync(void) {
+    const uint32_t iterations = 50;
+    const uint32_t frames_per_stream = 48;
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+    uint32_t starts[48];   // Позиции синхрослов настоящих кадров
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        size_t len = 0;
+        for (uint32_t f = 0; f < frames_per_stream; f++) {
+            size_t prefix = 1 + rng_next() % 3;
+            uint8_t frame_header[FRAME_LEN_HEADER_SIZE];
+            frame_encode_header(FRAME_MODE_LENGTH, DRONE_MSG_PACKET_SIZE, frame_header);
+
+            // Ложный заголовок: синхрослово, prefix случайных байт и начало кадра
+            uint8_t false_header[2 + 3 + FRAME_LEN_HEADER_SIZE];
+            uint8_t check[FRAME_LEN_HEADER_SIZE];
+            size_t false_len;
+            do {
+                false_header[0] = FRAME_SYNC_1;
+                false_header[1] = FRAME_SYNC_2;
+                for (size_t b = 0; b < prefix; b++) {
+                    false_header[2 + b] = (uint8_t)rng_next();
+                }
+                memcpy(false_header + 2 + prefix, frame_header, FRAME_LEN_HEADER_SIZE);
+                false_len = false_header[2] | ((size_t)false_header[3] << 8);
+                frame_encode_header(FRAME_MODE_LENGTH, false_len, check);
+            } while (check[4] == false_header[4] && false_len > 0 && false_len <= FRAME_PARSER_MAX_FRAME);
+
+            memcpy(fuzz_stream + len, false_header, 2 + prefix);
+            len += 2 + prefix;
+            starts[f] = (uint32_t)len;
+            len = append_message_frame(len, (uint8_t)f);
+        }
+        failed += check_parser_resync(len, starts, frames_per_stream, 0, &accepted);
+    }
+    report_fuzz("parser_resync_length", iterations, accepted, failed);
+}
+
+// Перед каждым кадром - ложный заголовок с верной CRC-8 и случайной длиной:
+// его данные захватывают настоящий кадр целиком или частично, а CRC данных
+// не сходится. Разбор продолжается с байта после ложного синхрослова, и
+// ни один кадр не должен потеряться
+static void fuzz_parser_resync_payload(void) {
+    const uint32_t iterations = 50;
+    const uint32_t frames_per_stream = 24;
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+    uint32_t starts[24];   // Позиции синхрослов настоящих кадров
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        size_t len = 0;
+        for (uint32_t f = 0; f < frames_per_stream; f++) {
+            size_t begin = len;
+            size_t false_len;
+            uint16_t crc;
+            do {
+                // Ложные данные и их CRC: настоящий кадр, затем заполнитель
+                false_len = 1 + rng_next() % 150;
+                len = begin + frame_encode_header(FRAME_MODE_LENGTH, false_len, fuzz_stream + begin);
+                starts[f] = (uint32_t)len;
+                len = append_message_frame(len, (uint8_t)f);
+                while (len < starts[f] + false_len + FRAME_LEN_TRAILER_SIZE) {
+                    fuzz_stream[len++] = (uint8_t)rng_next();
+                }
+                const uint8_t *trailer = fuzz_stream + starts[f] + false_len;
+                crc = trailer[0] | ((uint16_t)trailer[1] << 8);
+            } while (crc16_ccitt(fuzz_stream + starts[f], false_len) == crc);
+        }
+        failed += check_parser_resync(len, starts, frames_per_stream, frames_per_stream, &accepted);
+    }
+    report_fuzz("parser_resync_payload", iterations, accepted, failed);
+}
+
+static void check_unpacked(const uint8_t *frame, size_t len, void *user_ctx) {
+    size_t *total = user_ctx;
+    *total += len + 1;
+}
+
+static void fuzz_aggregator(void) {
+    const uint32_t iterations = 20000;
+    uint8_t packet[AGGREGATOR_MAX_SIZE];
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        size_t len = 1 + rng_next() % AGGREGATOR_MAX_SIZE;
+        for (size_t j = 0; j < len; j++) {
+            packet[j] = (uint8_t)rng_next();
+        }
+        packet[0] = AGGREGATOR_MAGIC;
+        if (len > 1) {
+            packet[1] = 1 + rng_next() % 8;
+        }
+
+        // Извлеченные записи не должны выходить за границы пакета
+        size_t total = 0;
+        if (aggregator_unpack(packet, len, check_unpacked, &total) >= 0) {
+            accepted++;
+        }
+        if (total + AGGREGATOR_HEADER_SIZE > len && total > 0) {
+            failed++;
+        }
+    }
+    report_fuzz("aggregator_unpack", iterations, accepted, failed);
+}
+
+static void sched_init(uint8_t capacity) {
+    const tx_sched_config_t config = {
+        .capacity = capacity,
+        .reserve = 4,
+        .weight = { [TX_CLASS_TELEMETRY] = 3, [TX_CLASS_BULK] = 1 },
+    };
+    tx_sched_init(&bench_sched, &config);
+}
+
+static void bench_tx_sched(void) {
+    uint8_t packet[3 + 3 * (DRONE_MSG_PACKET_SIZE + 1)];
+    aggregator_t agg;
+    drone_message_t msg;
+
+    aggregator_reset(&agg);
+    make_message(&msg, 1);
+    for (int i = 0; i < 3; i++) {
+        drone_msg_encode(&msg, packet, DRONE_MSG_PACKET_SIZE);
+        aggregator_add(&agg, packet, DRONE_MSG_PACKET_SIZE);
+    }
+    BENCH("tx_class_container", 100000, agg.len, sink += tx_class_of(agg.buf, agg.len));
+
+    // Очередь заполнена наполовину: постановка, выбор и извлечение одного пакета
+    sched_init(16);
+    for (int i = 0; i < 8; i++) {
+        tx_sched_push(&bench_sched, TX_CLASS_TELEMETRY + i % 2, 100, true, 0, NULL);
+    }
+    BENCH("tx_sched_cycle", 100000, 0, {
+        tx_sched_push(&bench_sched, bench_i % 7 ? TX_CLASS_TELEMETRY : TX_CLASS_ALERT, 100, true, bench_i, NULL);
+        tx_sched_peek(&bench_sched);
+        tx_sched_release(&bench_sched, tx_sched_pop(&bench_sched, bench_i));
+    });
+}
+
+// Прежний поиск узла перебором, для сравнения
+static int linear_find(uint8_t (*macs)[PEER_MAC_LEN], int count, const uint8_t *mac) {
+    for (int i = 0; i < count; i++) {
+        if (memcmp(macs[i], mac, PEER_MAC_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Поиск узла при 1, 10 и 20 узлах в таблице: время поиска в хеш-таблице
+// не должно расти, у перебора растет линейно
+static void bench_peer_lookup(void) {
+    static const int sizes[] = {1, 10, PEER_TABLE_CAPACITY};
+    char name[32];
+
+    // MAC одного производителя: различаются только младшие байты
+    for (int i = 0; i < PEER_TABLE_CAPACITY; i++) {
+        const uint8_t mac[PEER_MAC_LEN] = {0x24, 0x6F, 0x28, (uint8_t)rng_next(), (uint8_t)rng_next(), (uint8_t)i};
+        memcpy(bench_macs[i], mac, PEER_MAC_LEN);
+    }
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int count = sizes[s];
+        peer_table_init(&bench_peers);
+        for (int i = 0; i < count; i++) {
+            peer_table_add(&bench_peers, bench_macs[i], PEER_GROUP_ALL);
+        }
+        // Ищется последний добавленный узел: худший случай для перебора
+        snprintf(name, sizeof(name), "peer_lookup_%d", count);
+        BENCH(name, 100000, 0, sink += peer_table_find(&bench_peers, bench_macs[count - 1])->inflight);
+        snprintf(name, sizeof(name), "peer_linear_%d", count);
+        BENCH(name, 100000, 0, sink += linear_find(bench_macs, count, bench_macs[count - 1]));
+    }
+}
+
+// Случайные добавления, удаления и поиски сверяются с перебором списка
+static void fuzz_peer_table(void) {
+    const uint32_t iterations = 50000;
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+    int count = 0;
+
+    peer_table_init(&bench_peers);
+    for (uint32_t i = 0; i < iterations; i++) {
+        // Малое пространство адресов: часты повторы и длинные цепочки
+        uint8_t mac[PEER_MAC_LEN] = {0x24, 0x6F, 0x28, 0, (uint8_t)(rng_next() % 4), (uint8_t)(rng_next() % 8)};
+        int index = linear_find(bench_macs, count, mac);
+        peer_entry_t *entry;
+
+        switch (rng_next() % 3) {
+            case 0:
+                entry = peer_table_add(&bench_peers, mac, PEER_GROUP_ALL);
+                // Отказ допустим только для нового узла при заполненной таблице
+                if ((entry == NULL) != (index < 0 && count == PEER_TABLE_CAPACITY)) {
+                    failed++;
+                }
+                if (entry && index < 0) {
+                    memcpy(bench_macs[count++], mac, PEER_MAC_LEN);
+                    accepted++;
+                }
+                break;
+            case 1:
+                if (peer_table_remove(&bench_peers, mac) != (index >= 0)) {
+                    failed++;
+                }
+                if (index >= 0) {
+                    memcpy(bench_macs[index], bench_macs[--count], PEER_MAC_LEN);
+                }
+                break;
+            default:
+                entry = peer_table_find(&bench_peers, mac);
+                if ((entry != NULL) != (index >= 0) || (entry && memcmp(entry->mac, mac, PEER_MAC_LEN) != 0)) {
+                    failed++;
+                }
+                break;
+        }
+        if (bench_peers.count != count) {
+            failed++;
+        }
+    }
+    report_fuzz("peer_table", iterations, accepted, failed);
+}
+
+// Адрес дрона с номером id: один производитель, различаются младшие байты
+static void make_drone_mac(uint8_t *mac, uint32_t id) {
+    const uint8_t prefix[3] = {0x24, 0x6F, 0x28};
+    memcpy(mac, prefix, sizeof(prefix));
+    mac[3] = (uint8_t)(id >> 16);
+    mac[4] = (uint8_t)(id >> 8);
+    mac[5] = (uint8_t)id;
+}
+
+static void count_snapshot(const uint8_t *frame, size_t len, void *user_ctx) {
+    sink += len;
+}
+
+// Стоимость приема одного сообщения телеметрии в таблице состояния при
+// 64 дронах и выдачи снимка, в котором обновлены все дроны
+static void bench_fleet(void) {
+    static uint8_t macs[FLEET_MAX_DRONES][PEER_MAC_LEN];
+    uint8_t packet[DRONE_MSG_PACKET_SIZE];
+    drone_message_t msg;
+
+    make_message(&msg, 1);
+    drone_msg_encode(&msg, packet, sizeof(packet));
+    fleet_init(&bench_fleet_table);
+    for (int i = 0; i < FLEET_MAX_DRONES; i++) {
+        make_drone_mac(macs[i], rng_next());
+        fleet_update(&bench_fleet_table, macs[i], packet, sizeof(packet), 0);
+    }
+
+    // Шаг 37 взаимно прост с числом дронов: сообщения приходят от всех по очереди
+    BENCH("fleet_update_64", 100000, DRONE_MSG_PACKET_SIZE,
+          fleet_update(&bench_fleet_table, macs[(bench_i * 37) % FLEET_MAX_DRONES], packet, sizeof(packet), bench_i));
+    BENCH("fleet_snapshot_64", 2000, FLEET_MAX_DRONES * FLEET_RECORD_SIZE, {
+        memset(bench_fleet_table.dirty, 0xFF, sizeof(bench_fleet_table.dirty));
+        fleet_snapshot(&bench_fleet_table, bench_i, count_snapshot, NULL);
+    });
+}
+
+// Эталон таблицы состояния для фаззинг-проверки
+#define FUZZ_FLEET_DRONES (FLEET_MAX_DRONES + 16)
+
+typedef struct {
+    uint8_t mac[FUZZ_FLEET_DRONES][PEER_MAC_LEN];
+    uint8_t state[FUZZ_FLEET_DRONES][DRONE_MSG_PACKET_SIZE];
+    int64_t updated_us[FUZZ_FLEET_DRONES];
+    bool present[FUZZ_FLEET_DRONES];
+    bool dirty[FUZZ_FLEET_DRONES];
+    bool seen[FUZZ_FLEET_DRONES];
+    int count;
+    uint8_t part;
+    uint32_t records;
+    uint32_t failed;
+} fleet_ref_t;
+
+static int fleet_ref_find(const fleet_ref_t *ref, const uint8_t *mac) {
+    for (int i = 0; i < FUZZ_FLEET_DRONES; i++) {
+        if (memcmp(ref->mac[i], mac, PEER_MAC_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Каждая запись снимка - измененный дрон, выданный один раз, с последним сообщением
+static void check_snapshot(const uint8_t *frame, size_t len, void *user_ctx) {
+    fleet_ref_t *ref = user_ctx;
+    if (!fleet_is_snapshot(frame, len) || frame[2] != ref->part++ || frame[3] == 0 ||
+        frame[3] > FLEET_RECORDS_PER_FRAME || len != FLEET_SNAPSHOT_HEADER + frame[3] * FLEET_RECORD_SIZE) {
+        ref->failed++;
+        return;
+    }
+    for (int r = 0; r < frame[3]; r++) {
+        const uint8_t *record = frame + FLEET_SNAPSHOT_HEADER + r * FLEET_RECORD_SIZE;
+        int i = fleet_ref_find(ref, record);
+        if (i < 0 || !ref->present[i] || !ref->dirty[i] || ref->seen[i] ||
+            memcmp(record + PEER_MAC_LEN + 3, ref->state[i], DRONE_MSG_PACKET_SIZE) != 0) {
+            ref->failed++;
+            continue;
+        }
+        ref->seen[i] = true;
+        ref->records++;
+    }
+}
+
+// Случайные обновления от большего числа дронов, чем вмещает таблица,
+// снимки и удаление устаревших сверяются с эталоном
+static void fuzz_fleet(void) {
+    static fleet_ref_t ref;
+    const uint32_t iterations = 50000;
+    const int64_t max_age_us = 200000;
+    uint32_t accepted = 0;
+    int64_t now = 0;
+
+    memset(&ref, 0, sizeof(ref));
+    fleet_init(&bench_fleet_table);
+    for (int i = 0; i < FUZZ_FLEET_DRONES; i++) {
+        make_drone_mac(ref.mac[i], i * 7919);
+    }
+
+    for (uint32_t n = 0; n < iterations; n++) {
+        now += rng_next() % 2000;
+        uint32_t op = rng_next() % 100;
+
+        if (op < 90) {
+            // Часть дронов передает чаще остальных
+            int i = rng_next() % (rng_next() % 2 ? FUZZ_FLEET_DRONES : 8);
+            uint8_t packet[DRONE_MSG_PACKET_SIZE];
+            for (size_t b = 0; b < sizeof(packet); b++) {
+                packet[b] = (uint8_t)rng_next();
+            }
+            packet[0] = MSG_TYPE_TELEMETRY;
+            fleet_status_t status = fleet_update(&bench_fleet_table, ref.mac[i], packet, sizeof(packet), now);
+            bool fits = ref.present[i] || ref.count < FLEET_MAX_DRONES;
+            if ((status == FLEET_FULL) == fits) {
+                ref.failed++;
+            }
+            if (fits) {
+                ref.count += !ref.present[i];
+                ref.present[i] = true;
+                ref.dirty[i] = true;
+                ref.updated_us[i] = now;
+                memcpy(ref.state[i], packet, sizeof(packet));
+                accepted++;
+            }
+        } else if (op < 98) {
+            int expected = 0;
+            for (int i = 0; i < FUZZ_FLEET_DRONES; i++) {
+                expected += ref.present[i] && ref.dirty[i];
+                ref.seen[i] = false;
+            }
+            ref.part = 0;
+            ref.records = 0;
+            if (fleet_snapshot(&bench_fleet_table, now, check_snapshot, &ref) != expected || ref.records != (uint32_t)expected) {
+                ref.failed++;
+            }
+            memset(ref.dirty, 0, sizeof(ref.dirty));
+        } else {
+            int expected = 0;
+            for (int i = 0; i < FUZZ_FLEET_DRONES; i++) {
+                if (ref.present[i] && now - ref.updated_us[i] > max_age_us) {
+                    ref.present[i] = false;
+                    ref.dirty[i] = false;
+                    ref.count--;
+                    expected++;
+                }
+            }
+            if (fleet_expire(&bench_fleet_table, now, max_age_us) != expected) {
+                ref.failed++;
+            }
+        }
+
+        int i = rng_next() % FUZZ_FLEET_DRONES;
+        const uint8_t *state = fleet_get_state(&bench_fleet_table, ref.mac[i]);
+        if ((state != NULL) != ref.present[i] || (state && memcmp(state, ref.state[i], DRONE_MSG_PACKET_SIZE) != 0) ||
+            bench_fleet_table.count != ref.count) {
+            ref.failed++;
+        }
+    }
+    report_fuzz("fleet_table", iterations, accepted, ref.failed);
+}
+
+// Случайные постановки и извлечения: слоты не теряются, тревоги и команды
+// не отклоняются, пока есть вытесняемые пакеты, и извлекаются раньше
+// остальных, невытесняемые пакеты доходят до извлечения, tx_sched_room
+// предсказывает прием пакета, занятый получатель не задерживает пакеты
+// остальных; при насыщении классы с долей полосы получают ее по весам
+static int fuzz_busy_group;
+
+// Получатели моделируются остатком индекса слота: группа fuzz_busy_group занята
+static bool fuzz_slot_eligible(int slot, void *ctx) {
+    return slot % 4 != fuzz_busy_group;
+}
+
+static void fuzz_tx_sched(void) {
+    const uint32_t iterations = 50000;
+    const uint8_t capacity = 16;
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+    uint32_t pinned_pushed = 0;
+    uint32_t pinned_popped = 0;
+
+    sched_init(capacity);
+    for (uint32_t i = 0; i < iterations; i++) {
+        if (rng_next() % 2) {
+            tx_class_t cls = rng_next() % TX_CLASS_COUNT;
+            bool evictable = rng_next() % 4 != 0;
+            bool had_weighted = bench_sched.weighted_count > bench_sched.pinned_count || bench_sched.free_count > 0;
+            uint32_t room = tx_sched_room(&bench_sched, cls, evictable);
+            int slot = tx_sched_push(&bench_sched, cls, 1 + rng_next() % 250, evictable, i, NULL);
+            if ((slot >= 0) != (room > 0)) {
+                failed++;
+            }
+            if (slot >= 0) {
+                accepted++;
+                pinned_pushed += bench_sched.pinned[slot];
+            } else if (cls < TX_CLASS_FIRST_WEIGHTED && had_weighted) {
+                failed++;
+            }
+        } else if (rng_next() % 2) {
+            fuzz_busy_group = rng_next() % 4;
+            int slot = tx_sched_peek_eligible(&bench_sched, fuzz_slot_eligible, NULL);
+            bool any_eligible = false;
+            for (int cls = 0; cls < TX_CLASS_COUNT; cls++) {
+                for (int pos = 0; pos < bench_sched.count[cls]; pos++) {
+                    int queued = bench_sched.order[cls][(bench_sched.head[cls] + pos) % TX_SCHED_MAX_SLOTS];
+                    any_eligible |= fuzz_slot_eligible(queued, NULL);
+                }
+            }
+            if ((slot >= 0) != any_eligible || (slot >= 0 && !fuzz_slot_eligible(slot, NULL))) {
+                failed++;
+            }
+            if (slot >= 0) {
+                pinned_popped += bench_sched.pinned[slot];
+                tx_sched_release(&bench_sched, tx_sched_pop(&bench_sched, i));
+            }
+        } else if (tx_sched_peek(&bench_sched) >= 0) {
+            pinned_popped += bench_sched.pinned[tx_sched_peek(&bench_sched)];
+            int highest = TX_CLASS_COUNT;
+            for (int cls = TX_CLASS_FIRST_WEIGHTED - 1; cls >= 0; cls--) {
+                if (bench_sched.count[cls]) {
+                    highest = cls;
+                }
+            }
+            if (highest < TX_CLASS_FIRST_WEIGHTED && bench_sched.selected != highest) {
+                failed++;
+            }
+            tx_sched_release(&bench_sched, tx_sched_pop(&bench_sched, i));
+        }
+        if (bench_sched.free_count + tx_sched_depth(&bench_sched) != capacity ||
+            pinned_pushed != pinned_popped + bench_sched.pinned_count) {
+            failed++;
+        }
+    }
+
+    // Оба класса с долей полосы всегда имеют очередь: доли байт 3:1
+    uint32_t served[TX_CLASS_COUNT] = {0};
+    sched_init(capacity);
+    for (uint32_t i = 0; i < 20000; i++) {
+        while (bench_sched.count[TX_CLASS_TELEMETRY] < 4) {
+            tx_sched_push(&bench_sched, TX_CLASS_TELEMETRY, 30 + rng_next() % 40, true, i, NULL);
+        }
+        while (bench_sched.count[TX_CLASS_BULK] < 4) {
+            tx_sched_push(&bench_sched, TX_CLASS_BULK, 200 + rng_next() % 50, true, i, NULL);
+        }
+        int slot = tx_sched_peek(&bench_sched);
+        served[bench_sched.selected] += bench_sched.len[slot];
+        tx_sched_release(&bench_sched, tx_sched_pop(&bench_sched, i));
+    }
+    uint32_t share_x100 = served[TX_CLASS_TELEMETRY] * 100 / (served[TX_CLASS_TELEMETRY] + served[TX_CLASS_BULK]);
+    if (share_x100 < 72 || share_x100 > 78) {
+        failed++;
+    }
+
+    report_fuzz("tx_sched", iterations, accepted, failed);
+}
+
+// Фрагменты кадров: до FUZZ_FRAGMENT_FRAMES кадров от двух отправителей,
+// каждый фрагмент может прийти дважды
+#define FUZZ_FRAGMENT_FRAMES  6
+#define FUZZ_FRAGMENT_PACKETS (FUZZ_FRAGMENT_FRAMES * FRAGMENT_MAX_COUNT * 2)
+#define FUZZ_FRAGMENT_SLOTS   8
+
+typedef struct {
+    uint8_t peer;
+    uint8_t len;
+    uint8_t data[FRAGMENT_MAX_PACKET];
+} fragment_packet_t;
+
+static fragment_packet_t fragment_packets[FUZZ_FRAGMENT_PACKETS];
+static uint8_t fragment_frames[FUZZ_FRAGMENT_FRAMES][FRAGMENT_MAX_FRAME];
+static size_t fragment_frame_len[FUZZ_FRAGMENT_FRAMES];
+static fragment_slot_t fragment_slots[FUZZ_FRAGMENT_SLOTS];
+static fragment_rx_t fragment_rx;
+static int fragment_packet_count;
+static uint8_t fragment_peer;
+
+static void collect_fragment(const uint8_t *data, size_t len, void *user_ctx) {
+    fragment_packet_t *packet = &fragment_packets[fragment_packet_count++];
+    packet->peer = fragment_peer;
+    packet->len = (uint8_t)len;
+    memcpy(packet->data, data, len);
+}
+
+static void bench_fragment(void) {
+    fragment_tx_t tx;
+    uint8_t mac[6] = {0};
+    uint8_t *frame = fragment_frames[0];
+    uint32_t completed = 0;
+    for (size_t i = 0; i < FRAGMENT_MAX_FRAME; i++) {
+        frame[i] = (uint8_t)rng_next();
+    }
+    fragment_tx_init(&tx, 0);
+    fragment_rx_init(&fragment_rx, fragment_slots, FUZZ_FRAGMENT_SLOTS, 1000000);
+
+    BENCH("fragment_split", 10000, FRAGMENT_MAX_FRAME,
+          fragment_packet_count = 0;
+          sink += fragment_split(&tx, frame, FRAGMENT_MAX_FRAME, collect_fragment, NULL));
+    BENCH("fragment_reassemble", 10000, FRAGMENT_MAX_FRAME,
+          for (int p = 0; p < fragment_packet_count; p++) {
+              fragment_packets[p].data[2] = (uint8_t)bench_i;
+              sink += fragment_receive(&fragment_rx, mac, fragment_packets[p].data, fragment_packets[p].len, 0,
+                                       count_frame, &completed);
+          });
+    sink += completed;
+}
+
+typedef struct {
+    uint32_t delivered;            // Собранные кадры
+    uint32_t repeated;             // Собранные повторно
+} fragment_check_t;
+
+// Собранный кадр совпадает с одним из отправленных.
+// Первые два байта кадра - отправитель и номер кадра
+static void check_fragment_frame(const uint8_t *frame, size_t len, void *user_ctx) {
+    fragment_check_t *check = user_ctx;
+    uint8_t index = len >= 2 ? frame[1] : 0;
+    if (len < 2 || index >= FUZZ_FRAGMENT_FRAMES || frame[0] != index % 2 ||
+        len != fragment_frame_len[index] || memcmp(frame, fragment_frames[index], len) != 0) {
+        violations++;
+        ESP_LOGE(TAG, "FUZZ fragment: собран неверный кадр, %u байт", (unsigned)len);
+        return;
+    }
+    check->repeated |= check->delivered & 1u << index;
+    check->delivered |= 1u << index;
+}
+
+// Фрагменты нескольких кадров от двух отправителей приходят вперемешку,
+// с потерями и повторами. При достаточном числе слотов собираются ровно
+// кадры без потерь и каждый один раз, остальные отбрасываются по тайм-ауту;
+// при нехватке слотов собранные кадры по-прежнему должны быть целыми
+static void fuzz_fragment(void) {
+    const uint32_t iterations = 2000;
+    const int64_t timeout_us = 1000000;
+    fragment_tx_t tx[2];
+    uint8_t macs[2][6] = {{0x02, 0, 0, 0, 0, 1}, {0x02, 0, 0, 0, 0, 2}};
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+    int64_t now = 0;
+
+    fragment_tx_init(&tx[0], (uint8_t)rng_next());
+    fragment_tx_init(&tx[1], (uint8_t)rng_next());
+
+    for (uint32_t iter = 0; iter < iterations; iter++) {
+        int frames = 1 + rng_next() % FUZZ_FRAGMENT_FRAMES;
+        uint8_t slot_count = iter % 4 ? FUZZ_FRAGMENT_SLOTS : 1 + rng_next() % 3;
+        uint32_t lost = 0;
+        uint32_t present = 0;
+        fragment_check_t check = {0};
+        fragment_rx_init(&fragment_rx, fragment_slots, slot_count, timeout_us);
+
+        // Фрагменты всех кадров; потерянные не попадают в пул, повторы - дважды
+        fragment_packet_count = 0;
+        for (int f = 0; f < frames; f++) {
+            size_t len = 2 + rng_next() % (FRAGMENT_MAX_FRAME - 1);
+            uint8_t *frame = fragment_frames[f];
+            frame[0] = f % 2;
+            frame[1] = (uint8_t)f;
+            for (size_t i = 2; i < len; i++) {
+                frame[i] = (uint8_t)rng_next();
+            }
+            fragment_frame_len[f] = len;
+
+            int first = fragment_packet_count;
+            fragment_peer = f % 2;
+            fragment_split(&tx[f % 2], frame, len, collect_fragment, NULL);
+            // С конца: на место потерянного встает уже обработанный фрагмент
+            for (int p = fragment_packet_count - 1; p >= first; p--) {
+                uint32_t roll = rng_next() % 100;
+                if (roll < 5) {
+                    lost |= 1u << f;
+                    fragment_packets[p] = fragment_packets[--fragment_packet_count];
+                } else if (roll < 15) {
+                    fragment_packets[fragment_packet_count++] = fragment_packets[p];
+                }
+            }
+            if (fragment_packet_count > first) {
+                present |= 1u << f;
+            }
+        }
+        for (int p = fragment_packet_count - 1; p > 0; p--) {
+            int q = rng_next() % (p + 1);
+            fragment_packet_t tmp = fragment_packets[p];
+            fragment_packets[p] = fragment_packets[q];
+            fragment_packets[q] = tmp;
+        }
+
+        for (int p = 0; p < fragment_packet_count; p++) {
+            const fragment_packet_t *packet = &fragment_packets[p];
+            if (fragment_receive(&fragment_rx, macs[packet->peer], packet->data, packet->len, now++,
+                                 check_fragment_frame, &check) < 0) {
+                failed++;
+            }
+        }
+        now += timeout_us + 1;
+        fragment_expire(&fragment_rx, now);
+
+        // Кадры, от которых пришел хотя бы один фрагмент, собраны или отброшены по тайм-ауту
+        uint32_t all = (1u << frames) - 1;
+        const fragment_stats_t *stats = &fragment_rx.stats;
+        if (slot_count >= frames &&
+            (check.delivered != (all & ~lost) || check.repeated || stats->evicted != 0 ||
+             stats->completed + stats->timeouts != (uint32_t)__builtin_popcount(present))) {
+            failed++;
+            continue;
+        }
+        if (check.delivered) {
+            accepted++;
+        }
+    }
+
+    // Случайные фрагменты не должны выводить сборку за границы слотов
+    uint32_t completed = 0;
+    fragment_rx_init(&fragment_rx, fragment_slots, FUZZ_FRAGMENT_SLOTS, timeout_us);
+    for (uint32_t i = 0; i < iterations * 10; i++) {
+        uint8_t packet[FRAGMENT_MAX_PACKET];
+        size_t len = 1 + rng_next() % FRAGMENT_MAX_PACKET;
+        for (size_t j = 0; j < len; j++) {
+            packet[j] = (uint8_t)rng_next();
+        }
+        packet[0] = FRAGMENT_MAGIC;
+        if (len > 2) {
+            packet[2] &= 0x03;
+        }
+        fragment_receive(&fragment_rx, macs[i % 2], packet, len, now++, count_frame, &completed);
+    }
+    sink += completed;
+
+    report_fuzz("fragment", iterations, accepted, failed);
+}
+
+// Журнал пишется в раздел "flightrec"; в хостовой сборке - в раздел в
+// памяти (host/shim/esp_partition.c). Замер стирает журнал на разделе
+#define BENCH_FLIGHTREC_RECORDS 20480
+#define BENCH_FLIGHTREC_CHUNK   64
+#define BENCH_FLIGHTREC_RANGES  100
+#define FUZZ_FLIGHTREC_RECORDS  1500
+
+static flightrec_t bench_log;
+static flightrec_batch_t bench_batch;
+static uint8_t flightrec_frames[BENCH_FLIGHTREC_CHUNK][DRONE_MSG_PACKET_SIZE];
+
+// Сообщение i журнала: телеметрия 50 Гц, каждое десятое - тревога
+static void make_flightrec_message(uint8_t *frame, uint32_t i, uint32_t timestamp_ms, bool telemetry) {
+    drone_message_t msg;
+    make_message(&msg, (uint8_t)i);
+    msg.msg_type = telemetry ? MSG_TYPE_TELEMETRY : MSG_TYPE_ALERT;
+    msg.timestamp = timestamp_ms;
+    msg.latitude += 1e-6f * (i % 1000);
+    msg.altitude += 0.1f * (i % 500);
+    msg.yaw = (float)(i % 360);
+    drone_msg_encode(&msg, frame, DRONE_MSG_PACKET_SIZE);
+}
+
+static const esp_partition_t *flightrec_partition(void) {
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, FLIGHTREC_PARTITION_SUBTYPE,
+                                                           FLIGHTREC_PARTITION_LABEL);
+    if (!part) {
+        ESP_LOGW(TAG, "Раздел \"%s\" не найден, журнал не проверяется", FLIGHTREC_PARTITION_LABEL);
+    }
+    return part;
+}
+
+// Чтение в кадры ответа размером с пакет ESP-NOW, как при запросе по радиоканалу
+static void batch_record(const uint8_t *frame, size_t len, uint32_t timestamp_ms, void *user_ctx) {
+    if (!flightrec_batch_add(&bench_batch, frame, len)) {
+        sink += bench_batch.len;
+        flightrec_batch_init(&bench_batch, 0, TRANSPORT_MAX_DATA_LEN);
+        flightrec_batch_add(&bench_batch, frame, len);
+    }
+}
+
+static void bench_flightrec(void) {
+    const esp_partition_t *part = flightrec_partition();
+    if (!part || esp_partition_erase_range(part, 0, part->size) != ESP_OK ||
+        flightrec_open(&bench_log, part) < 0) {
+        return;
+    }
+
+    // Сообщения кодируются пачками вне замера: измеряется только запись
+    int64_t elapsed_us = 0;
+    for (uint32_t base = 0; base < BENCH_FLIGHTREC_RECORDS; base += BENCH_FLIGHTREC_CHUNK) {
+        for (uint32_t i = 0; i < BENCH_FLIGHTREC_CHUNK; i++) {
+            make_flightrec_message(flightrec_frames[i], base + i, (base + i) * 20, (base + i) % 10 != 0);
+        }
+        int64_t start = esp_timer_get_time();
+        for (uint32_t i = 0; i < BENCH_FLIGHTREC_CHUNK; i++) {
+            flightrec_append(&bench_log, flightrec_frames[i], DRONE_MSG_PACKET_SIZE);
+        }
+        elapsed_us += esp_timer_get_time() - start;
+    }
+    flightrec_flush(&bench_log);
+    report_bench("flightrec_append", BENCH_FLIGHTREC_RECORDS, elapsed_us, DRONE_MSG_PACKET_SIZE);
+
+    const flightrec_stats_t *stats = &bench_log.stats;
+    ESP_LOGI(TAG, "Журнал: %" PRIu32 " записей (%" PRIu32 " компактных), %" PRIu32 " байт, "
+             "%" PRIu32 " записей во флеш, %" PRIu32 " стираний",
+             stats->records, stats->compact, stats->bytes, stats->page_writes, stats->erases);
+
+    flightrec_batch_init(&bench_batch, 0, TRANSPORT_MAX_DATA_LEN);
+    int64_t start = esp_timer_get_time();
+    uint32_t count = flightrec_read(&bench_log, 0, UINT32_MAX, batch_record, NULL);
+    report_bench("flightrec_replay", count ? count : 1, esp_timer_get_time() - start, DRONE_MSG_PACKET_SIZE);
+
+    // Секундный интервал: индекс секторов отсекает остальной журнал
+    uint32_t found = 0;
+    start = esp_timer_get_time();
+    for (uint32_t i = 0; i < BENCH_FLIGHTREC_RANGES; i++) {
+        uint32_t from_ms = rng_next() % (BENCH_FLIGHTREC_RECORDS * 20);
+        found += flightrec_read(&bench_log, from_ms, from_ms + 999, batch_record, NULL);
+    }
+    report_bench("flightrec_range_1s", BENCH_FLIGHTREC_RANGES, esp_timer_get_time() - start,
+                 found / BENCH_FLIGHTREC_RANGES * DRONE_MSG_PACKET_SIZE);
+}
+
+// Записанное сообщение: сектор журнала, в который оно попало
+typedef struct {
+    uint32_t timestamp_ms;
+    uint32_t seq;
+    uint8_t msg_id;
+    uint8_t msg_type;
+} flightrec_ref_t;
+
+typedef struct {
+    uint32_t next;                 // Следующее ожидаемое сообщение
+    uint32_t count;
+    uint32_t from_ms;
+    uint32_t to_ms;
+    uint32_t failed;
+} flightrec_check_t;
+
+static flightrec_ref_t flightrec_ref[FUZZ_FLIGHTREC_RECORDS];
+
+// Прочитанное сообщение - следующее сохранившееся из интервала, в порядке записи
+static void check_flightrec_record(const uint8_t *frame, size_t len, uint32_t timestamp_ms, void *user_ctx) {
+    flightrec_check_t *check = user_ctx;
+    while (check->next < check->count &&
+           (flightrec_ref[check->next].seq == 0 || flightrec_ref[check->next].timestamp_ms < check->from_ms)) {
+        check->next++;
+    }
+    const flightrec_ref_t *ref = check->next < check->count ? &flightrec_ref[check->next++] : NULL;
+    if (!ref || drone_msg_verify(frame, len) < 0 || ref->timestamp_ms != timestamp_ms ||
+        ref->timestamp_ms > check->to_ms || drone_msg_get_timestamp(frame) != timestamp_ms ||
+        drone_msg_get_msg_id(frame) != ref->msg_id || drone_msg_get_msg_type(frame) != ref->msg_type) {
+        check->failed++;
+    }
+}
+
+// Журнал на разделе из нескольких секторов заполняется с переходами по
+// кольцу и перемонтированием. Читаются ровно сообщения из несохранившихся
+// секторов, в порядке записи и с исходными метками времени; запрос
+// интервала возвращает ровно сообщения из него
+static void fuzz_flightrec(void) {
+    const esp_partition_t *part = flightrec_partition();
+    if (!part) {
+        return;
+    }
+    const uint32_t iterations = 64;
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+    uint8_t frame[DRONE_MSG_PACKET_SIZE];
+
+    for (uint32_t iter = 0; iter < iterations; iter++) {
+        // Журнал на первых секторах раздела
+        esp_partition_t small = *part;
+        small.size = (2 + rng_next() % 6) * FLIGHTREC_SECTOR_SIZE;
+        if (esp_partition_erase_range(&small, 0, small.size) != ESP_OK || flightrec_open(&bench_log, &small) < 0) {
+            failed++;
+            continue;
+        }
+
+        uint32_t count = rng_next() % FUZZ_FLIGHTREC_RECORDS;
+        uint32_t remount_at = rng_next() % (count + 1);
+        uint32_t timestamp_ms = rng_next() % 100000;
+        bool ok = true;
+        for (uint32_t i = 0; i < count; i++) {
+            if (i == remount_at) {
+                ok &= flightrec_flush(&bench_log) == 0 && flightrec_open(&bench_log, &small) == 0;
+            }
+            timestamp_ms += 1 + rng_next() % 50;
+            bool telemetry = rng_next() % 8 != 0;
+            make_flightrec_message(frame, i, timestamp_ms, telemetry);
+            ok &= flightrec_append(&bench_log, frame, sizeof(frame)) == 0;
+            flightrec_ref[i] = (flightrec_ref_t){
+                .timestamp_ms = timestamp_ms,
+                .seq = bench_log.head_seq,
+                .msg_id = (uint8_t)i,
+                .msg_type = telemetry ? MSG_TYPE_TELEMETRY : MSG_TYPE_ALERT,
+            };
+        }
+        // Сохраняются последние сектора по числу секторов раздела
+        uint32_t sectors = small.size / FLIGHTREC_SECTOR_SIZE;
+        uint32_t first_seq = bench_log.head_seq > sectors ? bench_log.head_seq - sectors + 1 : 1;
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (flightrec_ref[i].seq < first_seq) {
+                flightrec_ref[i].seq = 0;
+            } else {
+                kept++;
+            }
+        }
+
+        flightrec_check_t check = {.count = count, .from_ms = 0, .to_ms = UINT32_MAX};
+        uint32_t read = flightrec_read(&bench_log, 0, UINT32_MAX, check_flightrec_record, &check);
+        ok &= read == kept && check.failed == 0;
+
+        // Интервал из середины журнала
+        uint32_t from_ms = timestamp_ms ? rng_next() % timestamp_ms : 0;
+        uint32_t to_ms = from_ms + rng_next() % 5000;
+        uint32_t expected = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            expected += flightrec_ref[i].seq != 0 && flightrec_ref[i].timestamp_ms >= from_ms &&
+                        flightrec_ref[i].timestamp_ms <= to_ms;
+        }
+        check = (flightrec_check_t){.count = count, .from_ms = from_ms, .to_ms = to_ms};
+        read = flightrec_read(&bench_log, from_ms, to_ms, check_flightrec_record, &check);
+        ok &= read == expected && check.failed == 0 && bench_log.stats.errors == 0;
+
+        if (ok) {
+            accepted++;
+        } else {
+            failed++;
+            ESP_LOGE(TAG, "FUZZ flightrec: итерация %" PRIu32 ", %" PRIu32 " сообщений, прочитано %" PRIu32,
+                     iter, count, read);
+        }
+    }
+
+    report_fuzz("flightrec", iterations, accepted, failed);
+}
+
+static timesync_t bench_sync;
+static timesync_t bench_sync_ref;
+
+// Один обмен синхронизации: запрос в t1, ответ эталона, прием ответа в t4
+static bool sync_exchange(timesync_t *client, timesync_t *ref, int64_t t1, int64_t t2, int64_t t4) {
+    static const uint8_t mac[6] = {0x02, 0, 0, 0, 0, 1};
+    uint8_t ping[TIMESYNC_PING_SIZE];
+    uint8_t pong[TIMESYNC_PONG_SIZE];
+    timesync_ping(client, t1, ping);
+    size_t len = timesync_answer(ref, ping, sizeof(ping), t2, t2, pong);
+    return timesync_on_pong(client, mac, pong, len, t4);
+}
+
+static void bench_timesync(void) {
+    timesync_init(&bench_sync, false, INT64_MAX);
+    timesync_init(&bench_sync_ref, true, 0);
+    BENCH("timesync_exchange", 10000, TIMESYNC_PING_SIZE + TIMESYNC_PONG_SIZE,
+          int64_t t = (int64_t)bench_i * 1000000;
+          sink += sync_exchange(&bench_sync, &bench_sync_ref, t, t + 500 + bench_i % 300, t + 1000));
+    BENCH("timesync_now", 100000, 0, sink += (uint32_t)timesync_now(&bench_sync, bench_i));
+}
+
+// Часы узла уходят относительно эталона на skew_ppm и смещены на offset_us.
+// Задержка каждого направления - постоянная часть и случайная добавка до
+// jitter_us. После заполнения окна и точек ухода ошибка общего времени не
+// больше половины разброса задержки с запасом на ошибку оценки ухода, а
+// оценка ухода близка к заданному
+static void fuzz_timesync(void) {
+    const uint32_t iterations = 200;
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+
+    for (uint32_t iter = 0; iter < iterations; iter++) {
+        int32_t skew_ppm = (int32_t)(rng_next() % 401) - 200;
+        int64_t offset_us = (int64_t)(rng_next() % 2000000000) - 1000000000;
+        int64_t period_us = 100000 + rng_next() % 1900000;
+        int64_t base_us = 200 + rng_next() % 2000;
+        int64_t jitter_us = 1 + rng_next() % 3000;
+        uint32_t exchanges = 2 * TIMESYNC_POINTS * (TIMESYNC_POINT_SPACING_US / period_us + 1) + TIMESYNC_SAMPLES;
+
+        timesync_init(&bench_sync, false, INT64_MAX);
+        timesync_init(&bench_sync_ref, true, 0);
+        int64_t now = rng_next() % 1000000000;
+        bool ok = true;
+        for (uint32_t i = 0; i < exchanges; i++) {
+            // Часы узла: local(t) = t + offset + t * skew
+            int64_t t1 = now;
+            int64_t t2 = t1 + base_us + rng_next() % jitter_us;
+            int64_t t4 = t2 + base_us + rng_next() % jitter_us;
+            ok &= sync_exchange(&bench_sync, &bench_sync_ref,
+                                t1 + offset_us + t1 * skew_ppm / 1000000, t2,
+                                t4 + offset_us + t4 * skew_ppm / 1000000);
+            now += period_us;
+        }
+
+        // Ошибка в течение периода после последнего обмена
+        int64_t max_error = 0;
+        for (int64_t t = now; t < now + period_us; t += period_us / 8) {
+            int64_t error = llabs(timesync_now(&bench_sync, t + offset_us + t * skew_ppm / 1000000) - t);
+            if (error > max_error) {
+                max_error = error;
+            }
+        }
+        int64_t drift_error = llabs(bench_sync.drift_ppb + (int64_t)skew_ppm * 1000);
+        int64_t drift_limit = 1000 + jitter_us * 1000000000LL / (TIMESYNC_POINTS * TIMESYNC_POINT_SPACING_US);
+        int64_t error_limit = jitter_us / 2 + 50 +
+                              drift_limit * (TIMESYNC_SAMPLES + 1) * period_us / 1000000000;
+        ok &= timesync_synced(&bench_sync) && bench_sync.stratum == 1;
+
+        // Без ответов дольше holdover синхронизация теряется, но общее время
+        // идет по последней модели с ошибкой ухода за время перерыва
+        int64_t holdover_us = 30 * period_us;
+        int64_t late = now + 2 * holdover_us;
+        int64_t late_local = late + offset_us + late * skew_ppm / 1000000;
+        bench_sync.holdover_us = holdover_us;
+        timesync_expire(&bench_sync, late_local);
+        int64_t late_error = llabs(timesync_now(&bench_sync, late_local) - late);
+        ok &= !timesync_synced(&bench_sync) && timesync_stale(&bench_sync) &&
+              late_error <= error_limit + drift_limit * (late - now) / 1000000000;
+
+        if (ok && max_error <= error_limit && drift_error <= drift_limit) {
+            accepted++;
+        } else {
+            failed++;
+            ESP_LOGE(TAG, "FUZZ timesync: skew %" PRId32 " ppm, jitter %" PRId32 " us: error %" PRId32
+                     " us (limit %" PRId32 "), drift error %" PRId32 " ppb", skew_ppm, (int32_t)jitter_us,
+                     (int32_t)max_error, (int32_t)error_limit, (int32_t)drift_error);
+        }
+    }
+
+    report_fuzz("timesync", iterations, accepted, failed);
+}
+
+static rate_ctrl_t bench_rate;
+
+static const rate_ctrl_config_t bench_rate_config = {
+    .period_us = 200000,
+    .min_hz = 5,
+    .step_hz = 5,
+    .good_permille = 950,
+    .poor_permille = 800,
+    .rssi_poor_dbm = -85,
+};
+
+static void bench_rate_ctrl(void) {
+    rate_ctrl_init(&bench_rate, &bench_rate_config);
+    bench_rate.limit_hz = 25;
+    BENCH("rate_ctrl_admit", 100000, 0, sink += rate_ctrl_admit(&bench_rate, (int64_t)bench_i * 10000));
+    rate_ctrl_sample_t sample = {0};
+    BENCH("rate_ctrl_update", 100000, 0,
+          sample.tx_ok += 9; sample.tx_fail += bench_i & 1;
+          rate_ctrl_update(&bench_rate, &sample, (int64_t)bench_i * 200000); sink += bench_rate.limit_hz);
+}
+
+// Допущенное сообщение доставляется с вероятностью delivery_permille
+static void rate_ctrl_deliver(rate_ctrl_sample_t *sample, uint32_t delivery_permille) {
+    if (rng_next() % RATE_CTRL_PERMILLE < delivery_permille) {
+        sample->tx_ok++;
+    } else {
+        sample->tx_fail++;
+    }
+}
+
+// Телеметрия с частотой input_hz и случайным разбросом интервалов в течение
+// duration_us, затем пауза потока. Придержанное сообщение уходит по таймеру
+// в срок, как в bridge_telemetry_deadline. Предел всегда 0 или не ниже
+// min_hz; после паузы ничего не остается придержанным
+static uint32_t rate_ctrl_run(rate_ctrl_sample_t *sample, int64_t *now, int64_t duration_us,
+                              uint32_t input_hz, uint32_t delivery_permille, bool *ok) {
+    uint32_t admitted = 0;
+    int64_t interval = 1000000 / input_hz;
+    for (int64_t end = *now + duration_us; *now < end; *now += interval / 2 + rng_next() % interval) {
+        if (bench_rate.held && bench_rate.next_us <= *now) {
+            *ok &= rate_ctrl_release(&bench_rate, bench_rate.next_us);
+            admitted++;
+            rate_ctrl_deliver(sample, delivery_permille);
+        }
+        if (rate_ctrl_due(&bench_rate, *now)) {
+            rate_ctrl_update(&bench_rate, sample, *now);
+            *ok &= bench_rate.limit_hz == 0 || bench_rate.limit_hz >= bench_rate.config.min_hz;
+        }
+        if (!rate_ctrl_admit(&bench_rate, *now)) {
+            continue;
+        }
+        admitted++;
+        rate_ctrl_deliver(sample, delivery_permille);
+    }
+    if (bench_rate.held) {
+        *ok &= rate_ctrl_release(&bench_rate, bench_rate.next_us);
+        admitted++;
+        rate_ctrl_deliver(sample, delivery_permille);
+    }
+    *ok &= !bench_rate.held;
+    return admitted;
+}
+
+// При постоянно плохом канале предел доходит до нижнего и частота
+// допущенных сообщений не превышает его; при хорошем канале ограничение
+// снимается. Каждое сообщение передано или заменено более новым
+static void fuzz_rate_ctrl(void) {
+    const uint32_t iterations = 100;
+    uint32_t accepted = 0;
+    uint32_t failed = 0;
+
+    for (uint32_t iter = 0; iter < iterations; iter++) {
+        rate_ctrl_config_t config = {
+            .period_us = 50000 + rng_next() % 450000,
+            .min_hz = 1 + rng_next() % 20,
+            .step_hz = 1 + rng_next() % 20,
+            .good_permille = 900 + rng_next() % 100,
+        };
+        config.poor_permille = 500 + rng_next() % (config.good_permille - 500);
+        uint32_t input_hz = 10 + rng_next() % 190;
+        rate_ctrl_init(&bench_rate, &config);
+
+        rate_ctrl_sample_t sample = {0};
+        int64_t now = rng_next() % 1000000000;
+        bool ok = true;
+        uint32_t sent = rate_ctrl_run(&sample, &now, 60000000, input_hz, rng_next() % (config.poor_permille / 2), &ok);
+        bool reached_min = bench_rate.limit_hz == config.min_hz;
+        uint32_t admitted = rate_ctrl_run(&sample, &now, 20000000, input_hz, 0, &ok);
+        bool limited = admitted <= 20 * config.min_hz + 2;
+        sent += admitted + rate_ctrl_run(&sample, &now, 120000000, input_hz, RATE_CTRL_PERMILLE, &ok);
+        bool released = bench_rate.limit_hz == 0;
+        bool accounted = sent + bench_rate.stats.decimated == bench_rate.stats.offered;
+
+        if (ok && reached_min && limited && released && accounted) {
+            accepted++;
+        } else {
+            failed++;
+            ESP_LOGE(TAG, "FUZZ rate_ctrl: input %" PRIu32 " Hz, min %u Hz: admitted %" PRIu32
+                     " in 20 s, limit %" PRIu32 " Hz, sent %" PRIu32 " + decimated %" PRIu32
+                     " of %" PRIu32, input_hz, config.min_hz, admitted, bench_rate.limit_hz,
+                     sent, bench_rate.stats.decimated, bench_rate.stats.offered);
+        }
+    }
+
+    report_fuzz("rate_ctrl", iterations, accepted, failed);
+}
+
+#if CONFIG_BRIDGE_METRICS
+static metrics_snapshot_t bench_snapshot;
+static latency_hist_t bench_metrics_ref;
+
+static void bench_metrics(void) {
+    BENCH("metrics_inc", 100000, 0, metrics_inc(METRIC_RX_PACKETS));
+    BENCH("metrics_record", 100000, 0, metrics_record(METRIC_HIST_RX_TO_UART, bench_i & 0xFFFF));
+
+    uint8_t frame[METRICS_FRAME_SIZE];
+    const uint8_t mac[6] = {0};
+    BENCH("metrics_encode", 1000, METRICS_FRAME_SIZE,
+          sink += metrics_encode(&bench_snapshot, mac, bench_i, frame, sizeof(frame)));
+}
+
+// Значения снимка совпадают с учтенными: счетчики - с приращением,
+// перцентили интервала - с эталонной гистограммой тех же измерений
+static void fuzz_metrics(void) {
+    uint8_t frame[METRICS_FRAME_SIZE];
+    const uint8_t mac[6] = {1, 2, 3, 4, 5, 6};
+    uint32_t iterations = 64;
+    uint32_t failed = 0;
+
+    for (uint32_t iter = 0; iter < iterations; iter++) {
+        // Предыдущий снимок задает начало интервала
+        metrics_encode(&bench_snapshot, mac, 0, frame, sizeof(frame));
+        uint32_t before = metrics_get(METRIC_TX_DROPPED);
+
+        latency_hist_reset(&bench_metrics_ref);
+        uint32_t count = rng_next() % 2000;
+        for (uint32_t i = 0; i < count; i++) {
+            int64_t latency_us = rng_next() % (1u << (rng_next() % 24));
+            latency_hist_record(&bench_metrics_ref, latency_us);
+            metrics_record(METRIC_HIST_QUEUE_TO_SEND, latency_us);
+            metrics_inc(METRIC_TX_DROPPED);
+        }
+
+        size_t len = metrics_encode(&bench_snapshot, mac, iter, frame, sizeof(frame));
+        const uint8_t *counters = frame + METRICS_HEADER_SIZE + 1;
+        const uint8_t *hist = counters + METRIC_COUNT * 4 + 1 + METRIC_GAUGE_COUNT * 4 + 1 +
+                              METRIC_HIST_QUEUE_TO_SEND * METRICS_HIST_SIZE;
+        // Снимок знает максимум с точностью до корзины
+        uint32_t max_us = count ? latency_hist_bucket_limit(latency_hist_bucket(bench_metrics_ref.max_us)) : 0;
+        bench_metrics_ref.max_us = max_us;
+        if (len != METRICS_FRAME_SIZE || !metrics_is_snapshot(frame, len) ||
+            drone_msg_le32(counters + METRIC_TX_DROPPED * 4) != before + count ||
+            drone_msg_le32(hist) != count ||
+            drone_msg_le32(hist + 4) != latency_hist_percentile(&bench_metrics_ref, 50) ||
+            drone_msg_le32(hist + 8) != latency_hist_percentile(&bench_metrics_ref, 99) ||
+            drone_msg_le32(hist + 12) != max_us) {
+            failed++;
+        }
+    }
+
+    report_fuzz("metrics", iterations, iterations - failed, failed);
+}
+#endif
+
+static void bench_parser_all(void) {
+    bench_parsers(FRAME_MODE_MARKERS, "parser_feed_markers", "parser_ring_markers");
+    bench_parsers(FRAME_MODE_LENGTH, "parser_feed_length", "parser_ring_length");
+}
+
+static void fuzz_parser_all(void) {
+    fuzz_parser(FRAME_MODE_LENGTH, "parser_split_length");
+    fuzz_parser(FRAME_MODE_MARKERS, "parser_split_markers");
+    fuzz_parser_resync();
+    fuzz_parser_resync_payload();
+}
+
+static void fuzz_codecs(void) {
+    fuzz_decode();
+    fuzz_compact();
+    fuzz_typed();
+}
+
+// Группы замеров по модулям. Полный прогон выполняет сначала все замеры,
+// затем все фаззинг-проверки
+typedef struct {
+    const char *name;
+    void (*bench)(void);
+    void (*fuzz)(void);
+} bench_group_t;
+
+static const bench_group_t bench_groups[] = {
+    { "codecs",     bench_codecs,      fuzz_codecs },
+    { "parser",     bench_parser_all,  fuzz_parser_all },
+    { "aggregator", NULL,              fuzz_aggregator },
+    { "tx_sched",   bench_tx_sched,    fuzz_tx_sched },
+    { "peer_table", bench_peer_lookup, fuzz_peer_table },
+    { "fleet",      bench_fleet,       fuzz_fleet },
+    { "fragment",   bench_fragment,    fuzz_fragment },
+    { "flightrec",  bench_flightrec,   fuzz_flightrec },
+    { "timesync",   bench_timesync,    fuzz_timesync },
+    { "rate_ctrl",  bench_rate_ctrl,   fuzz_rate_ctrl },
+#if CONFIG_BRIDGE_METRICS
+    { "metrics",    bench_metrics,     fuzz_metrics },
+#endif
+};
+
+#define BENCH_GROUP_COUNT (sizeof(bench_groups) / sizeof(bench_groups[0]))
+
+bool bench_run(const char *group) {
+    benchmarks = 0;
+    violations = 0;
+    rng_state = 0x9E3779B9;
+
+    bool found = false;
+    for (size_t i = 0; i < BENCH_GROUP_COUNT; i++) {
+        found = found || !group || strcmp(bench_groups[i].name, group) == 0;
+    }
+    if (!found) {
+        ESP_LOGE(TAG, "Нет группы замеров %s", group);
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Замеры производительности и фаззинг-проверки%s%s", group ? ": " : "", group ? group : "");
+
+    for (size_t i = 0; i < BENCH_GROUP_COUNT; i++) {
+        if (bench_groups[i].bench && (!group || strcmp(bench_groups[i].name, group) == 0)) {
+            bench_groups[i].bench();
+        }
+    }
+    for (size_t i = 0; i < BENCH_GROUP_COUNT; i++) {
+        if (bench_groups[i].fuzz && (!group || strcmp(bench_groups[i].name, group) == 0)) {
+            bench_groups[i].fuzz();
+        }
+    }
+
+    ESP_LOGI(TAG, "SELFTEST {\"benchmarks\":%" PRIu32 ",\"violations\":%" PRIu32 ",\"result\":\"%s\"}",
+             benchmarks, violations, violations ? "FAIL" : "PASS");
+    return violations == 0;
+}
+
+bool bench_run_all(void) {
+    return bench_run(NULL);
+}
+
+#endif /* TEST_BUILD */
@@ -0,0 +1,694 @@
+#include "bridge.h"
+#include <string.h>
+#include "drone_message.h"
+#include "drone_msg_view.h"
+#include "drone_typed.h"
+#include "metrics.h"
+#include "dlog.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "sdkconfig.h"
+
+#define TAG "BRIDGE"
+
+void bridge_default_config(bridge_config_t *config) {
+    memset(config, 0, sizeof(*config));
+#if CONFIG_BRIDGE_AGGREGATION
+    config->aggregation = true;
+    config->aggregation_deadline_us = CONFIG_BRIDGE_AGGREGATION_DEADLINE_US;
+#else
+    config->aggregation_deadline_us = 5000;
+#endif
+#if CONFIG_BRIDGE_COMPACT_TELEMETRY
+    config->compact = true;
+    config->keyframe_interval = CONFIG_BRIDGE_COMPACT_KEYFRAME_INTERVAL;
+#else
+    config->keyframe_interval = 10;
+#endif
+#if CONFIG_BRIDGE_TYPED_MESSAGES
+    config->typed = true;
+#endif
+#if CONFIG_BRIDGE_RELIABLE
+    config->reliable = true;
+    config->reliable_config.window = CONFIG_BRIDGE_RELIABLE_WINDOW;
+    config->reliable_config.rto_min_us = CONFIG_BRIDGE_RELIABLE_RTO_MIN_MS * 1000;
+    config->reliable_config.rto_max_us = CONFIG_BRIDGE_RELIABLE_RTO_MAX_MS * 1000;
+    config->reliable_config.max_retries = CONFIG_BRIDGE_RELIABLE_MAX_RETRIES;
+#else
+    config->reliable_config.window = RELIABLE_MAX_WINDOW;
+    config->reliable_config.rto_min_us = 10000;
+    config->reliable_config.rto_max_us = 400000;
+    config->reliable_config.max_retries = 8;
+#endif
+#if CONFIG_BRIDGE_FRAGMENT
+    config->fragment = true;
+    config->fragment_timeout_us = CONFIG_BRIDGE_FRAGMENT_TIMEOUT_MS * 1000LL;
+#else
+    config->fragment_timeout_us = 500000;
+#endif
+#if CONFIG_BRIDGE_TIMESYNC
+    config->timesync = true;
+    // Синхронизация теряется, если ответов нет в течение 30 периодов запросов
+    config->timesync_holdover_us = CONFIG_BRIDGE_TIMESYNC_INTERVAL_MS * 30 * 1000LL;
+    config->stamp_every = CONFIG_BRIDGE_TIMESYNC_STAMP_EVERY;
+#if CONFIG_BRIDGE_TIMESYNC_REFERENCE
+    config->timesync_reference = true;
+#endif
+#endif
+#if CONFIG_BRIDGE_RATE_CTRL
+    config->rate_ctrl = true;
+    config->rate_ctrl_config = (rate_ctrl_config_t){
+        .period_us = CONFIG_BRIDGE_RATE_CTRL_PERIOD_MS * 1000,
+        .min_hz = CONFIG_BRIDGE_RATE_CTRL_MIN_HZ,
+        .step_hz = CONFIG_BRIDGE_RATE_CTRL_STEP_HZ,
+        .good_permille = CONFIG_BRIDGE_RATE_CTRL_GOOD_PERMILLE,
+        .poor_permille = CONFIG_BRIDGE_RATE_CTRL_POOR_PERMILLE,
+        .rssi_poor_dbm = CONFIG_BRIDGE_RATE_CTRL_RSSI_POOR,
+    };
+#else
+    config->rate_ctrl_config = (rate_ctrl_config_t){
+        .period_us = 200000,
+        .min_hz = 5,
+        .step_hz = 5,
+        .good_permille = 950,
+        .poor_permille = 800,
+    };
+#endif
+}
+
+// Счетчики моста пишут несколько задач: стадия пересылки, прием, журнал
+static inline void bridge_count(uint32_t *counter, metric_counter_t metric) {
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+    metrics_inc(metric);
+}
+
+static inline int64_t bridge_now(const bridge_t *bridge) {
+    return bridge->hooks.now(bridge->hooks.ctx);
+}
+
+// Первые байты служебных пакетов: контейнер, доставка с подтверждением,
+// снимки, метрики, фрагменты, журнал и синхронизация часов
+#define BRIDGE_RESERVED_FIRST   AGGREGATOR_MAGIC
+#define BRIDGE_RESERVED_LAST    TIMESYNC_MAGIC
+
+// Кадр вкладывается в контейнер из одного кадра, который сам может попасть
+// в контейнер
+#define BRIDGE_ESCAPE_MAX_FRAME (AGGREGATOR_MAX_FRAME - AGGREGATOR_HEADER_SIZE - 1)
+
+// Кадр полетного контроллера, который приемник разобрал бы как служебный.
+// Запрос чтения журнала к другому мосту служебный по назначению
+static bool bridge_reserved(const uint8_t *frame, size_t len) {
+    return len > 0 && frame[0] >= BRIDGE_RESERVED_FIRST && frame[0] <= BRIDGE_RESERVED_LAST &&
+           !flightrec_parse_request(frame, len, NULL);
+}
+
+// Контейнер из одного кадра внутри пакета или контейнера - вложенный кадр
+// полетного контроллера с первым байтом служебного пакета
+static bool bridge_unescape(const uint8_t **frame, size_t *len) {
+    const uint8_t *data = *frame;
+    if (!aggregator_is_container(data, *len) || data[1] != 1 || data[2] == 0 ||
+        *len != AGGREGATOR_HEADER_SIZE + 1 + (size_t)data[2]) {
+        return false;
+    }
+    *frame = data + AGGREGATOR_HEADER_SIZE + 1;
+    *len = data[2];
+    return true;
+}
+
+void bridge_send_to(bridge_t *bridge, const transport_dest_t *dest, const uint8_t *packet, size_t len) {
+    const transport_t *transport = bridge->transport;
+    tx_class_t cls = tx_class_of(packet, len);
+    transport_tx_status_t status;
+    // Пакет ждет места в любом режиме адресации: копии для группы канал
+    // ставит все или ни одной, поэтому повтор их не удваивает. Если канал
+    // не может ждать места (модель с общим модельным временем), пакет не
+    // ставится
+    while ((status = transport->send(dest, packet, len, cls)) == TRANSPORT_TX_FULL &&
+           transport->wait_space(portMAX_DELAY)) {
+    }
+
+    if (status == TRANSPORT_TX_QUEUED || status == TRANSPORT_TX_QUEUED_DROPPED) {
+        bridge_count(&bridge->stats.tx_queued, METRIC_TX_QUEUED);
+    }
+    if (status != TRANSPORT_TX_QUEUED) {
+        bridge_count(&bridge->stats.tx_dropped, METRIC_TX_DROPPED);
+    }
+    if (status == TRANSPORT_TX_QUEUED_DROPPED) {
+        ESP_LOGD(TAG, "TX queue full, oldest lower-priority packet dropped");
+    }
+    ESP_LOGD(TAG, "Queued for %s: %d bytes", transport->name, len);
+}
+
+void bridge_send(bridge_t *bridge, const uint8_t *packet, size_t len) {
+    bridge_send_to(bridge, &bridge->route, packet, len);
+}
+
+static void aggregate_flush_locked(bridge_t *bridge) {
+    if (bridge->aggregator.count == 0) {
+        return;
+    }
+    bridge->hooks.aggregate_timer(0, bridge->hooks.ctx);
+    bridge_send(bridge, bridge->aggregator.buf, bridge->aggregator.len);
+    ESP_LOGD(TAG, "Aggregated %d frames into %d bytes", bridge->aggregator.count, bridge->aggregator.len);
+    aggregator_reset(&bridge->aggregator);
+    bridge->aggregator_urgent = false;
+}
+
+void bridge_aggregate_deadline(bridge_t *bridge) {
+    xSemaphoreTake(bridge->aggregator_mutex, portMAX_DELAY);
+    aggregate_flush_locked(bridge);
+    xSemaphoreGive(bridge->aggregator_mutex);
+}
+
+static bool aggregate_frame(bridge_t *bridge, const uint8_t *frame, size_t len, bool urgent) {
+    if (len > AGGREGATOR_MAX_FRAME) {
+        return false;
+    }
+
+    xSemaphoreTake(bridge->aggregator_mutex, portMAX_DELAY);
+
+    if (!aggregator_fits(&bridge->aggregator, len)) {
+        aggregate_flush_locked(bridge);
+    }
+    aggregator_add(&bridge->aggregator, frame, len);
+    bridge->aggregator_urgent |= urgent;
+
+    // Команды и тревоги не ждут: уходят сразу вместе с накопленной телеметрией
+    if (bridge->aggregator_urgent || aggregator_should_flush(&bridge->aggregator)) {
+        aggregate_flush_locked(bridge);
+    } else if (bridge->aggregator.count == 1) {
+        bridge->hooks.aggregate_timer(bridge->config.aggregation_deadline_us, bridge->hooks.ctx);
+    }
+
+    xSemaphoreGive(bridge->aggregator_mutex);
+    return true;
+}
+
+static void forward_to_uart(const uint8_t *frame, size_t len, void *user_ctx);
+static void forward_to_air(bridge_t *bridge, const uint8_t *frame, size_t len, int64_t rx_time, bool urgent);
+
+// Служебные кадры не ждут места в очереди: потерянный кадр будет повторен
+static void reliable_send_mac(bridge_t *bridge, const uint8_t *mac, const uint8_t *data, size_t len) {
+    transport_dest_t dest = {.mode = TRANSPORT_DEST_UNICAST};
+    memcpy(dest.mac, mac, sizeof(dest.mac));
+    if (bridge->transport->send(&dest, data, len, tx_class_of(data, len)) == TRANSPORT_TX_FULL) {
+        ESP_LOGD(TAG, "TX queue full, reliable frame left for retransmission");
+    }
+}
+
+static void reliable_send_cb(const uint8_t *data, size_t len, void *user_ctx) {
+    bridge_t *bridge = user_ctx;
+    reliable_send_mac(bridge, bridge->route.mac, data, len);
+}
+
+void bridge_reliable_poll(bridge_t *bridge) {
+    // Задача таймеров не ждет: повтор выполнит следующий вызов
+    if (xSemaphoreTake(bridge->link_mutex, 0) != pdTRUE) {
+        return;
+    }
+    reliable_poll(&bridge->link, bridge_now(bridge));
+    xSemaphoreGive(bridge->link_mutex);
+}
+
+// Состояние приема отправителя mac. Если таблица заполнена, место
+// освобождает отправитель, от которого дольше всех не было пакетов
+static bridge_peer_t *bridge_peer(bridge_t *bridge, const uint8_t *mac, int64_t now) {
+    peer_table_t *peers = &bridge->peers;
+    peer_entry_t *entry = peer_table_find(peers, mac);
+    if (!entry) {
+        if (peers->count >= PEER_TABLE_CAPACITY) {
+            int oldest = -1;
+            for (int i = 0; i < PEER_TABLE_CAPACITY; i++) {
+                if (peers->entries[i].used && (oldest < 0 ||
+                    bridge->peer_state[i].last_rx_us < bridge->peer_state[oldest].last_rx_us)) {
+                    oldest = i;
+                }
+            }
+            peer_table_remove(peers, peers->entries[oldest].mac);
+        }
+        entry = peer_table_add(peers, mac, 0);
+        bridge_peer_t *state = &bridge->peer_state[entry - peers->entries];
+        memset(state, 0, sizeof(*state));
+        reliable_rx_init(&state->reliable);
+        drone_compact_decoder_init(&state->compact);
+    }
+    bridge_peer_t *state = &bridge->peer_state[entry - peers->entries];
+    state->last_rx_us = now;
+    return state;
+}
+
+// Служебный кадр доставки с подтверждением. Подтверждения относятся к
+// передаче получателю кадров, кадры данных принимаются от любого
+// отправителя со своей нумерацией и выдаются в UART вне мьютекса канала
+static void reliable_receive(bridge_t *bridge, const transport_packet_t *packet) {
+    const uint8_t *data = packet->data;
+    size_t len = packet->len;
+
+    if (data[0] == RELIABLE_ACK_MAGIC) {
+        if (memcmp(packet->src_mac, bridge->route.mac, sizeof(bridge->route.mac)) != 0) {
+            DLOGW(DLOG_RELIABLE_FOREIGN, len);
+            return;
+        }
+        xSemaphoreTake(bridge->link_mutex, portMAX_DELAY);
+        reliable_on_ack(&bridge->link, data, len, bridge_now(bridge));
+        xSemaphoreGive(bridge->link_mutex);
+        return;
+    }
+
+    bridge_peer_t *peer = bridge->rx_peer;
+    const uint8_t *frame = NULL;
+    size_t frame_len = 0;
+    uint8_t ack[RELIABLE_ACK_SIZE];
+    reliable_rx_status_t status = reliable_rx_data(&peer->reliable, data, len, &frame, &frame_len, ack);
+    reliable_send_mac(bridge, packet->src_mac, ack, sizeof(ack));
+
+    if (status == RELIABLE_RX_OUT_OF_WINDOW) {
+        DLOGW(DLOG_RELIABLE_OUT_OF_WINDOW, data[2], peer->reliable.next);
+        bridge_count(&bridge->stats.decode_errors, METRIC_DECODE_ERRORS);
+    } else if (status == RELIABLE_RX_DELIVER) {
+        forward_to_uart(frame, frame_len, bridge);
+    }
+}
+
+// Ставит кадр в очередь доставки с подтверждением. При заполненной очереди
+// кадр уходит обычным путем без подтверждения
+static bool reliable_frame(bridge_t *bridge, const uint8_t *frame, size_t len) {
+    xSemaphoreTake(bridge->link_mutex, portMAX_DELAY);
+    reliable_status_t status = reliable_send(&bridge->link, frame, len, bridge_now(bridge));
+    xSemaphoreGive(bridge->link_mutex);
+
+    if (status == RELIABLE_FULL) {
+        ESP_LOGW(TAG, "Reliable queue full, sending without acknowledgement");
+    }
+    return status == RELIABLE_OK;
+}
+
+static void fragment_enqueue_cb(const uint8_t *data, size_t len, void *user_ctx) {
+    bridge_send(user_ctx, data, len);
+}
+
+bool bridge_clock_now(bridge_t *bridge, int64_t local_us, int64_t *shared_us) {
+    xSemaphoreTake(bridge->clock_sync_mutex, portMAX_DELAY);
+    bool synced = timesync_synced(&bridge->clock_sync);
+    *shared_us = timesync_now(&bridge->clock_sync, local_us);
+    xSemaphoreGive(bridge->clock_sync_mutex);
+    return synced;
+}
+
+void bridge_clock_state(bridge_t *bridge, uint8_t *stratum, uint32_t *delay_us) {
+    xSemaphoreTake(bridge->clock_sync_mutex, portMAX_DELAY);
+    *stratum = bridge->clock_sync.stratum;
+    *delay_us = bridge->clock_sync.base_delay_us;
+    xSemaphoreGive(bridge->clock_sync_mutex);
+}
+
+// Запрос уходит получателю кадров моста и не ждет места в очереди:
+// пропущенный запрос заменит запрос следующего периода
+void bridge_clock_sync_ping(bridge_t *bridge) {
+    uint8_t ping[TIMESYNC_PING_SIZE];
+    xSemaphoreTake(bridge->clock_sync_mutex, portMAX_DELAY);
+    size_t len = timesync_ping(&bridge->clock_sync, bridge_now(bridge), ping);
+    xSemaphoreGive(bridge->clock_sync_mutex);
+    if (len && bridge->transport->send(&bridge->route, ping, len, TX_CLASS_CONTROL) == TRANSPORT_TX_FULL) {
+        ESP_LOGD(TAG, "TX queue full, time sync request skipped");
+    }
+}
+
+// Ответ на запрос синхронизации уходит его отправителю. Метки времени
+// приема берутся из обработчика приема, а не из задачи приема
+static void clock_sync_receive(bridge_t *bridge, const transport_packet_t *packet) {
+    uint8_t pong[TIMESYNC_PONG_SIZE];
+    xSemaphoreTake(bridge->clock_sync_mutex, portMAX_DELAY);
+    timesync_on_pong(&bridge->clock_sync, packet->src_mac, packet->data, packet->len, packet->rx_time);
+    size_t len = timesync_answer(&bridge->clock_sync, packet->data, packet->len, packet->rx_time,
+                                 bridge_now(bridge), pong);
+    xSemaphoreGive(bridge->clock_sync_mutex);
+    if (len == 0) {
+        return;
+    }
+
+    transport_dest_t sender = {.mode = TRANSPORT_DEST_UNICAST};
+    memcpy(sender.mac, packet->src_mac, sizeof(sender.mac));
+    if (bridge->transport->send(&sender, pong, len, TX_CLASS_CONTROL) == TRANSPORT_TX_FULL) {
+        ESP_LOGD(TAG, "TX queue full, time sync reply skipped");
+    }
+}
+
+// Задержка от приема кадра по UART на отправителе до приема из радиоканала
+// и до выдачи в UART на этом узле, по общему времени. Младшие 32 бита
+// метки переполняются раз в 71 минуту, разность от этого не зависит
+static void record_one_way(bridge_t *bridge, uint32_t stamp_us, bool sent_to_uart) {
+    int64_t rx_us;
+    int64_t now_us;
+    if (!bridge_clock_now(bridge, bridge->rx_packet_time, &rx_us) ||
+        !bridge_clock_now(bridge, bridge_now(bridge), &now_us)) {
+        return;
+    }
+    int32_t one_way = (int32_t)((uint32_t)rx_us - stamp_us);
+    latency_hist_record(&bridge->stats.one_way_us, one_way);
+    metrics_record(METRIC_HIST_ONE_WAY_RADIO, one_way);
+    if (sent_to_uart) {
+        metrics_record(METRIC_HIST_ONE_WAY_UART, (int32_t)((uint32_t)now_us - stamp_us));
+    }
+}
+
+// Таймер на срок придержанного сообщения, не раньше чем через 1 мкс: 0
+// останавливает таймер
+static void telemetry_timer_start(bridge_t *bridge, int64_t now_us) {
+    int64_t delay = bridge->telemetry_rate.next_us - now_us;
+    bridge->hooks.telemetry_timer(delay > 0 ? (uint32_t)delay : 1, bridge->hooks.ctx);
+}
+
+// Канал оценивается при приеме телеметрии: без нее ограничивать нечего.
+// Широковещательные передачи не подтверждаются, для них остаются только
+// вытеснения из очереди
+static bool telemetry_admit(bridge_t *bridge, const uint8_t *frame, int64_t rx_time) {
+    const transport_t *transport = bridge->transport;
+    if (rate_ctrl_due(&bridge->telemetry_rate, rx_time)) {
+        // Статический снимок: гистограмма не помещается в стек задачи.
+        // Вызывается только стадией пересылки
+        static tx_sched_class_stats_t class_stats;
+        rate_ctrl_sample_t sample = {0};
+        peer_link_stats_t link;
+        if (transport->get_link_stats(&bridge->route, &link)) {
+            sample.tx_ok = link.tx_ok;
+            sample.tx_fail = link.tx_fail;
+            sample.rssi_dbm = link.rx_packets ? link.rssi_avg_x16 / 16 : 0;
+        }
+        transport->get_class_stats(TX_CLASS_TELEMETRY, &class_stats);
+        sample.queue_drops = class_stats.dropped;
+        rate_ctrl_update(&bridge->telemetry_rate, &sample, rx_time);
+    }
+    // Придержанное ранее сообщение заменяется этим в любом случае
+    bool replaced = bridge->telemetry_rate.held;
+    bool admitted = rate_ctrl_admit(&bridge->telemetry_rate, rx_time);
+    if (replaced) {
+        bridge_count(&bridge->stats.decimated, METRIC_TELEMETRY_DECIMATED);
+        drone_compact_skip(&bridge->compact_encoder);
+    }
+    if (admitted) {
+        if (replaced) {
+            bridge->hooks.telemetry_timer(0, bridge->hooks.ctx);
+        }
+        return true;
+    }
+    memcpy(bridge->telemetry_held, frame, DRONE_MSG_PACKET_SIZE);
+    bridge->telemetry_held_time = rx_time;
+    if (!replaced) {
+        telemetry_timer_start(bridge, bridge_now(bridge));
+    }
+    return false;
+}
+
+// Приемник разбирает как контейнер любой пакет с первым байтом
+// AGGREGATOR_MAGIC, а кадры контейнера - как вложенные: вложенный кадр
+// уходит в эфир внутри еще одного контейнера из одного кадра
+static void send_escaped(bridge_t *bridge, const uint8_t *frame, size_t len) {
+    aggregator_t wrapper;
+    aggregator_reset(&wrapper);
+    aggregator_add(&wrapper, frame, len);
+    bridge_send(bridge, wrapper.buf, wrapper.len);
+}
+
+void bridge_forward(bridge_t *bridge, const uint8_t *frame, size_t len, int64_t rx_time) {
+    const bridge_config_t *config = &bridge->config;
+
+    // Запрос чтения журнала от полетного контроллера выполняется на этом
+    // мосту, запрос к другому мосту уходит в эфир как команда
+    flightrec_request_t req;
+    if (bridge->hooks.flightrec_request && flightrec_parse_request(frame, len, &req) && !req.remote) {
+        bridge->hooks.flightrec_request(&req, NULL, bridge->hooks.ctx);
+        return;
+    }
+
+    bool urgent = drone_msg_get_msg_type(frame) != MSG_TYPE_TELEMETRY;
+    // Телеметрия прореживается до компактного кодирования: кодер видит
+    // только переданные сообщения
+    if (config->rate_ctrl && !urgent && len == DRONE_MSG_PACKET_SIZE && !telemetry_admit(bridge, frame, rx_time)) {
+        return;
+    }
+    forward_to_air(bridge, frame, len, rx_time, urgent);
+}
+
+void bridge_telemetry_deadline(bridge_t *bridge) {
+    if (!bridge->telemetry_rate.held) {
+        return;
+    }
+    int64_t now_us = bridge_now(bridge);
+    if (!rate_ctrl_release(&bridge->telemetry_rate, now_us)) {
+        // Таймер сработал раньше срока
+        telemetry_timer_start(bridge, now_us);
+        return;
+    }
+    forward_to_air(bridge, bridge->telemetry_held, DRONE_MSG_PACKET_SIZE, bridge->telemetry_held_time, false);
+}
+
+// Передает в эфир кадр, допущенный пределом частоты
+static void forward_to_air(bridge_t *bridge, const uint8_t *frame, size_t len, int64_t rx_time, bool urgent) {
+    const bridge_config_t *config = &bridge->config;
+
+    // Кадр с первым байтом служебного пакета вкладывается в контейнер из
+    // одного кадра. Не помещающийся в него уходит фрагментами: собранный
+    // кадр выдается в UART без разбора
+    aggregator_t escaped;
+    if (bridge_reserved(frame, len)) {
+        if (len > BRIDGE_ESCAPE_MAX_FRAME) {
+            if (config->fragment) {
+                fragment_split(&bridge->tx_fragments, frame, len, fragment_enqueue_cb, bridge);
+            } else {
+                DLOGW(DLOG_AGGREGATE_ESCAPE_FAILED, len);
+                bridge_count(&bridge->stats.tx_dropped, METRIC_TX_DROPPED);
+            }
+            return;
+        }
+        aggregator_reset(&escaped);
+        aggregator_add(&escaped, frame, len);
+        frame = escaped.buf;
+        len = escaped.len;
+    }
+
+    bool stamp = config->stamp_every > 0 && len == DRONE_MSG_PACKET_SIZE &&
+                 ++bridge->stamp_countdown >= config->stamp_every;
+
+    // Телеметрия уходит в эфир в компактном формате, остальные сообщения - без изменений
+    uint8_t compact[DRONE_COMPACT_MAX_SIZE];
+    drone_message_t drone_msg;
+    if (config->compact && !urgent && len == DRONE_MSG_PACKET_SIZE && drone_msg_decode(frame, len, &drone_msg) == 0) {
+        int compact_len = drone_compact_encode(&bridge->compact_encoder, &drone_msg, compact, sizeof(compact));
+        if (compact_len > 0) {
+            frame = compact;
+            len = compact_len;
+        }
+    }
+
+    // Команды, подтверждения и тревоги - в формате своего типа
+    uint8_t typed[DRONE_TYPED_MAX_SIZE];
+    if (config->typed && urgent && len == DRONE_MSG_PACKET_SIZE) {
+        int typed_len = drone_typed_encode(frame, len, typed, sizeof(typed));
+        if (typed_len > 0) {
+            frame = typed;
+            len = typed_len;
+        }
+    }
+
+    // Каждое N-е сообщение несет общее время его приема по UART: получатель
+    // считает по нему задержку в одну сторону
+    uint8_t stamped[TIMESYNC_STAMP_HEADER + DRONE_MSG_PACKET_SIZE];
+    int64_t stamp_us;
+    if (stamp && bridge_clock_now(bridge, rx_time, &stamp_us)) {
+        len = timesync_stamp((uint32_t)stamp_us, frame, len, stamped, sizeof(stamped));
+        frame = stamped;
+        bridge->stamp_countdown = 0;
+    }
+
+    // Кадр длиннее MTU уходит фрагментами в очередь его класса, без
+    // подтверждения и агрегации
+    if (config->fragment && len > TRANSPORT_MAX_DATA_LEN) {
+        fragment_split(&bridge->tx_fragments, frame, len, fragment_enqueue_cb, bridge);
+        return;
+    }
+
+    // Команды и тревоги - с подтверждением, телеметрия - без. Подтверждения
+    // нескольких получателей группы смешались бы, поэтому только для одного
+    if (config->reliable && urgent && len <= RELIABLE_MAX_FRAME &&
+        bridge->route.mode == TRANSPORT_DEST_UNICAST && reliable_frame(bridge, frame, len)) {
+        return;
+    }
+
+    if (config->aggregation && aggregate_frame(bridge, frame, len, urgent)) {
+        return;
+    }
+    if (len > 0 && frame[0] == AGGREGATOR_MAGIC) {
+        send_escaped(bridge, frame, len);
+        return;
+    }
+    bridge_send(bridge, frame, len);
+}
+
+// Выдает кадр полетному контроллеру. stamped - кадр нес метку времени stamp_us
+static void uart_output(bridge_t *bridge, const uint8_t *frame, size_t len, bool stamped, uint32_t stamp_us) {
+    if (bridge->hooks.uart_send(frame, len, bridge->hooks.ctx) < 0) {
+        DLOGW(DLOG_UART_TX_FAILED, len);
+        return;
+    }
+    bridge_count(&bridge->stats.uart_frames, METRIC_UART_TX_FRAMES);
+    if (stamped) {
+        record_one_way(bridge, stamp_us, true);
+    }
+
+#if DLOG_LEVEL >= DLOG_LEVEL_INFO
+    // Для журнала достаточно заголовка: поля читаются прямо из кадра
+    if (drone_msg_verify(frame, len) >= 0) {
+        DLOGI(DLOG_MSG_RECEIVED, drone_msg_get_msg_type(frame), drone_msg_get_msg_id(frame),
+              drone_msg_get_timestamp(frame));
+#if DLOG_LEVEL >= DLOG_LEVEL_DEBUG
+        drone_message_t drone_msg;
+        if (drone_msg_decode(frame, len, &drone_msg) == 0) {
+            drone_msg_log(&drone_msg);
+        }
+#endif
+    }
+#endif
+}
+
+// Восстанавливает кадр данных из сжатых форматов и выдает его в UART или
+// таблицу дронов. Отправитель - bridge->rx_mac
+static void deliver_to_uart(bridge_t *bridge, const uint8_t *frame, size_t len, bool stamped, uint32_t stamp_us) {
+    const bridge_config_t *config = &bridge->config;
+
+    // Запрос чтения журнала, пришедший по радиоканалу, выполняется на этом мосту
+    flightrec_request_t req;
+    if (bridge->hooks.flightrec_request && flightrec_parse_request(frame, len, &req)) {
+        bridge->hooks.flightrec_request(&req, bridge->rx_mac, bridge->hooks.ctx);
+        return;
+    }
+
+    // Полетный контроллер получает телеметрию в полном формате
+    uint8_t expanded[DRONE_MSG_PACKET_SIZE];
+    if (config->compact && drone_compact_is_compact(frame, len)) {
+        drone_message_t compact_msg;
+        if (drone_compact_decode(&bridge->rx_peer->compact, frame, len, &compact_msg) < 0) {
+            DLOGW(DLOG_COMPACT_DROPPED, len);
+            bridge_count(&bridge->stats.decode_errors, METRIC_DECODE_ERRORS);
+            return;
+        }
+        len = drone_msg_encode(&compact_msg, expanded, sizeof(expanded));
+        frame = expanded;
+    }
+
+    // Полный пакет восстанавливается побайтно, с исходной CRC
+    uint8_t typed_expanded[DRONE_MSG_PACKET_SIZE];
+    if (config->typed && drone_typed_is_typed(frame, len)) {
+        if (drone_typed_expand(frame, len, typed_expanded, sizeof(typed_expanded)) < 0) {
+            DLOGW(DLOG_TYPED_DROPPED, len);
+            bridge_count(&bridge->stats.decode_errors, METRIC_DECODE_ERRORS);
+            return;
+        }
+        frame = typed_expanded;
+        len = DRONE_MSG_PACKET_SIZE;
+    }
+
+    // Телеметрия попадает в UART только в составе снимка
+    fleet_table_t *fleet = config->fleet;
+    if (fleet && len > 0 && frame[0] == MSG_TYPE_TELEMETRY) {
+        if (stamped) {
+            record_one_way(bridge, stamp_us, false);
+        }
+        if (fleet_update(fleet, bridge->rx_mac, frame, len, bridge_now(bridge)) == FLEET_FULL &&
+            fleet->stats.rejected == 1) {
+            // Сообщается один раз, дальше видно по счетчику rejected
+            DLOGW(DLOG_FLEET_FULL, fleet->count);
+        }
+        return;
+    }
+
+    uart_output(bridge, frame, len, stamped, stamp_us);
+}
+
+// Передает в полетный контроллер один кадр, принятый из эфира: пакет,
+// кадр контейнера или доставленный с подтверждением
+static void forward_to_uart(const uint8_t *frame, size_t len, void *user_ctx) {
+    bridge_t *bridge = user_ctx;
+
+    uint32_t stamp_us;
+    bool stamped = timesync_unstamp(&frame, &len, &stamp_us);
+
+    // Вложенный кадр полетного контроллера выдается без разбора
+    if (bridge_unescape(&frame, &len)) {
+        uart_output(bridge, frame, len, stamped, stamp_us);
+        return;
+    }
+    deliver_to_uart(bridge, frame, len, stamped, stamp_us);
+}
+
+// Фрагментами передаются только кадры полетного контроллера, без меток
+// времени и вложений
+static void forward_fragment_to_uart(const uint8_t *frame, size_t len, void *user_ctx) {
+    deliver_to_uart(user_ctx, frame, len, false, 0);
+}
+
+void bridge_receive(bridge_t *bridge, const transport_packet_t *packet) {
+    const bridge_config_t *config = &bridge->config;
+    bridge->rx_mac = packet->src_mac;
+    bridge->rx_peer = bridge_peer(bridge, packet->src_mac, bridge_now(bridge));
+    bridge->rx_packet_time = packet->rx_time;
+
+    if (config->timesync && timesync_is_sync_frame(packet->data, packet->len)) {
+        clock_sync_receive(bridge, packet);
+    } else if (config->reliable && reliable_is_link_frame(packet->data, packet->len)) {
+        reliable_receive(bridge, packet);
+    } else if (config->fragment && fragment_is_fragment(packet->data, packet->len)) {
+        // Собранный кадр выдается в UART прямо из слота сборки
+        fragment_rx_t *rx = &bridge->rx_fragments;
+        if (fragment_receive(rx, packet->src_mac, packet->data, packet->len, bridge_now(bridge),
+                             forward_fragment_to_uart, bridge) < 0) {
+            DLOGW(DLOG_FRAGMENT_INVALID, packet->len);
+            bridge_count(&bridge->stats.decode_errors, METRIC_DECODE_ERRORS);
+        }
+        uint32_t lost = rx->stats.timeouts + rx->stats.evicted;
+        metrics_add(METRIC_FRAGMENT_DROPPED, lost - bridge->rx_fragments_reported_lost);
+        bridge->rx_fragments_reported_lost = lost;
+    } else if (aggregator_is_container(packet->data, packet->len)) {
+        if (aggregator_unpack(packet->data, packet->len, forward_to_uart, bridge) < 0) {
+            DLOGW(DLOG_ESPNOW_BAD_CONTAINER, packet->len);
+            bridge_count(&bridge->stats.decode_errors, METRIC_DECODE_ERRORS);
+        }
+    } else {
+        forward_to_uart(packet->data, packet->len, bridge);
+    }
+    bridge->rx_mac = NULL;
+    bridge->rx_peer = NULL;
+}
+
+void bridge_init(bridge_t *bridge, const bridge_config_t *config, const transport_t *transport,
+                 const transport_dest_t *route, const bridge_hooks_t *hooks) {
+    memset(bridge, 0, sizeof(*bridge));
+    bridge->config = *config;
+    bridge->transport = transport;
+    bridge->route = *route;
+    bridge->hooks = *hooks;
+
+    aggregator_reset(&bridge->aggregator);
+    bridge->aggregator_mutex = xSemaphoreCreateMutexStatic(&bridge->aggregator_mutex_buf);
+
+    drone_compact_encoder_init(&bridge->compact_encoder, config->keyframe_interval);
+
+    const reliable_config_t *link_config = &config->reliable_config;
+    bridge->link_mutex = xSemaphoreCreateMutexStatic(&bridge->link_mutex_buf);
+    reliable_init(&bridge->link, link_config, (uint8_t)(esp_random() % 255 + 1), reliable_send_cb, bridge);
+    peer_table_init(&bridge->peers);
+
+    // Без слотов мост только разбивает кадры: принятые фрагменты отбрасываются
+    fragment_tx_init(&bridge->tx_fragments, (uint8_t)esp_random());
+    fragment_rx_init(&bridge->rx_fragments, config->fragment_slots, config->fragment_slot_count,
+                     config->fragment_timeout_us);
+
+    bridge->clock_sync_mutex = xSemaphoreCreateMutexStatic(&bridge->clock_sync_mutex_buf);
+    // Эталон только отвечает на запросы
+    timesync_init(&bridge->clock_sync, config->timesync_reference, config->timesync_holdover_us);
+    if (!config->timesync) {
+        bridge->config.stamp_every = 0;
+    }
+
+    rate_ctrl_init(&bridge->telemetry_rate, &config->rate_ctrl_config);
+}
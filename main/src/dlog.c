@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "dlog.h"
+#include "bridge_tasks.h"
+
+#define DLOG_RING_LEN      CONFIG_BRIDGE_DLOG_RING_LEN
+#define DLOG_RATE_LIMIT    CONFIG_BRIDGE_DLOG_RATE_LIMIT
+#define DLOG_FLUSH_MS      50
+
+_Static_assert((DLOG_RING_LEN & (DLOG_RING_LEN - 1)) == 0, "DLOG_RING_LEN должна быть степенью двойки");
+
+// Компактная запись события
+typedef struct {
+    uint32_t timestamp;        // Время (мс, esp_log_timestamp)
+    uint16_t event;            // Идентификатор события
+    uint8_t level;             // Уровень
+    uint8_t argc;              // Количество аргументов
+    uint16_t suppressed;       // Подавлено записей этого места перед данной
+    uint32_t args[DLOG_MAX_ARGS];
+} dlog_record_t;
+
+// Ячейка кольцевого буфера с порядковым номером: позволяет нескольким
+// задачам писать без блокировок (очередь Вьюкова), читает одна задача
+typedef struct {
+    uint32_t seq;
+    dlog_record_t record;
+} dlog_cell_t;
+
+typedef struct {
+    const char *tag;
+    const char *format;
+} dlog_event_info_t;
+
+static const dlog_event_info_t dlog_events[DLOG_EVENT_COUNT] = {
+#define DLOG_EVENT_INFO(id, tag, fmt) [id] = { tag, fmt },
+    DLOG_EVENTS(DLOG_EVENT_INFO)
+#undef DLOG_EVENT_INFO
+};
+
+static dlog_cell_t dlog_ring[DLOG_RING_LEN];
+static uint32_t dlog_head = 0;
+static uint32_t dlog_tail = 0;
+static uint32_t dlog_dropped = 0;
+static bool dlog_ready = false;
+
+// Ограничение частоты: не более DLOG_RATE_LIMIT записей в секунду на место вызова
+static bool dlog_rate_allow(dlog_site_t *site, uint32_t now) {
+    if (now - site->window_start >= 1000) {
+        site->window_start = now;
+        site->count = 0;
+    }
+    if (site->count >= DLOG_RATE_LIMIT) {
+        if (site->suppressed < UINT16_MAX) {
+            site->suppressed++;
+        }
+        return false;
+    }
+    site->count++;
+    return true;
+}
+
+void dlog_write(dlog_site_t *site, uint8_t level, dlog_event_t event, const uint32_t *args, int argc) {
+    if (!dlog_ready) {
+        return;
+    }
+
+    uint32_t now = esp_log_timestamp();
+    if (site && !dlog_rate_allow(site, now)) {
+        return;
+    }
+
+    // Резервируем ячейку
+    dlog_cell_t *cell;
+    uint32_t pos = __atomic_load_n(&dlog_head, __ATOMIC_RELAXED);
+    while (1) {
+        cell = &dlog_ring[pos & (DLOG_RING_LEN - 1)];
+        uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&dlog_head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&dlog_dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&dlog_head, __ATOMIC_RELAXED);
+        }
+    }
+
+    dlog_record_t *record = &cell->record;
+    record->timestamp = now;
+    record->event = event;
+    record->level = level;
+    record->argc = argc;
+    record->suppressed = 0;
+    if (site) {
+        record->suppressed = site->suppressed;
+        site->suppressed = 0;
+    }
+    for (int i = 0; i < argc && i < DLOG_MAX_ARGS; i++) {
+        record->args[i] = args[i];
+    }
+
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+static bool dlog_read(dlog_record_t *out) {
+    dlog_cell_t *cell = &dlog_ring[dlog_tail & (DLOG_RING_LEN - 1)];
+    uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    if (seq != dlog_tail + 1) {
+        return false;
+    }
+
+    *out = cell->record;
+    __atomic_store_n(&cell->seq, dlog_tail + DLOG_RING_LEN, __ATOMIC_RELEASE);
+    dlog_tail++;
+    return true;
+}
+
+static void dlog_emit(const dlog_record_t *record) {
+    static const char level_letter[] = { 'N', 'E', 'W', 'I', 'D' };
+
+    if (record->event >= DLOG_EVENT_COUNT) {
+        return;
+    }
+    const dlog_event_info_t *info = &dlog_events[record->event];
+
+    uint32_t a[DLOG_MAX_ARGS] = {0};
+    for (int i = 0; i < record->argc && i < DLOG_MAX_ARGS; i++) {
+        a[i] = record->args[i];
+    }
+
+    char text[160];
+    snprintf(text, sizeof(text), info->format,
+             (unsigned)a[0], (unsigned)a[1], (unsigned)a[2], (unsigned)a[3]);
+
+    char letter = record->level < sizeof(level_letter) ? level_letter[record->level] : '?';
+    if (record->suppressed > 0) {
+        esp_log_write(record->level, info->tag, "%c (%" PRIu32 ") %s: %s (подавлено %u)\n",
+                      letter, record->timestamp, info->tag, text, record->suppressed);
+    } else {
+        esp_log_write(record->level, info->tag, "%c (%" PRIu32 ") %s: %s\n",
+                      letter, record->timestamp, info->tag, text);
+    }
+}
+
+// Фоновая задача с низким приоритетом: форматирует и выводит накопленные записи
+static void dlog_task(void *arg) {
+    uint32_t reported_dropped = 0;
+    dlog_record_t record;
+
+    while (1) {
+        while (dlog_read(&record)) {
+            dlog_emit(&record);
+        }
+
+        uint32_t dropped = __atomic_load_n(&dlog_dropped, __ATOMIC_RELAXED);
+        if (dropped != reported_dropped) {
+            ESP_LOGW("DLOG", "Буфер лога переполнен, потеряно записей: %" PRIu32, dropped - reported_dropped);
+            reported_dropped = dropped;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(DLOG_FLUSH_MS));
+    }
+}
+
+void dlog_init(void) {
+    if (dlog_ready) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < DLOG_RING_LEN; i++) {
+        dlog_ring[i].seq = i;
+    }
+    dlog_head = 0;
+    dlog_tail = 0;
+    dlog_ready = true;
+
+    // Вывод лога не привязан к ядру: задача с низшим приоритетом занимает
+    // любое ядро, свободное от стадий конвейера
+    BRIDGE_TASK_CREATE_STATIC(dlog_task, "dlog_task", DLOG_TASK_STACK, NULL, DLOG_TASK_PRIO, NULL, tskNO_AFFINITY);
+}
+
+uint32_t dlog_get_dropped(void) {
+    return __atomic_load_n(&dlog_dropped, __ATOMIC_RELAXED);
+}
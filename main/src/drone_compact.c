@@ -0,0 +1,342 @@
+#include <string.h>
+#include "drone_compact.h"
+#include "crc.h"
+
+// Размеры групп полей в ключевом кадре (в порядке битов карты присутствия)
+static const uint8_t group_size[8] = {12, 2, 6, 6, 5, 2, 2, 3};
+
+// Разностная позиция: три int16 вместо трех int32
+#define DELTA_POSITION_SIZE 6
+
+static inline void put_u16(uint8_t **p, uint16_t v) {
+    (*p)[0] = v & 0xFF;
+    (*p)[1] = v >> 8;
+    *p += 2;
+}
+
+static inline void put_u32(uint8_t **p, uint32_t v) {
+    (*p)[0] = v & 0xFF;
+    (*p)[1] = (v >> 8) & 0xFF;
+    (*p)[2] = (v >> 16) & 0xFF;
+    (*p)[3] = v >> 24;
+    *p += 4;
+}
+
+static inline uint16_t get_u16(const uint8_t **p) {
+    uint16_t v = (uint16_t)((*p)[0] | ((*p)[1] << 8));
+    *p += 2;
+    return v;
+}
+
+static inline uint32_t get_u32(const uint8_t **p) {
+    uint32_t v = (uint32_t)(*p)[0] | ((uint32_t)(*p)[1] << 8) |
+                 ((uint32_t)(*p)[2] << 16) | ((uint32_t)(*p)[3] << 24);
+    *p += 4;
+    return v;
+}
+
+// Перевод в фиксированную точку с округлением и насыщением, NaN -> 0
+static int32_t quantize(double value, double scale, int32_t min, int32_t max) {
+    if (value != value) {
+        return 0;
+    }
+    double q = value * scale;
+    q = (q < 0) ? q - 0.5 : q + 0.5;
+    if (q <= (double)min) {
+        return min;
+    }
+    if (q >= (double)max) {
+        return max;
+    }
+    return (int32_t)q;
+}
+
+static void quantize_fields(const drone_message_t *msg, drone_compact_fields_t *q) {
+    q->latitude = quantize(msg->latitude, 1e7, -900000000, 900000000);
+    q->longitude = quantize(msg->longitude, 1e7, -1800000000, 1800000000);
+    q->altitude = quantize(msg->altitude, 100.0, INT32_MIN, INT32_MAX);
+    q->relative_altitude = (int16_t)quantize(msg->relative_altitude, 10.0, INT16_MIN, INT16_MAX);
+    q->roll = (int16_t)quantize(msg->roll, 100.0, INT16_MIN, INT16_MAX);
+    q->pitch = (int16_t)quantize(msg->pitch, 100.0, INT16_MIN, INT16_MAX);
+    q->yaw = (int16_t)quantize(msg->yaw, 50.0, INT16_MIN, INT16_MAX);
+    q->vx = (int16_t)quantize(msg->vx, 100.0, INT16_MIN, INT16_MAX);
+    q->vy = (int16_t)quantize(msg->vy, 100.0, INT16_MIN, INT16_MAX);
+    q->vz = (int16_t)quantize(msg->vz, 100.0, INT16_MIN, INT16_MAX);
+    q->battery_percentage = msg->battery_percentage;
+    q->battery_voltage = (uint16_t)quantize(msg->battery_voltage, 1000.0, 0, UINT16_MAX);
+    q->battery_current = (int16_t)quantize(msg->battery_current, 100.0, INT16_MIN, INT16_MAX);
+    q->flight_time = msg->flight_time;
+    q->status_flags = msg->status_flags;
+    q->cpu_load = msg->cpu_load;
+    q->rssi = msg->rssi;
+    q->gps = (msg->satellites > 63 ? 63 : msg->satellites) | ((msg->fix_type & 0x03) << 6);
+}
+
+static void dequantize_fields(const drone_compact_fields_t *q, drone_message_t *msg) {
+    msg->latitude = (float)(q->latitude / 1e7);
+    msg->longitude = (float)(q->longitude / 1e7);
+    msg->altitude = (float)(q->altitude / 100.0);
+    msg->relative_altitude = q->relative_altitude / 10.0f;
+    msg->roll = q->roll / 100.0f;
+    msg->pitch = q->pitch / 100.0f;
+    msg->yaw = q->yaw / 50.0f;
+    msg->vx = q->vx / 100.0f;
+    msg->vy = q->vy / 100.0f;
+    msg->vz = q->vz / 100.0f;
+    msg->battery_percentage = q->battery_percentage;
+    msg->battery_voltage = q->battery_voltage / 1000.0f;
+    msg->battery_current = q->battery_current / 100.0f;
+    msg->flight_time = q->flight_time;
+    msg->status_flags = q->status_flags;
+    msg->cpu_load = q->cpu_load;
+    msg->rssi = q->rssi;
+    msg->satellites = q->gps & 0x3F;
+    msg->fix_type = q->gps >> 6;
+}
+
+// Битовая карта групп, отличающихся от ключевого кадра
+static uint8_t changed_groups(const drone_compact_fields_t *a, const drone_compact_fields_t *b) {
+    uint8_t groups = 0;
+    if (a->latitude != b->latitude || a->longitude != b->longitude || a->altitude != b->altitude)
+        groups |= DRONE_COMPACT_POSITION;
+    if (a->relative_altitude != b->relative_altitude)
+        groups |= DRONE_COMPACT_REL_ALT;
+    if (a->roll != b->roll || a->pitch != b->pitch || a->yaw != b->yaw)
+        groups |= DRONE_COMPACT_ATTITUDE;
+    if (a->vx != b->vx || a->vy != b->vy || a->vz != b->vz)
+        groups |= DRONE_COMPACT_VELOCITY;
+    if (a->battery_percentage != b->battery_percentage ||
+        a->battery_voltage != b->battery_voltage || a->battery_current != b->battery_current)
+        groups |= DRONE_COMPACT_BATTERY;
+    if (a->flight_time != b->flight_time)
+        groups |= DRONE_COMPACT_FLIGHT;
+    if (a->status_flags != b->status_flags)
+        groups |= DRONE_COMPACT_STATUS;
+    if (a->cpu_load != b->cpu_load || a->rssi != b->rssi || a->gps != b->gps)
+        groups |= DRONE_COMPACT_SYSTEM;
+    return groups;
+}
+
+static inline bool fits_int16(int32_t v) {
+    return v >= INT16_MIN && v <= INT16_MAX;
+}
+
+static int expected_length(uint8_t flags, uint8_t groups) {
+    bool delta = flags & DRONE_COMPACT_FLAG_DELTA;
+    int len = DRONE_COMPACT_HEADER_SIZE + (delta ? 2 : 4) + 1 + sizeof(uint16_t);
+    for (int i = 0; i < 8; i++) {
+        if (groups & (1 << i)) {
+            len += (delta && i == 0) ? DELTA_POSITION_SIZE : group_size[i];
+        }
+    }
+    return len;
+}
+
+void drone_compact_encoder_init(drone_compact_encoder_t *enc, uint16_t interval) {
+    memset(enc, 0, sizeof(*enc));
+    enc->interval = interval ? interval : 1;
+}
+
+void drone_compact_force_keyframe(drone_compact_encoder_t *enc) {
+    enc->has_key = false;
+}
+
+void drone_compact_skip(drone_compact_encoder_t *enc) {
+    if (enc->since_key < enc->interval) {
+        enc->since_key++;
+    }
+}
+
+int drone_compact_encode(drone_compact_encoder_t *enc, const drone_message_t *msg,
+                         uint8_t *buffer, int buf_size) {
+    if (!enc || !msg || !buffer || buf_size < DRONE_COMPACT_MAX_SIZE ||
+        msg->msg_type != MSG_TYPE_TELEMETRY) {
+        return -1;
+    }
+
+    drone_compact_fields_t q;
+    quantize_fields(msg, &q);
+
+    int32_t dlat = q.latitude - enc->key.latitude;
+    int32_t dlon = q.longitude - enc->key.longitude;
+    int64_t dalt = (int64_t)q.altitude - enc->key.altitude;
+    uint32_t dtime = msg->timestamp - enc->key_timestamp;
+
+    // Разностный кадр возможен, пока разности помещаются в int16
+    bool delta = enc->has_key && enc->since_key + 1 < enc->interval &&
+                 dtime <= UINT16_MAX && fits_int16(dlat) && fits_int16(dlon) &&
+                 dalt >= INT16_MIN && dalt <= INT16_MAX;
+
+    uint8_t groups;
+    if (delta) {
+        groups = changed_groups(&q, &enc->key);
+        enc->since_key++;
+    } else {
+        groups = DRONE_COMPACT_ALL_GROUPS;
+        enc->key = q;
+        enc->key_timestamp = msg->timestamp;
+        enc->key_seq = (enc->key_seq + 1) & DRONE_COMPACT_KEY_SEQ_MASK;
+        enc->since_key = 0;
+        enc->has_key = true;
+    }
+
+    uint8_t *p = buffer;
+    *p++ = msg->msg_type;
+    *p++ = DRONE_MSG_VERSION_COMPACT;
+    *p++ = msg->msg_id;
+    *p++ = enc->key_seq | (delta ? DRONE_COMPACT_FLAG_DELTA : 0);
+
+    if (delta) {
+        put_u16(&p, (uint16_t)dtime);
+    } else {
+        put_u32(&p, msg->timestamp);
+    }
+    *p++ = groups;
+
+    if (groups & DRONE_COMPACT_POSITION) {
+        if (delta) {
+            put_u16(&p, (uint16_t)dlat);
+            put_u16(&p, (uint16_t)dlon);
+            put_u16(&p, (uint16_t)dalt);
+        } else {
+            put_u32(&p, (uint32_t)q.latitude);
+            put_u32(&p, (uint32_t)q.longitude);
+            put_u32(&p, (uint32_t)q.altitude);
+        }
+    }
+    if (groups & DRONE_COMPACT_REL_ALT) {
+        put_u16(&p, (uint16_t)q.relative_altitude);
+    }
+    if (groups & DRONE_COMPACT_ATTITUDE) {
+        put_u16(&p, (uint16_t)q.roll);
+        put_u16(&p, (uint16_t)q.pitch);
+        put_u16(&p, (uint16_t)q.yaw);
+    }
+    if (groups & DRONE_COMPACT_VELOCITY) {
+        put_u16(&p, (uint16_t)q.vx);
+        put_u16(&p, (uint16_t)q.vy);
+        put_u16(&p, (uint16_t)q.vz);
+    }
+    if (groups & DRONE_COMPACT_BATTERY) {
+        *p++ = q.battery_percentage;
+        put_u16(&p, q.battery_voltage);
+        put_u16(&p, (uint16_t)q.battery_current);
+    }
+    if (groups & DRONE_COMPACT_FLIGHT) {
+        put_u16(&p, q.flight_time);
+    }
+    if (groups & DRONE_COMPACT_STATUS) {
+        put_u16(&p, q.status_flags);
+    }
+    if (groups & DRONE_COMPACT_SYSTEM) {
+        *p++ = q.cpu_load;
+        *p++ = q.rssi;
+        *p++ = q.gps;
+    }
+
+    put_u16(&p, crc16_ccitt(buffer, p - buffer));
+    return p - buffer;
+}
+
+void drone_compact_decoder_init(drone_compact_decoder_t *dec) {
+    memset(dec, 0, sizeof(*dec));
+}
+
+bool drone_compact_is_compact(const uint8_t *buffer, int len) {
+    return buffer && len > DRONE_COMPACT_HEADER_SIZE + 2 && len <= DRONE_COMPACT_MAX_SIZE &&
+           buffer[1] == DRONE_MSG_VERSION_COMPACT;
+}
+
+int drone_compact_decode(drone_compact_decoder_t *dec, const uint8_t *buffer, int len,
+                         drone_message_t *msg) {
+    if (!dec || !msg || !drone_compact_is_compact(buffer, len)) {
+        return -1;
+    }
+
+    uint8_t flags = buffer[3];
+    bool delta = flags & DRONE_COMPACT_FLAG_DELTA;
+    int groups_pos = DRONE_COMPACT_HEADER_SIZE + (delta ? 2 : 4);
+    if (len <= groups_pos || expected_length(flags, buffer[groups_pos]) != len) {
+        return -1;
+    }
+
+    const uint8_t *crc_pos = buffer + len - sizeof(uint16_t);
+    if (crc16_ccitt(buffer, len - sizeof(uint16_t)) != get_u16(&crc_pos)) {
+        return -1;
+    }
+
+    uint8_t key_seq = flags & DRONE_COMPACT_KEY_SEQ_MASK;
+    if (delta && (!dec->has_key || dec->key_seq != key_seq)) {
+        dec->missing_key++;
+        return -1;
+    }
+
+    const uint8_t *p = buffer + DRONE_COMPACT_HEADER_SIZE;
+    drone_compact_fields_t q;
+    uint32_t timestamp;
+    if (delta) {
+        q = dec->key;
+        timestamp = dec->key_timestamp + get_u16(&p);
+    } else {
+        memset(&q, 0, sizeof(q));
+        timestamp = get_u32(&p);
+    }
+    uint8_t groups = *p++;
+
+    if (groups & DRONE_COMPACT_POSITION) {
+        if (delta) {
+            q.latitude += (int16_t)get_u16(&p);
+            q.longitude += (int16_t)get_u16(&p);
+            q.altitude += (int16_t)get_u16(&p);
+        } else {
+            q.latitude = (int32_t)get_u32(&p);
+            q.longitude = (int32_t)get_u32(&p);
+            q.altitude = (int32_t)get_u32(&p);
+        }
+    }
+    if (groups & DRONE_COMPACT_REL_ALT) {
+        q.relative_altitude = (int16_t)get_u16(&p);
+    }
+    if (groups & DRONE_COMPACT_ATTITUDE) {
+        q.roll = (int16_t)get_u16(&p);
+        q.pitch = (int16_t)get_u16(&p);
+        q.yaw = (int16_t)get_u16(&p);
+    }
+    if (groups & DRONE_COMPACT_VELOCITY) {
+        q.vx = (int16_t)get_u16(&p);
+        q.vy = (int16_t)get_u16(&p);
+        q.vz = (int16_t)get_u16(&p);
+    }
+    if (groups & DRONE_COMPACT_BATTERY) {
+        q.battery_percentage = *p++;
+        q.battery_voltage = get_u16(&p);
+        q.battery_current = (int16_t)get_u16(&p);
+    }
+    if (groups & DRONE_COMPACT_FLIGHT) {
+        q.flight_time = get_u16(&p);
+    }
+    if (groups & DRONE_COMPACT_STATUS) {
+        q.status_flags = get_u16(&p);
+    }
+    if (groups & DRONE_COMPACT_SYSTEM) {
+        q.cpu_load = *p++;
+        q.rssi = *p++;
+        q.gps = *p++;
+    }
+
+    if (!delta) {
+        dec->key = q;
+        dec->key_timestamp = timestamp;
+        dec->key_seq = key_seq;
+        dec->has_key = true;
+    }
+
+    memset(msg, 0, sizeof(*msg));
+    msg->msg_type = buffer[0];
+    msg->msg_id = buffer[2];
+    msg->timestamp = timestamp;
+    dequantize_fields(&q, msg);
+    msg->version = DRONE_MSG_VERSION;
+
+    return 0;
+}
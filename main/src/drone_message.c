@@ -1,13 +1,34 @@
 #include <string.h>
+#include <stddef.h>
 #include <inttypes.h> 
 #include <stdbool.h>
+#include "sdkconfig.h"
 #include "drone_message.h"
+#include "drone_msg_view.h"
+#include "crc.h"
 #include "esp_log.h"
+#include "dlog.h"
+#include "metrics.h"
 
 static const char* TAG = "DRONE_MSG";
 
+// Прием версии 1 с аддитивной суммой (полетные контроллеры старого формата)
+#if CONFIG_BRIDGE_MSG_ACCEPT_V1
+#define DRONE_MSG_ACCEPT_V1 1
+#else
+#define DRONE_MSG_ACCEPT_V1 0
+#endif
+
 #define DEBUG_LEVEL 0
 
+// Схема должна давать прежний пакет: смещения ключевых полей закреплены
+_Static_assert(sizeof(drone_message_t) == EXPECTED_DRONE_MSG_SIZE, "drone_message_t size");
+_Static_assert(DRONE_MSG_OFF(timestamp) == 2, "timestamp offset");
+_Static_assert(DRONE_MSG_OFF(battery_voltage) == 47, "battery_voltage offset");
+_Static_assert(DRONE_MSG_OFF(flight_time) == 55, "flight_time offset");
+_Static_assert(DRONE_MSG_OFF_CHECKSUM == 65, "checksum offset");
+_Static_assert(DRONE_MSG_OFF_VERSION == DRONE_MSG_VERSION_OFFSET, "version offset");
+
 // Функция для печати размера структуры и смещений полей (отладка)
 void print_struct_info() {
     ESP_LOGI(TAG, "=== ИНФОРМАЦИЯ О СТРУКТУРЕ drone_message_t ===");
@@ -43,24 +64,71 @@ uint16_t drone_msg_calculate_checksum(const uint8_t *buffer, int length) {
     return checksum;
 }
 
+// Вычисление CRC-16 (табличный алгоритм: одно обращение к таблице на байт)
+uint16_t drone_msg_calculate_crc(const uint8_t *buffer, int length) {
+    return crc16_ccitt(buffer, length);
+}
+
+#define WRITE_FIELD(name, type, def, min, max, label) drone_msg_set_##name(b, msg->name);
+#define READ_FIELD(name, type, def, min, max, label) msg->name = drone_msg_get_##name(b);
+
+// Запись полей структуры в пакет (little-endian, без checksum)
+static void write_fields(const drone_message_t *msg, uint8_t *b) {
+    DRONE_MSG_FIELDS(WRITE_FIELD)
+}
+
+// Чтение полей пакета в структуру (первые DRONE_MSG_PAYLOAD_SIZE байт)
+static void read_fields(const uint8_t *b, drone_message_t *msg) {
+    DRONE_MSG_FIELDS(READ_FIELD)
+}
+
+// Проверка целостности пакета без декодирования
+int drone_msg_verify(const uint8_t *buffer, int len) {
+    if (!buffer || len < DRONE_MSG_PACKET_SIZE) {
+        return -1;
+    }
+    
+    uint8_t version = drone_msg_get_version(buffer);
+    uint16_t calculated;
+    if (version == DRONE_MSG_VERSION) {
+        calculated = drone_msg_calculate_crc(buffer, DRONE_MSG_PAYLOAD_SIZE);
+    } else if (DRONE_MSG_ACCEPT_V1 && version <= DRONE_MSG_VERSION_LEGACY) {
+        calculated = drone_msg_calculate_checksum(buffer, DRONE_MSG_PAYLOAD_SIZE);
+    } else {
+        return -1;
+    }
+    
+    return calculated == drone_msg_get_checksum(buffer) ? version : -1;
+}
+
 // Кодирование структуры в бинарный формат
 int drone_msg_encode(const drone_message_t *msg, uint8_t *buffer, int buf_size) {
+    return drone_msg_encode_version(msg, buffer, buf_size, DRONE_MSG_VERSION);
+}
+
+// Кодирование в формате заданной версии
+int drone_msg_encode_version(const drone_message_t *msg, uint8_t *buffer, int buf_size,
+                             uint8_t version) {
+    if (version != DRONE_MSG_VERSION_LEGACY && version != DRONE_MSG_VERSION) {
+        ESP_LOGE(TAG, "Неподдерживаемая версия формата: %d", version);
+        return -1;
+    }
+    
     if (!msg || !buffer || buf_size < DRONE_MSG_PACKET_SIZE) {
         ESP_LOGE(TAG, "Недостаточный размер буфера для кодирования: %d < %d", 
                  buf_size, DRONE_MSG_PACKET_SIZE);
         return -1;
     }
     
-    drone_message_t temp_msg = *msg;
-    temp_msg.version = DRONE_MSG_VERSION;
-    temp_msg.reserved = 0; 
-    
-    memcpy(buffer, &temp_msg, DRONE_MSG_PAYLOAD_SIZE);
+    write_fields(msg, buffer);
+    drone_msg_set_version(buffer, version);
+    drone_msg_set_reserved(buffer, 0);
     
-    uint16_t checksum = drone_msg_calculate_checksum(buffer, DRONE_MSG_PAYLOAD_SIZE);
+    uint16_t checksum = (version == DRONE_MSG_VERSION_LEGACY) ?
+        drone_msg_calculate_checksum(buffer, DRONE_MSG_PAYLOAD_SIZE) :
+        drone_msg_calculate_crc(buffer, DRONE_MSG_PAYLOAD_SIZE);
     
-    buffer[DRONE_MSG_PAYLOAD_SIZE] = (checksum >> 8) & 0xFF;
-    buffer[DRONE_MSG_PAYLOAD_SIZE + 1] = checksum & 0xFF;
+    drone_msg_set_checksum(buffer, checksum);
     
     if (DEBUG_LEVEL > 0) {
         ESP_LOGI(TAG, "Сообщение закодировано: размер=%d (payload=%d + checksum=%d), тип=%d, id=%d", 
@@ -71,6 +139,15 @@ int drone_msg_encode(const drone_message_t *msg, uint8_t *buffer, int buf_size)
     return DRONE_MSG_PACKET_SIZE;
 }
 
+// Упаковывает 4 байта буфера (начиная с offset) в слово для дампа в отложенный лог
+static inline uint32_t dump_word(const uint8_t *buffer, int buf_size, int offset) {
+    uint32_t word = 0;
+    for (int i = offset; i < offset + 4; i++) {
+        word = (word << 8) | (i < buf_size ? buffer[i] : 0);
+    }
+    return word;
+}
+
 // Декодирование данных из бинарного формата в структуру
 int drone_msg_decode(const uint8_t *buffer, int buf_size, drone_message_t *msg) {
     static bool info_printed = false;
@@ -80,9 +157,6 @@ int drone_msg_decode(const uint8_t *buffer, int buf_size, drone_message_t *msg)
         info_printed = true;
     }
     
-    ESP_LOGI(TAG, "Декодирование: получено %d байт, требуется %d байт (структура %d байт)", 
-             buf_size, DRONE_MSG_PACKET_SIZE, sizeof(drone_message_t));
-
     const int min_payload_size = 10;
     
     if (!buffer || !msg) {
@@ -90,17 +164,54 @@ int drone_msg_decode(const uint8_t *buffer, int buf_size, drone_message_t *msg)
         return -1;
     }
     
+    // Версия 2: только полный пакет с верным CRC, частичное декодирование не допускается
+    if (buf_size >= DRONE_MSG_PACKET_SIZE) {
+        uint8_t version = drone_msg_get_version(buffer);
+        
+        if (version > DRONE_MSG_VERSION) {
+            DLOGE(DLOG_MSG_BAD_VERSION, version, DRONE_MSG_VERSION);
+            return -1;
+        }
+        
+        if (version == DRONE_MSG_VERSION) {
+            uint16_t calculated_crc = drone_msg_calculate_crc(buffer, DRONE_MSG_PAYLOAD_SIZE);
+            uint16_t received_crc = drone_msg_get_checksum(buffer);
+            
+            if (calculated_crc != received_crc) {
+                DLOGE(DLOG_MSG_CRC, received_crc, calculated_crc);
+                metrics_inc(METRIC_CHECKSUM_ERRORS);
+                DLOGD(DLOG_MSG_DUMP, dump_word(buffer, buf_size, 0), dump_word(buffer, buf_size, 4),
+                      dump_word(buffer, buf_size, 8), dump_word(buffer, buf_size, 12));
+                return -1;
+            }
+            
+            read_fields(buffer, msg);
+            msg->checksum = received_crc;
+            
+            DLOGD(DLOG_MSG_DECODED, buf_size, msg->msg_type, msg->msg_id);
+            
+            return 0;
+        }
+    }
+    
+    // Версия 1 (аддитивная сумма), включая неполные пакеты, - только с
+    // CONFIG_BRIDGE_MSG_ACCEPT_V1: иначе искаженный пакет с версией 0 или 1
+    // в поле version обходил бы проверку CRC. Пакет с неверной суммой
+    // отклоняется, как и в версии 2
+    if (!DRONE_MSG_ACCEPT_V1) {
+        DLOGW(DLOG_MSG_LEGACY_REJECTED, buf_size >= DRONE_MSG_PACKET_SIZE ? drone_msg_get_version(buffer) : 0,
+              buf_size);
+        metrics_inc(METRIC_CHECKSUM_ERRORS);
+        return -1;
+    }
     memset(msg, 0, sizeof(drone_message_t));
     
     if (buf_size < DRONE_MSG_PACKET_SIZE) {
-        ESP_LOGW(TAG, "Размер буфера меньше ожидаемого: %d < %d, декодирование может быть неполным", 
-                 buf_size, DRONE_MSG_PACKET_SIZE);
-                 
         if (buf_size < min_payload_size + sizeof(uint16_t)) {
-            ESP_LOGE(TAG, "Буфер слишком мал для минимального декодирования: %d < %d", 
-                     buf_size, min_payload_size + sizeof(uint16_t));
+            DLOGE(DLOG_MSG_TOO_SHORT, buf_size, min_payload_size + sizeof(uint16_t));
             return -1;
         }
+        DLOGW(DLOG_MSG_PARTIAL, buf_size, DRONE_MSG_PACKET_SIZE);
     }
     
     int payload_size = buf_size - sizeof(uint16_t);
@@ -108,7 +219,10 @@ int drone_msg_decode(const uint8_t *buffer, int buf_size, drone_message_t *msg)
         payload_size = DRONE_MSG_PAYLOAD_SIZE;
     }
     
-    memcpy(msg, buffer, payload_size);
+    // Неполный пакет дополняется нулями до полного размера
+    uint8_t payload[DRONE_MSG_PAYLOAD_SIZE] = {0};
+    memcpy(payload, buffer, payload_size);
+    read_fields(payload, msg);
     
     if (buf_size >= min_payload_size + sizeof(uint16_t)) {
         int checksum_pos = (buf_size < DRONE_MSG_PACKET_SIZE) ? 
@@ -120,124 +234,90 @@ int drone_msg_decode(const uint8_t *buffer, int buf_size, drone_message_t *msg)
         msg->checksum = received_checksum;
         
         if (calculated_checksum != received_checksum) {
-            ESP_LOGE(TAG, "Ошибка контрольной суммы: получено 0x%04X, вычислено 0x%04X", 
-                     received_checksum, calculated_checksum);
-            
-            ESP_LOGW(TAG, "Дамп буфера (первые %d байт из %d):", 
-                    (buf_size > 16) ? 16 : buf_size, buf_size);
-            for (int i = 0; i < buf_size && i < 16; i++) {
-                ESP_LOGW(TAG, "  [%02d]: 0x%02X", i, buffer[i]);
-            }
+            DLOGE(DLOG_MSG_CHECKSUM, received_checksum, calculated_checksum, buf_size);
+            metrics_inc(METRIC_CHECKSUM_ERRORS);
+            DLOGD(DLOG_MSG_DUMP, dump_word(buffer, buf_size, 0), dump_word(buffer, buf_size, 4),
+                  dump_word(buffer, buf_size, 8), dump_word(buffer, buf_size, 12));
+            return -1;
         }
     } else {
         ESP_LOGW(TAG, "Буфер не содержит контрольную сумму или слишком мал");
+        return -1;
     }
     
     if (msg->version == 0) {
-        msg->version = DRONE_MSG_VERSION;
+        msg->version = DRONE_MSG_VERSION_LEGACY;
     }
     
-    ESP_LOGI(TAG, "Сообщение декодировано (возможно частично): тип=%d, id=%d",
-             msg->msg_type, msg->msg_id);
+    DLOGD(DLOG_MSG_DECODED, buf_size, msg->msg_type, msg->msg_id);
     
     return 0;
 }
 
-// Инициализация структуры сообщения значениями по умолчанию
+// Инициализация структуры сообщения значениями по умолчанию из схемы
 void drone_msg_init(drone_message_t *msg) {
     if (!msg) return;
     
     memset(msg, 0, sizeof(drone_message_t));
-    
-    msg->msg_type = MSG_TYPE_TELEMETRY;
-    msg->battery_percentage = 100;
-    msg->battery_voltage = 12.6f;
-    msg->rssi = 99;
-    msg->version = DRONE_MSG_VERSION;
-    msg->reserved = 0;
+#define INIT_FIELD(name, type, def, min, max, label) msg->name = def;
+    DRONE_MSG_FIELDS(INIT_FIELD)
+#undef INIT_FIELD
+}
+
+// Дробные значения выводятся с точностью float, целые - без дробной части
+#define FIELD_REAL_U8  false
+#define FIELD_REAL_U16 false
+#define FIELD_REAL_U32 false
+#define FIELD_REAL_F32 true
+
+// Значение поля с подписью; значение вне диапазона схемы - предупреждением.
+// Сравнение в double: NaN тоже вне диапазона
+static void log_field(const char *label, double value, double min, double max, bool real) {
+    bool valid = value >= min && value <= max;
+    if (real && valid) {
+        ESP_LOGI(TAG, "%s: %.7g", label, value);
+    } else if (valid) {
+        ESP_LOGI(TAG, "%s: %.0f", label, value);
+    } else {
+        ESP_LOGW(TAG, "%s: %.7g - вне диапазона [%g, %g], данные могут быть повреждены",
+                 label, value, min, max);
+    }
 }
 
-// Функция для вывода информации о сообщении в лог
+// Функция для вывода информации о сообщении в лог: поля формата типа
+// сообщения (для телеметрии - все), подписи и диапазоны из схемы
 void drone_msg_log(const drone_message_t *msg) {
     if (!msg) return;
     
     const char* msg_type_str = "НЕИЗВЕСТНО";
+    uint32_t fields = ~0u;
     switch(msg->msg_type) {
         case MSG_TYPE_TELEMETRY: msg_type_str = "ТЕЛЕМЕТРИЯ"; break;
-        case MSG_TYPE_COMMAND:   msg_type_str = "КОМАНДА"; break;
-        case MSG_TYPE_ACK:       msg_type_str = "ПОДТВЕРЖДЕНИЕ"; break;
-        case MSG_TYPE_ALERT:     msg_type_str = "ТРЕВОГА"; break;
+        case MSG_TYPE_COMMAND:   msg_type_str = "КОМАНДА"; fields = DRONE_TYPED_MASK(COMMAND); break;
+        case MSG_TYPE_ACK:       msg_type_str = "ПОДТВЕРЖДЕНИЕ"; fields = DRONE_TYPED_MASK(ACK); break;
+        case MSG_TYPE_ALERT:     msg_type_str = "ТРЕВОГА"; fields = DRONE_TYPED_MASK(ALERT); break;
     }
+    fields &= ~DRONE_FIELDS_HEADER;
     
     ESP_LOGI(TAG, "=========== СООБЩЕНИЕ ДРОНА ===========");
-    ESP_LOGI(TAG, "Тип: %s (0x%02X), ID: %d", msg_type_str, msg->msg_type, msg->msg_id);
-    ESP_LOGI(TAG, "Время: %" PRIu32 " мс", msg->timestamp);
-    ESP_LOGI(TAG, "Версия формата: %d", msg->version);
-    
-    bool valid_coords = (msg->latitude >= -90.0f && msg->latitude <= 90.0f &&
-                         msg->longitude >= -180.0f && msg->longitude <= 180.0f &&
-                         msg->altitude >= -1000.0f && msg->altitude <= 10000.0f);
-                         
-    ESP_LOGI(TAG, "----- ПОЗИЦИЯ -----");
-    if (valid_coords) {
-        ESP_LOGI(TAG, "Координаты: %.6f, %.6f (высота: %.2f м, отн. высота: %.2f м)", 
-                msg->latitude, msg->longitude, msg->altitude, msg->relative_altitude);
-    } else {
-        ESP_LOGW(TAG, "Некорректные координаты: lat=%.6f, lon=%.6f, alt=%.2f (возможно, данные повреждены)",
-                msg->latitude, msg->longitude, msg->altitude);
+    ESP_LOGI(TAG, "Тип: %s (0x%02X), ID: %d, версия формата: %d", msg_type_str, msg->msg_type, msg->msg_id,
+             msg->version);
+#define LOG_FIELD(name, type, def, min, max, label) \
+    if (fields & DRONE_FIELD_BIT(name)) { \
+        log_field(label, msg->name, min, max, FIELD_REAL_##type); \
     }
+    DRONE_MSG_FIELDS(LOG_FIELD)
+#undef LOG_FIELD
     
-    bool valid_attitude = (msg->roll >= -180.0f && msg->roll <= 180.0f &&
-                           msg->pitch >= -90.0f && msg->pitch <= 90.0f &&
-                           msg->yaw >= -360.0f && msg->yaw <= 360.0f);
-                           
-    if (valid_attitude) {
-        ESP_LOGI(TAG, "Ориентация: крен=%.2f°, тангаж=%.2f°, курс=%.2f°", 
-                msg->roll, msg->pitch, msg->yaw);
-    } else {
-        ESP_LOGW(TAG, "Некорректная ориентация: roll=%.2f, pitch=%.2f, yaw=%.2f (данные могут быть повреждены)",
-                msg->roll, msg->pitch, msg->yaw);
+    if (fields & DRONE_FIELD_BIT(status_flags)) {
+        if (msg->status_flags & DRONE_FLAG_ARMED) ESP_LOGI(TAG, " - Активирован");
+        if (msg->status_flags & DRONE_FLAG_FLYING) ESP_LOGI(TAG, " - В полете");
+        if (msg->status_flags & DRONE_FLAG_GPS_FIX) ESP_LOGI(TAG, " - GPS фиксация");
+        if (msg->status_flags & DRONE_FLAG_LOW_BATTERY) ESP_LOGI(TAG, " - Низкий заряд!");
+        if (msg->status_flags & DRONE_FLAG_RTH_ACTIVE) ESP_LOGI(TAG, " - Возврат домой");
+        if (msg->status_flags & DRONE_FLAG_FAILSAFE) ESP_LOGI(TAG, " - Аварийная защита!");
+        if (msg->status_flags & DRONE_FLAG_CALIBRATING) ESP_LOGI(TAG, " - Калибровка");
+        if (msg->status_flags & DRONE_FLAG_ERROR) ESP_LOGI(TAG, " - Ошибка!");
     }
-    
-    bool valid_speed = (msg->vx >= -100.0f && msg->vx <= 100.0f &&
-                        msg->vy >= -100.0f && msg->vy <= 100.0f &&
-                        msg->vz >= -50.0f && msg->vz <= 50.0f);
-                        
-    if (valid_speed) {
-        ESP_LOGI(TAG, "Скорость: X=%.2f, Y=%.2f, Z=%.2f м/с", 
-                msg->vx, msg->vy, msg->vz);
-    } else {
-        ESP_LOGW(TAG, "Некорректная скорость: vx=%.2f, vy=%.2f, vz=%.2f (данные могут быть повреждены)",
-                msg->vx, msg->vy, msg->vz);
-    }
-    
-    ESP_LOGI(TAG, "----- СОСТОЯНИЕ -----");
-    if (msg->battery_percentage <= 100) {
-        ESP_LOGI(TAG, "Батарея: %d%%, %.2fV, %.2fA", 
-                msg->battery_percentage, msg->battery_voltage, msg->battery_current);
-    } else {
-        ESP_LOGW(TAG, "Некорректный заряд батареи: %d%% (ожидается 0-100)", 
-                msg->battery_percentage);
-    }
-    
-    ESP_LOGI(TAG, "Время полета: %" PRIu16 " с", msg->flight_time);
-    ESP_LOGI(TAG, "Статус: 0x%04X", msg->status_flags);
-    if (msg->status_flags & DRONE_FLAG_ARMED) ESP_LOGI(TAG, " - Активирован");
-    if (msg->status_flags & DRONE_FLAG_FLYING) ESP_LOGI(TAG, " - В полете");
-    if (msg->status_flags & DRONE_FLAG_GPS_FIX) ESP_LOGI(TAG, " - GPS фиксация");
-    if (msg->status_flags & DRONE_FLAG_LOW_BATTERY) ESP_LOGI(TAG, " - Низкий заряд!");
-    if (msg->status_flags & DRONE_FLAG_RTH_ACTIVE) ESP_LOGI(TAG, " - Возврат домой");
-    if (msg->status_flags & DRONE_FLAG_FAILSAFE) ESP_LOGI(TAG, " - Аварийная защита!");
-    if (msg->status_flags & DRONE_FLAG_CALIBRATING) ESP_LOGI(TAG, " - Калибровка");
-    if (msg->status_flags & DRONE_FLAG_ERROR) ESP_LOGI(TAG, " - Ошибка!");
-    
-    ESP_LOGI(TAG, "----- СИСТЕМА -----");
-    ESP_LOGI(TAG, "Загрузка процессора: %d%%", msg->cpu_load);
-    ESP_LOGI(TAG, "Уровень сигнала: %d%%", msg->rssi);
-    ESP_LOGI(TAG, "GPS: %d спутников, тип фиксации: %d", msg->satellites, msg->fix_type);
     ESP_LOGI(TAG, "====================================");
-    
-    ESP_LOGI(TAG, "Размер структуры: %d байт (ожидаемый: %d + 2)",
-             sizeof(drone_message_t), EXPECTED_DRONE_MSG_SIZE);
-    ESP_LOGI(TAG, "Размер полезных данных: %d байт", DRONE_MSG_PAYLOAD_SIZE);
-}
\ No newline at end of file
+}
@@ -0,0 +1,111 @@
+#include <string.h>
+#include "drone_typed.h"
+#include "drone_msg_view.h"
+#include "crc.h"
+
+_Static_assert(DRONE_TYPED_MAX_SIZE < DRONE_MSG_PACKET_SIZE, "Формат типа не короче полного пакета");
+
+// Поля формата типа сообщения, 0 - у типа нет своего формата
+static uint32_t layout_fields(uint8_t msg_type) {
+    switch (msg_type) {
+#define LAYOUT_FIELDS(type, layout) case type: return DRONE_TYPED_MASK(layout);
+        DRONE_TYPED_LAYOUTS(LAYOUT_FIELDS)
+#undef LAYOUT_FIELDS
+    }
+    return 0;
+}
+
+int drone_typed_size(uint8_t msg_type) {
+    switch (msg_type) {
+#define LAYOUT_SIZE(type, layout) case type: return DRONE_TYPED_SIZE_##layout;
+        DRONE_TYPED_LAYOUTS(LAYOUT_SIZE)
+#undef LAYOUT_SIZE
+    }
+    return 0;
+}
+
+static bool is_zero(const uint8_t *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (p[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#define FIELD_SIZE(type) sizeof(DRONE_FIELD_TYPE_##type)
+
+// Поля пакета уже в little-endian и копируются без преобразования, поэтому
+// восстановленный пакет совпадает с исходным побайтно
+int drone_typed_encode(const uint8_t *frame, int len, uint8_t *out, int buf_size) {
+    if (!frame || !out || len != DRONE_MSG_PACKET_SIZE) {
+        return -1;
+    }
+    uint8_t msg_type = drone_msg_get_msg_type(frame);
+    uint32_t fields = layout_fields(msg_type);
+    if (!fields || buf_size < drone_typed_size(msg_type) || drone_msg_get_reserved(frame) != 0 ||
+        drone_msg_verify(frame, len) != DRONE_MSG_VERSION) {
+        return -1;
+    }
+
+    out[0] = msg_type;
+    out[1] = DRONE_MSG_VERSION_TYPED;
+    out[2] = drone_msg_get_msg_id(frame);
+    uint8_t *p = out + DRONE_TYPED_HEADER_SIZE;
+#define PUT_FIELD(name, type, def, min, max, label) \
+    if (fields & DRONE_FIELD_BIT(name)) { \
+        memcpy(p, frame + DRONE_MSG_OFF(name), FIELD_SIZE(type)); \
+        p += FIELD_SIZE(type); \
+    } else if (!(DRONE_FIELDS_HEADER & DRONE_FIELD_BIT(name)) && \
+               !is_zero(frame + DRONE_MSG_OFF(name), FIELD_SIZE(type))) { \
+        return -1; \
+    }
+    DRONE_MSG_FIELDS(PUT_FIELD)
+#undef PUT_FIELD
+
+    drone_msg_put_le16(p, crc16_ccitt(out, p - out));
+    p += sizeof(uint16_t);
+    return p - out;
+}
+
+bool drone_typed_is_typed(const uint8_t *buffer, int len) {
+    return buffer && len > DRONE_TYPED_HEADER_SIZE + 2 && buffer[1] == DRONE_MSG_VERSION_TYPED &&
+           len == drone_typed_size(buffer[0]);
+}
+
+int drone_typed_expand(const uint8_t *buffer, int len, uint8_t *out, int buf_size) {
+    if (!out || buf_size < (int)DRONE_MSG_PACKET_SIZE || !drone_typed_is_typed(buffer, len) ||
+        crc16_ccitt(buffer, (size_t)len - sizeof(uint16_t)) != drone_msg_le16(buffer + len - sizeof(uint16_t))) {
+        return -1;
+    }
+
+    uint32_t fields = layout_fields(buffer[0]);
+    memset(out, 0, DRONE_MSG_PAYLOAD_SIZE);
+    drone_msg_set_msg_type(out, buffer[0]);
+    drone_msg_set_msg_id(out, buffer[2]);
+    drone_msg_set_version(out, DRONE_MSG_VERSION);
+    const uint8_t *p = buffer + DRONE_TYPED_HEADER_SIZE;
+#define GET_FIELD(name, type, def, min, max, label) \
+    if (fields & DRONE_FIELD_BIT(name)) { \
+        memcpy(out + DRONE_MSG_OFF(name), p, FIELD_SIZE(type)); \
+        p += FIELD_SIZE(type); \
+    }
+    DRONE_MSG_FIELDS(GET_FIELD)
+#undef GET_FIELD
+
+    drone_msg_set_checksum(out, drone_msg_calculate_crc(out, DRONE_MSG_PAYLOAD_SIZE));
+    return DRONE_MSG_PACKET_SIZE;
+}
+
+void drone_typed_clear_unused(drone_message_t *msg) {
+    uint32_t fields = layout_fields(msg->msg_type);
+    if (!fields) {
+        return;
+    }
+#define CLEAR_FIELD(name, type, def, min, max, label) \
+    if (!((fields | DRONE_FIELDS_HEADER) & DRONE_FIELD_BIT(name))) { \
+        msg->name = 0; \
+    }
+    DRONE_MSG_FIELDS(CLEAR_FIELD)
+#undef CLEAR_FIELD
+}
@@ -1,60 +1,648 @@
 #include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_now.h"
 #include "esp_wifi.h"
 #include "esp_log.h"
-#include "drone_message.h"
+#include "espnow_handler.h"
+#include "spsc_ring.h"
+#include "dlog.h"
+#include "metrics.h"
 #include "esp_mac.h"
+#include "esp_timer.h"
+#include "peer_table.h"
+#include "bridge_tasks.h"
+#include <inttypes.h>
 
-#define ESPNOW_MAX_DATA_LEN 250
 static const char* TAG = "ESPNOW";
 
+// Сколько ждать подтверждения в espnow_send_cb, прежде чем считать его потерянным
+#define ESPNOW_INFLIGHT_TIMEOUT_MS 100
+// Сколько ждать опоздавшего подтверждения пакета, место которого сброшено
+#define ESPNOW_INFLIGHT_STALE_MS   1000
+
+// Слот очереди передачи
+typedef struct {
+    uint8_t peer_mac[ESP_NOW_ETH_ALEN];
+    uint16_t len;
+    uint8_t data[ESPNOW_MAX_DATA_LEN];
+} espnow_tx_slot_t;
+
+// Очередь передачи: слоты с данными и планировщик, который хранит очереди
+// индексов слотов по классам трафика, поэтому ни вытеснение, ни выбор
+// пакета вне порядка постановки не требуют копирования данных
+static espnow_tx_slot_t tx_slots[ESPNOW_TX_QUEUE_LEN];
+static tx_sched_t tx_sched;
+// Счетчики постановки в очередь и queue_depth изменяются под tx_mutex,
+// счетчики передачи и подтверждений - под peer_lock
+static espnow_tx_stats_t tx_stats;
+
+_Static_assert(ESPNOW_TX_QUEUE_LEN <= TX_SCHED_MAX_SLOTS, "ESPNOW_TX_QUEUE_LEN больше TX_SCHED_MAX_SLOTS");
+
+static StaticSemaphore_t tx_mutex_buf;
+static StaticSemaphore_t tx_space_sem_buf;
+static SemaphoreHandle_t tx_mutex = NULL;
+static SemaphoreHandle_t tx_space_sem = NULL;
+static TaskHandle_t tx_task_handle = NULL;
+
+// Принятые пакеты: espnow_recv_cb только копирует их в кольцевой буфер
+static transport_packet_t rx_packets[ESPNOW_RX_RING_LEN];
+static spsc_ring_t rx_ring;
+static TaskHandle_t rx_consumer_task = NULL;
+static transport_rx_stats_t rx_stats;
+
+_Static_assert((ESPNOW_RX_RING_LEN & (ESPNOW_RX_RING_LEN - 1)) == 0, "ESPNOW_RX_RING_LEN должна быть степенью двойки");
+
+// Таблица узлов: поиск по MAC за постоянное время, поэтому стоимость
+// обработчиков Wi-Fi и задачи передачи не растет с числом дронов
+static peer_table_t peers;
+static portMUX_TYPE peer_lock = portMUX_INITIALIZER_UNLOCKED;
+
+_Static_assert(ESP_NOW_MAX_TOTAL_PEER_NUM <= PEER_TABLE_CAPACITY, "Таблица узлов меньше лимита ESP-NOW");
+
+// Пакеты "в полете" каждого узла в порядке передачи: подтверждения узла
+// приходят в том же порядке, первое относится к inflight_head. Если
+// подтверждения нет дольше ESPNOW_INFLIGHT_TIMEOUT_MS, место узла
+// освобождается, а поколение узла увеличивается: записи прежнего поколения
+// остаются в очереди, и опоздавшее подтверждение снимает свою запись, не
+// уменьшая счетчик новых пакетов. Записи прежнего поколения старше
+// ESPNOW_INFLIGHT_STALE_MS считаются потерянными. Доступ под peer_lock
+#define ESPNOW_INFLIGHT_RECORDS (2 * ESPNOW_MAX_INFLIGHT)
+
+typedef struct {
+    int64_t sent_us;           // Время вызова esp_now_send
+    uint8_t generation;
+} espnow_inflight_t;
+
+static espnow_inflight_t inflight_records[PEER_TABLE_CAPACITY][ESPNOW_INFLIGHT_RECORDS];
+static uint8_t inflight_head[PEER_TABLE_CAPACITY];
+static uint8_t inflight_count[PEER_TABLE_CAPACITY];
+static uint8_t inflight_generation[PEER_TABLE_CAPACITY];
+
+static espnow_inflight_t *inflight_record(int index, int position) {
+    return &inflight_records[index][(inflight_head[index] + position) % ESPNOW_INFLIGHT_RECORDS];
+}
+
+// Запись таблицы заняла новый узел: записи прежнего владельца не относятся к нему
+static void inflight_reset(int index) {
+    inflight_head[index] = 0;
+    inflight_count[index] = 0;
+    inflight_generation[index] = 0;
+}
+
+static void inflight_drop_head(int index) {
+    inflight_head[index] = (inflight_head[index] + 1) % ESPNOW_INFLIGHT_RECORDS;
+    inflight_count[index]--;
+}
+
+// Задача передачи не хранит указатели на записи таблицы: узел может быть
+// удален во время передачи, и его запись займет другой узел. Запись
+// ищется по MAC под peer_lock при каждом обращении
+
+// Занимает место "в полете" для узла, если лимит не исчерпан. Узлы не из
+// таблицы (широковещательный адрес, удаленный узел) не ограничиваются
+static bool espnow_peer_acquire(const uint8_t *mac) {
+    bool acquired = true;
+    portENTER_CRITICAL(&peer_lock);
+    peer_entry_t *peer = peer_table_find(&peers, mac);
+    if (peer) {
+        acquired = peer->inflight < ESPNOW_MAX_INFLIGHT;
+        if (acquired) {
+            int index = peer - peers.entries;
+            if (inflight_count[index] == ESPNOW_INFLIGHT_RECORDS) {
+                // Место занято записями прежних поколений: самая старая потеряна
+                inflight_drop_head(index);
+            }
+            *inflight_record(index, inflight_count[index]++) = (espnow_inflight_t){
+                .sent_us = 0,
+                .generation = inflight_generation[index],
+            };
+            peer->inflight++;
+        }
+    }
+    portEXIT_CRITICAL(&peer_lock);
+    return acquired;
+}
+
+// Возвращает место, занятое последним: пакет не передан, подтверждения не будет
+static void espnow_peer_release(const uint8_t *mac) {
+    portENTER_CRITICAL(&peer_lock);
+    peer_entry_t *peer = peer_table_find(&peers, mac);
+    if (peer && peer->inflight > 0) {
+        int index = peer - peers.entries;
+        inflight_count[index]--;
+        peer->inflight--;
+    }
+    portEXIT_CRITICAL(&peer_lock);
+}
+
+// Время вызова esp_now_send для последнего занятого места "в полете"
+static void espnow_peer_stamp(const uint8_t *mac, int64_t now) {
+    portENTER_CRITICAL(&peer_lock);
+    peer_entry_t *peer = peer_table_find(&peers, mac);
+    if (peer && peer->inflight > 0) {
+        int index = peer - peers.entries;
+        inflight_record(index, inflight_count[index] - 1)->sent_us = now;
+    }
+    portEXIT_CRITICAL(&peer_lock);
+}
+
+// Счетчик передачи задачи передачи: его же изменяет espnow_send_cb
+static void tx_stats_inc(uint32_t *counter) {
+    portENTER_CRITICAL(&peer_lock);
+    (*counter)++;
+    portEXIT_CRITICAL(&peer_lock);
+}
+
+// Выполняется в контексте задачи Wi-Fi, поэтому только копирует пакет
+// в кольцевой буфер и будит задачу-потребитель
 static void espnow_recv_cb(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
-    const uint8_t *mac_addr = recv_info->src_addr;
+    int64_t start = esp_timer_get_time();
+
     if (len > ESPNOW_MAX_DATA_LEN) {
-        ESP_LOGW(TAG, "Принято слишком много данных (%d байт), обрезаем до %d!", len, ESPNOW_MAX_DATA_LEN);
         len = ESPNOW_MAX_DATA_LEN;
     }
-    ESP_LOGI(TAG, "Получено %d байт от " MACSTR, len, MAC2STR(mac_addr));
-    drone_message_t drone_msg;
-    if (drone_msg_decode(data, len, &drone_msg) == 0) {
-        drone_msg_log(&drone_msg);
+
+    transport_packet_t *packet = spsc_ring_acquire(&rx_ring);
+    if (!packet) {
+        rx_stats.dropped++;
+        return;
+    }
+
+    memcpy(packet->src_mac, recv_info->src_addr, ESP_NOW_ETH_ALEN);
+    packet->rssi = recv_info->rx_ctrl ? recv_info->rx_ctrl->rssi : 0;
+    packet->len = len;
+    packet->rx_time = start;
+    memcpy(packet->data, data, len);
+
+    portENTER_CRITICAL(&peer_lock);
+    peer_entry_t *peer = peer_table_find(&peers, recv_info->src_addr);
+    if (peer) {
+        peer_stats_record_rx(&peer->stats, len, packet->rssi, start);
+    }
+    portEXIT_CRITICAL(&peer_lock);
+
+    // Будим потребителя после каждой публикации. Проверка "буфер был пуст"
+    // теряет пробуждение: потребитель может освободить последний элемент
+    // после чтения позиции в spsc_ring_publish и уснуть, не увидев новый.
+    // Лишние уведомления сливаются в счетчике и стоят одной проверки кольца
+    spsc_ring_publish(&rx_ring);
+    if (rx_consumer_task) {
+        xTaskNotifyGive(rx_consumer_task);
     }
+
+    rx_stats.received++;
+    latency_hist_record(&rx_stats.cb_time_us, esp_timer_get_time() - start);
 }
 
 static void espnow_send_cb(const uint8_t *mac_addr, esp_now_send_status_t status) {
-    ESP_LOGI(TAG, "Отправка " MACSTR ": %s",
+    int64_t now = esp_timer_get_time();
+    int64_t sent_us = 0;
+    portENTER_CRITICAL(&peer_lock);
+    peer_entry_t *peer = peer_table_find(&peers, mac_addr);
+    if (peer) {
+        int index = peer - peers.entries;
+        while (inflight_count[index] > 0 &&
+               inflight_record(index, 0)->generation != inflight_generation[index] &&
+               now - inflight_record(index, 0)->sent_us > ESPNOW_INFLIGHT_STALE_MS * 1000) {
+            inflight_drop_head(index);
+        }
+        if (inflight_count[index] > 0) {
+            espnow_inflight_t record = *inflight_record(index, 0);
+            inflight_drop_head(index);
+            if (record.generation == inflight_generation[index]) {
+                sent_us = record.sent_us;
+                peer->inflight--;
+            } else {
+                // Подтверждение пакета, место которого уже сброшено по тайм-ауту
+                tx_stats.late_acks++;
+            }
+        }
+    }
+    if (status == ESP_NOW_SEND_SUCCESS) {
+        tx_stats.send_ok++;
+        if (peer) peer->stats.tx_ok++;
+    } else {
+        tx_stats.send_fail++;
+        if (peer) peer->stats.tx_fail++;
+    }
+    portEXIT_CRITICAL(&peer_lock);
+
+    if (sent_us) {
+        metrics_record(METRIC_HIST_SEND_TO_ACK, now - sent_us);
+    }
+    if (status != ESP_NOW_SEND_SUCCESS) {
+        metrics_inc(METRIC_SEND_FAILED);
+    }
+
+    // Будим задачу передачи: у узла освободилось место
+    if (tx_task_handle) {
+        xTaskNotifyGive(tx_task_handle);
+    }
+
+    ESP_LOGD(TAG, "Отправка " MACSTR ": %s",
         MAC2STR(mac_addr),
         status == ESP_NOW_SEND_SUCCESS ? "OK" : "FAIL"
     );
 }
 
+// Получателю пакета слота можно передавать: у него есть место "в полете".
+// Пакеты узлам не из таблицы передаются без ограничения
+static bool espnow_slot_eligible(int slot, void *ctx) {
+    portENTER_CRITICAL(&peer_lock);
+    peer_entry_t *peer = peer_table_find(&peers, tx_slots[slot].peer_mac);
+    bool eligible = !peer || peer->inflight < ESPNOW_MAX_INFLIGHT;
+    portEXIT_CRITICAL(&peer_lock);
+    return eligible;
+}
+
+// Выбирает следующий пакет планировщиком среди пакетов, у получателей
+// которых есть место "в полете", занимает место и извлекает пакет из
+// очереди. Пакеты занятого узла остаются в очереди и не задерживают другие
+// классы и других получателей; пришедшая за время ожидания тревога будет
+// выбрана раньше них. Слот остается занятым, пока задача передачи не
+// вызовет espnow_tx_release. Возвращает индекс слота или -1; busy_mac -
+// узел, подтверждения которого нужно дождаться, если очередь не пуста, но
+// все получатели заняты
+static int espnow_tx_pop(uint8_t busy_mac[ESP_NOW_ETH_ALEN], bool *busy) {
+    int index = -1;
+    *busy = false;
+
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    int candidate = tx_sched_peek_eligible(&tx_sched, espnow_slot_eligible, NULL);
+    if (candidate >= 0) {
+        // Место проверено под tx_mutex, а освобождает его только
+        // espnow_send_cb, поэтому захват не может не удаться
+        espnow_peer_acquire(tx_slots[candidate].peer_mac);
+        index = tx_sched_pop(&tx_sched, esp_timer_get_time());
+        tx_stats.queue_depth = tx_sched_depth(&tx_sched);
+    } else if (tx_sched_depth(&tx_sched) > 0) {
+        // Все получатели заняты: ждем подтверждения получателя пакета,
+        // который планировщик выбрал бы первым
+        candidate = tx_sched_peek(&tx_sched);
+        memcpy(busy_mac, tx_slots[candidate].peer_mac, ESP_NOW_ETH_ALEN);
+        *busy = true;
+    }
+    xSemaphoreGive(tx_mutex);
+    return index;
+}
+
+static void espnow_tx_release(int index) {
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    tx_sched_release(&tx_sched, index);
+    xSemaphoreGive(tx_mutex);
+    xSemaphoreGive(tx_space_sem);
+}
+
+// Лимит пакетов "в полете" исчерпан у всех получателей пакетов очереди,
+// ждем espnow_send_cb любого из них
+static void espnow_wait_peer(const uint8_t *mac) {
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ESPNOW_INFLIGHT_TIMEOUT_MS)) == 0) {
+        DLOGW(DLOG_ESPNOW_NO_ACK, ESPNOW_INFLIGHT_TIMEOUT_MS);
+        portENTER_CRITICAL(&peer_lock);
+        peer_entry_t *peer = peer_table_find(&peers, mac);
+        if (peer) {
+            // Записи пакетов остаются: их подтверждения еще могут прийти
+            inflight_generation[peer - peers.entries]++;
+            peer->inflight = 0;
+        }
+        portEXIT_CRITICAL(&peer_lock);
+    }
+}
+
+static void espnow_tx_task(void *arg) {
+    int current = -1;
+
+    while (1) {
+        if (current < 0) {
+            uint8_t busy_mac[ESP_NOW_ETH_ALEN];
+            bool busy;
+            current = espnow_tx_pop(busy_mac, &busy);
+            if (busy) {
+                espnow_wait_peer(busy_mac);
+                continue;
+            }
+            if (current < 0) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                continue;
+            }
+        } else if (!espnow_peer_acquire(tx_slots[current].peer_mac)) {
+            // Пакет, отложенный из-за ESP_ERR_ESPNOW_NO_MEM
+            espnow_wait_peer(tx_slots[current].peer_mac);
+            continue;
+        }
+
+        espnow_tx_slot_t *slot = &tx_slots[current];
+
+        // Время записывается до вызова: espnow_send_cb может прийти раньше возврата
+        int64_t now = esp_timer_get_time();
+        espnow_peer_stamp(slot->peer_mac, now);
+
+        esp_err_t err = esp_now_send(slot->peer_mac, slot->data, slot->len);
+        if (err == ESP_ERR_ESPNOW_NO_MEM) {
+            // Буферы Wi-Fi заняты: пакет остается у задачи до следующего подтверждения
+            espnow_peer_release(slot->peer_mac);
+            tx_stats_inc(&tx_stats.no_mem_retries);
+            ulTaskNotifyTake(pdTRUE, 1);
+            continue;
+        }
+
+        if (err != ESP_OK) {
+            espnow_peer_release(slot->peer_mac);
+            tx_stats_inc(&tx_stats.send_errors);
+            metrics_inc(METRIC_SEND_ERRORS);
+            DLOGE(DLOG_ESPNOW_SEND_ERROR, err);
+        } else {
+            // Слот не изменяется до освобождения, время постановки читается без мьютекса
+            metrics_record(METRIC_HIST_QUEUE_TO_SEND, now - tx_sched.enqueued_us[current]);
+        }
+
+        espnow_tx_release(current);
+        current = -1;
+    }
+}
+
 void espnow_init(void) {
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_start());
 
+    tx_mutex = xSemaphoreCreateMutexStatic(&tx_mutex_buf);
+    tx_space_sem = xSemaphoreCreateBinaryStatic(&tx_space_sem_buf);
+    const tx_sched_config_t sched_config = {
+        .capacity = ESPNOW_TX_QUEUE_LEN,
+        .reserve = CONFIG_BRIDGE_ESPNOW_URGENT_RESERVE,
+        .weight = {
+            [TX_CLASS_TELEMETRY] = CONFIG_BRIDGE_TX_WEIGHT_TELEMETRY,
+            [TX_CLASS_BULK] = CONFIG_BRIDGE_TX_WEIGHT_BULK,
+        },
+    };
+    tx_sched_init(&tx_sched, &sched_config);
+
+    spsc_ring_init(&rx_ring, rx_packets, sizeof(transport_packet_t), ESPNOW_RX_RING_LEN);
+    peer_table_init(&peers);
+
     ESP_ERROR_CHECK(esp_now_init());
     ESP_ERROR_CHECK(esp_now_register_recv_cb(espnow_recv_cb));
     ESP_ERROR_CHECK(esp_now_register_send_cb(espnow_send_cb));
+
+    // Передача - стадия конвейера на ядре задачи Wi-Fi
+    BRIDGE_TASK_CREATE_STATIC(espnow_tx_task, BRIDGE_TASK_RADIO_TX, RADIO_TX_TASK_STACK, NULL,
+                              RADIO_TX_TASK_PRIO, &tx_task_handle, BRIDGE_RADIO_CORE);
 }
 
-void espnow_add_peer(const uint8_t *peer_mac) {
+esp_err_t espnow_add_peer(const uint8_t *peer_mac, uint32_t groups) {
+    if (!peer_mac) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&peer_lock);
+    peer_entry_t *entry = peer_table_find(&peers, peer_mac);
+    if (entry) {
+        entry->groups |= groups;
+    }
+    portEXIT_CRITICAL(&peer_lock);
+    if (entry) {
+        return ESP_OK;
+    }
+
     esp_now_peer_info_t peer = {0};
     memcpy(peer.peer_addr, peer_mac, 6);
     peer.channel = 0;
     peer.ifidx = WIFI_IF_STA;
     peer.encrypt = false;
-    ESP_ERROR_CHECK(esp_now_add_peer(&peer));
+    esp_err_t err = esp_now_add_peer(&peer);
+    if (err != ESP_OK && err != ESP_ERR_ESPNOW_EXIST) {
+        return err;
+    }
+
+    portENTER_CRITICAL(&peer_lock);
+    entry = peer_table_add(&peers, peer_mac, groups);
+    if (entry) {
+        inflight_reset(entry - peers.entries);
+    }
+    portEXIT_CRITICAL(&peer_lock);
+    if (!entry) {
+        esp_now_del_peer(peer_mac);
+        return ESP_ERR_ESPNOW_FULL;
+    }
+    ESP_LOGI(TAG, "Узел " MACSTR " добавлен, группы 0x%" PRIx32, MAC2STR(peer_mac), groups);
+    return ESP_OK;
 }
 
-void espnow_send(const uint8_t *peer_mac, const uint8_t *data, size_t len) {
-    if (len > ESPNOW_MAX_DATA_LEN) {
-        ESP_LOGW(TAG, "Передача превышает лимит ESP-NOW (%d > %d байт), данные будут усечены!", len, ESPNOW_MAX_DATA_LEN);
-        len = ESPNOW_MAX_DATA_LEN;
+esp_err_t espnow_remove_peer(const uint8_t *peer_mac) {
+    if (!peer_mac) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&peer_lock);
+    bool removed = peer_table_remove(&peers, peer_mac);
+    portEXIT_CRITICAL(&peer_lock);
+    if (!removed) {
+        return ESP_ERR_ESPNOW_NOT_FOUND;
+    }
+
+    // Пакеты, уже стоящие в очереди для узла, esp_now_send отклонит
+    esp_now_del_peer(peer_mac);
+    ESP_LOGI(TAG, "Узел " MACSTR " удален", MAC2STR(peer_mac));
+    return ESP_OK;
+}
+
+bool espnow_has_peer(const uint8_t *peer_mac) {
+    portENTER_CRITICAL(&peer_lock);
+    bool found = peer_mac && peer_table_find(&peers, peer_mac) != NULL;
+    portEXIT_CRITICAL(&peer_lock);
+    return found;
+}
+
+bool espnow_get_peer_stats(const uint8_t *peer_mac, peer_link_stats_t *stats) {
+    if (!peer_mac || !stats) return false;
+
+    portENTER_CRITICAL(&peer_lock);
+    peer_entry_t *peer = peer_table_find(&peers, peer_mac);
+    if (peer) {
+        *stats = peer->stats;
+    }
+    portEXIT_CRITICAL(&peer_lock);
+    return peer != NULL;
+}
+
+bool espnow_get_link_stats(const transport_dest_t *dest, peer_link_stats_t *stats) {
+    if (!dest || !stats) return false;
+
+    if (dest->mode == TRANSPORT_DEST_UNICAST) {
+        return espnow_get_peer_stats(dest->mac, stats);
+    }
+    if (dest->mode != TRANSPORT_DEST_GROUP) {
+        return false;
+    }
+    portENTER_CRITICAL(&peer_lock);
+    size_t count = peer_table_group_stats(&peers, dest->groups, stats);
+    portEXIT_CRITICAL(&peer_lock);
+    return count > 0;
+}
+
+uint8_t espnow_peer_count(void) {
+    return peers.count;
+}
+
+// Ставит пакет в очередь. Вызывается под tx_mutex
+static transport_tx_status_t espnow_tx_push(const uint8_t *peer_mac, const uint8_t *data, size_t len,
+                                            tx_class_t cls) {
+    bool dropped;
+    int index = tx_sched_push(&tx_sched, cls, len, tx_evictable(data, len), esp_timer_get_time(), &dropped);
+    if (index < 0) {
+        tx_stats.rejected++;
+        return TRANSPORT_TX_FULL;
     }
-    esp_err_t err = esp_now_send(peer_mac, data, len);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "esp_now_send error: 0x%x", err);
+    if (dropped) {
+        tx_stats.dropped++;
+    }
+
+    espnow_tx_slot_t *slot = &tx_slots[index];
+    memcpy(slot->peer_mac, peer_mac, ESP_NOW_ETH_ALEN);
+    memcpy(slot->data, data, len);
+    slot->len = len;
+
+    tx_stats.enqueued++;
+    tx_stats.queue_depth = tx_sched_depth(&tx_sched);
+    return dropped ? TRANSPORT_TX_QUEUED_DROPPED : TRANSPORT_TX_QUEUED;
+}
+
+// Проверяет аргументы и усекает пакет до MTU ESP-NOW
+static bool espnow_tx_check(const uint8_t *data, size_t *len) {
+    if (!data || *len == 0 || !tx_mutex) {
+        return false;
+    }
+    if (*len > ESPNOW_MAX_DATA_LEN) {
+        DLOGW(DLOG_ESPNOW_TRUNCATED, *len, ESPNOW_MAX_DATA_LEN);
+        *len = ESPNOW_MAX_DATA_LEN;
+    }
+    return true;
+}
+
+transport_tx_status_t espnow_send_async(const uint8_t *peer_mac, const uint8_t *data, size_t len,
+                                     tx_class_t cls) {
+    if (!peer_mac || !espnow_tx_check(data, &len)) {
+        return TRANSPORT_TX_INVALID;
     }
-}
\ No newline at end of file
+
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    transport_tx_status_t status = espnow_tx_push(peer_mac, data, len, cls);
+    xSemaphoreGive(tx_mutex);
+
+    if (status != TRANSPORT_TX_FULL) {
+        xTaskNotifyGive(tx_task_handle);
+    }
+    return status;
+}
+
+transport_tx_status_t espnow_send_dest(const transport_dest_t *dest, const uint8_t *data, size_t len,
+                                    tx_class_t cls) {
+    if (!dest) {
+        return TRANSPORT_TX_INVALID;
+    }
+    if (dest->mode == TRANSPORT_DEST_UNICAST) {
+        return espnow_send_async(dest->mac, data, len, cls);
+    }
+    if (dest->mode == TRANSPORT_DEST_BROADCAST) {
+        // Один кадр в эфире для всех узлов, без подтверждения получателями
+        return espnow_send_async(PEER_BROADCAST_MAC, data, len, cls);
+    }
+
+    // ESP-NOW не поддерживает групповую адресацию: копия каждому узлу
+    // группы. Копии ставятся все или ни одной, чтобы вызывающий мог
+    // повторить передачу после ожидания места, не удваивая копии
+    if (!espnow_tx_check(data, &len)) {
+        return TRANSPORT_TX_INVALID;
+    }
+    uint8_t macs[PEER_TABLE_CAPACITY][PEER_MAC_LEN];
+    portENTER_CRITICAL(&peer_lock);
+    size_t count = peer_table_collect(&peers, dest->groups, macs, PEER_TABLE_CAPACITY);
+    portEXIT_CRITICAL(&peer_lock);
+    if (count == 0) {
+        return TRANSPORT_TX_INVALID;
+    }
+
+    transport_tx_status_t result = TRANSPORT_TX_QUEUED;
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    if (tx_sched_room(&tx_sched, cls, tx_evictable(data, len)) < count) {
+        tx_stats.rejected++;
+        result = TRANSPORT_TX_FULL;
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            if (espnow_tx_push(macs[i], data, len, cls) == TRANSPORT_TX_QUEUED_DROPPED) {
+                result = TRANSPORT_TX_QUEUED_DROPPED;
+            }
+        }
+    }
+    xSemaphoreGive(tx_mutex);
+
+    if (result != TRANSPORT_TX_FULL) {
+        xTaskNotifyGive(tx_task_handle);
+    }
+    return result;
+}
+
+bool espnow_tx_wait_space(TickType_t ticks_to_wait) {
+    if (!tx_space_sem) {
+        return false;
+    }
+    return xSemaphoreTake(tx_space_sem, ticks_to_wait) == pdTRUE;
+}
+
+void espnow_tx_get_stats(espnow_tx_stats_t *stats) {
+    if (!stats) return;
+
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    portENTER_CRITICAL(&peer_lock);
+    *stats = tx_stats;
+    portEXIT_CRITICAL(&peer_lock);
+    xSemaphoreGive(tx_mutex);
+}
+
+void espnow_tx_get_class_stats(tx_class_t cls, tx_sched_class_stats_t *stats) {
+    if (!stats || (unsigned)cls >= TX_CLASS_COUNT || !tx_mutex) return;
+
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    *stats = tx_sched.stats[cls];
+    xSemaphoreGive(tx_mutex);
+}
+
+const transport_packet_t *espnow_rx_receive(TickType_t ticks_to_wait) {
+    if (!rx_consumer_task) {
+        rx_consumer_task = xTaskGetCurrentTaskHandle();
+    }
+
+    const transport_packet_t *packet = spsc_ring_peek(&rx_ring);
+    if (!packet && ulTaskNotifyTake(pdTRUE, ticks_to_wait) > 0) {
+        packet = spsc_ring_peek(&rx_ring);
+    }
+    return packet;
+}
+
+void espnow_rx_release(void) {
+    spsc_ring_release(&rx_ring);
+}
+
+void espnow_rx_get_stats(transport_rx_stats_t *stats) {
+    if (!stats) return;
+    *stats = rx_stats;
+}
+
+const transport_t transport_espnow = {
+    .name = "espnow",
+    .init = espnow_init,
+    .add_peer = espnow_add_peer,
+    .has_peer = espnow_has_peer,
+    .peer_count = espnow_peer_count,
+    .send = espnow_send_dest,
+    .wait_space = espnow_tx_wait_space,
+    .get_class_stats = espnow_tx_get_class_stats,
+    .get_link_stats = espnow_get_link_stats,
+    .receive = espnow_rx_receive,
+    .release = espnow_rx_release,
+    .get_rx_stats = espnow_rx_get_stats,
+};
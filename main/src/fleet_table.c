@@ -0,0 +1,188 @@
+#include <string.h>
+#include "fleet_table.h"
+#include "drone_msg_view.h"
+
+#define BUCKET_MASK (FLEET_BUCKETS - 1)
+
+_Static_assert((FLEET_BUCKETS & BUCKET_MASK) == 0, "FLEET_BUCKETS должна быть степенью двойки");
+_Static_assert(FLEET_BUCKETS >= 2 * FLEET_MAX_DRONES, "Хеш-таблица дронов заполнена больше чем наполовину");
+_Static_assert(FLEET_MAX_DRONES < 128, "Индекс записи не помещается в int8_t");
+_Static_assert(FLEET_RECORDS_PER_FRAME > 0, "Запись не помещается в кадр снимка");
+
+// Старшие биты хеша - номер корзины
+static inline uint32_t mac_hash(const uint8_t *mac) {
+    return peer_mac_hash(mac) >> 25;
+}
+
+_Static_assert(FLEET_BUCKETS == 128, "mac_hash возвращает 7 бит");
+
+static inline bool bit_test(const uint32_t *bitmap, int index) {
+    return (bitmap[index / 32] >> (index % 32)) & 1;
+}
+
+static inline void bit_set(uint32_t *bitmap, int index) {
+    bitmap[index / 32] |= 1u << (index % 32);
+}
+
+static inline void bit_clear(uint32_t *bitmap, int index) {
+    bitmap[index / 32] &= ~(1u << (index % 32));
+}
+
+void fleet_init(fleet_table_t *fleet) {
+    memset(fleet, 0, sizeof(*fleet));
+    memset(fleet->buckets, -1, sizeof(fleet->buckets));
+}
+
+// Корзина, в которой лежит дрон, или первая пустая корзина его цепочки
+static uint32_t find_bucket(const fleet_table_t *fleet, const uint8_t *mac) {
+    uint32_t bucket = mac_hash(mac);
+    while (fleet->buckets[bucket] >= 0 &&
+           memcmp(fleet->mac[fleet->buckets[bucket]], mac, PEER_MAC_LEN) != 0) {
+        bucket = (bucket + 1) & BUCKET_MASK;
+    }
+    return bucket;
+}
+
+static int alloc_index(const fleet_table_t *fleet) {
+    for (int word = 0; word < FLEET_BITMAP_WORDS; word++) {
+        if (~fleet->used[word]) {
+            int index = word * 32 + __builtin_ctz(~fleet->used[word]);
+            return index < FLEET_MAX_DRONES ? index : -1;
+        }
+    }
+    return -1;
+}
+
+fleet_status_t fleet_update(fleet_table_t *fleet, const uint8_t *mac,
+                            const uint8_t *frame, size_t len, int64_t now_us) {
+    if (len != EXPECTED_DRONE_MSG_SIZE || drone_msg_get_msg_type(frame) != MSG_TYPE_TELEMETRY) {
+        return FLEET_INVALID;
+    }
+
+    fleet_status_t status = FLEET_UPDATED;
+    uint32_t bucket = find_bucket(fleet, mac);
+    int index = fleet->buckets[bucket];
+    if (index < 0) {
+        index = alloc_index(fleet);
+        if (index < 0) {
+            fleet->stats.rejected++;
+            return FLEET_FULL;
+        }
+        memcpy(fleet->mac[index], mac, PEER_MAC_LEN);
+        bit_set(fleet->used, index);
+        fleet->coalesced[index] = 0;
+        fleet->buckets[bucket] = index;
+        fleet->count++;
+        status = FLEET_ADDED;
+    }
+
+    if (bit_test(fleet->dirty, index)) {
+        // Предыдущее сообщение не попало в снимок и заменяется свежим
+        fleet->stats.coalesced++;
+        if (fleet->coalesced[index] < UINT8_MAX) {
+            fleet->coalesced[index]++;
+        }
+    } else {
+        bit_set(fleet->dirty, index);
+        fleet->coalesced[index] = 0;
+    }
+    memcpy(fleet->state[index], frame, EXPECTED_DRONE_MSG_SIZE);
+    fleet->updated_us[index] = now_us;
+    fleet->stats.updates++;
+    return status;
+}
+
+static void put_record(const fleet_table_t *fleet, int index, int64_t now_us, uint8_t *out) {
+    int64_t age_ms = (now_us - fleet->updated_us[index]) / 1000;
+    memcpy(out, fleet->mac[index], PEER_MAC_LEN);
+    drone_msg_put_le16(out + PEER_MAC_LEN, age_ms > UINT16_MAX ? UINT16_MAX : (uint16_t)age_ms);
+    out[PEER_MAC_LEN + 2] = fleet->coalesced[index];
+    memcpy(out + PEER_MAC_LEN + 3, fleet->state[index], EXPECTED_DRONE_MSG_SIZE);
+}
+
+int fleet_snapshot(fleet_table_t *fleet, int64_t now_us, fleet_emit_fn_t emit, void *user_ctx) {
+    uint8_t *frame = fleet->frame;
+    uint8_t part = 0;
+    uint8_t count = 0;
+    int total = 0;
+
+    for (int word = 0; word < FLEET_BITMAP_WORDS; word++) {
+        uint32_t pending = fleet->dirty[word];
+        fleet->dirty[word] = 0;
+        while (pending) {
+            int index = word * 32 + __builtin_ctz(pending);
+            pending &= pending - 1;
+            put_record(fleet, index, now_us, frame + FLEET_SNAPSHOT_HEADER + count * FLEET_RECORD_SIZE);
+            fleet->coalesced[index] = 0;
+            total++;
+            if (++count == FLEET_RECORDS_PER_FRAME) {
+                frame[0] = FLEET_SNAPSHOT_MAGIC;
+                frame[1] = fleet->seq;
+                frame[2] = part++;
+                frame[3] = count;
+                emit(frame, FLEET_SNAPSHOT_HEADER + count * FLEET_RECORD_SIZE, user_ctx);
+                fleet->stats.snapshots++;
+                count = 0;
+            }
+        }
+    }
+    if (count > 0) {
+        frame[0] = FLEET_SNAPSHOT_MAGIC;
+        frame[1] = fleet->seq;
+        frame[2] = part;
+        frame[3] = count;
+        emit(frame, FLEET_SNAPSHOT_HEADER + count * FLEET_RECORD_SIZE, user_ctx);
+        fleet->stats.snapshots++;
+    }
+    if (total > 0) {
+        fleet->seq++;
+    }
+    fleet->stats.records += total;
+    return total;
+}
+
+// Удаляет запись из хеш-таблицы со сдвигом следующих записей цепочки
+static void remove_index(fleet_table_t *fleet, int index) {
+    uint32_t hole = find_bucket(fleet, fleet->mac[index]);
+    fleet->buckets[hole] = -1;
+    bit_clear(fleet->used, index);
+    bit_clear(fleet->dirty, index);
+    fleet->count--;
+
+    uint32_t bucket = (hole + 1) & BUCKET_MASK;
+    while (fleet->buckets[bucket] >= 0) {
+        uint32_t home = mac_hash(fleet->mac[fleet->buckets[bucket]]);
+        if (((bucket - home) & BUCKET_MASK) >= ((bucket - hole) & BUCKET_MASK)) {
+            fleet->buckets[hole] = fleet->buckets[bucket];
+            fleet->buckets[bucket] = -1;
+            hole = bucket;
+        }
+        bucket = (bucket + 1) & BUCKET_MASK;
+    }
+}
+
+int fleet_expire(fleet_table_t *fleet, int64_t now_us, int64_t max_age_us) {
+    int expired = 0;
+    for (int word = 0; word < FLEET_BITMAP_WORDS; word++) {
+        uint32_t used = fleet->used[word];
+        while (used) {
+            int index = word * 32 + __builtin_ctz(used);
+            used &= used - 1;
+            if (now_us - fleet->updated_us[index] > max_age_us) {
+                remove_index(fleet, index);
+                expired++;
+            }
+        }
+    }
+    fleet->stats.expired += expired;
+    return expired;
+}
+
+const uint8_t *fleet_get_state(const fleet_table_t *fleet, const uint8_t *mac) {
+    int index = fleet->buckets[find_bucket(fleet, mac)];
+    return index >= 0 ? fleet->state[index] : NULL;
+}
+
+bool fleet_is_snapshot(const uint8_t *data, size_t len) {
+    return data && len >= FLEET_SNAPSHOT_HEADER && data[0] == FLEET_SNAPSHOT_MAGIC;
+}
@@ -0,0 +1,378 @@
+#include <string.h>
+#include "flightrec.h"
+#include "drone_msg_view.h"
+
+_Static_assert(FLIGHTREC_SECTOR_SIZE % FLIGHTREC_PAGE_SIZE == 0, "Сектор должен состоять из целых страниц");
+_Static_assert(DRONE_MSG_PACKET_SIZE < 0xFF, "Длина записи не помещается в байт");
+_Static_assert(FLIGHTREC_HEADER_SIZE + FLIGHTREC_RECORD_HEADER + DRONE_MSG_PACKET_SIZE <= FLIGHTREC_SECTOR_SIZE,
+               "Запись не помещается в сектор");
+
+// Место под самую длинную запись: по нему решается, нужен ли новый сектор,
+// до кодирования записи
+#define RECORD_MAX (FLIGHTREC_RECORD_HEADER + DRONE_MSG_PACKET_SIZE)
+
+#define END_MARKER 0xFF
+
+static inline size_t sector_offset(uint16_t sector) {
+    return (size_t)sector * FLIGHTREC_SECTOR_SIZE;
+}
+
+static int flash_write(flightrec_t *rec, size_t offset, const void *data, size_t len) {
+    if (esp_partition_write(rec->part, offset, data, len) != ESP_OK) {
+        rec->stats.errors++;
+        return -1;
+    }
+    rec->stats.page_writes++;
+    return 0;
+}
+
+int flightrec_flush(flightrec_t *rec) {
+    if (!rec || !rec->head_open) {
+        return 0;
+    }
+    uint16_t fill = rec->write_off - rec->page_base;
+    if (fill <= rec->page_flushed) {
+        return 0;
+    }
+    // Дописывается только новая часть страницы: остальные байты уже
+    // запрограммированы, а стертые байты 0xFF программировать не нужно
+    size_t offset = sector_offset(rec->head) + rec->page_base + rec->page_flushed;
+    int ret = flash_write(rec, offset, rec->page + rec->page_flushed, fill - rec->page_flushed);
+    rec->page_flushed = fill;
+    return ret;
+}
+
+// Копирует байты записи в страницу; заполненная страница пишется целиком
+static int page_put(flightrec_t *rec, const uint8_t *data, size_t len) {
+    int ret = 0;
+    while (len > 0) {
+        uint16_t fill = rec->write_off - rec->page_base;
+        size_t chunk = len < (size_t)(FLIGHTREC_PAGE_SIZE - fill) ? len : (size_t)(FLIGHTREC_PAGE_SIZE - fill);
+        memcpy(rec->page + fill, data, chunk);
+        rec->write_off += chunk;
+        data += chunk;
+        len -= chunk;
+
+        if (rec->write_off - rec->page_base == FLIGHTREC_PAGE_SIZE) {
+            if (flightrec_flush(rec) < 0) {
+                ret = -1;
+            }
+            rec->page_base += FLIGHTREC_PAGE_SIZE;
+            rec->page_flushed = 0;
+            memset(rec->page, END_MARKER, sizeof(rec->page));
+        }
+    }
+    return ret;
+}
+
+// Дописывает в заголовок сектора диапазон меток времени его записей
+static void seal_sector(flightrec_t *rec) {
+    flightrec_flush(rec);
+    const flightrec_sector_t *entry = &rec->index[rec->head];
+    if (entry->min_ms > entry->max_ms) {
+        return;
+    }
+    uint8_t range[8];
+    drone_msg_put_le32(range, entry->min_ms);
+    drone_msg_put_le32(range + 4, entry->max_ms);
+    flash_write(rec, sector_offset(rec->head) + 8, range, sizeof(range));
+}
+
+// Закрывает текущий сектор, стирает следующий сектор кольца и начинает в
+// нем запись. Если стереть не удалось, следующая попытка - в тот же сектор
+static int open_sector(flightrec_t *rec) {
+    if (rec->head_open) {
+        seal_sector(rec);
+        rec->head_open = false;
+    }
+    uint16_t next = rec->head;
+    if (rec->head_seq != 0 && rec->index[rec->head].seq == rec->head_seq) {
+        next = (rec->head + 1) % rec->sector_count;
+    }
+    rec->head = next;
+
+    if (rec->index[next].seq != 0) {
+        rec->stats.overwritten++;
+    }
+    rec->index[next].seq = 0;
+    if (esp_partition_erase_range(rec->part, sector_offset(next), FLIGHTREC_SECTOR_SIZE) != ESP_OK) {
+        rec->stats.errors++;
+        return -1;
+    }
+    rec->stats.erases++;
+
+    rec->head_seq++;
+    rec->index[next] = (flightrec_sector_t){.seq = rec->head_seq, .min_ms = UINT32_MAX, .max_ms = 0};
+    rec->head_open = true;
+    rec->write_off = 0;
+    rec->page_base = 0;
+    rec->page_flushed = 0;
+    memset(rec->page, END_MARKER, sizeof(rec->page));
+
+    // Диапазон меток времени остается стертым до закрытия сектора
+    uint8_t header[8];
+    drone_msg_put_le32(header, FLIGHTREC_MAGIC_WORD);
+    drone_msg_put_le32(header + 4, rec->head_seq);
+    page_put(rec, header, sizeof(header));
+    rec->write_off = FLIGHTREC_HEADER_SIZE;
+
+    drone_compact_force_keyframe(&rec->encoder);
+    return 0;
+}
+
+// Проходит записи сектора в buf до limit. Возвращает смещение конца записей
+static size_t walk_records(const uint8_t *buf, size_t limit, uint32_t *min_ms, uint32_t *max_ms) {
+    size_t off = FLIGHTREC_HEADER_SIZE;
+    while (off + FLIGHTREC_RECORD_HEADER <= limit) {
+        uint8_t len = buf[off];
+        // Запись, прерванная сбросом питания, - конец сектора
+        if (len == END_MARKER || len == 0 || off + FLIGHTREC_RECORD_HEADER + len > limit) {
+            break;
+        }
+        uint32_t ts = drone_msg_le32(buf + off + 1);
+        if (ts < *min_ms) *min_ms = ts;
+        if (ts > *max_ms) *max_ms = ts;
+        off += FLIGHTREC_RECORD_HEADER + len;
+    }
+    return off;
+}
+
+int flightrec_open(flightrec_t *rec, const esp_partition_t *part) {
+    if (!rec || !part) {
+        return -1;
+    }
+    memset(rec, 0, sizeof(*rec));
+    rec->part = part;
+    rec->sector_count = part->size / FLIGHTREC_SECTOR_SIZE;
+    if (rec->sector_count > FLIGHTREC_MAX_SECTORS) {
+        rec->sector_count = FLIGHTREC_MAX_SECTORS;
+    }
+    if (rec->sector_count < 2) {
+        return -1;
+    }
+    drone_compact_encoder_init(&rec->encoder, FLIGHTREC_KEYFRAME_INTERVAL);
+    memset(rec->page, END_MARKER, sizeof(rec->page));
+
+    // Индекс строится по заголовкам, сектор целиком читается, только если
+    // он не был закрыт
+    bool head_sealed = false;
+    for (uint16_t s = 0; s < rec->sector_count; s++) {
+        uint8_t header[FLIGHTREC_HEADER_SIZE];
+        if (esp_partition_read(part, sector_offset(s), header, sizeof(header)) != ESP_OK) {
+            return -1;
+        }
+        uint32_t seq = drone_msg_le32(header + 4);
+        if (drone_msg_le32(header) != FLIGHTREC_MAGIC_WORD || seq == 0 || seq == UINT32_MAX) {
+            continue;
+        }
+        flightrec_sector_t *entry = &rec->index[s];
+        entry->seq = seq;
+        entry->min_ms = drone_msg_le32(header + 8);
+        entry->max_ms = drone_msg_le32(header + 12);
+        bool sealed = entry->min_ms != UINT32_MAX || entry->max_ms != UINT32_MAX;
+        if (seq > rec->head_seq) {
+            head_sealed = sealed;
+        }
+        if (!sealed) {
+            if (esp_partition_read(part, sector_offset(s), rec->sector_buf, FLIGHTREC_SECTOR_SIZE) != ESP_OK) {
+                return -1;
+            }
+            entry->min_ms = UINT32_MAX;
+            entry->max_ms = 0;
+            walk_records(rec->sector_buf, FLIGHTREC_SECTOR_SIZE, &entry->min_ms, &entry->max_ms);
+        }
+        if (seq > rec->head_seq) {
+            rec->head_seq = seq;
+            rec->head = s;
+        }
+    }
+    // Закрытый последний сектор не дописывается: диапазон в заголовке уже
+    // запрограммирован. Запись начнется со следующего сектора
+    if (rec->head_seq == 0 || head_sealed) {
+        return 0;
+    }
+
+    // Запись продолжается в последнем секторе после его последней записи
+    if (esp_partition_read(part, sector_offset(rec->head), rec->sector_buf, FLIGHTREC_SECTOR_SIZE) != ESP_OK) {
+        return -1;
+    }
+    uint32_t min_ms = UINT32_MAX;
+    uint32_t max_ms = 0;
+    rec->write_off = walk_records(rec->sector_buf, FLIGHTREC_SECTOR_SIZE, &min_ms, &max_ms);
+    rec->index[rec->head].min_ms = min_ms;
+    rec->index[rec->head].max_ms = max_ms;
+    rec->page_base = rec->write_off & ~(FLIGHTREC_PAGE_SIZE - 1);
+    rec->page_flushed = rec->write_off - rec->page_base;
+    memcpy(rec->page, rec->sector_buf + rec->page_base, rec->page_flushed);
+    rec->head_open = true;
+    return 0;
+}
+
+int flightrec_append(flightrec_t *rec, const uint8_t *frame, size_t len) {
+    if (!rec || !rec->part || drone_msg_verify(frame, len) < 0) {
+        return -1;
+    }
+    if (!rec->head_open || rec->write_off + RECORD_MAX > FLIGHTREC_SECTOR_SIZE) {
+        if (open_sector(rec) < 0) {
+            return -1;
+        }
+    }
+
+    // Телеметрия - в компактном формате, остальные сообщения без изменений.
+    // Компактный кадр короче полного, по длине они и различаются при чтении
+    uint8_t record[RECORD_MAX];
+    uint8_t *body = record + FLIGHTREC_RECORD_HEADER;
+    int body_len = -1;
+    if (drone_msg_get_msg_type(frame) == MSG_TYPE_TELEMETRY) {
+        drone_message_t msg;
+        if (drone_msg_decode(frame, len, &msg) == 0) {
+            body_len = drone_compact_encode(&rec->encoder, &msg, body, DRONE_COMPACT_MAX_SIZE);
+        }
+    }
+    if (body_len > 0) {
+        rec->stats.compact++;
+    } else {
+        memcpy(body, frame, len);
+        body_len = len;
+    }
+
+    uint32_t ts = drone_msg_get_timestamp(frame);
+    record[0] = body_len;
+    drone_msg_put_le32(record + 1, ts);
+    int ret = page_put(rec, record, FLIGHTREC_RECORD_HEADER + body_len);
+
+    flightrec_sector_t *entry = &rec->index[rec->head];
+    if (ts < entry->min_ms) entry->min_ms = ts;
+    if (ts > entry->max_ms) entry->max_ms = ts;
+    rec->stats.records++;
+    rec->stats.bytes += FLIGHTREC_RECORD_HEADER + body_len;
+    return ret;
+}
+
+uint32_t flightrec_first_seq(const flightrec_t *rec) {
+    if (rec->head_seq < rec->sector_count) {
+        return 1;
+    }
+    return rec->head_seq - rec->sector_count + 1;
+}
+
+int flightrec_read_sector(flightrec_t *rec, uint32_t *seq, uint32_t from_ms, uint32_t to_ms,
+                          flightrec_cb_t cb, void *user_ctx) {
+    if (!rec || !seq || rec->head_seq == 0 || *seq > rec->head_seq) {
+        return -1;
+    }
+    if (*seq < flightrec_first_seq(rec)) {
+        *seq = flightrec_first_seq(rec);
+    }
+    uint32_t cur = (*seq)++;
+    uint16_t s = (rec->head + rec->sector_count - (rec->head_seq - cur)) % rec->sector_count;
+
+    const flightrec_sector_t *entry = &rec->index[s];
+    if (entry->seq != cur || entry->max_ms < from_ms || entry->min_ms > to_ms) {
+        return 0;
+    }
+
+    size_t limit = FLIGHTREC_SECTOR_SIZE;
+    if (s == rec->head && rec->head_open) {
+        flightrec_flush(rec);
+        limit = rec->write_off;
+    }
+    if (esp_partition_read(rec->part, sector_offset(s), rec->sector_buf, limit) != ESP_OK) {
+        rec->stats.errors++;
+        return 0;
+    }
+
+    // Сектор начинается с ключевого кадра, поэтому декодер свой для сектора
+    drone_compact_decoder_t decoder;
+    drone_compact_decoder_init(&decoder);
+    uint8_t expanded[DRONE_MSG_PACKET_SIZE];
+    int delivered = 0;
+    size_t off = FLIGHTREC_HEADER_SIZE;
+    while (off + FLIGHTREC_RECORD_HEADER <= limit) {
+        uint8_t len = rec->sector_buf[off];
+        if (len == END_MARKER || len == 0 || off + FLIGHTREC_RECORD_HEADER + len > limit) {
+            break;
+        }
+        uint32_t ts = drone_msg_le32(rec->sector_buf + off + 1);
+        const uint8_t *body = rec->sector_buf + off + FLIGHTREC_RECORD_HEADER;
+        off += FLIGHTREC_RECORD_HEADER + len;
+
+        const uint8_t *frame = body;
+        size_t frame_len = len;
+        if (drone_compact_is_compact(body, len)) {
+            // Ключевые кадры декодируются и вне диапазона: от них зависят следующие
+            drone_message_t msg;
+            if (drone_compact_decode(&decoder, body, len, &msg) < 0) {
+                rec->stats.errors++;
+                continue;
+            }
+            if (ts < from_ms || ts > to_ms) {
+                continue;
+            }
+            frame_len = drone_msg_encode(&msg, expanded, sizeof(expanded));
+            frame = expanded;
+        } else if (ts < from_ms || ts > to_ms) {
+            continue;
+        } else if (drone_msg_verify(body, len) < 0) {
+            rec->stats.errors++;
+            continue;
+        }
+        if (cb) {
+            cb(frame, frame_len, ts, user_ctx);
+        }
+        delivered++;
+    }
+    return delivered;
+}
+
+uint32_t flightrec_read(flightrec_t *rec, uint32_t from_ms, uint32_t to_ms, flightrec_cb_t cb, void *user_ctx) {
+    uint32_t total = 0;
+    uint32_t seq = flightrec_first_seq(rec);
+    int count;
+    while ((count = flightrec_read_sector(rec, &seq, from_ms, to_ms, cb, user_ctx)) >= 0) {
+        total += count;
+    }
+    return total;
+}
+
+bool flightrec_parse_request(const uint8_t *frame, size_t len, flightrec_request_t *req) {
+    if (!frame || len != FLIGHTREC_REQUEST_SIZE || frame[0] != FLIGHTREC_MAGIC ||
+        (frame[1] != FLIGHTREC_OP_REQUEST && frame[1] != FLIGHTREC_OP_REQUEST_REMOTE)) {
+        return false;
+    }
+    if (req) {
+        req->req_id = frame[2];
+        req->remote = frame[1] == FLIGHTREC_OP_REQUEST_REMOTE;
+        req->from_ms = drone_msg_le32(frame + 3);
+        req->to_ms = drone_msg_le32(frame + 7);
+    }
+    return true;
+}
+
+void flightrec_batch_init(flightrec_batch_t *batch, uint8_t req_id, size_t cap) {
+    batch->buf[0] = FLIGHTREC_MAGIC;
+    batch->buf[1] = FLIGHTREC_OP_DATA;
+    batch->buf[2] = req_id;
+    batch->buf[3] = 0;
+    batch->len = FLIGHTREC_DATA_HEADER;
+    batch->cap = cap < sizeof(batch->buf) ? cap : sizeof(batch->buf);
+}
+
+bool flightrec_batch_add(flightrec_batch_t *batch, const uint8_t *frame, size_t len) {
+    if (len > UINT8_MAX || batch->buf[3] == UINT8_MAX || batch->len + 1 + len > batch->cap) {
+        return false;
+    }
+    batch->buf[batch->len++] = len;
+    memcpy(batch->buf + batch->len, frame, len);
+    batch->len += len;
+    batch->buf[3]++;
+    return true;
+}
+
+size_t flightrec_encode_end(uint8_t req_id, uint32_t count, uint8_t *out) {
+    out[0] = FLIGHTREC_MAGIC;
+    out[1] = FLIGHTREC_OP_END;
+    out[2] = req_id;
+    drone_msg_put_le32(out + 3, count);
+    return FLIGHTREC_END_SIZE;
+}
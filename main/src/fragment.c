@@ -0,0 +1,160 @@
+#include <string.h>
+#include "fragment.h"
+
+_Static_assert(FRAGMENT_MAX_COUNT <= 16, "Индекс фрагмента не помещается в 4 бита");
+
+void fragment_tx_init(fragment_tx_t *tx, uint8_t first_stream) {
+    if (!tx) return;
+    tx->next_stream = first_stream;
+}
+
+int fragment_split(fragment_tx_t *tx, const uint8_t *frame, size_t len, fragment_cb_t cb, void *user_ctx) {
+    if (!tx || !frame || !cb || len == 0 || len > FRAGMENT_MAX_FRAME) {
+        return -1;
+    }
+
+    uint8_t packet[FRAGMENT_MAX_PACKET];
+    int count = (len + FRAGMENT_PAYLOAD - 1) / FRAGMENT_PAYLOAD;
+    uint8_t stream = tx->next_stream++;
+
+    for (int index = 0; index < count; index++) {
+        size_t offset = (size_t)index * FRAGMENT_PAYLOAD;
+        size_t chunk = len - offset < FRAGMENT_PAYLOAD ? len - offset : FRAGMENT_PAYLOAD;
+        packet[0] = FRAGMENT_MAGIC;
+        packet[1] = frame[0];
+        packet[2] = stream;
+        packet[3] = (uint8_t)(index << 4 | (count - 1));
+        memcpy(packet + FRAGMENT_HEADER_SIZE, frame + offset, chunk);
+        cb(packet, FRAGMENT_HEADER_SIZE + chunk, user_ctx);
+    }
+    return count;
+}
+
+void fragment_rx_init(fragment_rx_t *rx, fragment_slot_t *slots, uint8_t slot_count, int64_t timeout_us) {
+    if (!rx) return;
+    memset(rx, 0, sizeof(*rx));
+    rx->slots = slots;
+    rx->slot_count = slots ? slot_count : 0;
+    rx->timeout_us = timeout_us;
+    for (int i = 0; i < rx->slot_count; i++) {
+        slots[i].used = false;
+    }
+}
+
+bool fragment_is_fragment(const uint8_t *data, size_t len) {
+    return data && len > FRAGMENT_HEADER_SIZE && data[0] == FRAGMENT_MAGIC;
+}
+
+void fragment_expire(fragment_rx_t *rx, int64_t now_us) {
+    for (int i = 0; i < rx->slot_count; i++) {
+        fragment_slot_t *slot = &rx->slots[i];
+        if (slot->used && now_us - slot->updated_us > rx->timeout_us) {
+            slot->used = false;
+            if (!slot->done) {
+                rx->stats.timeouts++;
+            }
+        }
+    }
+}
+
+// Слот кадра (mac, stream); для нового кадра - свободный, слот собранного
+// кадра или вытесненный
+static fragment_slot_t *fragment_slot(fragment_rx_t *rx, const uint8_t *mac, uint8_t stream) {
+    fragment_slot_t *free_slot = NULL;
+    fragment_slot_t *done = NULL;
+    fragment_slot_t *oldest = NULL;
+
+    for (int i = 0; i < rx->slot_count; i++) {
+        fragment_slot_t *slot = &rx->slots[i];
+        if (!slot->used) {
+            if (!free_slot) {
+                free_slot = slot;
+            }
+            continue;
+        }
+        if (slot->stream == stream && memcmp(slot->mac, mac, sizeof(slot->mac)) == 0) {
+            return slot;
+        }
+        if (slot->done) {
+            if (!done || slot->updated_us < done->updated_us) {
+                done = slot;
+            }
+        } else if (!oldest || slot->updated_us < oldest->updated_us) {
+            oldest = slot;
+        }
+    }
+
+    fragment_slot_t *slot = free_slot ? free_slot : done;
+    if (!slot) {
+        slot = oldest;
+        rx->stats.evicted++;
+    }
+    slot->used = false;
+    return slot;
+}
+
+int fragment_receive(fragment_rx_t *rx, const uint8_t *mac, const uint8_t *data, size_t len, int64_t now_us,
+                     fragment_cb_t cb, void *user_ctx) {
+    if (!rx || !mac || !fragment_is_fragment(data, len) || rx->slot_count == 0) {
+        if (rx) {
+            rx->stats.invalid++;
+        }
+        return -1;
+    }
+
+    uint8_t stream = data[2];
+    uint8_t index = data[3] >> 4;
+    uint8_t count = (data[3] & 0x0F) + 1;
+    size_t chunk = len - FRAGMENT_HEADER_SIZE;
+    bool last = index == count - 1;
+
+    // Все фрагменты, кроме последнего, заполнены целиком
+    if (index >= count || count > FRAGMENT_MAX_COUNT || (!last && chunk != FRAGMENT_PAYLOAD) ||
+        (size_t)index * FRAGMENT_PAYLOAD + chunk > FRAGMENT_MAX_FRAME) {
+        rx->stats.invalid++;
+        return -1;
+    }
+
+    fragment_expire(rx, now_us);
+
+    fragment_slot_t *slot = fragment_slot(rx, mac, stream);
+    if (slot->used && slot->count != count) {
+        // Номер потока повторился раньше тайм-аута: прежний кадр не собрать
+        if (!slot->done) {
+            rx->stats.evicted++;
+        }
+        slot->used = false;
+    }
+    if (!slot->used) {
+        slot->used = true;
+        slot->done = false;
+        memcpy(slot->mac, mac, sizeof(slot->mac));
+        slot->stream = stream;
+        slot->count = count;
+        slot->received = 0;
+        slot->last_len = 0;
+    }
+    slot->updated_us = now_us;
+
+    uint16_t bit = 1u << index;
+    if (slot->received & bit) {
+        rx->stats.duplicates++;
+        return 0;
+    }
+    memcpy(slot->data + (size_t)index * FRAGMENT_PAYLOAD, data + FRAGMENT_HEADER_SIZE, chunk);
+    slot->received |= bit;
+    if (last) {
+        slot->last_len = chunk;
+    }
+
+    if (slot->received != (uint16_t)((1u << count) - 1)) {
+        return 0;
+    }
+
+    rx->stats.completed++;
+    slot->done = true;
+    if (cb) {
+        cb(slot->data, (size_t)(count - 1) * FRAGMENT_PAYLOAD + slot->last_len, user_ctx);
+    }
+    return 1;
+}
@@ -0,0 +1,419 @@
+#include <string.h>
+#include <stdbool.h>
+#include "frame_parser.h"
+#include "crc.h"
+
+#define RING_MASK (FRAME_PARSER_RING_SIZE - 1)
+
+_Static_assert((FRAME_PARSER_RING_SIZE & RING_MASK) == 0, "Размер кольцевого буфера должен быть степенью двойки");
+
+// Начальное состояние автомата для формата кадров
+static frame_parser_state_t frame_idle_state(const frame_parser_t *parser) {
+    return parser->mode == FRAME_MODE_LENGTH ? FRAME_WAIT_SYNC_1 : FRAME_WAIT_START_1;
+}
+
+// CRC-8 (полином 0x07) для заголовка кадра
+static uint8_t frame_header_crc(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+void frame_parser_init(frame_parser_t *parser, frame_mode_t mode) {
+    if (!parser) return;
+    
+    parser->ring_head = 0;
+    parser->ring_tail = 0;
+    parser->scan_base = 0;
+    parser->frame_start = 0;
+    parser->frame_len = 0;
+    parser->mode = mode;
+    parser->state = frame_idle_state(parser);
+    parser->header_len = 0;
+    parser->expected_len = 0;
+    parser->trailer_len = 0;
+    parser->replay_len = 0;
+    parser->replay_pos = 0;
+    parser->replay_base = 0;
+    parser->resync = false;
+    parser->frames = 0;
+    parser->overflows = 0;
+    parser->header_errors = 0;
+    parser->payload_errors = 0;
+}
+
+void frame_parser_reset(frame_parser_t *parser) {
+    if (!parser) return;
+    
+    parser->ring_tail = parser->ring_head;
+    parser->frame_len = 0;
+    parser->header_len = 0;
+    parser->trailer_len = 0;
+    parser->replay_len = 0;
+    parser->replay_pos = 0;
+    parser->resync = false;
+    parser->state = frame_idle_state(parser);
+}
+
+// Добавляет байты в собираемый кадр, при переполнении кадр отбрасывается
+static bool frame_append(frame_parser_t *parser, const uint8_t *data, size_t len) {
+    if (parser->frame_len + len > FRAME_PARSER_MAX_FRAME) {
+        parser->overflows++;
+        parser->frame_len = 0;
+        parser->state = FRAME_WAIT_START_1;
+        return false;
+    }
+    memcpy(parser->frame + parser->frame_len, data, len);
+    parser->frame_len += len;
+    return true;
+}
+
+// Разбор кадров с маркерами начала и конца
+static size_t frame_scan_markers(frame_parser_t *parser, const uint8_t *data, size_t len, bool *complete) {
+    size_t i = 0;
+    
+    while (i < len) {
+        switch (parser->state) {
+            case FRAME_WAIT_START_1: {
+                const uint8_t *start = memchr(data + i, FRAME_START_MARKER_1, len - i);
+                if (!start) {
+                    return len;
+                }
+                i = (size_t)(start - data) + 1;
+                parser->frame_start = parser->scan_base + (uint32_t)(i - 1);
+                parser->state = FRAME_WAIT_START_2;
+                break;
+            }
+                
+            case FRAME_WAIT_START_2:
+                if (data[i] == FRAME_START_MARKER_2) {
+                    parser->frame_len = 0;
+                    parser->state = FRAME_RECEIVING_DATA;
+                    i++;
+                } else if (data[i] != FRAME_START_MARKER_1) {
+                    parser->state = FRAME_WAIT_START_1;
+                    i++;
+                } else {
+                    // Повтор 0xAA может оказаться началом маркера
+                    parser->frame_start = parser->scan_base + (uint32_t)i;
+                    i++;
+                }
+                break;
+                
+            case FRAME_RECEIVING_DATA: {
+                // Копируем весь участок до ближайшего кандидата в маркер конца одним memcpy
+                const uint8_t *end = memchr(data + i, FRAME_END_MARKER_1, len - i);
+                size_t run = end ? (size_t)(end - data) - i : len - i;
+                size_t room = FRAME_PARSER_MAX_FRAME - parser->frame_len;
+                if (run > room) {
+                    // Кадр не помещается: поиск маркера начала продолжается с первого
+                    // лишнего байта, чтобы результат не зависел от разбиения потока на блоки
+                    parser->overflows++;
+                    parser->frame_len = 0;
+                    parser->state = FRAME_WAIT_START_1;
+                    i += room;
+                    break;
+                }
+                memcpy(parser->frame + parser->frame_len, data + i, run);
+                parser->frame_len += run;
+                i += run;
+                if (end) {
+                    parser->state = FRAME_WAIT_END_2;
+                    i++;
+                }
+                break;
+            }
+                
+            case FRAME_WAIT_END_2:
+                if (data[i] == FRAME_END_MARKER_2) {
+                    parser->state = FRAME_WAIT_START_1;
+                    parser->frames++;
+                    *complete = true;
+                    return i + 1;
+                }
+                // 0x55 оказался частью данных
+                if (frame_append(parser, (const uint8_t[]){ FRAME_END_MARKER_1 }, 1)) {
+                    parser->state = FRAME_RECEIVING_DATA;
+                }
+                break;
+                
+            default:
+                parser->state = FRAME_WAIT_START_1;
+                break;
+        }
+    }
+    
+    return i;
+}
+
+static size_t frame_scan_length(frame_parser_t *parser, const uint8_t *data, size_t len, bool *complete);
+
+// Синхрослово оказалось ложным: байты заголовка после него еще не разобраны
+// и могут содержать начало настоящего кадра, поэтому поиск продолжается с
+// байта, следующего за ложным SYNC_1. Байты берутся из сохраненного
+// заголовка, так что результат не зависит от разбиения потока на блоки.
+// Из FRAME_LEN_HEADER_SIZE - 1 байт заголовок не собрать, рекурсии нет
+static void frame_resync_header(frame_parser_t *parser) {
+    uint8_t rest[FRAME_LEN_HEADER_SIZE - 1];
+    size_t rest_len = parser->header_len - 1;
+    memcpy(rest, parser->header + 1, rest_len);
+    parser->header_len = 0;
+    parser->state = FRAME_WAIT_SYNC_1;
+    
+    // Позиции байтов заголовка на линии - следом за ложным SYNC_1
+    uint32_t scan_base = parser->scan_base;
+    parser->scan_base = parser->frame_start + 1;
+    bool complete = false;
+    frame_scan_length(parser, rest, rest_len, &complete);
+    parser->scan_base = scan_base;
+}
+
+// Разбор кадров с префиксом длины: данные копируются целиком, без просмотра
+// каждого байта, CRC данных проверяется по завершении кадра
+static size_t frame_scan_length(frame_parser_t *parser, const uint8_t *data, size_t len, bool *complete) {
+    size_t i = 0;
+    
+    while (i < len) {
+        switch (parser->state) {
+            case FRAME_WAIT_SYNC_1: {
+                const uint8_t *sync = memchr(data + i, FRAME_SYNC_1, len - i);
+                if (!sync) {
+                    return len;
+                }
+                i = (size_t)(sync - data) + 1;
+                parser->frame_start = parser->scan_base + (uint32_t)(i - 1);
+                parser->state = FRAME_WAIT_SYNC_2;
+                break;
+            }
+                
+            case FRAME_WAIT_SYNC_2:
+                if (data[i] == FRAME_SYNC_2) {
+                    parser->header[0] = FRAME_SYNC_1;
+                    parser->header[1] = FRAME_SYNC_2;
+                    parser->header_len = 2;
+                    parser->state = FRAME_RECEIVING_HEADER;
+                } else if (data[i] != FRAME_SYNC_1) {
+                    parser->state = FRAME_WAIT_SYNC_1;
+                } else {
+                    parser->frame_start = parser->scan_base + (uint32_t)i;
+                }
+                i++;
+                break;
+                
+            case FRAME_RECEIVING_HEADER: {
+                parser->header[parser->header_len++] = data[i++];
+                if (parser->header_len < FRAME_LEN_HEADER_SIZE) {
+                    break;
+                }
+                
+                size_t frame_len = parser->header[2] | ((size_t)parser->header[3] << 8);
+                if (frame_header_crc(parser->header + 2, 2) != parser->header[4] ||
+                    frame_len == 0 || frame_len > FRAME_PARSER_MAX_FRAME) {
+                    parser->header_errors++;
+                    frame_resync_header(parser);
+                    break;
+                }
+                parser->expected_len = frame_len;
+                parser->frame_len = 0;
+                parser->trailer_len = 0;
+                parser->state = FRAME_RECEIVING_PAYLOAD;
+                break;
+            }
+                
+            case FRAME_RECEIVING_PAYLOAD: {
+                size_t need = parser->expected_len - parser->frame_len;
+                size_t run = len - i < need ? len - i : need;
+                memcpy(parser->frame + parser->frame_len, data + i, run);
+                parser->frame_len += run;
+                i += run;
+                if (parser->frame_len == parser->expected_len) {
+                    parser->state = FRAME_RECEIVING_CRC;
+                }
+                break;
+            }
+                
+            case FRAME_RECEIVING_CRC: {
+                parser->trailer[parser->trailer_len++] = data[i++];
+                if (parser->trailer_len < FRAME_LEN_TRAILER_SIZE) {
+                    break;
+                }
+                
+                parser->state = FRAME_WAIT_SYNC_1;
+                uint16_t crc = parser->trailer[0] | ((uint16_t)parser->trailer[1] << 8);
+                if (crc16_ccitt(parser->frame, parser->frame_len) != crc) {
+                    // Байты после ложного SYNC_1 разбираются заново: frame_scan
+                    // переносит их в буфер повтора до разбора следующих байт
+                    parser->payload_errors++;
+                    parser->resync = true;
+                    return i;
+                }
+                parser->frames++;
+                *complete = true;
+                return i;
+            }
+                
+            default:
+                parser->state = FRAME_WAIT_SYNC_1;
+                break;
+        }
+    }
+    
+    return i;
+}
+
+// CRC данных не сошлась: синхрослово могло оказаться ложным (A5 5A внутри
+// данных), и в принятом участке может лежать настоящий кадр. Остаток
+// заголовка, данные и CRC переносятся в буфер повтора и разбираются заново
+// с байта, следующего за ложным SYNC_1, как в frame_resync_header.
+// Неразобранный остаток прежнего повтора идет следом: ложный кадр начался
+// внутри повтора, поэтому новое начало короче уже разобранной части
+static void frame_resync_payload(frame_parser_t *parser) {
+    size_t head = FRAME_LEN_HEADER_SIZE - 1;
+    size_t prefix = head + parser->expected_len + FRAME_LEN_TRAILER_SIZE;
+    size_t rest = parser->replay_len - parser->replay_pos;
+    
+    memmove(parser->replay + prefix, parser->replay + parser->replay_pos, rest);
+    memcpy(parser->replay, parser->header + 1, head);
+    memcpy(parser->replay + head, parser->frame, parser->expected_len);
+    memcpy(parser->replay + head + parser->expected_len, parser->trailer, FRAME_LEN_TRAILER_SIZE);
+    parser->replay_len = prefix + rest;
+    parser->replay_pos = 0;
+    parser->replay_base = parser->frame_start + 1;
+    parser->frame_len = 0;
+    parser->resync = false;
+}
+
+// Прогоняет байты через конечный автомат и останавливается сразу после
+// завершения кадра. Буфер повтора разбирается раньше новых байт, кадр из
+// него возвращается без потребления data. Возвращает количество
+// обработанных байт data
+static size_t frame_scan(frame_parser_t *parser, const uint8_t *data, size_t len, bool *complete) {
+    *complete = false;
+    if (parser->mode != FRAME_MODE_LENGTH) {
+        return frame_scan_markers(parser, data, len, complete);
+    }
+    
+    uint32_t scan_base = parser->scan_base;
+    size_t used = 0;
+    while (!*complete) {
+        if (parser->replay_pos < parser->replay_len) {
+            parser->scan_base = parser->replay_base + (uint32_t)parser->replay_pos;
+            parser->replay_pos += frame_scan_length(parser, parser->replay + parser->replay_pos,
+                                                    parser->replay_len - parser->replay_pos, complete);
+        } else if (used < len) {
+            parser->scan_base = scan_base + (uint32_t)used;
+            used += frame_scan_length(parser, data + used, len - used, complete);
+        } else {
+            break;
+        }
+        if (parser->resync) {
+            frame_resync_payload(parser);
+        }
+    }
+    parser->scan_base = scan_base;
+    return used;
+}
+
+size_t frame_encode_header(frame_mode_t mode, size_t len, uint8_t *out) {
+    if (mode == FRAME_MODE_LENGTH) {
+        out[0] = FRAME_SYNC_1;
+        out[1] = FRAME_SYNC_2;
+        out[2] = len & 0xFF;
+        out[3] = (len >> 8) & 0xFF;
+        out[4] = frame_header_crc(out + 2, 2);
+        return FRAME_LEN_HEADER_SIZE;
+    }
+    out[0] = FRAME_START_MARKER_1;
+    out[1] = FRAME_START_MARKER_2;
+    return 2;
+}
+
+size_t frame_encode_trailer(frame_mode_t mode, const uint8_t *data, size_t len, uint8_t *out) {
+    if (mode == FRAME_MODE_LENGTH) {
+        uint16_t crc = crc16_ccitt(data, len);
+        out[0] = crc & 0xFF;
+        out[1] = crc >> 8;
+        return FRAME_LEN_TRAILER_SIZE;
+    }
+    out[0] = FRAME_END_MARKER_1;
+    out[1] = FRAME_END_MARKER_2;
+    return 2;
+}
+
+uint8_t *frame_parser_write_ptr(frame_parser_t *parser, size_t *contiguous) {
+    uint32_t used = parser->ring_head - parser->ring_tail;
+    uint32_t offset = parser->ring_head & RING_MASK;
+    size_t free_total = FRAME_PARSER_RING_SIZE - used;
+    size_t to_end = FRAME_PARSER_RING_SIZE - offset;
+    
+    *contiguous = free_total < to_end ? free_total : to_end;
+    return parser->ring + offset;
+}
+
+void frame_parser_commit(frame_parser_t *parser, size_t len) {
+    parser->ring_head += len;
+}
+
+size_t frame_parser_write(frame_parser_t *parser, const uint8_t *data, size_t len) {
+    if (!parser || !data) return 0;
+    
+    size_t written = 0;
+    while (written < len) {
+        size_t contiguous;
+        uint8_t *dst = frame_parser_write_ptr(parser, &contiguous);
+        if (contiguous == 0) {
+            break;
+        }
+        size_t chunk = len - written < contiguous ? len - written : contiguous;
+        memcpy(dst, data + written, chunk);
+        frame_parser_commit(parser, chunk);
+        written += chunk;
+    }
+    return written;
+}
+
+int frame_parser_next(frame_parser_t *parser, const uint8_t **frame, size_t *len) {
+    if (!parser || !frame || !len) return 0;
+    
+    while (parser->ring_tail != parser->ring_head || parser->replay_pos < parser->replay_len) {
+        uint32_t offset = parser->ring_tail & RING_MASK;
+        uint32_t available = parser->ring_head - parser->ring_tail;
+        size_t to_end = FRAME_PARSER_RING_SIZE - offset;
+        size_t chunk = available < to_end ? available : to_end;
+        
+        bool complete;
+        parser->scan_base = parser->ring_tail;
+        parser->ring_tail += frame_scan(parser, parser->ring + offset, chunk, &complete);
+        if (complete) {
+            *frame = parser->frame;
+            *len = parser->frame_len;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int frame_parser_feed(frame_parser_t *parser, const uint8_t *data, size_t len,
+                      frame_parser_cb_t cb, void *user_ctx) {
+    if (!parser || !data) return 0;
+    
+    int frames = 0;
+    while (len > 0 || parser->replay_pos < parser->replay_len) {
+        bool complete;
+        size_t used = frame_scan(parser, data, len, &complete);
+        data += used;
+        len -= used;
+        if (complete) {
+            frames++;
+            if (cb) {
+                cb(parser->frame, parser->frame_len, user_ctx);
+            }
+        }
+    }
+    return frames;
+}
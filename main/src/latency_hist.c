@@ -0,0 +1,64 @@
+#include <string.h>
+#include "latency_hist.h"
+
+// Значения меньше 16 мкс хранятся точно, дальше на каждую степень двойки
+// приходится 4 корзины (погрешность не более 25%)
+int latency_hist_bucket(uint32_t value) {
+    if (value < 16) {
+        return value;
+    }
+    int msb = 31 - __builtin_clz(value);
+    int sub = (value >> (msb - 2)) & 0x3;
+    int bucket = 16 + (msb - 4) * 4 + sub;
+    return bucket < LATENCY_HIST_BUCKETS ? bucket : LATENCY_HIST_BUCKETS - 1;
+}
+
+// Верхняя граница значений, попадающих в корзину
+uint32_t latency_hist_bucket_limit(int bucket) {
+    if (bucket < 16) {
+        return bucket;
+    }
+    int msb = (bucket - 16) / 4 + 4;
+    int sub = (bucket - 16) % 4;
+    uint64_t limit = ((uint64_t)(4 + sub + 1) << (msb - 2)) - 1;
+    return limit > UINT32_MAX ? UINT32_MAX : (uint32_t)limit;
+}
+
+void latency_hist_reset(latency_hist_t *hist) {
+    if (!hist) return;
+    memset(hist, 0, sizeof(*hist));
+}
+
+void latency_hist_record(latency_hist_t *hist, int64_t latency_us) {
+    if (!hist) return;
+
+    uint32_t value = 0;
+    if (latency_us > 0) {
+        value = latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+    }
+
+    hist->buckets[latency_hist_bucket(value)]++;
+    hist->count++;
+    if (value > hist->max_us) {
+        hist->max_us = value;
+    }
+}
+
+uint32_t latency_hist_percentile(const latency_hist_t *hist, int percentile) {
+    if (!hist || hist->count == 0) return 0;
+
+    uint64_t target = ((uint64_t)hist->count * percentile + 99) / 100;
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= target) {
+            uint32_t limit = latency_hist_bucket_limit(i);
+            return limit < hist->max_us ? limit : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
@@ -0,0 +1,960 @@
+#include "loopback_sim.h"
+
+#ifdef TEST_BUILD
+
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "drone_message.h"
+#include "drone_msg_view.h"
+#include "drone_typed.h"
+#include "frame_parser.h"
+#include "fragment.h"
+#include "transport.h"
+#include "espnow_handler.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "SIM";
+
+#if CONFIG_BRIDGE_UART_FRAMING_LENGTH
+#define SIM_FRAME_MODE FRAME_MODE_LENGTH
+#else
+#define SIM_FRAME_MODE FRAME_MODE_MARKERS
+#endif
+
+// Модель эфира ESP-NOW (802.11b, длинная преамбула): заголовок PLCP,
+// служебные поля action-кадра с vendor-элементом, SIFS + ACK, DIFS и
+// средняя задержка отсрочки при CWmin = 15
+#define SIM_PLCP_US          192
+#define SIM_MAC_OVERHEAD     43
+#define SIM_ACK_US           (10 + 304)
+#define SIM_CONTENTION_US    (50 + 150)
+
+#define SIM_NO_EVENT INT64_MAX
+
+// Кадры массовой передачи (выгрузка параметров, журналов): тип, не
+// совпадающий с типами сообщений, поэтому класс - прочие данные
+#define SIM_BULK_TYPE 0x10
+
+// Широта дрона i - SIM_LAT_BASE + i * SIM_LAT_STEP с медленным смещением:
+// наземная станция узнает по ней, чьи поля содержит кадр
+#define SIM_LAT_BASE 55.75f
+#define SIM_LAT_STEP 0.01f
+
+// Слоты сборки фрагментов на наземной станции, как в main.c
+#if CONFIG_BRIDGE_FRAGMENT
+#define SIM_FRAGMENT_SLOTS CONFIG_BRIDGE_FRAGMENT_SLOTS
+#else
+#define SIM_FRAGMENT_SLOTS 4
+#endif
+
+typedef struct {
+    uint8_t data[ESPNOW_MAX_DATA_LEN];
+    uint16_t len;
+    uint8_t peer;                  // Дрон-отправитель или дрон-получатель пакета наземной станции
+    bool down;                     // От наземной станции к дрону
+    uint8_t attempt;               // Повторов на уровне MAC
+    int64_t queued_us;             // Постановка в очередь текущего узла
+} sim_packet_t;
+
+// Очередь передачи: планировщик классов трафика, как в espnow_handler.c
+typedef struct {
+    tx_sched_t sched;
+    sim_packet_t *packets;
+} sim_queue_t;
+
+// Дрон или наземная станция: мост прошивки, очередь передачи и часы узла
+typedef struct {
+    bridge_t bridge;
+    uint8_t mac[6];
+    sim_queue_t queue;
+    int64_t agg_deadline;          // Срок контейнера, запущенный мостом
+    int64_t telemetry_deadline;    // Срок придержанной телеметрии
+    int64_t clock_offset_us;       // Часы узла: модельное время + смещение + уход
+    int32_t clock_skew_ppm;
+    uint32_t tx_ok;                // Пакетов узла доставлено (espnow_send_cb)
+    uint32_t tx_fail;              // Пакетов узла не доставлено после всех повторов
+    // Полетный контроллер дрона
+    int64_t next_gen_us;           // Время следующего сообщения полетного контроллера
+    uint8_t msg_id;
+    uint32_t msg_count;
+    int64_t gen_time[256];         // Время формирования по msg_id
+    int64_t uart_rx_time[256];     // Модельное время приема по UART по msg_id
+    int64_t next_bulk_us;          // Время следующего кадра массовой передачи
+    uint16_t bulk_seq;
+    int64_t next_sync_us;          // Время следующего запроса синхронизации
+    int64_t newest_gen_us;         // Формирование последней доставленной телеметрии
+    int64_t age_from_us;           // С какого времени возраст еще не учтен (0 - телеметрии не было)
+} sim_node_t;
+
+typedef struct {
+    const loopback_sim_config_t *config;
+    loopback_sim_result_t *result;
+    sim_node_t *nodes;             // Дроны 0..nodes-1, наземная станция - nodes
+    int64_t now;
+    uint32_t rng;
+    int node;                      // Узел, мост которого сейчас выполняется
+    sim_queue_t relay_queues[LOOPBACK_SIM_MAX_HOPS]; // Очереди ретрансляторов по слоям 1..hops-1
+    int64_t next_tick;             // Очередной вызов bridge_reliable_poll
+    // Пакет в эфире
+    bool air_busy;
+    sim_packet_t air_packet;
+    int air_node;                  // Отправитель: дрон, config->nodes - наземная станция,
+                                   // config->nodes + k - ретранслятор слоя k
+    int64_t air_done;
+    int next_sender;               // Очередной узел при круговом доступе к эфиру
+} sim_t;
+
+// Модель однопоточная: канал передачи и обработчики мостов находят ее и
+// выполняемый узел через эту переменную
+static sim_t *sim_active;
+
+static frame_parser_t sim_parser;
+
+static uint32_t sim_rand(sim_t *sim) {
+    sim->rng ^= sim->rng << 13;
+    sim->rng ^= sim->rng >> 17;
+    sim->rng ^= sim->rng << 5;
+    return sim->rng;
+}
+
+static int64_t uart_time_us(const sim_t *sim, size_t bytes) {
+    // 10 бит на байт: старт, 8 бит данных, стоп
+    return (int64_t)bytes * 10 * 1000000 / sim->config->uart_baud;
+}
+
+static int64_t airtime_us(const sim_t *sim, size_t len) {
+    return SIM_PLCP_US + (int64_t)(len + SIM_MAC_OVERHEAD) * 8 * 1000 / sim->config->phy_rate_kbps +
+           SIM_ACK_US + SIM_CONTENTION_US;
+}
+
+// Показание часов узла в модельное время now_us
+static int64_t sim_clock(const sim_node_t *node, int64_t now_us) {
+    return now_us + node->clock_offset_us + now_us * node->clock_skew_ppm / 1000000;
+}
+
+// Без приоритетов все пакеты попадают в одну вытесняемую очередь
+static transport_tx_status_t sim_enqueue(sim_t *sim, sim_queue_t *queue, const uint8_t *data, size_t len,
+                                         tx_class_t cls, uint8_t peer, bool down) {
+    bool dropped;
+    int slot = tx_sched_push(&queue->sched, sim->config->priority ? cls : TX_CLASS_TELEMETRY, len,
+                             tx_evictable(data, len), sim->now, &dropped);
+    if (slot < 0 || dropped) {
+        sim->result->queue_drops++;
+    }
+    if (slot < 0) {
+        return TRANSPORT_TX_FULL;
+    }
+    sim_packet_t *packet = &queue->packets[slot];
+    memcpy(packet->data, data, len);
+    packet->len = len;
+    packet->peer = peer;
+    packet->down = down;
+    packet->attempt = 0;
+    packet->queued_us = sim->now;
+    return dropped ? TRANSPORT_TX_QUEUED_DROPPED : TRANSPORT_TX_QUEUED;
+}
+
+static void sim_queue_init(sim_queue_t *queue, sim_packet_t *packets, const loopback_sim_config_t *config) {
+    tx_sched_config_t sched_config = config->tx_sched;
+    sched_config.capacity = config->tx_queue_len;
+    tx_sched_init(&queue->sched, &sched_config);
+    queue->packets = packets;
+}
+
+// Канал передачи модели для моста выполняемого узла. Дрон передает только
+// наземной станции, наземная станция - дрону по MAC
+static transport_tx_status_t sim_transport_send(const transport_dest_t *dest, const uint8_t *data, size_t len,
+                                                tx_class_t cls) {
+    sim_t *sim = sim_active;
+    int ground = sim->config->nodes;
+    if (len == 0 || len > ESPNOW_MAX_DATA_LEN) {
+        return TRANSPORT_TX_INVALID;
+    }
+    if (sim->node != ground) {
+        return sim_enqueue(sim, &sim->nodes[sim->node].queue, data, len, cls, (uint8_t)sim->node, false);
+    }
+    if (dest->mode != TRANSPORT_DEST_UNICAST || dest->mac[5] >= ground ||
+        memcmp(dest->mac, sim->nodes[dest->mac[5]].mac, sizeof(dest->mac)) != 0) {
+        return TRANSPORT_TX_INVALID;
+    }
+    return sim_enqueue(sim, &sim->nodes[ground].queue, data, len, cls, dest->mac[5], true);
+}
+
+// Модельное время стоит, пока выполняется мост: место в очереди не
+// освободится, пакет не ставится
+static bool sim_transport_wait_space(TickType_t ticks_to_wait) {
+    return false;
+}
+
+static void sim_transport_get_class_stats(tx_class_t cls, tx_sched_class_stats_t *stats) {
+    *stats = sim_active->nodes[sim_active->node].queue.sched.stats[cls];
+}
+
+// Результаты передачи узла, как в espnow_send_cb. Уровень сигнала в модели
+// не известен
+static bool sim_transport_get_link_stats(const transport_dest_t *dest, peer_link_stats_t *stats) {
+    const sim_node_t *node = &sim_active->nodes[sim_active->node];
+    memset(stats, 0, sizeof(*stats));
+    stats->tx_ok = node->tx_ok;
+    stats->tx_fail = node->tx_fail;
+    return true;
+}
+
+// Мосты используют только передачу: прием модель выполняет сама
+static const transport_t sim_transport = {
+    .name = "sim",
+    .send = sim_transport_send,
+    .wait_space = sim_transport_wait_space,
+    .get_class_stats = sim_transport_get_class_stats,
+    .get_link_stats = sim_transport_get_link_stats,
+};
+
+// Мост узла index, который будет выполняться
+static bridge_t *sim_select(sim_t *sim, int index) {
+    sim->node = index;
+    return &sim->nodes[index].bridge;
+}
+
+static int64_t sim_bridge_now(void *ctx) {
+    return sim_clock(ctx, sim_active->now);
+}
+
+static void sim_aggregate_timer(uint32_t delay_us, void *ctx) {
+    sim_node_t *node = ctx;
+    node->agg_deadline = delay_us ? sim_active->now + delay_us : SIM_NO_EVENT;
+}
+
+static void sim_telemetry_timer(uint32_t delay_us, void *ctx) {
+    sim_node_t *node = ctx;
+    node->telemetry_deadline = delay_us ? sim_active->now + delay_us : SIM_NO_EVENT;
+}
+
+// Возраст последней доставленной телеметрии растет линейно до момента
+// until_us: его интеграл - площадь трапеции
+static void sim_account_age(sim_t *sim, sim_node_t *node, int64_t until_us) {
+    if (!node->age_from_us || until_us <= node->age_from_us) {
+        return;
+    }
+    int64_t age_from = node->age_from_us - node->newest_gen_us;
+    int64_t age_until = until_us - node->newest_gen_us;
+    sim->result->age_area += (uint64_t)((until_us - node->age_from_us) * (age_from + age_until) / 2);
+    sim->result->age_time_us += until_us - node->age_from_us;
+    if (age_until > sim->result->age_max_us) {
+        sim->result->age_max_us = (uint32_t)age_until;
+    }
+    node->age_from_us = until_us;
+}
+
+// Содержимое кадра массовой передачи восстанавливается по номеру на приеме
+static uint8_t sim_bulk_byte(int index, uint16_t seq, size_t offset) {
+    return (uint8_t)(seq * 31 + offset * 7 + index);
+}
+
+// Первые два байта кадра массовой передачи. Служебные первые байты
+// перебираются с кодами операций 0-3: запрос и ответ синхронизации, метка
+// времени, контейнер из одного кадра
+static void sim_bulk_lead(const loopback_sim_config_t *config, uint16_t seq, uint8_t lead[2]) {
+    if (config->bulk_reserved) {
+        lead[0] = (uint8_t)(0xA6 + seq % 10);
+        lead[1] = (uint8_t)(seq / 10 % 4);
+    } else {
+        // Второй байт не совпадает с версиями сжатых форматов
+        lead[0] = SIM_BULK_TYPE;
+        lead[1] = 0;
+    }
+}
+
+static bool sim_is_bulk(const loopback_sim_config_t *config, const uint8_t *frame, size_t len) {
+    return len > 0 && (config->bulk_reserved ? frame[0] >= 0xA6 && frame[0] <= 0xAF : frame[0] == SIM_BULK_TYPE);
+}
+
+// Кадр массовой передачи, выданный в UART наземной станции
+static void sim_ground_bulk(sim_t *sim, int index, const uint8_t *frame, size_t len) {
+    uint16_t seq = frame[2] | frame[3] << 8;
+    uint8_t lead[2];
+    sim_bulk_lead(sim->config, seq, lead);
+    bool valid = len == sim->config->bulk_len && frame[0] == lead[0] && frame[1] == lead[1];
+    for (size_t i = 4; valid && i < len; i++) {
+        valid = frame[i] == sim_bulk_byte(index, seq, i);
+    }
+    if (!valid) {
+        sim->result->corrupted++;
+        return;
+    }
+    sim->result->bulk_delivered++;
+    sim->result->bulk_bytes += len;
+}
+
+// Кадр, выданный мостом в UART. Полетный контроллер наземной станции
+// проверяет кадр и учитывает задержку от формирования на дроне-отправителе
+static int sim_uart_send(const uint8_t *frame, size_t len, void *ctx) {
+    sim_t *sim = sim_active;
+    sim_node_t *ground = &sim->nodes[sim->config->nodes];
+    if (ctx != ground || !ground->bridge.rx_mac || ground->bridge.rx_mac[5] >= sim->config->nodes) {
+        // Дронам в модели передаются только служебные кадры
+        return 0;
+    }
+    int index = ground->bridge.rx_mac[5];
+    sim_node_t *node = &sim->nodes[index];
+
+    if (sim_is_bulk(sim->config, frame, len)) {
+        sim_ground_bulk(sim, index, frame, len);
+        return 0;
+    }
+    // Поля другого дрона (разностный кадр, восстановленный по чужому
+    // ключевому) проверка CRC восстановленного пакета не обнаруживает
+    float lat_steps = (drone_msg_get_latitude(frame) - SIM_LAT_BASE) / SIM_LAT_STEP;
+    if (drone_msg_verify(frame, len) < 0 || (int)(lat_steps + 0.5f) != index) {
+        sim->result->corrupted++;
+        return 0;
+    }
+
+    uint8_t msg_id = drone_msg_get_msg_id(frame);
+    latency_hist_record(&sim->result->one_way_actual, sim->now - node->uart_rx_time[msg_id]);
+    size_t wire_len = len + (SIM_FRAME_MODE == FRAME_MODE_LENGTH ? FRAME_LEN_HEADER_SIZE + FRAME_LEN_TRAILER_SIZE : 4);
+    int64_t latency = sim->now + uart_time_us(sim, wire_len) - node->gen_time[msg_id];
+    latency_hist_record(&sim->result->latency, latency);
+    if (drone_msg_get_msg_type(frame) == MSG_TYPE_COMMAND) {
+        latency_hist_record(&sim->result->command_latency, latency);
+        sim->result->commands_delivered++;
+    } else if (drone_msg_get_msg_type(frame) == MSG_TYPE_ALERT) {
+        latency_hist_record(&sim->result->alert_latency, latency);
+        sim->result->alerts_delivered++;
+    } else {
+        int64_t gen_us = node->gen_time[msg_id];
+        if (!node->age_from_us || gen_us > node->newest_gen_us) {
+            sim_account_age(sim, node, sim->now);
+            node->newest_gen_us = gen_us;
+            node->age_from_us = sim->now;
+        }
+        sim->result->telemetry_delivered++;
+    }
+    sim->result->delivered++;
+    return 0;
+}
+
+// Кадр, собранный разборщиком UART дрона. В режиме маркеров данные,
+// совпадающие с маркером конца, обрывают кадр раньше
+static void sim_bridge_frame(const uint8_t *frame, size_t len, void *user_ctx) {
+    sim_t *sim = user_ctx;
+    sim_node_t *node = &sim->nodes[sim->node];
+    if (len != DRONE_MSG_PACKET_SIZE) {
+        sim->result->misframed++;
+    }
+    bridge_forward(&node->bridge, frame, len, sim_clock(node, sim->now));
+}
+
+// Полетный контроллер дрона формирует сообщение; событие наступает, когда
+// последний байт кадра принят мостом по UART
+static void sim_generate(sim_t *sim, int index) {
+    const loopback_sim_config_t *config = sim->config;
+    sim_node_t *node = &sim->nodes[index];
+    uint8_t wire[DRONE_MSG_PACKET_SIZE + FRAME_LEN_HEADER_SIZE + 2];
+    drone_message_t msg;
+
+    drone_msg_init(&msg);
+    node->msg_count++;
+    if (config->alert_every && node->msg_count % config->alert_every == 0) {
+        msg.msg_type = MSG_TYPE_ALERT;
+        sim->result->alerts++;
+    } else if (config->command_every && node->msg_count % config->command_every == 0) {
+        msg.msg_type = MSG_TYPE_COMMAND;
+        sim->result->commands++;
+    }
+    msg.msg_id = node->msg_id++;
+    msg.timestamp = (uint32_t)(sim->now / 1000);
+    msg.latitude = SIM_LAT_BASE + index * SIM_LAT_STEP + node->msg_count * 1e-6f;
+    msg.longitude = 37.61f + node->msg_count * 1e-6f;
+    msg.altitude = 120.0f + (node->msg_count % 100) * 0.1f;
+    msg.roll = (float)(sim_rand(sim) % 2000) / 100.0f - 10.0f;
+    msg.pitch = (float)(sim_rand(sim) % 2000) / 100.0f - 10.0f;
+    msg.yaw = (float)(node->msg_count % 360);
+    msg.vx = 5.0f;
+    msg.flight_time = (uint16_t)(sim->now / 1000000);
+    msg.satellites = 12;
+    msg.fix_type = 2;
+    // Команды и тревоги несут только поля своего типа
+    drone_typed_clear_unused(&msg);
+
+    size_t len = frame_encode_header(SIM_FRAME_MODE, DRONE_MSG_PACKET_SIZE, wire);
+    len += drone_msg_encode(&msg, wire + len, DRONE_MSG_PACKET_SIZE);
+    len += frame_encode_trailer(SIM_FRAME_MODE, wire + len - DRONE_MSG_PACKET_SIZE, DRONE_MSG_PACKET_SIZE, wire + len);
+
+    node->gen_time[msg.msg_id] = sim->now - uart_time_us(sim, len);
+    node->uart_rx_time[msg.msg_id] = sim->now;
+    sim->result->generated++;
+
+    bridge_t *bridge = sim_select(sim, index);
+    frame_parser_feed(&sim_parser, wire, len, sim_bridge_frame, sim);
+
+    if (config->bridge.rate_ctrl && bridge->telemetry_rate.limit_hz &&
+        (!sim->result->min_limit_hz || bridge->telemetry_rate.limit_hz < sim->result->min_limit_hz)) {
+        sim->result->min_limit_hz = bridge->telemetry_rate.limit_hz;
+    }
+    int64_t shared_us;
+    if (bridge_clock_now(bridge, sim_clock(node, sim->now), &shared_us)) {
+        latency_hist_record(&sim->result->sync_error, llabs(shared_us - sim->now));
+    }
+
+    // Период с небольшим разбросом, чтобы дроны не передавали синхронно
+    int64_t period = 1000000 / config->telemetry_hz;
+    node->next_gen_us = sim->now + period - period / 20 + sim_rand(sim) % (period / 10 + 1);
+}
+
+// Полетный контроллер дрона передает кадр массовой передачи; событие
+// наступает, когда кадр принят мостом по UART
+static void sim_generate_bulk(sim_t *sim, int index) {
+    const loopback_sim_config_t *config = sim->config;
+    sim_node_t *node = &sim->nodes[index];
+    uint8_t frame[FRAGMENT_MAX_FRAME];
+    uint16_t seq = node->bulk_seq++;
+
+    sim_bulk_lead(config, seq, frame);
+    frame[2] = seq & 0xFF;
+    frame[3] = seq >> 8;
+    for (size_t i = 4; i < config->bulk_len; i++) {
+        frame[i] = sim_bulk_byte(index, seq, i);
+    }
+    sim->result->bulk_frames++;
+
+    bridge_forward(sim_select(sim, index), frame, config->bulk_len, sim_clock(node, sim->now));
+    node->next_bulk_us = sim->now + 1000000 / config->bulk_hz;
+}
+
+// Слой отправителя: 0 - наземная станция, hops - дроны
+static int sim_layer(const sim_t *sim, int sender) {
+    const loopback_sim_config_t *config = sim->config;
+    if (sender < config->nodes) {
+        return config->hops;
+    }
+    return sender - config->nodes;
+}
+
+// Вероятность потери пакета: канал дрона во время ухудшения - в обе стороны
+static uint32_t sim_loss_permille(const sim_t *sim, const sim_packet_t *packet) {
+    const loopback_sim_config_t *config = sim->config;
+    if (packet->peer < config->fade_nodes && sim->now >= (int64_t)config->fade_start_ms * 1000 &&
+        sim->now < (int64_t)config->fade_end_ms * 1000) {
+        return config->fade_loss_permille;
+    }
+    return config->loss_permille;
+}
+
+static void sim_deliver(sim_t *sim) {
+    const loopback_sim_config_t *config = sim->config;
+    sim->air_busy = false;
+    bool lost = sim_rand(sim) % 1000 < sim_loss_permille(sim, &sim->air_packet);
+    if (lost && sim->air_packet.attempt < config->mac_retries) {
+        // Повтор на уровне MAC: пакет снова занимает эфир
+        int64_t airtime = airtime_us(sim, sim->air_packet.len);
+        sim->air_packet.attempt++;
+        sim->air_busy = true;
+        sim->air_done = sim->now + airtime;
+        sim->result->airtime_us += airtime;
+        sim->result->mac_retries++;
+        return;
+    }
+    if (sim->air_node <= config->nodes) {
+        // Результат передачи узла, как в espnow_send_cb
+        sim_node_t *sender = &sim->nodes[sim->air_node];
+        if (lost) {
+            sender->tx_fail++;
+            if (sim->air_node < config->nodes) {
+                sim->result->send_failed++;
+            }
+        } else {
+            sender->tx_ok++;
+        }
+    }
+    if (lost) {
+        sim->result->air_losses++;
+        return;
+    }
+
+    const sim_packet_t *packet = &sim->air_packet;
+    latency_hist_record(&sim->result->hop_latency, sim->now - packet->queued_us);
+    int layer = sim_layer(sim, sim->air_node) + (packet->down ? 1 : -1);
+    if (layer > 0 && layer < config->hops) {
+        // Ретранслятор пересылает пакет дальше по цепочке без разбора
+        if (sim_enqueue(sim, &sim->relay_queues[layer], packet->data, packet->len,
+                        tx_class_of(packet->data, packet->len), packet->peer, packet->down) != TRANSPORT_TX_FULL) {
+            sim->result->relayed++;
+        }
+        return;
+    }
+
+    // Получатель видит отправителя пакета, а не последний ретранслятор
+    int receiver = packet->down ? packet->peer : config->nodes;
+    int sender = packet->down ? config->nodes : packet->peer;
+    sim_node_t *node = &sim->nodes[receiver];
+    static transport_packet_t rx;
+    memcpy(rx.src_mac, sim->nodes[sender].mac, sizeof(rx.src_mac));
+    rx.rssi = 0;
+    rx.len = packet->len;
+    rx.rx_time = sim_clock(node, sim->now);
+    memcpy(rx.data, packet->data, packet->len);
+    bridge_receive(sim_select(sim, receiver), &rx);
+}
+
+static sim_queue_t *sim_sender_queue(sim_t *sim, int sender) {
+    if (sender <= sim->config->nodes) {
+        return &sim->nodes[sender].queue;
+    }
+    return &sim->relay_queues[sender - sim->config->nodes];
+}
+
+// Если эфир свободен, передает пакет следующего по кругу узла с непустой
+// очередью. Наземная станция участвует в очереди доступа под номером nodes,
+// ретрансляторы - под номерами nodes + слой
+static void sim_start_tx(sim_t *sim) {
+    if (sim->air_busy) {
+        return;
+    }
+    const loopback_sim_config_t *config = sim->config;
+    int senders = config->nodes + config->hops;
+    for (int i = 0; i < senders; i++) {
+        int index = (sim->next_sender + i) % senders;
+        sim_queue_t *queue = sim_sender_queue(sim, index);
+        if (tx_sched_peek(&queue->sched) < 0) {
+            continue;
+        }
+
+        int slot = tx_sched_pop(&queue->sched, sim->now);
+        sim->air_packet = queue->packets[slot];
+        tx_sched_release(&queue->sched, slot);
+
+        int64_t airtime = airtime_us(sim, sim->air_packet.len);
+        sim->air_busy = true;
+        sim->air_node = index;
+        sim->air_done = sim->now + airtime;
+        sim->next_sender = (index + 1) % senders;
+
+        sim->result->packets++;
+        sim->result->air_bytes += sim->air_packet.len;
+        sim->result->airtime_us += airtime;
+        return;
+    }
+}
+
+void loopback_sim_default_config(loopback_sim_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    config->nodes = CONFIG_BRIDGE_SIM_NODES;
+    config->duration_ms = CONFIG_BRIDGE_SIM_DURATION_MS;
+    config->telemetry_hz = CONFIG_BRIDGE_SIM_TELEMETRY_HZ;
+    config->command_every = 20;
+    config->alert_every = 50;
+#if CONFIG_BRIDGE_UART_HIGH_SPEED
+    config->uart_baud = CONFIG_BRIDGE_UART_TARGET_BAUD;
+#else
+    config->uart_baud = CONFIG_BRIDGE_UART_BAUD_RATE;
+#endif
+    config->phy_rate_kbps = CONFIG_BRIDGE_SIM_PHY_RATE_KBPS;
+    config->loss_permille = CONFIG_BRIDGE_SIM_LOSS_PERMILLE;
+    config->hops = 1;
+    config->tx_queue_len = ESPNOW_TX_QUEUE_LEN;
+    config->priority = true;
+    config->tx_sched.reserve = CONFIG_BRIDGE_ESPNOW_URGENT_RESERVE;
+    config->tx_sched.weight[TX_CLASS_TELEMETRY] = CONFIG_BRIDGE_TX_WEIGHT_TELEMETRY;
+    config->tx_sched.weight[TX_CLASS_BULK] = CONFIG_BRIDGE_TX_WEIGHT_BULK;
+    bridge_default_config(&config->bridge);
+    // Синхронизацию и фрагментацию включают параметры модели; в модели
+    // метку времени несет каждое сообщение
+    config->bridge.timesync = false;
+    config->bridge.timesync_reference = false;
+    config->bridge.fragment = false;
+    config->bridge.fleet = NULL;
+    config->bridge.stamp_every = 1;
+#if CONFIG_BRIDGE_TIMESYNC
+    config->sync_interval_ms = CONFIG_BRIDGE_TIMESYNC_INTERVAL_MS;
+#endif
+    config->seed = 0x5EED1234;
+}
+
+// Мост узла index с каналом модели. Наземная станция - эталон времени и
+// собирает фрагменты, дроны только разбивают кадры
+static void sim_bridge_init(sim_t *sim, int index, fragment_slot_t *fragment_slots) {
+    const loopback_sim_config_t *config = sim->config;
+    sim_node_t *node = &sim->nodes[index];
+    int ground = config->nodes;
+    bool is_ground = index == ground;
+
+    bridge_config_t bridge_config = config->bridge;
+    bridge_config.timesync = config->sync_interval_ms > 0;
+    bridge_config.timesync_reference = is_ground;
+    bridge_config.timesync_holdover_us = (int64_t)config->sync_interval_ms * 1000 * 30;
+    bridge_config.fragment = config->bulk_len > 0;
+    bridge_config.fragment_slots = is_ground ? fragment_slots : NULL;
+    bridge_config.fragment_slot_count = is_ground ? SIM_FRAGMENT_SLOTS : 0;
+    bridge_config.fleet = NULL;
+
+    // Кадры дрона уходят наземной станции, кадры наземной станции - первому дрону
+    transport_dest_t route = {.mode = TRANSPORT_DEST_UNICAST};
+    memcpy(route.mac, sim->nodes[is_ground ? 0 : ground].mac, sizeof(route.mac));
+    const bridge_hooks_t hooks = {
+        .now = sim_bridge_now,
+        .uart_send = sim_uart_send,
+        .aggregate_timer = sim_aggregate_timer,
+        .telemetry_timer = sim_telemetry_timer,
+        .ctx = node,
+    };
+    sim_select(sim, index);
+    bridge_init(&node->bridge, &bridge_config, &sim_transport, &route, &hooks);
+}
+
+void loopback_sim_run(const loopback_sim_config_t *config, loopback_sim_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    if (!config->nodes || config->nodes > LOOPBACK_SIM_MAX_NODES || !config->telemetry_hz ||
+        !config->tx_queue_len || config->tx_queue_len > TX_SCHED_MAX_SLOTS ||
+        !config->uart_baud || !config->phy_rate_kbps || !config->hops || config->hops > LOOPBACK_SIM_MAX_HOPS ||
+        config->bulk_len > FRAGMENT_MAX_FRAME || (config->bulk_len && (config->bulk_len < 4 || !config->bulk_hz))) {
+        ESP_LOGE(TAG, "Недопустимые параметры моделирования");
+        return;
+    }
+
+    sim_t sim = {
+        .config = config,
+        .result = result,
+        .rng = config->seed ? config->seed : 1,
+    };
+    int ground = config->nodes;
+    sim.nodes = calloc(config->nodes + 1, sizeof(sim_node_t));
+    sim_packet_t *queues = calloc((config->nodes + config->hops) * config->tx_queue_len, sizeof(sim_packet_t));
+    fragment_slot_t *fragment_slots = calloc(SIM_FRAGMENT_SLOTS, sizeof(fragment_slot_t));
+    if (!sim.nodes || !queues || !fragment_slots) {
+        ESP_LOGE(TAG, "Недостаточно памяти для моделирования");
+        free(sim.nodes);
+        free(queues);
+        free(fragment_slots);
+        return;
+    }
+    sim_active = &sim;
+    int64_t sync_period = (int64_t)config->sync_interval_ms * 1000;
+
+    frame_parser_init(&sim_parser, SIM_FRAME_MODE);
+    for (int i = 0; i <= ground; i++) {
+        sim_node_t *node = &sim.nodes[i];
+        const uint8_t mac[6] = {0x02, 0, 0, 0, 0, (uint8_t)i};
+        memcpy(node->mac, mac, sizeof(mac));
+        sim_queue_init(&node->queue, queues + i * config->tx_queue_len, config);
+        node->agg_deadline = SIM_NO_EVENT;
+        node->telemetry_deadline = SIM_NO_EVENT;
+        node->next_gen_us = SIM_NO_EVENT;
+        node->next_bulk_us = SIM_NO_EVENT;
+        node->next_sync_us = SIM_NO_EVENT;
+        if (i == ground) {
+            continue;
+        }
+        node->next_gen_us = sim_rand(&sim) % (1000000 / config->telemetry_hz);
+        if (config->bulk_len) {
+            node->next_bulk_us = sim_rand(&sim) % (1000000 / config->bulk_hz);
+        }
+        if (sync_period) {
+            node->next_sync_us = sim_rand(&sim) % sync_period;
+        }
+        node->clock_offset_us = (int64_t)config->clock_offset_us * (i + 1);
+        node->clock_skew_ppm = config->nodes > 1 ?
+            config->clock_skew_ppm * (2 * i - (config->nodes - 1)) / (config->nodes - 1) : config->clock_skew_ppm;
+    }
+    for (int i = 0; i <= ground; i++) {
+        sim_bridge_init(&sim, i, fragment_slots);
+    }
+    for (int layer = 1; layer < config->hops; layer++) {
+        sim_queue_init(&sim.relay_queues[layer], queues + (config->nodes + layer) * config->tx_queue_len, config);
+    }
+
+    // Таймер повторов, как reliable_poll_cb в main.c
+    int64_t tick_period = config->bridge.reliable_config.rto_min_us / 2;
+    if (tick_period < 1000) {
+        tick_period = 1000;
+    }
+    sim.next_tick = config->bridge.reliable ? tick_period : SIM_NO_EVENT;
+
+    const int64_t end = (int64_t)config->duration_ms * 1000;
+    uint32_t events = 0;
+    while (1) {
+        // Длительное моделирование не должно блокировать задачу IDLE
+        if (++events % 4096 == 0) {
+            vTaskDelay(1);
+        }
+
+        // Ближайшее событие: конец передачи в эфире, срок контейнера, новое
+        // сообщение или таймер повторов, пока есть неподтвержденные кадры
+        int64_t next = sim.air_busy ? sim.air_done : SIM_NO_EVENT;
+        bool pending = false;
+        for (int i = 0; i <= ground; i++) {
+            pending |= reliable_pending(&sim.nodes[i].bridge.link) > 0;
+        }
+        if (sim.next_tick < next && (sim.next_tick < end || pending)) {
+            next = sim.next_tick;
+        }
+        for (int i = 0; i <= ground; i++) {
+            const sim_node_t *node = &sim.nodes[i];
+            if (node->agg_deadline < next) {
+                next = node->agg_deadline;
+            }
+            if (node->telemetry_deadline < next) {
+                next = node->telemetry_deadline;
+            }
+            if (node->next_gen_us < end && node->next_gen_us < next) {
+                next = node->next_gen_us;
+            }
+            if (node->next_bulk_us < end && node->next_bulk_us < next) {
+                next = node->next_bulk_us;
+            }
+            if (node->next_sync_us < end && node->next_sync_us < next) {
+                next = node->next_sync_us;
+            }
+        }
+        if (next == SIM_NO_EVENT) {
+            break;
+        }
+        sim.now = next;
+
+        if (sim.air_busy && sim.air_done == sim.now) {
+            sim_deliver(&sim);
+        }
+        if (sim.next_tick == sim.now) {
+            for (int i = 0; i <= ground; i++) {
+                bridge_reliable_poll(sim_select(&sim, i));
+            }
+            sim.next_tick += tick_period;
+        }
+        for (int i = 0; i <= ground; i++) {
+            sim_node_t *node = &sim.nodes[i];
+            if (node->agg_deadline == sim.now) {
+                bridge_aggregate_deadline(sim_select(&sim, i));
+            }
+            if (node->telemetry_deadline == sim.now) {
+                node->telemetry_deadline = SIM_NO_EVENT;
+                bridge_telemetry_deadline(sim_select(&sim, i));
+            }
+            if (node->next_gen_us == sim.now && node->next_gen_us < end) {
+                sim_generate(&sim, i);
+            }
+            if (node->next_bulk_us == sim.now && node->next_bulk_us < end) {
+                sim_generate_bulk(&sim, i);
+            }
+            if (node->next_sync_us == sim.now && node->next_sync_us < end) {
+                // Запрос синхронизации, как clock_sync_ping_cb в main.c
+                bridge_clock_sync_ping(sim_select(&sim, i));
+                node->next_sync_us = sim.now + sync_period;
+            }
+        }
+        sim_start_tx(&sim);
+    }
+
+    for (int i = 0; i <= ground; i++) {
+        const bridge_t *bridge = &sim.nodes[i].bridge;
+        result->retransmits += bridge->link.stats.retransmits;
+        result->decode_errors += bridge->stats.decode_errors;
+        result->decimated += bridge->stats.decimated;
+        if (i < ground) {
+            sim_account_age(&sim, &sim.nodes[i], end);
+        }
+    }
+    bridge_t *ground_bridge = &sim.nodes[ground].bridge;
+    result->one_way = ground_bridge->stats.one_way_us;
+    result->stamped = ground_bridge->stats.one_way_us.count;
+    // Кадры, не собранные к концу моделирования, тоже потеряны
+    fragment_expire(&ground_bridge->rx_fragments, SIM_NO_EVENT);
+    result->bulk_dropped = ground_bridge->rx_fragments.stats.timeouts + ground_bridge->rx_fragments.stats.evicted;
+
+    sim_active = NULL;
+    free(fragment_slots);
+    free(queues);
+    free(sim.nodes);
+}
+
+void loopback_sim_report(const loopback_sim_config_t *config, const loopback_sim_result_t *result) {
+    uint32_t duration_ms = config->duration_ms ? config->duration_ms : 1;
+    uint32_t received_packets = result->packets - result->air_losses;
+    uint32_t frames_per_packet_x100 = received_packets ?
+        (uint32_t)((uint64_t)(result->delivered + result->decode_errors) * 100 / received_packets) : 0;
+    const bridge_config_t *bridge = &config->bridge;
+    // Метки и модель дают разные сообщения, поэтому сравниваются распределения
+    uint32_t one_way_p50 = latency_hist_percentile(&result->one_way, 50);
+    uint32_t one_way_p99 = latency_hist_percentile(&result->one_way, 99);
+    uint32_t actual_p50 = latency_hist_percentile(&result->one_way_actual, 50);
+    uint32_t actual_p99 = latency_hist_percentile(&result->one_way_actual, 99);
+
+    ESP_LOGI(TAG, "SIM {\"nodes\":%u,\"hops\":%u,\"telemetry_hz\":%" PRIu32 ",\"loss_permille\":%" PRIu32
+             ",\"compact\":%d,\"typed\":%d,\"reliable\":%d,\"priority\":%d,\"aggregation_us\":%" PRIu32 ",\"generated\":%" PRIu32 ",\"delivered\":%" PRIu32
+             ",\"queue_drops\":%" PRIu32 ",\"air_losses\":%" PRIu32 ",\"decode_errors\":%" PRIu32 ",\"corrupted\":%" PRIu32 ",\"misframed\":%" PRIu32
+             ",\"packets\":%" PRIu32 ",\"frames_per_packet_x100\":%" PRIu32 ",\"air_bytes_s\":%" PRIu32
+             ",\"airtime_pct\":%" PRIu32 ",\"p50_us\":%" PRIu32 ",\"p99_us\":%" PRIu32 ",\"max_us\":%" PRIu32
+             ",\"commands\":%" PRIu32 ",\"commands_delivered\":%" PRIu32 ",\"retransmits\":%" PRIu32
+             ",\"cmd_p99_us\":%" PRIu32 ",\"cmd_max_us\":%" PRIu32
+             ",\"alerts\":%" PRIu32 ",\"alerts_delivered\":%" PRIu32
+             ",\"alert_p50_us\":%" PRIu32 ",\"alert_p99_us\":%" PRIu32
+             ",\"relayed\":%" PRIu32 ",\"hop_p50_us\":%" PRIu32 ",\"delivered_bytes_s\":%" PRIu32
+             ",\"bulk_len\":%u,\"bulk_reserved\":%d,\"bulk_frames\":%" PRIu32 ",\"bulk_delivered\":%" PRIu32 ",\"bulk_dropped\":%" PRIu32
+             ",\"bulk_kb_s\":%" PRIu32 ",\"sync_ms\":%" PRIu32 ",\"skew_ppm\":%" PRId32 ",\"stamped\":%" PRIu32
+             ",\"sync_err_p50_us\":%" PRIu32 ",\"sync_err_p99_us\":%" PRIu32 ",\"sync_err_max_us\":%" PRIu32
+             ",\"one_way_p50_us\":%" PRIu32 ",\"one_way_p99_us\":%" PRIu32
+             ",\"one_way_err_p50_us\":%" PRIu32 ",\"one_way_err_p99_us\":%" PRIu32
+             ",\"mac_retries\":%u,\"fade_nodes\":%u,\"fade_loss_permille\":%" PRIu32 ",\"rate_ctrl\":%d"
+             ",\"decimated\":%" PRIu32 ",\"min_limit_hz\":%" PRIu32 ",\"retries\":%" PRIu32 ",\"send_failed\":%" PRIu32
+             ",\"telemetry_hz_delivered\":%" PRIu32 ",\"age_avg_us\":%" PRIu32 ",\"age_max_us\":%" PRIu32 "}",
+             config->nodes, config->hops, config->telemetry_hz, config->loss_permille,
+             bridge->compact, bridge->typed, bridge->reliable, config->priority,
+             bridge->aggregation ? bridge->aggregation_deadline_us : 0, result->generated, result->delivered,
+             result->queue_drops, result->air_losses, result->decode_errors, result->corrupted, result->misframed,
+             result->packets, frames_per_packet_x100,
+             (uint32_t)(result->air_bytes * 1000 / duration_ms),
+             (uint32_t)(result->airtime_us / 10 / duration_ms),
+             latency_hist_percentile(&result->latency, 50),
+             latency_hist_percentile(&result->latency, 99),
+             result->latency.max_us,
+             result->commands, result->commands_delivered, result->retransmits,
+             latency_hist_percentile(&result->command_latency, 99),
+             result->command_latency.max_us,
+             result->alerts, result->alerts_delivered,
+             latency_hist_percentile(&result->alert_latency, 50),
+             latency_hist_percentile(&result->alert_latency, 99),
+             result->relayed, latency_hist_percentile(&result->hop_latency, 50),
+             (uint32_t)((uint64_t)result->delivered * DRONE_MSG_PACKET_SIZE * 1000 / duration_ms),
+             config->bulk_len, config->bulk_reserved, result->bulk_frames, result->bulk_delivered, result->bulk_dropped,
+             (uint32_t)(result->bulk_bytes / duration_ms),
+             config->sync_interval_ms, config->clock_skew_ppm, result->stamped,
+             latency_hist_percentile(&result->sync_error, 50),
+             latency_hist_percentile(&result->sync_error, 99),
+             result->sync_error.max_us,
+             one_way_p50, one_way_p99,
+             one_way_p50 > actual_p50 ? one_way_p50 - actual_p50 : actual_p50 - one_way_p50,
+             one_way_p99 > actual_p99 ? one_way_p99 - actual_p99 : actual_p99 - one_way_p99,
+             config->mac_retries, config->fade_nodes, config->fade_loss_permille, bridge->rate_ctrl,
+             result->decimated, result->min_limit_hz, result->mac_retries, result->send_failed,
+             (uint32_t)((uint64_t)result->telemetry_delivered * 1000 / duration_ms),
+             (uint32_t)(result->age_time_us ? result->age_area / result->age_time_us : 0),
+             result->age_max_us);
+}
+
+// Выполняет сценарий и выводит результат. Сценарий не пройден, если
+// ничего не доставлено или полетный контроллер получил поврежденный кадр,
+// который не объясняется ошибкой разбора UART на дроне
+static bool sim_scenario(const loopback_sim_config_t *config, loopback_sim_result_t *result) {
+    loopback_sim_run(config, result);
+    loopback_sim_report(config, result);
+    return result->delivered + result->bulk_delivered > 0 && result->corrupted <= result->misframed;
+}
+
+bool loopback_sim_run_suite(void) {
+    static loopback_sim_config_t config;
+    static loopback_sim_result_t result;
+    bool passed = true;
+
+    loopback_sim_default_config(&config);
+    passed &= sim_scenario(&config, &result);
+
+    // Агрегация кадров в контейнеры: задержка телеметрии до срока контейнера
+    config.bridge.aggregation = true;
+    passed &= sim_scenario(&config, &result);
+    config.bridge.aggregation = false;
+
+    // Доставка команд при сильных потерях без подтверждений и с ними
+    config.loss_permille = 200;
+    for (int reliable = 0; reliable <= 1; reliable++) {
+        config.bridge.reliable = reliable;
+        passed &= sim_scenario(&config, &result);
+    }
+
+    // Задержка тревог при перегрузке эфира телеметрией: одна очередь и классы трафика
+    loopback_sim_default_config(&config);
+    config.nodes = LOOPBACK_SIM_MAX_NODES;
+    config.telemetry_hz = 150;
+    config.bridge.aggregation = false;
+    config.bridge.rate_ctrl = false;
+    for (int priority = 0; priority <= 1; priority++) {
+        config.priority = priority;
+        passed &= sim_scenario(&config, &result);
+    }
+
+    // Команды и тревоги в полном формате и в формате своего типа: каждый
+    // кадр без агрегации уходит отдельным пакетом
+    loopback_sim_default_config(&config);
+    config.nodes = 8;
+    config.bridge.aggregation = false;
+    for (int typed = 0; typed <= 1; typed++) {
+        config.bridge.typed = typed;
+        passed &= sim_scenario(&config, &result);
+    }
+
+    // Компактный формат телеметрии восьми дронов: разностные кадры каждого
+    // дрона декодируются по его собственному ключевому кадру
+    loopback_sim_default_config(&config);
+    config.nodes = 8;
+    config.bridge.compact = true;
+    passed &= sim_scenario(&config, &result);
+
+    // Задержка на прыжок и пропускная способность цепочки ретрансляторов ESP-MESH
+    loopback_sim_default_config(&config);
+    for (uint8_t hops = 1; hops <= LOOPBACK_SIM_MAX_HOPS; hops++) {
+        config.hops = hops;
+        passed &= sim_scenario(&config, &result);
+    }
+
+    // Массовая передача кадрами по 1 КБ: фрагментация и сборка при потерях
+    loopback_sim_default_config(&config);
+    config.nodes = 1;
+    config.bulk_len = FRAGMENT_MAX_FRAME;
+    config.bulk_hz = 20;
+    static const uint16_t bulk_losses[] = {0, 50, 200};
+    for (size_t i = 0; i < sizeof(bulk_losses) / sizeof(bulk_losses[0]); i++) {
+        config.loss_permille = bulk_losses[i];
+        passed &= sim_scenario(&config, &result);
+    }
+
+    // Кадры полетного контроллера с первыми байтами служебных пакетов
+    // доходят до UART без изменений: короткие - в контейнере из одного
+    // кадра, с метками времени, агрегацией и подтверждением, длинные -
+    // фрагментами
+    config.loss_permille = 0;
+    config.bulk_reserved = true;
+    config.bulk_hz = 50;
+    config.sync_interval_ms = 1000;
+    config.bridge.reliable = true;
+    static const uint16_t reserved_lens[] = {64, 64, FRAGMENT_MAX_FRAME};
+    for (size_t i = 0; i < sizeof(reserved_lens) / sizeof(reserved_lens[0]); i++) {
+        config.bulk_len = reserved_lens[i];
+        config.bridge.aggregation = i == 1;
+        passed &= sim_scenario(&config, &result);
+        passed &= result.bulk_delivered == result.bulk_frames && result.corrupted == 0;
+    }
+
+    // Точность синхронизации часов: уход часов дронов и потери в эфире
+    loopback_sim_default_config(&config);
+    config.sync_interval_ms = 1000;
+    config.clock_offset_us = 1234567;
+    static const int32_t clock_skews[] = {0, 20, 100};
+    for (size_t i = 0; i < sizeof(clock_skews) / sizeof(clock_skews[0]); i++) {
+        config.clock_skew_ppm = clock_skews[i];
+        passed &= sim_scenario(&config, &result);
+    }
+    config.loss_permille = 200;
+    passed &= sim_scenario(&config, &result);
+
+    // Телеметрия при ухудшении канала: у двух дронов из восьми на 10 с
+    // пропадает большая часть пакетов, предел частоты по качеству канала
+    loopback_sim_default_config(&config);
+    config.nodes = 8;
+    config.duration_ms = 30000;
+    config.mac_retries = 4;
+    config.fade_nodes = 2;
+    config.fade_loss_permille = 800;
+    config.fade_start_ms = 10000;
+    config.fade_end_ms = 20000;
+    for (int rate_ctrl = 0; rate_ctrl <= 1; rate_ctrl++) {
+        config.bridge.rate_ctrl = rate_ctrl;
+        passed &= sim_scenario(&config, &result);
+    }
+    // С пределом в компактном формате: разностные кадры при пониженной частоте
+    config.bridge.compact = true;
+    passed &= sim_scenario(&config, &result);
+    return passed;
+}
+
+#endif /* TEST_BUILD */
@@ -1,22 +1,38 @@
 #include "espnow_handler.h"
+#include "transport.h"
 #include "uart_handler.h"
+#include "bridge.h"
 #include "drone_message.h"
+#include "latency_hist.h"
+#include "fleet_table.h"
+#include "fragment.h"
+#include "flightrec.h"
+#include "dlog.h"
+#include "bench.h"
+#include "loopback_sim.h"
+#include "metrics.h"
+#include "bridge_tasks.h"
+#include "spsc_ring.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "esp_wifi.h"
+#include "esp_mac.h"
+#include "esp_random.h"
 #include "nvs_flash.h"
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <inttypes.h>
 #include "esp_timer.h"
+#include "sdkconfig.h"
 
 #define TAG "MAIN"
-#define ESPNOW_MAX_DATA_LEN 250
 
-// MAC ESP8266
-static const uint8_t PEER_MAC[6] = {0x40, 0x91, 0x51, 0x52, 0xad, 0x24};
-// MAC ESP32: f4:65:0b:46:d9:e0
+// Канал передачи между мостами (CONFIG_BRIDGE_TRANSPORT)
+static const transport_t *transport;
 
 void print_mac() {
     uint8_t mac[6] = {0};
@@ -25,18 +41,705 @@ void print_mac() {
              mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 }
 
-void uart_to_espnow_task(void *arg) {
-    uint8_t uart_buffer[ESPNOW_MAX_DATA_LEN];
+// Регистрирует узлы из CONFIG_BRIDGE_PEER_MACS и выбирает получателя кадров.
+// Первый узел списка - получатель при адресации одному узлу
+static void peers_init(transport_dest_t *route) {
+    const char *p = CONFIG_BRIDGE_PEER_MACS;
+    int configured = 0;
+
+    while (*p) {
+        uint8_t mac[6];
+        int consumed = 0;
+        if (sscanf(p, " %hhx:%hhx:%hhx:%hhx:%hhx:%hhx%n",
+                   &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5], &consumed) != 6 || consumed == 0) {
+            ESP_LOGE(TAG, "Invalid MAC in peer list: \"%s\"", p);
+            break;
+        }
+        ESP_ERROR_CHECK(transport->add_peer(mac, PEER_GROUP_ALL));
+        if (configured++ == 0) {
+            memcpy(route->mac, mac, sizeof(mac));
+        }
+        p += consumed;
+        while (*p == ',' || *p == ' ') {
+            p++;
+        }
+    }
+
+#if CONFIG_BRIDGE_ROUTE_ALL_PEERS
+    route->mode = TRANSPORT_DEST_GROUP;
+    route->groups = PEER_GROUP_ALL;
+#elif CONFIG_BRIDGE_ROUTE_BROADCAST
+    route->mode = TRANSPORT_DEST_BROADCAST;
+#else
+    route->mode = TRANSPORT_DEST_UNICAST;
+    if (configured == 0) {
+        ESP_LOGW(TAG, "No peers configured, falling back to broadcast");
+        route->mode = TRANSPORT_DEST_BROADCAST;
+    }
+#endif
+    if (route->mode == TRANSPORT_DEST_BROADCAST) {
+        ESP_ERROR_CHECK(transport->add_peer(PEER_BROADCAST_MAC, 0));
+    }
+    ESP_LOGI(TAG, "%d peers configured, route mode %d", configured, route->mode);
+}
+
+#if CONFIG_BRIDGE_LATENCY_STATS
+// Задержка от приема кадра по UART до вызова esp_now_send
+static latency_hist_t uart_to_espnow_latency;
+
+// Время ожидания в очереди передачи по классам трафика с момента запуска
+static void report_queue_delay(void) {
+    static const char *const class_names[TX_CLASS_COUNT] = {"alert", "control", "telemetry", "bulk"};
+    // Статический снимок: гистограмма не помещается в стек задачи
+    static tx_sched_class_stats_t stats;
+    for (int cls = 0; cls < TX_CLASS_COUNT; cls++) {
+        transport->get_class_stats(cls, &stats);
+        if (stats.queue_delay_us.count == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "TX queue delay %s over %" PRIu32 " packets: p50=%" PRIu32 " us, p99=%" PRIu32 " us, max=%" PRIu32 " us, dropped=%" PRIu32,
+                 class_names[cls], stats.queue_delay_us.count,
+                 latency_hist_percentile(&stats.queue_delay_us, 50),
+                 latency_hist_percentile(&stats.queue_delay_us, 99),
+                 stats.queue_delay_us.max_us, stats.dropped);
+    }
+}
+
+static void report_latency(int64_t rx_time) {
+    latency_hist_record(&uart_to_espnow_latency, esp_timer_get_time() - rx_time);
+    if (uart_to_espnow_latency.count >= CONFIG_BRIDGE_LATENCY_REPORT_INTERVAL) {
+        ESP_LOGI(TAG, "UART->ESPNOW latency over %" PRIu32 " frames: p50=%" PRIu32 " us, p99=%" PRIu32 " us, max=%" PRIu32 " us",
+                 uart_to_espnow_latency.count,
+                 latency_hist_percentile(&uart_to_espnow_latency, 50),
+                 latency_hist_percentile(&uart_to_espnow_latency, 99),
+                 uart_to_espnow_latency.max_us);
+        latency_hist_reset(&uart_to_espnow_latency);
+        report_queue_delay();
+    }
+}
+#endif
+// Путь данных моста между UART и каналом передачи
+static bridge_t bridge;
+
+#if CONFIG_BRIDGE_FRAGMENT
+// Слоты сборки кадров из фрагментов. Доступ только из espnow_to_uart_task
+static fragment_slot_t rx_fragment_slots[CONFIG_BRIDGE_FRAGMENT_SLOTS];
+#endif
+
+static int64_t bridge_clock(void *ctx) {
+    return esp_timer_get_time();
+}
+
+static int bridge_uart_send(const uint8_t *frame, size_t len, void *ctx) {
+    return uart_send_data(frame, len);
+}
+
+#if CONFIG_BRIDGE_AGGREGATION
+static esp_timer_handle_t aggregate_timer = NULL;
+// Срок контейнера истек, контейнер отправляет стадия пересылки
+static bool aggregate_due;
+static void aggregate_deadline_cb(void *arg);
+#endif
+
+static void bridge_aggregate_timer(uint32_t delay_us, void *ctx) {
+#if CONFIG_BRIDGE_AGGREGATION
+    esp_timer_stop(aggregate_timer);
+    if (delay_us) {
+        esp_timer_start_once(aggregate_timer, delay_us);
+    }
+#endif
+}
+
+#if CONFIG_BRIDGE_RATE_CTRL
+static esp_timer_handle_t telemetry_timer = NULL;
+// Срок придержанной телеметрии истек, ее передает стадия пересылки
+static bool telemetry_due;
+static void telemetry_deadline_cb(void *arg);
+#endif
+
+static void bridge_telemetry_timer(uint32_t delay_us, void *ctx) {
+#if CONFIG_BRIDGE_RATE_CTRL
+    esp_timer_stop(telemetry_timer);
+    if (delay_us) {
+        esp_timer_start_once(telemetry_timer, delay_us);
+    }
+#endif
+}
+
+#if CONFIG_BRIDGE_RELIABLE
+static void reliable_poll_cb(void *arg) {
+    bridge_reliable_poll(&bridge);
+}
+#endif
+
+#if CONFIG_BRIDGE_TIMESYNC && !CONFIG_BRIDGE_TIMESYNC_REFERENCE
+static void clock_sync_ping_cb(void *arg) {
+    bridge_clock_sync_ping(&bridge);
+}
+#endif
+
+#if CONFIG_BRIDGE_FLIGHTREC
+#define FLIGHTREC_RING_LEN CONFIG_BRIDGE_FLIGHTREC_RING_LEN
+
+_Static_assert((FLIGHTREC_RING_LEN & (FLIGHTREC_RING_LEN - 1)) == 0,
+               "FLIGHTREC_RING_LEN должна быть степенью двойки");
+
+// Период, с которым задача журнала забирает сообщения из кольца
+#define FLIGHTREC_POLL_MS 100
+
+// Пакетов ответа в очереди передачи: ответ не вытесняет сам себя
+#define FLIGHTREC_RADIO_INFLIGHT 4
+
+// Сообщение, ожидающее записи в журнал
+typedef struct {
+    uint8_t len;
+    uint8_t data[DRONE_MSG_PACKET_SIZE];
+} flightrec_entry_t;
+
+// Путь, которым пришел запрос чтения; ответ уходит им же
+typedef enum {
+    FLIGHTREC_REPLY_UART,
+    FLIGHTREC_REPLY_RADIO
+} flightrec_reply_t;
+
+typedef struct {
+    flightrec_request_t req;
+    flightrec_reply_t reply;
+    transport_dest_t peer;     // Отправитель запроса по радиоканалу
+} flightrec_job_t;
+
+// Выполняемый запрос чтения
+typedef struct {
+    flightrec_job_t job;
+    flightrec_batch_t batch;
+    uint32_t seq;              // Следующий сектор журнала
+    uint32_t sent;             // Отправлено записей
+    bool active;
+} flightrec_replay_t;
+
+// Кольцо между стадией пересылки и задачей журнала
+static flightrec_entry_t flightrec_entries[FLIGHTREC_RING_LEN];
+static spsc_ring_t flightrec_ring;
+static StaticQueue_t flightrec_jobs_buf;
+static uint8_t flightrec_jobs_storage[2 * sizeof(flightrec_job_t)];
+static QueueHandle_t flightrec_jobs = NULL;
+static TaskHandle_t flightrec_task_handle = NULL;
+
+// Журнал и чтение. Доступ только из flightrec_task
+static flightrec_t flight_log;
+static flightrec_replay_t flightrec_replay;
+
+// Стадия пересылки передает сообщение в журнал без ожидания: при
+// заполненном кольце сообщение не записывается. Задача журнала будится
+// только при заполнении кольца наполовину, иначе забирает сообщения сама
+static void flightrec_submit(const uint8_t *frame, size_t len) {
+    if (!flightrec_task_handle || len != DRONE_MSG_PACKET_SIZE) {
+        return;
+    }
+    flightrec_entry_t *entry = spsc_ring_acquire(&flightrec_ring);
+    if (!entry) {
+        metrics_inc(METRIC_FLIGHTREC_DROPPED);
+        return;
+    }
+    entry->len = len;
+    memcpy(entry->data, frame, len);
+    if (spsc_ring_publish(&flightrec_ring) + 1 == FLIGHTREC_RING_LEN / 2) {
+        xTaskNotifyGive(flightrec_task_handle);
+    }
+}
+
+// Запрос чтения журнала от моста: src_mac - отправитель запроса по
+// радиоканалу, NULL - запрос из UART
+static void flightrec_request(const flightrec_request_t *req, const uint8_t *src_mac, void *ctx) {
+    flightrec_job_t job = {.req = *req, .reply = src_mac ? FLIGHTREC_REPLY_RADIO : FLIGHTREC_REPLY_UART};
+    if (src_mac) {
+        job.peer.mode = TRANSPORT_DEST_UNICAST;
+        memcpy(job.peer.mac, src_mac, sizeof(job.peer.mac));
+    }
+    if (!flightrec_task_handle || xQueueSend(flightrec_jobs, &job, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Flight recorder busy, read request %u dropped", req->req_id);
+        return;
+    }
+    xTaskNotifyGive(flightrec_task_handle);
+}
+
+// Передает кадр ответа. В радиоканал - отправителю запроса классом фоновых
+// данных, дожидаясь, пока в очереди останется мало пакетов ответа
+static void flightrec_send(const uint8_t *frame, size_t len, const flightrec_job_t *job) {
+    if (job->reply == FLIGHTREC_REPLY_UART) {
+        if (uart_send_data(frame, len) < 0) {
+            DLOGW(DLOG_UART_TX_FAILED, len);
+            return;
+        }
+        metrics_inc(METRIC_UART_TX_FRAMES);
+        return;
+    }
+
+    static tx_sched_class_stats_t stats;
+    transport->get_class_stats(TX_CLASS_BULK, &stats);
+    while (stats.depth >= FLIGHTREC_RADIO_INFLIGHT) {
+        transport->wait_space(pdMS_TO_TICKS(10));
+        transport->get_class_stats(TX_CLASS_BULK, &stats);
+    }
+    bridge_send_to(&bridge, &job->peer, frame, len);
+}
+
+static void flightrec_replay_cb(const uint8_t *frame, size_t len, uint32_t timestamp_ms, void *user_ctx) {
+    flightrec_replay_t *replay = user_ctx;
+    if (!flightrec_batch_add(&replay->batch, frame, len)) {
+        flightrec_send(replay->batch.buf, replay->batch.len, &replay->job);
+        flightrec_batch_init(&replay->batch, replay->job.req.req_id, replay->batch.cap);
+        flightrec_batch_add(&replay->batch, frame, len);
+    }
+    replay->sent++;
+}
+
+// Один шаг чтения: один сектор журнала, чтобы запись не ждала конца ответа
+static void flightrec_replay_step(flightrec_replay_t *replay) {
+    const flightrec_request_t *req = &replay->job.req;
+    if (flightrec_read_sector(&flight_log, &replay->seq, req->from_ms, req->to_ms,
+                              flightrec_replay_cb, replay) >= 0) {
+        return;
+    }
+
+    if (flightrec_batch_count(&replay->batch) > 0) {
+        flightrec_send(replay->batch.buf, replay->batch.len, &replay->job);
+    }
+    uint8_t end[FLIGHTREC_END_SIZE];
+    flightrec_send(end, flightrec_encode_end(req->req_id, replay->sent, end), &replay->job);
+    metrics_add(METRIC_FLIGHTREC_REPLAYED, replay->sent);
+    ESP_LOGI(TAG, "Flight recorder request %u: %" PRIu32 " records", req->req_id, replay->sent);
+    replay->active = false;
+}
+
+// Задача журнала: запись сообщений во флеш-память страницами и ответы на
+// запросы чтения. Работает с низким приоритетом, стадии конвейера ее не ждут
+static void flightrec_task(void *arg) {
+    flightrec_replay_t *replay = &flightrec_replay;
+    TickType_t last_flush = xTaskGetTickCount();
+
     while (1) {
-        int uart_len = uart_receive_data(uart_buffer, ESPNOW_MAX_DATA_LEN);
-        if (uart_len > 0) {
-            espnow_send(PEER_MAC, uart_buffer, uart_len);
-            ESP_LOGI(TAG, "Sent via ESP-NOW: %d bytes", uart_len);
+        ulTaskNotifyTake(pdTRUE, replay->active ? 0 : pdMS_TO_TICKS(FLIGHTREC_POLL_MS));
+
+        const flightrec_entry_t *entry;
+        while ((entry = spsc_ring_peek(&flightrec_ring)) != NULL) {
+            if (flightrec_append(&flight_log, entry->data, entry->len) == 0) {
+                metrics_inc(METRIC_FLIGHTREC_RECORDS);
+            }
+            spsc_ring_release(&flightrec_ring);
+        }
+        // Неполная страница дописывается по сроку: при сбросе питания
+        // теряется не больше CONFIG_BRIDGE_FLIGHTREC_FLUSH_MS записей
+        if (xTaskGetTickCount() - last_flush >= pdMS_TO_TICKS(CONFIG_BRIDGE_FLIGHTREC_FLUSH_MS)) {
+            flightrec_flush(&flight_log);
+            last_flush = xTaskGetTickCount();
+        }
+
+        if (!replay->active && xQueueReceive(flightrec_jobs, &replay->job, 0) == pdTRUE) {
+            size_t cap = replay->job.reply == FLIGHTREC_REPLY_UART ? FLIGHTREC_BATCH_MAX : TRANSPORT_MAX_DATA_LEN;
+            flightrec_batch_init(&replay->batch, replay->job.req.req_id, cap);
+            replay->seq = flightrec_first_seq(&flight_log);
+            replay->sent = 0;
+            replay->active = true;
+        }
+        if (replay->active) {
+            flightrec_replay_step(replay);
         }
-        vTaskDelay(pdMS_TO_TICKS(50));
     }
 }
 
+static void flightrec_start(void) {
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           FLIGHTREC_PARTITION_SUBTYPE,
+                                                           FLIGHTREC_PARTITION_LABEL);
+    if (!part || flightrec_open(&flight_log, part) < 0) {
+        ESP_LOGE(TAG, "Flight recorder partition \"%s\" not found or unreadable, recorder disabled",
+                 FLIGHTREC_PARTITION_LABEL);
+        return;
+    }
+    ESP_LOGI(TAG, "Flight recorder: %u sectors, last sector #%" PRIu32,
+             flight_log.sector_count, flight_log.head_seq);
+
+    spsc_ring_init(&flightrec_ring, flightrec_entries, sizeof(flightrec_entry_t), FLIGHTREC_RING_LEN);
+    flightrec_jobs = xQueueCreateStatic(2, sizeof(flightrec_job_t), flightrec_jobs_storage, &flightrec_jobs_buf);
+    BRIDGE_TASK_CREATE_STATIC(flightrec_task, "flightrec", FLIGHTREC_TASK_STACK, NULL,
+                              FLIGHTREC_TASK_PRIO, &flightrec_task_handle, tskNO_AFFINITY);
+}
+#endif
+
+
+// Наибольший кадр UART: длиннее MTU только при фрагментации
+#if CONFIG_BRIDGE_FRAGMENT
+#define UART_FRAME_MAX_LEN FRAGMENT_MAX_FRAME
+#else
+#define UART_FRAME_MAX_LEN ESPNOW_MAX_DATA_LEN
+#endif
+
+// Кадр, принятый стадией приема UART
+typedef struct {
+    int64_t rx_time;           // Время приема кадра (esp_timer, мкс)
+    uint16_t len;
+    uint8_t data[UART_FRAME_MAX_LEN];
+} uart_frame_t;
+
+#define UART_RING_LEN CONFIG_BRIDGE_UART_RING_LEN
+
+_Static_assert((UART_RING_LEN & (UART_RING_LEN - 1)) == 0, "UART_RING_LEN должна быть степенью двойки");
+
+// Кольцо между стадиями приема UART и пересылки
+static uart_frame_t uart_frames[UART_RING_LEN];
+static spsc_ring_t uart_ring;
+static TaskHandle_t uart_rx_task_handle = NULL;
+static TaskHandle_t forward_task_handle = NULL;
+// Наибольшее заполнение кольца с предыдущего снимка метрик
+static uint32_t uart_ring_peak;
+
+// Стадия приема: чтение из драйвера и разбор кадров UART. Кадр разбирается
+// прямо в свободный элемент кольца, между стадиями данные не копируются.
+// Если кольцо заполнено, стадия ждет, а данные остаются в буфере драйвера
+static void uart_rx_task(void *arg) {
+    bool ring_full = false;
+    while (1) {
+        uart_frame_t *frame = spsc_ring_acquire(&uart_ring);
+        if (!frame) {
+            if (!ring_full) {
+                metrics_inc(METRIC_UART_RING_FULL);
+                ring_full = true;
+            }
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+            continue;
+        }
+        ring_full = false;
+
+        // Задача спит в очереди событий UART до прихода данных
+        int uart_len = uart_receive_data(frame->data, sizeof(frame->data), &frame->rx_time, portMAX_DELAY);
+        if (uart_len <= 0) {
+            continue;
+        }
+        frame->len = uart_len;
+
+        uint32_t depth = spsc_ring_publish(&uart_ring) + 1;
+        if (depth > __atomic_load_n(&uart_ring_peak, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&uart_ring_peak, depth, __ATOMIC_RELAXED);
+        }
+        // Уведомление на каждый кадр: при проверке "кольцо было пустым"
+        // стадия пересылки могла освободить последний кадр после чтения
+        // позиции в spsc_ring_publish и уснуть, не увидев новый
+        xTaskNotifyGive(forward_task_handle);
+    }
+}
+
+#if CONFIG_BRIDGE_AGGREGATION
+// Отправка неполного контейнера по истечении срока ожидания. Постановка в
+// очередь может ждать места, а задача esp_timer обслуживает все таймеры,
+// поэтому таймер только передает работу стадии пересылки
+static void aggregate_deadline_cb(void *arg) {
+    __atomic_store_n(&aggregate_due, true, __ATOMIC_RELEASE);
+    xTaskNotifyGive(forward_task_handle);
+}
+#endif
+
+#if CONFIG_BRIDGE_RATE_CTRL
+// Передача придержанной телеметрии в срок предела частоты: кодер и
+// состояние предела принадлежат стадии пересылки
+static void telemetry_deadline_cb(void *arg) {
+    __atomic_store_n(&telemetry_due, true, __ATOMIC_RELEASE);
+    xTaskNotifyGive(forward_task_handle);
+}
+#endif
+
+// Стадия пересылки: классификация, компактный формат, доставка с
+// подтверждением, агрегация и постановка в очередь передачи. Передачу в
+// радиоканал выполняет задача канала на ядре Wi-Fi
+static void forward_task(void *arg) {
+    while (1) {
+#if CONFIG_BRIDGE_AGGREGATION
+        if (__atomic_exchange_n(&aggregate_due, false, __ATOMIC_ACQUIRE)) {
+            bridge_aggregate_deadline(&bridge);
+        }
+#endif
+#if CONFIG_BRIDGE_RATE_CTRL
+        if (__atomic_exchange_n(&telemetry_due, false, __ATOMIC_ACQUIRE)) {
+            bridge_telemetry_deadline(&bridge);
+        }
+#endif
+        const uart_frame_t *frame = spsc_ring_peek(&uart_ring);
+        if (!frame) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+#if CONFIG_BRIDGE_LATENCY_STATS
+        report_latency(frame->rx_time);
+#endif
+        bridge_forward(&bridge, frame->data, frame->len, frame->rx_time);
+        metrics_record(METRIC_HIST_UART_TO_QUEUE, esp_timer_get_time() - frame->rx_time);
+#if CONFIG_BRIDGE_FLIGHTREC
+        flightrec_submit(frame->data, frame->len);
+#endif
+
+        // Стадия приема могла заполнить кольцо после проверки заполнения
+        // здесь, поэтому место освобождается с уведомлением всегда
+        spsc_ring_release(&uart_ring);
+        xTaskNotifyGive(uart_rx_task_handle);
+    }
+}
+
+#if CONFIG_BRIDGE_FLEET
+#define FLEET_SNAPSHOT_PERIOD_US (1000000 / CONFIG_BRIDGE_FLEET_SNAPSHOT_HZ)
+
+// Последнее состояние каждого дрона. Доступ только из espnow_to_uart_task
+static fleet_table_t fleet;
+static int64_t fleet_next_snapshot_us;
+
+static void fleet_emit_cb(const uint8_t *frame, size_t len, void *user_ctx) {
+    if (uart_send_data(frame, len) < 0) {
+        DLOGW(DLOG_UART_TX_FAILED, len);
+        return;
+    }
+    metrics_inc(METRIC_UART_TX_FRAMES);
+}
+
+// Выдает снимок, если подошел его срок. Возвращает время ожидания пакета
+// до следующего снимка
+static TickType_t fleet_publish_due(void) {
+    int64_t now = esp_timer_get_time();
+    if (now >= fleet_next_snapshot_us) {
+        fleet_expire(&fleet, now, CONFIG_BRIDGE_FLEET_EXPIRE_S * 1000000LL);
+        fleet_snapshot(&fleet, now, fleet_emit_cb, NULL);
+        fleet_next_snapshot_us += FLEET_SNAPSHOT_PERIOD_US;
+        if (fleet_next_snapshot_us <= now) {
+            // Задача не успела к сроку: снимки не наверстываются
+            fleet_next_snapshot_us = now + FLEET_SNAPSHOT_PERIOD_US;
+        }
+    }
+    TickType_t ticks = pdMS_TO_TICKS((fleet_next_snapshot_us - now + 999) / 1000);
+    return ticks > 0 ? ticks : 1;
+}
+#endif
+
+#if CONFIG_BRIDGE_LATENCY_STATS
+static void report_rx_callback_time(void) {
+    static uint32_t reported = 0;
+    transport_rx_stats_t stats;
+    transport->get_rx_stats(&stats);
+    if (stats.received - reported >= CONFIG_BRIDGE_LATENCY_REPORT_INTERVAL) {
+        ESP_LOGI(TAG, "espnow_recv_cb time over %" PRIu32 " packets: p50=%" PRIu32 " us, p99=%" PRIu32 " us, max=%" PRIu32 " us, dropped=%" PRIu32,
+                 stats.cb_time_us.count,
+                 latency_hist_percentile(&stats.cb_time_us, 50),
+                 latency_hist_percentile(&stats.cb_time_us, 99),
+                 stats.cb_time_us.max_us,
+                 stats.dropped);
+        reported = stats.received;
+    }
+}
+#endif
+
+// Мост с параметрами из menuconfig и таймерами прошивки
+static void bridge_start(const transport_dest_t *route) {
+    bridge_config_t config;
+    bridge_default_config(&config);
+#if CONFIG_BRIDGE_FRAGMENT
+    config.fragment_slots = rx_fragment_slots;
+    config.fragment_slot_count = CONFIG_BRIDGE_FRAGMENT_SLOTS;
+#endif
+#if CONFIG_BRIDGE_FLEET
+    config.fleet = &fleet;
+#endif
+    const bridge_hooks_t hooks = {
+        .now = bridge_clock,
+        .uart_send = bridge_uart_send,
+        .aggregate_timer = bridge_aggregate_timer,
+        .telemetry_timer = bridge_telemetry_timer,
+#if CONFIG_BRIDGE_FLIGHTREC
+        .flightrec_request = flightrec_request,
+#endif
+    };
+
+#if CONFIG_BRIDGE_AGGREGATION
+    const esp_timer_create_args_t aggregate_args = {
+        .callback = aggregate_deadline_cb,
+        .name = "aggregate_deadline",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&aggregate_args, &aggregate_timer));
+#endif
+#if CONFIG_BRIDGE_RATE_CTRL
+    const esp_timer_create_args_t telemetry_args = {
+        .callback = telemetry_deadline_cb,
+        .name = "telemetry_deadline",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&telemetry_args, &telemetry_timer));
+#endif
+
+    bridge_init(&bridge, &config, transport, route, &hooks);
+
+#if CONFIG_BRIDGE_RELIABLE
+    esp_timer_handle_t reliable_timer;
+    const esp_timer_create_args_t reliable_args = {
+        .callback = reliable_poll_cb,
+        .name = "reliable_poll",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&reliable_args, &reliable_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(reliable_timer, CONFIG_BRIDGE_RELIABLE_RTO_MIN_MS * 1000 / 2));
+#endif
+
+#if CONFIG_BRIDGE_TIMESYNC && !CONFIG_BRIDGE_TIMESYNC_REFERENCE
+    // Эталон только отвечает на запросы
+    esp_timer_handle_t clock_sync_timer;
+    const esp_timer_create_args_t clock_sync_args = {
+        .callback = clock_sync_ping_cb,
+        .name = "clock_sync",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&clock_sync_args, &clock_sync_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(clock_sync_timer, CONFIG_BRIDGE_TIMESYNC_INTERVAL_MS * 1000));
+#endif
+}
+
+void espnow_to_uart_task(void *arg) {
+    TickType_t wait = portMAX_DELAY;
+#if CONFIG_BRIDGE_FLEET
+    fleet_init(&fleet);
+    fleet_next_snapshot_us = esp_timer_get_time() + FLEET_SNAPSHOT_PERIOD_US;
+    wait = pdMS_TO_TICKS(FLEET_SNAPSHOT_PERIOD_US / 1000);
+#endif
+
+    while (1) {
+        const transport_packet_t *packet = transport->receive(wait);
+#if CONFIG_BRIDGE_FLEET
+        wait = fleet_publish_due();
+#endif
+        if (!packet) {
+            continue;
+        }
+
+        ESP_LOGD(TAG, "Received %d bytes from " MACSTR, packet->len, MAC2STR(packet->src_mac));
+        metrics_inc(METRIC_RX_PACKETS);
+
+#if CONFIG_BRIDGE_PEER_AUTO_ADD
+        // Наземная станция узнает дроны по первому принятому пакету. Принимать
+        // пакеты можно и от незарегистрированных дронов, их больше 20 в режиме
+        // таблицы состояния
+        if (transport->peer_count() < PEER_TABLE_CAPACITY && !transport->has_peer(packet->src_mac)) {
+            esp_err_t err = transport->add_peer(packet->src_mac, PEER_GROUP_ALL);
+            if (err != ESP_OK) {
+                DLOGW(DLOG_ESPNOW_PEER_ADD_FAILED, err);
+            }
+        }
+#endif
+
+        bridge_receive(&bridge, packet);
+
+        metrics_record(METRIC_HIST_RX_TO_UART, esp_timer_get_time() - packet->rx_time);
+        transport->release();
+#if CONFIG_BRIDGE_LATENCY_STATS
+        report_rx_callback_time();
+#endif
+    }
+}
+
+#if CONFIG_BRIDGE_METRICS
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+// Время выполнения стадии конвейера на предыдущем снимке
+typedef struct {
+    TaskHandle_t task;
+    uint32_t prev_run_us;
+} stage_cpu_t;
+
+// Загрузка ядра стадией за интервал interval_us, промилле. Счетчик времени
+// выполнения FreeRTOS ведется по esp_timer в микросекундах
+static uint32_t stage_cpu_permille(stage_cpu_t *stage, uint32_t interval_us) {
+    if (!stage->task || interval_us == 0) {
+        return 0;
+    }
+    TaskStatus_t status;
+    vTaskGetInfo(stage->task, &status, pdFALSE, eInvalid);
+    uint32_t run_us = status.ulRunTimeCounter - stage->prev_run_us;
+    stage->prev_run_us = status.ulRunTimeCounter;
+    return (uint64_t)run_us * 1000 / interval_us;
+}
+#endif
+
+// Периодический снимок метрик узла. Наземная станция выдает его в UART,
+// остальные узлы при BRIDGE_METRICS_RADIO передают получателю кадров
+// моста, иначе только формируют: гистограммы и пики считаются за интервал.
+// Снимок не вытесняет другие пакеты: при заполненной очереди он
+// пропускается
+void metrics_task(void *arg) {
+    // Статические буферы: гистограммы не помещаются в стек задачи
+    static metrics_snapshot_t snapshot;
+    static tx_sched_class_stats_t class_stats;
+    static transport_rx_stats_t rx_stats;
+    uint8_t frame[METRICS_FRAME_SIZE];
+    uint8_t mac[TRANSPORT_ADDR_LEN];
+    esp_wifi_get_mac(WIFI_IF_STA, mac);
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    stage_cpu_t stages[] = {
+        [0] = {.task = uart_rx_task_handle},
+        [1] = {.task = forward_task_handle},
+        [2] = {.task = xTaskGetHandle(BRIDGE_TASK_RADIO_TX)},
+    };
+    int64_t prev_snapshot_us = esp_timer_get_time();
+#endif
+
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CONFIG_BRIDGE_METRICS_INTERVAL_MS));
+
+        uint32_t depth = 0;
+        for (int cls = 0; cls < TX_CLASS_COUNT; cls++) {
+            transport->get_class_stats(cls, &class_stats);
+            depth += class_stats.depth;
+        }
+        transport->get_rx_stats(&rx_stats);
+        uart_stats_t uart_stats;
+        uart_get_stats(&uart_stats);
+
+        snapshot.gauges[METRIC_GAUGE_TX_QUEUE_DEPTH] = depth;
+        snapshot.gauges[METRIC_GAUGE_RX_RING_DROPS] = rx_stats.dropped;
+        snapshot.gauges[METRIC_GAUGE_UART_BAUD] = uart_stats.baud_rate;
+#if CONFIG_BRIDGE_FLEET
+        snapshot.gauges[METRIC_GAUGE_FLEET_DRONES] = fleet.count;
+#endif
+#if CONFIG_BRIDGE_TIMESYNC
+        uint8_t stratum;
+        uint32_t sync_delay_us;
+        bridge_clock_state(&bridge, &stratum, &sync_delay_us);
+        snapshot.gauges[METRIC_GAUGE_SYNC_STRATUM] = stratum;
+        snapshot.gauges[METRIC_GAUGE_SYNC_DELAY] = sync_delay_us;
+#endif
+#if CONFIG_BRIDGE_RATE_CTRL
+        snapshot.gauges[METRIC_GAUGE_TELEMETRY_LIMIT] = __atomic_load_n(&bridge.telemetry_rate.limit_hz, __ATOMIC_RELAXED);
+        snapshot.gauges[METRIC_GAUGE_LINK_DELIVERY] = __atomic_load_n(&bridge.telemetry_rate.delivery_permille,
+                                                                      __ATOMIC_RELAXED);
+#endif
+        snapshot.gauges[METRIC_GAUGE_UART_RING_PEAK] = __atomic_exchange_n(&uart_ring_peak, spsc_ring_count(&uart_ring),
+                                                                           __ATOMIC_RELAXED);
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        int64_t now = esp_timer_get_time();
+        uint32_t interval_us = now - prev_snapshot_us;
+        prev_snapshot_us = now;
+        snapshot.gauges[METRIC_GAUGE_CPU_UART_RX] = stage_cpu_permille(&stages[0], interval_us);
+        snapshot.gauges[METRIC_GAUGE_CPU_FORWARD] = stage_cpu_permille(&stages[1], interval_us);
+        snapshot.gauges[METRIC_GAUGE_CPU_RADIO_TX] = stage_cpu_permille(&stages[2], interval_us);
+#endif
+
+        size_t len = metrics_encode(&snapshot, mac, (uint32_t)(esp_timer_get_time() / 1000), frame, sizeof(frame));
+#if CONFIG_BRIDGE_FLEET
+        if (uart_send_data(frame, len) < 0) {
+            DLOGW(DLOG_UART_TX_FAILED, len);
+        }
+#elif CONFIG_BRIDGE_METRICS_RADIO
+        if (transport->send(&bridge.route, frame, len, TX_CLASS_BULK) == TRANSPORT_TX_FULL) {
+            ESP_LOGD(TAG, "TX queue full, metrics snapshot skipped");
+        }
+#else
+        ESP_LOGD(TAG, "Metrics snapshot %u: %u bytes", frame[2], (unsigned)len);
+#endif
+    }
+}
+#endif
+
 void test_send_task(void *arg) {
     int counter = 0;
     static uint8_t buffer[32];
@@ -44,7 +747,7 @@ void test_send_task(void *arg) {
     while(1) {
         snprintf((char*)buffer, sizeof(buffer), "Test message #%d", counter++);
 
-        espnow_send(PEER_MAC, buffer, strlen((char*)buffer));
+        transport->send(&bridge.route, buffer, strlen((char*)buffer), TX_CLASS_BULK);
         ESP_LOGI(TAG, "Sent: %s", buffer);
 
         vTaskDelay(pdMS_TO_TICKS(5000));
@@ -55,6 +758,8 @@ void app_main(void) {
     vTaskDelay(500 / portTICK_PERIOD_MS);
     ESP_LOGI(TAG, "--- ESP32 APP STARTING ---");
 
+    dlog_init();
+
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
@@ -62,19 +767,78 @@ void app_main(void) {
     }
     ESP_ERROR_CHECK(ret);
 
-    ESP_LOGI(TAG, "Initializing WiFi + ESPNOW...");
-    espnow_init();
+#ifdef TEST_BUILD
+    // В QEMU нет Wi-Fi: вместо запуска моста выполняются замеры, фаззинг-проверки
+    // и модель нескольких мостов с общим эфиром
+    bool passed = bench_run_all();
+
+    if (!loopback_sim_run_suite()) {
+        passed = false;
+    }
+
+    // Пропускная способность UART через внутреннюю петлю второго порта
+    // (первый занят консолью): на каждой скорости не должно быть переполнений,
+    // и каждый переданный кадр должен быть принят
+    static const uint32_t uart_rates[] = {115200, 921600, 2000000, 3000000};
+    for (size_t i = 0; i < sizeof(uart_rates) / sizeof(uart_rates[0]); i++) {
+        uart_loopback_result_t uart_result;
+        uart_loopback_test(UART_NUM_1, uart_rates[i], 1000, &uart_result);
+        ESP_LOGI(TAG, "UART {\"baud\":%" PRIu32 ",\"sent\":%" PRIu32 ",\"received\":%" PRIu32
+                 ",\"overruns\":%" PRIu32 ",\"bytes_s\":%" PRIu32 "}",
+                 uart_result.baud_rate, uart_result.frames_sent, uart_result.frames_received,
+                 uart_result.overruns, uart_result.bytes_per_s);
+        if (uart_result.overruns != 0 || uart_result.frames_received != uart_result.frames_sent) {
+            passed = false;
+        }
+    }
+
+    if (passed) {
+        ESP_LOGI(TAG, "Успешная загрузка в режиме тестирования!");
+    }
+    return;
+#endif
+
+    transport = transport_get();
+    ESP_LOGI(TAG, "Initializing WiFi + %s transport...", transport->name);
+    transport->init();
 
-    ESP_LOGI(TAG, "Adding peer...");
-    espnow_add_peer(PEER_MAC);
+    ESP_LOGI(TAG, "Adding peers...");
+    transport_dest_t route = {0};
+    peers_init(&route);
 
     print_mac();
 
     ESP_LOGI(TAG, "Initializing UART...");
-    uart_init(115200);
+    uart_init(UART_BAUD_RATE);
+#if CONFIG_BRIDGE_UART_HIGH_SPEED
+    uart_negotiate_baud(CONFIG_BRIDGE_UART_TARGET_BAUD);
+#endif
+
+#if CONFIG_BRIDGE_FLIGHTREC
+    flightrec_start();
+#endif
+
+    bridge_start(&route);
+
+    // Стадии приема и пересылки UART работают на ядре, свободном от задачи
+    // Wi-Fi, передача в радиоканал - на ядре Wi-Fi (задача канала).
+    // Пересылка создается первой: стадия приема будит ее с первого кадра
+    ESP_LOGI(TAG, "Creating UART pipeline tasks on core %d...", BRIDGE_UART_CORE);
+    spsc_ring_init(&uart_ring, uart_frames, sizeof(uart_frame_t), UART_RING_LEN);
+    BRIDGE_TASK_CREATE_STATIC(forward_task, BRIDGE_TASK_FORWARD, FORWARD_TASK_STACK, NULL,
+                              FORWARD_TASK_PRIO, &forward_task_handle, BRIDGE_UART_CORE);
+    BRIDGE_TASK_CREATE_STATIC(uart_rx_task, BRIDGE_TASK_UART_RX, UART_RX_TASK_STACK, NULL,
+                              UART_RX_TASK_PRIO, &uart_rx_task_handle, BRIDGE_UART_CORE);
+
+    ESP_LOGI(TAG, "Creating ESPNOW->UART task...");
+    BRIDGE_TASK_CREATE_STATIC(espnow_to_uart_task, "espnow_to_uart", UART_TX_TASK_STACK, NULL,
+                              UART_TX_TASK_PRIO, NULL, BRIDGE_UART_CORE);
 
-    ESP_LOGI(TAG, "Creating UART->ESPNOW task...");
-    xTaskCreate(uart_to_espnow_task, "uart_to_espnow_task", 2048, NULL, 5, NULL);
+#if CONFIG_BRIDGE_METRICS
+    ESP_LOGI(TAG, "Creating metrics task...");
+    BRIDGE_TASK_CREATE_STATIC(metrics_task, "metrics_task", METRICS_TASK_STACK, NULL,
+                              METRICS_TASK_PRIO, NULL, tskNO_AFFINITY);
+#endif
 
     ESP_LOGI(TAG, "ESP32 initialization complete");
 }
\ No newline at end of file
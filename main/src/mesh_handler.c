@@ -0,0 +1,507 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_wifi.h"
+#include "esp_mesh.h"
+#include "esp_netif.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "mesh_handler.h"
+#include "peer_table.h"
+#include "spsc_ring.h"
+#include "bridge_tasks.h"
+#include "dlog.h"
+#include "metrics.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "MESH";
+
+// Очередь передачи и буфер приема - те же параметры, что и для ESP-NOW
+#define MESH_TX_QUEUE_LEN CONFIG_BRIDGE_ESPNOW_TX_QUEUE_LEN
+#define MESH_RX_RING_LEN  CONFIG_BRIDGE_ESPNOW_RX_RING_LEN
+
+// Слот очереди передачи
+typedef struct {
+    uint8_t dest[TRANSPORT_ADDR_LEN];
+    bool to_root;              // Корню дерева, адрес не нужен
+    uint16_t len;
+    uint8_t data[TRANSPORT_MAX_DATA_LEN];
+} mesh_tx_slot_t;
+
+// Очередь передачи с классами трафика, как в espnow_handler.c.
+// esp_mesh_send блокирует задачу, пока пакет не принят стеком, поэтому
+// лимит пакетов "в полете" не нужен
+static mesh_tx_slot_t tx_slots[MESH_TX_QUEUE_LEN];
+static tx_sched_t tx_sched;
+// Все счетчики изменяются и читаются под tx_mutex
+static mesh_tx_stats_t tx_stats;
+static StaticSemaphore_t tx_mutex_buf;
+static StaticSemaphore_t tx_space_sem_buf;
+static SemaphoreHandle_t tx_mutex = NULL;
+static SemaphoreHandle_t tx_space_sem = NULL;
+static TaskHandle_t tx_task_handle = NULL;
+
+_Static_assert(MESH_TX_QUEUE_LEN <= TX_SCHED_MAX_SLOTS, "MESH_TX_QUEUE_LEN больше TX_SCHED_MAX_SLOTS");
+
+// Принятые пакеты: задача приема пишет их прямо в кольцевой буфер
+static transport_packet_t rx_packets[MESH_RX_RING_LEN];
+static spsc_ring_t rx_ring;
+static TaskHandle_t rx_consumer_task = NULL;
+static transport_rx_stats_t rx_stats;
+
+_Static_assert((MESH_RX_RING_LEN & (MESH_RX_RING_LEN - 1)) == 0, "MESH_RX_RING_LEN должна быть степенью двойки");
+
+// Узлы, известные мосту: группы и статистика канала. Маршруты до узлов
+// строит ESP-MESH, регистрация для передачи не нужна
+static peer_table_t peers;
+static portMUX_TYPE peer_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Таблица маршрутов корня для широковещательной передачи (под tx_mutex)
+static mesh_addr_t route_table[CONFIG_MESH_ROUTE_TABLE_SIZE];
+static uint8_t route_macs[CONFIG_MESH_ROUTE_TABLE_SIZE][PEER_MAC_LEN];
+
+static esp_netif_t *netif_sta = NULL;
+static uint8_t self_mac[TRANSPORT_ADDR_LEN];
+static volatile int mesh_layer = 0;
+
+static void mesh_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
+    switch (event_id) {
+        case MESH_EVENT_STARTED:
+            ESP_LOGI(TAG, "Mesh запущена, MAC узла " MACSTR, MAC2STR(self_mac));
+            break;
+        case MESH_EVENT_PARENT_CONNECTED: {
+            mesh_event_connected_t *connected = event_data;
+            mesh_layer = esp_mesh_get_layer();
+            ESP_LOGI(TAG, "Подключен к родителю " MACSTR ", слой %d%s",
+                     MAC2STR(connected->connected.bssid), mesh_layer,
+                     esp_mesh_is_root() ? " (корень)" : "");
+            if (esp_mesh_is_root()) {
+                // Корень получает адрес от маршрутизатора
+                esp_netif_dhcpc_stop(netif_sta);
+                esp_netif_dhcpc_start(netif_sta);
+            }
+            xTaskNotifyGive(tx_task_handle);
+            break;
+        }
+        case MESH_EVENT_PARENT_DISCONNECTED:
+            mesh_layer = 0;
+            ESP_LOGW(TAG, "Связь с родителем потеряна");
+            break;
+        case MESH_EVENT_LAYER_CHANGE:
+            mesh_layer = ((mesh_event_layer_change_t *)event_data)->new_layer;
+            ESP_LOGI(TAG, "Новый слой %d", mesh_layer);
+            break;
+        case MESH_EVENT_ROUTING_TABLE_ADD:
+        case MESH_EVENT_ROUTING_TABLE_REMOVE:
+            ESP_LOGI(TAG, "Узлов в таблице маршрутов: %d", esp_mesh_get_routing_table_size());
+            break;
+        default:
+            break;
+    }
+}
+
+// Ставит пакет в очередь. Вызывается под tx_mutex
+static transport_tx_status_t mesh_tx_push(const uint8_t *dest, bool to_root, const uint8_t *data, size_t len,
+                                          tx_class_t cls) {
+    bool dropped;
+    int index = tx_sched_push(&tx_sched, cls, len, tx_evictable(data, len), esp_timer_get_time(), &dropped);
+    if (index < 0) {
+        tx_stats.rejected++;
+        return TRANSPORT_TX_FULL;
+    }
+    if (dropped) {
+        tx_stats.dropped++;
+    }
+
+    mesh_tx_slot_t *slot = &tx_slots[index];
+    if (dest) {
+        memcpy(slot->dest, dest, TRANSPORT_ADDR_LEN);
+    }
+    slot->to_root = to_root;
+    memcpy(slot->data, data, len);
+    slot->len = len;
+    tx_stats.enqueued++;
+    return dropped ? TRANSPORT_TX_QUEUED_DROPPED : TRANSPORT_TX_QUEUED;
+}
+
+// Ставит копии пакета узлам группы или дерева: все или ни одной, чтобы
+// вызывающий мог повторить передачу после ожидания места, не удваивая
+// копии. Вызывается под tx_mutex
+static transport_tx_status_t mesh_tx_push_copies(const uint8_t (*macs)[PEER_MAC_LEN], size_t count,
+                                                 const uint8_t *data, size_t len, tx_class_t cls) {
+    if (count == 0) {
+        return TRANSPORT_TX_INVALID;
+    }
+    if (tx_sched_room(&tx_sched, cls, tx_evictable(data, len)) < count) {
+        tx_stats.rejected++;
+        return TRANSPORT_TX_FULL;
+    }
+    transport_tx_status_t result = TRANSPORT_TX_QUEUED;
+    for (size_t i = 0; i < count; i++) {
+        if (mesh_tx_push(macs[i], false, data, len, cls) == TRANSPORT_TX_QUEUED_DROPPED) {
+            result = TRANSPORT_TX_QUEUED_DROPPED;
+        }
+    }
+    return result;
+}
+
+static transport_tx_status_t mesh_send(const transport_dest_t *dest, const uint8_t *data, size_t len,
+                                       tx_class_t cls) {
+    if (!dest || !data || len == 0 || !tx_mutex) {
+        return TRANSPORT_TX_INVALID;
+    }
+    if (len > TRANSPORT_MAX_DATA_LEN) {
+        DLOGW(DLOG_ESPNOW_TRUNCATED, len, TRANSPORT_MAX_DATA_LEN);
+        len = TRANSPORT_MAX_DATA_LEN;
+    }
+
+    uint8_t macs[PEER_TABLE_CAPACITY][PEER_MAC_LEN];
+    size_t count = 0;
+    if (dest->mode == TRANSPORT_DEST_GROUP) {
+        portENTER_CRITICAL(&peer_lock);
+        count = peer_table_collect(&peers, dest->groups, macs, PEER_TABLE_CAPACITY);
+        portEXIT_CRITICAL(&peer_lock);
+        if (count == 0) {
+            return TRANSPORT_TX_INVALID;
+        }
+    }
+
+    transport_tx_status_t result = TRANSPORT_TX_QUEUED;
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    if (dest->mode == TRANSPORT_DEST_UNICAST) {
+        result = mesh_tx_push(dest->mac, false, data, len, cls);
+    } else if (dest->mode == TRANSPORT_DEST_GROUP) {
+        result = mesh_tx_push_copies((const uint8_t (*)[PEER_MAC_LEN])macs, count, data, len, cls);
+    } else if (!esp_mesh_is_root()) {
+        // Широковещательный пакет узла уходит корню - наземной станции
+        result = mesh_tx_push(NULL, true, data, len, cls);
+    } else {
+        // Корень передает копию каждому узлу дерева
+        int routes = 0;
+        esp_mesh_get_routing_table(route_table, sizeof(route_table), &routes);
+        size_t route_count = 0;
+        for (int i = 0; i < routes; i++) {
+            if (memcmp(route_table[i].addr, self_mac, TRANSPORT_ADDR_LEN) != 0) {
+                memcpy(route_macs[route_count++], route_table[i].addr, PEER_MAC_LEN);
+            }
+        }
+        result = mesh_tx_push_copies((const uint8_t (*)[PEER_MAC_LEN])route_macs, route_count, data, len, cls);
+    }
+    xSemaphoreGive(tx_mutex);
+
+    if (result != TRANSPORT_TX_FULL && result != TRANSPORT_TX_INVALID) {
+        xTaskNotifyGive(tx_task_handle);
+    }
+    return result;
+}
+
+static void mesh_tx_task(void *arg) {
+    while (1) {
+        if (mesh_layer == 0 && !esp_mesh_is_root()) {
+            // Без родителя маршрута нет: ждем подключения
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        xSemaphoreTake(tx_mutex, portMAX_DELAY);
+        int index = tx_sched_peek(&tx_sched) >= 0 ? tx_sched_pop(&tx_sched, esp_timer_get_time()) : -1;
+        xSemaphoreGive(tx_mutex);
+        if (index < 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        // Слот не изменяется до освобождения, время постановки читается без мьютекса
+        int64_t start = esp_timer_get_time();
+        metrics_record(METRIC_HIST_QUEUE_TO_SEND, start - tx_sched.enqueued_us[index]);
+
+        mesh_tx_slot_t *slot = &tx_slots[index];
+        mesh_addr_t to;
+        memcpy(to.addr, slot->dest, TRANSPORT_ADDR_LEN);
+        mesh_data_t data = {
+            .data = slot->data,
+            .size = slot->len,
+            .proto = MESH_PROTO_BIN,
+            .tos = MESH_TOS_P2P,
+        };
+        esp_err_t err = esp_mesh_send(slot->to_root ? NULL : &to, &data, slot->to_root ? 0 : MESH_DATA_P2P, NULL, 0);
+        // Подтверждения передачи у ESP-MESH нет: учитывается время до приема стеком
+        metrics_record(METRIC_HIST_SEND_TO_ACK, esp_timer_get_time() - start);
+        if (err == ESP_OK) {
+            portENTER_CRITICAL(&peer_lock);
+            peer_entry_t *peer = slot->to_root ? NULL : peer_table_find(&peers, slot->dest);
+            if (peer) {
+                peer->stats.tx_ok++;
+            }
+            portEXIT_CRITICAL(&peer_lock);
+        } else {
+            if (err != ESP_ERR_MESH_DISCONNECTED && err != ESP_ERR_MESH_NO_ROUTE_FOUND) {
+                DLOGE(DLOG_MESH_SEND_ERROR, err);
+            }
+            metrics_inc(METRIC_SEND_ERRORS);
+            portENTER_CRITICAL(&peer_lock);
+            peer_entry_t *peer = slot->to_root ? NULL : peer_table_find(&peers, slot->dest);
+            if (peer) {
+                peer->stats.tx_fail++;
+            }
+            portEXIT_CRITICAL(&peer_lock);
+        }
+
+        // Счетчики читаются под tx_mutex вместе со счетчиками постановки
+        xSemaphoreTake(tx_mutex, portMAX_DELAY);
+        if (err == ESP_OK) {
+            tx_stats.send_ok++;
+        } else if (err == ESP_ERR_MESH_DISCONNECTED || err == ESP_ERR_MESH_NO_ROUTE_FOUND) {
+            tx_stats.no_route++;
+        } else {
+            tx_stats.send_errors++;
+        }
+        tx_sched_release(&tx_sched, index);
+        xSemaphoreGive(tx_mutex);
+        xSemaphoreGive(tx_space_sem);
+    }
+}
+
+// Принимает пакеты прямо в свободный элемент кольцевого буфера. Если буфер
+// заполнен, пакет все равно забирается из стека и отбрасывается
+static void mesh_rx_task(void *arg) {
+    static uint8_t discard[TRANSPORT_MAX_DATA_LEN];
+
+    while (1) {
+        transport_packet_t *packet = spsc_ring_acquire(&rx_ring);
+        mesh_addr_t from;
+        mesh_data_t data = {
+            .data = packet ? packet->data : discard,
+            .size = TRANSPORT_MAX_DATA_LEN,
+        };
+        int flag = 0;
+        esp_err_t err = esp_mesh_recv(&from, &data, portMAX_DELAY, &flag, NULL, 0);
+        int64_t start = esp_timer_get_time();
+        if (err != ESP_OK) {
+            DLOGW(DLOG_MESH_RECV_ERROR, err);
+            continue;
+        }
+        if (!packet) {
+            rx_stats.dropped++;
+            continue;
+        }
+
+        memcpy(packet->src_mac, from.addr, TRANSPORT_ADDR_LEN);
+        packet->rssi = 0;
+        packet->len = data.size;
+        packet->rx_time = start;
+
+        portENTER_CRITICAL(&peer_lock);
+        peer_entry_t *peer = peer_table_find(&peers, from.addr);
+        if (peer) {
+            peer_stats_record_rx(&peer->stats, data.size, 0, start);
+        }
+        portEXIT_CRITICAL(&peer_lock);
+
+        // Уведомление на каждый пакет: проверка "буфер был пуст" теряет
+        // пробуждение, если потребитель освободил последний элемент после
+        // чтения позиции в spsc_ring_publish
+        spsc_ring_publish(&rx_ring);
+        if (rx_consumer_task) {
+            xTaskNotifyGive(rx_consumer_task);
+        }
+        rx_stats.received++;
+        latency_hist_record(&rx_stats.cb_time_us, esp_timer_get_time() - start);
+    }
+}
+
+void mesh_init(void) {
+    tx_mutex = xSemaphoreCreateMutexStatic(&tx_mutex_buf);
+    tx_space_sem = xSemaphoreCreateBinaryStatic(&tx_space_sem_buf);
+    const tx_sched_config_t sched_config = {
+        .capacity = MESH_TX_QUEUE_LEN,
+        .reserve = CONFIG_BRIDGE_ESPNOW_URGENT_RESERVE,
+        .weight = {
+            [TX_CLASS_TELEMETRY] = CONFIG_BRIDGE_TX_WEIGHT_TELEMETRY,
+            [TX_CLASS_BULK] = CONFIG_BRIDGE_TX_WEIGHT_BULK,
+        },
+    };
+    tx_sched_init(&tx_sched, &sched_config);
+    spsc_ring_init(&rx_ring, rx_packets, sizeof(transport_packet_t), MESH_RX_RING_LEN);
+    peer_table_init(&peers);
+
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    ESP_ERROR_CHECK(esp_netif_create_default_wifi_mesh_netifs(&netif_sta, NULL));
+    wifi_init_config_t wifi_config = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+    ESP_ERROR_CHECK(esp_wifi_start());
+    ESP_ERROR_CHECK(esp_wifi_get_mac(WIFI_IF_STA, self_mac));
+
+    ESP_ERROR_CHECK(esp_mesh_init());
+    ESP_ERROR_CHECK(esp_event_handler_register(MESH_EVENT, ESP_EVENT_ANY_ID, mesh_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_mesh_set_topology(CONFIG_MESH_TOPOLOGY));
+    ESP_ERROR_CHECK(esp_mesh_set_max_layer(CONFIG_MESH_MAX_LAYER));
+    ESP_ERROR_CHECK(esp_mesh_set_vote_percentage(1));
+#if CONFIG_BRIDGE_MESH_FIXED_ROOT
+    // Корень назначается, а не выбирается голосованием: наземная станция
+    // всегда корень, выборы не прерывают поток телеметрии
+    ESP_ERROR_CHECK(esp_mesh_fix_root(true));
+#if CONFIG_BRIDGE_MESH_ROOT
+    ESP_ERROR_CHECK(esp_mesh_set_type(MESH_ROOT));
+#endif
+#endif
+    ESP_ERROR_CHECK(esp_mesh_set_xon_qsize(128));
+#if CONFIG_MESH_ENABLE_PS
+    ESP_ERROR_CHECK(esp_mesh_enable_ps());
+    // Узел в режиме энергосбережения отвечает реже: дольше ждем ассоциации
+    ESP_ERROR_CHECK(esp_mesh_set_ap_assoc_expire(60));
+    ESP_ERROR_CHECK(esp_mesh_set_announce_interval(600, 3300));
+#else
+    ESP_ERROR_CHECK(esp_mesh_disable_ps());
+    ESP_ERROR_CHECK(esp_mesh_set_ap_assoc_expire(10));
+#endif
+
+    mesh_cfg_t cfg = MESH_INIT_CONFIG_DEFAULT();
+    const uint8_t mesh_id[6] = MESH_NETWORK_ID;
+    memcpy(cfg.mesh_id.addr, mesh_id, sizeof(mesh_id));
+    cfg.channel = CONFIG_MESH_CHANNEL;
+    cfg.router.ssid_len = strlen(CONFIG_MESH_ROUTER_SSID);
+    memcpy(cfg.router.ssid, CONFIG_MESH_ROUTER_SSID, cfg.router.ssid_len);
+    memcpy(cfg.router.password, CONFIG_MESH_ROUTER_PASSWD, strlen(CONFIG_MESH_ROUTER_PASSWD));
+    ESP_ERROR_CHECK(esp_mesh_set_ap_authmode(CONFIG_MESH_AP_AUTHMODE));
+    cfg.mesh_ap.max_connection = CONFIG_MESH_AP_CONNECTIONS;
+    cfg.mesh_ap.nonmesh_max_connection = CONFIG_MESH_NON_MESH_AP_CONNECTIONS;
+    memcpy(cfg.mesh_ap.password, CONFIG_MESH_AP_PASSWD, strlen(CONFIG_MESH_AP_PASSWD));
+    ESP_ERROR_CHECK(esp_mesh_set_config(&cfg));
+
+    // Передача и прием - стадии конвейера на ядре задачи Wi-Fi
+    BRIDGE_TASK_CREATE_STATIC(mesh_tx_task, BRIDGE_TASK_RADIO_TX, RADIO_TX_TASK_STACK, NULL,
+                              RADIO_TX_TASK_PRIO, &tx_task_handle, BRIDGE_RADIO_CORE);
+    BRIDGE_TASK_CREATE_STATIC(mesh_rx_task, "radio_rx", RADIO_RX_TASK_STACK, NULL,
+                              RADIO_RX_TASK_PRIO, NULL, BRIDGE_RADIO_CORE);
+
+    ESP_ERROR_CHECK(esp_mesh_start());
+#if CONFIG_MESH_ENABLE_PS
+    ESP_ERROR_CHECK(esp_mesh_set_active_duty_cycle(CONFIG_MESH_PS_DEV_DUTY, CONFIG_MESH_PS_DEV_DUTY_TYPE));
+    ESP_ERROR_CHECK(esp_mesh_set_network_duty_cycle(CONFIG_MESH_PS_NWK_DUTY, CONFIG_MESH_PS_NWK_DUTY_DURATION,
+                                                    CONFIG_MESH_PS_NWK_DUTY_RULE));
+#endif
+    ESP_LOGI(TAG, "ESP-MESH: топология %d, до %d слоев, канал %d",
+             CONFIG_MESH_TOPOLOGY, CONFIG_MESH_MAX_LAYER, CONFIG_MESH_CHANNEL);
+}
+
+int mesh_get_layer(void) {
+    return mesh_layer;
+}
+
+void mesh_tx_get_stats(mesh_tx_stats_t *stats) {
+    if (!stats || !tx_mutex) return;
+
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    *stats = tx_stats;
+    xSemaphoreGive(tx_mutex);
+}
+
+static esp_err_t mesh_add_peer(const uint8_t *mac, uint32_t groups) {
+    if (!mac) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&peer_lock);
+    peer_entry_t *entry = peer_table_add(&peers, mac, groups);
+    if (entry) {
+        entry->groups |= groups;
+    }
+    portEXIT_CRITICAL(&peer_lock);
+    return entry ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static bool mesh_has_peer(const uint8_t *mac) {
+    portENTER_CRITICAL(&peer_lock);
+    bool found = mac && peer_table_find(&peers, mac) != NULL;
+    portEXIT_CRITICAL(&peer_lock);
+    return found;
+}
+
+static uint8_t mesh_peer_count(void) {
+    return peers.count;
+}
+
+static bool mesh_tx_wait_space(TickType_t ticks_to_wait) {
+    if (!tx_space_sem) {
+        return false;
+    }
+    return xSemaphoreTake(tx_space_sem, ticks_to_wait) == pdTRUE;
+}
+
+static void mesh_tx_get_class_stats(tx_class_t cls, tx_sched_class_stats_t *stats) {
+    if (!stats || (unsigned)cls >= TX_CLASS_COUNT || !tx_mutex) return;
+
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    *stats = tx_sched.stats[cls];
+    xSemaphoreGive(tx_mutex);
+}
+
+// Подтверждений получателя у ESP-MESH нет: доставкой считается прием
+// пакета стеком, недоставкой - ошибка esp_mesh_send. Широковещательные
+// пакеты узла уходят корню, для них берутся счетчики всех передач
+static bool mesh_get_link_stats(const transport_dest_t *dest, peer_link_stats_t *stats) {
+    if (!dest || !stats || !tx_mutex) return false;
+
+    bool found = true;
+    portENTER_CRITICAL(&peer_lock);
+    if (dest->mode == TRANSPORT_DEST_UNICAST) {
+        const peer_entry_t *peer = peer_table_find(&peers, dest->mac);
+        found = peer != NULL;
+        if (peer) {
+            *stats = peer->stats;
+        }
+    } else if (dest->mode == TRANSPORT_DEST_GROUP) {
+        found = peer_table_group_stats(&peers, dest->groups, stats) > 0;
+    }
+    portEXIT_CRITICAL(&peer_lock);
+
+    if (dest->mode == TRANSPORT_DEST_BROADCAST) {
+        memset(stats, 0, sizeof(*stats));
+        xSemaphoreTake(tx_mutex, portMAX_DELAY);
+        stats->tx_ok = tx_stats.send_ok;
+        stats->tx_fail = tx_stats.no_route + tx_stats.send_errors;
+        xSemaphoreGive(tx_mutex);
+    }
+    return found;
+}
+
+static const transport_packet_t *mesh_rx_receive(TickType_t ticks_to_wait) {
+    if (!rx_consumer_task) {
+        rx_consumer_task = xTaskGetCurrentTaskHandle();
+    }
+
+    const transport_packet_t *packet = spsc_ring_peek(&rx_ring);
+    if (!packet && ulTaskNotifyTake(pdTRUE, ticks_to_wait) > 0) {
+        packet = spsc_ring_peek(&rx_ring);
+    }
+    return packet;
+}
+
+static void mesh_rx_release(void) {
+    spsc_ring_release(&rx_ring);
+}
+
+static void mesh_rx_get_stats(transport_rx_stats_t *stats) {
+    if (!stats) return;
+    *stats = rx_stats;
+}
+
+const transport_t transport_mesh = {
+    .name = "mesh",
+    .init = mesh_init,
+    .add_peer = mesh_add_peer,
+    .has_peer = mesh_has_peer,
+    .peer_count = mesh_peer_count,
+    .send = mesh_send,
+    .wait_space = mesh_tx_wait_space,
+    .get_class_stats = mesh_tx_get_class_stats,
+    .get_link_stats = mesh_get_link_stats,
+    .receive = mesh_rx_receive,
+    .release = mesh_rx_release,
+    .get_rx_stats = mesh_rx_get_stats,
+};
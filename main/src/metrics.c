@@ -0,0 +1,97 @@
+#include <string.h>
+#include "metrics.h"
+#include "drone_msg_view.h"
+
+_Static_assert(METRICS_FRAME_SIZE <= 250, "Снимок метрик не помещается в пакет ESP-NOW");
+
+metrics_core_t metrics_cores[portNUM_PROCESSORS];
+
+uint32_t metrics_get(metric_counter_t id) {
+    uint32_t sum = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        sum += __atomic_load_n(&metrics_cores[core].counters[id], __ATOMIC_RELAXED);
+    }
+    return sum;
+}
+
+// Корзины участка id по всем ядрам
+static void sum_buckets(metric_hist_t id, uint32_t *buckets) {
+    memset(buckets, 0, LATENCY_HIST_BUCKETS * sizeof(uint32_t));
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+            buckets[i] += __atomic_load_n(&metrics_cores[core].hists[id][i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Заполняет счетчик и максимум по корзинам. Максимум - верхняя граница
+// старшей непустой корзины
+static void finish_hist(latency_hist_t *hist) {
+    hist->count = 0;
+    hist->max_us = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        if (hist->buckets[i]) {
+            hist->count += hist->buckets[i];
+            hist->max_us = latency_hist_bucket_limit(i);
+        }
+    }
+}
+
+void metrics_get_hist(metric_hist_t id, latency_hist_t *hist) {
+    sum_buckets(id, hist->buckets);
+    finish_hist(hist);
+}
+
+size_t metrics_encode(metrics_snapshot_t *snapshot, const uint8_t *mac, uint32_t uptime_ms,
+                      uint8_t *out, size_t max_len) {
+    if (max_len < METRICS_FRAME_SIZE) {
+        return 0;
+    }
+
+    uint8_t *p = out;
+    *p++ = METRICS_MAGIC;
+    *p++ = METRICS_VERSION;
+    *p++ = snapshot->seq++;
+    memcpy(p, mac, 6);
+    p += 6;
+    drone_msg_put_le32(p, uptime_ms);
+    p += 4;
+
+    *p++ = METRIC_COUNT;
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        drone_msg_put_le32(p, metrics_get(id));
+        p += 4;
+    }
+
+    *p++ = METRIC_GAUGE_COUNT;
+    for (int id = 0; id < METRIC_GAUGE_COUNT; id++) {
+        drone_msg_put_le32(p, snapshot->gauges[id]);
+        p += 4;
+    }
+
+    // Гистограммы за интервал - разность с корзинами предыдущего снимка.
+    // Статический буфер: гистограмма не помещается в стек задачи
+    static latency_hist_t interval;
+    *p++ = METRIC_HIST_COUNT;
+    for (int id = 0; id < METRIC_HIST_COUNT; id++) {
+        uint32_t *prev = snapshot->prev[id];
+        sum_buckets(id, interval.buckets);
+        for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+            uint32_t total = interval.buckets[i];
+            interval.buckets[i] = total - prev[i];
+            prev[i] = total;
+        }
+        finish_hist(&interval);
+        drone_msg_put_le32(p, interval.count);
+        drone_msg_put_le32(p + 4, latency_hist_percentile(&interval, 50));
+        drone_msg_put_le32(p + 8, latency_hist_percentile(&interval, 99));
+        drone_msg_put_le32(p + 12, interval.max_us);
+        p += METRICS_HIST_SIZE;
+    }
+
+    return p - out;
+}
+
+bool metrics_is_snapshot(const uint8_t *data, size_t len) {
+    return data && len >= METRICS_HEADER_SIZE && data[0] == METRICS_MAGIC;
+}
@@ -0,0 +1,137 @@
+#include <string.h>
+#include "peer_table.h"
+
+#define BUCKET_MASK (PEER_TABLE_BUCKETS - 1)
+
+_Static_assert((PEER_TABLE_BUCKETS & BUCKET_MASK) == 0, "PEER_TABLE_BUCKETS должна быть степенью двойки");
+_Static_assert(PEER_TABLE_BUCKETS >= 2 * PEER_TABLE_CAPACITY, "Хеш-таблица узлов заполнена больше чем наполовину");
+_Static_assert(PEER_TABLE_CAPACITY < 128, "Индекс записи не помещается в int8_t");
+
+const uint8_t PEER_BROADCAST_MAC[PEER_MAC_LEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Старшие биты хеша - номер корзины
+static inline uint32_t mac_hash(const uint8_t *mac) {
+    return peer_mac_hash(mac) >> 26;
+}
+
+_Static_assert(PEER_TABLE_BUCKETS == 64, "mac_hash возвращает 6 бит");
+
+void peer_table_init(peer_table_t *table) {
+    memset(table, 0, sizeof(*table));
+    memset(table->buckets, -1, sizeof(table->buckets));
+}
+
+// Корзина, в которой лежит узел, или первая пустая корзина его цепочки
+static uint32_t find_bucket(const peer_table_t *table, const uint8_t *mac) {
+    uint32_t bucket = mac_hash(mac);
+    while (table->buckets[bucket] >= 0 &&
+           memcmp(table->entries[table->buckets[bucket]].mac, mac, PEER_MAC_LEN) != 0) {
+        bucket = (bucket + 1) & BUCKET_MASK;
+    }
+    return bucket;
+}
+
+peer_entry_t *peer_table_find(peer_table_t *table, const uint8_t *mac) {
+    int8_t index = table->buckets[find_bucket(table, mac)];
+    return index >= 0 ? &table->entries[index] : NULL;
+}
+
+peer_entry_t *peer_table_add(peer_table_t *table, const uint8_t *mac, uint32_t groups) {
+    uint32_t bucket = find_bucket(table, mac);
+    if (table->buckets[bucket] >= 0) {
+        return &table->entries[table->buckets[bucket]];
+    }
+    if (table->count >= PEER_TABLE_CAPACITY) {
+        return NULL;
+    }
+
+    int index = 0;
+    while (table->entries[index].used) {
+        index++;
+    }
+    peer_entry_t *entry = &table->entries[index];
+    memset(entry, 0, sizeof(*entry));
+    memcpy(entry->mac, mac, PEER_MAC_LEN);
+    entry->used = true;
+    entry->groups = groups;
+    table->buckets[bucket] = index;
+    table->count++;
+    return entry;
+}
+
+bool peer_table_remove(peer_table_t *table, const uint8_t *mac) {
+    uint32_t hole = find_bucket(table, mac);
+    int8_t index = table->buckets[hole];
+    if (index < 0) {
+        return false;
+    }
+    table->entries[index].used = false;
+    table->buckets[hole] = -1;
+    table->count--;
+
+    // Сдвиг следующих записей цепочки на место удаленной вместо пометок
+    // об удалении: цепочки не удлиняются при частых добавлениях и удалениях
+    uint32_t bucket = (hole + 1) & BUCKET_MASK;
+    while (table->buckets[bucket] >= 0) {
+        uint32_t home = mac_hash(table->entries[table->buckets[bucket]].mac);
+        // Запись можно перенести в hole, если ее начальная корзина не лежит
+        // в циклическом интервале (hole, bucket]
+        if (((bucket - home) & BUCKET_MASK) >= ((bucket - hole) & BUCKET_MASK)) {
+            table->buckets[hole] = table->buckets[bucket];
+            table->buckets[bucket] = -1;
+            hole = bucket;
+        }
+        bucket = (bucket + 1) & BUCKET_MASK;
+    }
+    return true;
+}
+
+size_t peer_table_collect(const peer_table_t *table, uint32_t groups,
+                          uint8_t (*macs)[PEER_MAC_LEN], size_t max) {
+    size_t count = 0;
+    for (int i = 0; i < PEER_TABLE_CAPACITY && count < max; i++) {
+        const peer_entry_t *entry = &table->entries[i];
+        if (entry->used && (entry->groups & groups) && !peer_is_broadcast(entry->mac)) {
+            memcpy(macs[count++], entry->mac, PEER_MAC_LEN);
+        }
+    }
+    return count;
+}
+
+size_t peer_table_group_stats(const peer_table_t *table, uint32_t groups, peer_link_stats_t *total) {
+    size_t count = 0;
+    memset(total, 0, sizeof(*total));
+    for (int i = 0; i < PEER_TABLE_CAPACITY; i++) {
+        const peer_entry_t *entry = &table->entries[i];
+        if (!entry->used || !(entry->groups & groups) || peer_is_broadcast(entry->mac)) {
+            continue;
+        }
+        const peer_link_stats_t *stats = &entry->stats;
+        total->tx_ok += stats->tx_ok;
+        total->tx_fail += stats->tx_fail;
+        total->rx_packets += stats->rx_packets;
+        total->rx_bytes += stats->rx_bytes;
+        if (stats->rx_packets && (total->rssi_avg_x16 == 0 || stats->rssi_avg_x16 < total->rssi_avg_x16)) {
+            total->rssi_last = stats->rssi_last;
+            total->rssi_avg_x16 = stats->rssi_avg_x16;
+        }
+        if (stats->last_rx_us > total->last_rx_us) {
+            total->last_rx_us = stats->last_rx_us;
+        }
+        count++;
+    }
+    return count;
+}
+
+void peer_stats_record_rx(peer_link_stats_t *stats, size_t len, int8_t rssi, int64_t now_us) {
+    if (stats->rx_packets == 0) {
+        stats->rssi_avg_x16 = rssi * 16;
+    } else {
+        // Экспоненциальное сглаживание с коэффициентом 1/8
+        stats->rssi_avg_x16 += (rssi * 16 - stats->rssi_avg_x16) / 8;
+    }
+    stats->rx_packets++;
+    stats->rx_bytes += len;
+    stats->rssi_last = rssi;
+    stats->last_rx_us = now_us;
+}
@@ -0,0 +1,115 @@
+#include <string.h>
+#include "rate_ctrl.h"
+
+void rate_ctrl_init(rate_ctrl_t *rc, const rate_ctrl_config_t *config) {
+    if (!rc || !config) return;
+    memset(rc, 0, sizeof(*rc));
+    rc->config = *config;
+    rc->delivery_permille = RATE_CTRL_PERMILLE;
+}
+
+// Предел вдвое ниже текущего или, если ограничения не было, входной частоты
+static void rate_ctrl_decrease(rate_ctrl_t *rc) {
+    uint32_t base = rc->limit_hz ? rc->limit_hz : rc->input_hz;
+    if (base == 0) {
+        return;
+    }
+    uint32_t limit = base / 2;
+    if (limit < rc->config.min_hz) {
+        limit = rc->config.min_hz;
+    }
+    if (limit != rc->limit_hz) {
+        rc->limit_hz = limit;
+        rc->stats.decreases++;
+    }
+}
+
+static void rate_ctrl_increase(rate_ctrl_t *rc) {
+    if (rc->limit_hz == 0) {
+        return;
+    }
+    rc->limit_hz += rc->config.step_hz ? rc->config.step_hz : 1;
+    rc->stats.increases++;
+    // Предел выше входной частоты ничего не ограничивает
+    if (rc->limit_hz > rc->input_hz) {
+        rc->limit_hz = 0;
+    }
+}
+
+void rate_ctrl_update(rate_ctrl_t *rc, const rate_ctrl_sample_t *sample, int64_t now_us) {
+    if (!rc->started) {
+        rc->started = true;
+        rc->last_update_us = now_us;
+        rc->last_ok = sample->tx_ok;
+        rc->last_fail = sample->tx_fail;
+        rc->last_drops = sample->queue_drops;
+        rc->period_offered = 0;
+        return;
+    }
+    int64_t elapsed = now_us - rc->last_update_us;
+    if (elapsed <= 0) {
+        return;
+    }
+    rc->input_hz = (uint32_t)((uint64_t)rc->period_offered * 1000000 / elapsed);
+    rc->period_offered = 0;
+    rc->last_update_us = now_us;
+
+    uint32_t drops = sample->queue_drops - rc->last_drops;
+    rc->last_drops = sample->queue_drops;
+
+    // При малой частоте передач счетчики копятся за несколько периодов
+    uint32_t ok = sample->tx_ok - rc->last_ok;
+    uint32_t fail = sample->tx_fail - rc->last_fail;
+    bool measured = ok + fail >= RATE_CTRL_MIN_SAMPLES;
+    if (measured) {
+        uint32_t delivery = (uint64_t)ok * RATE_CTRL_PERMILLE / (ok + fail);
+        // Экспоненциальное сглаживание с коэффициентом 1/2
+        rc->delivery_permille = (rc->delivery_permille + delivery) / 2;
+        rc->last_ok = sample->tx_ok;
+        rc->last_fail = sample->tx_fail;
+    }
+
+    bool weak = rc->config.rssi_poor_dbm && sample->rssi_dbm && sample->rssi_dbm < rc->config.rssi_poor_dbm;
+    if (drops > 0 || (measured && rc->delivery_permille < rc->config.poor_permille)) {
+        rate_ctrl_decrease(rc);
+    } else if (measured && rc->delivery_permille >= rc->config.good_permille && !weak) {
+        rate_ctrl_increase(rc);
+    }
+}
+
+// Опоздание меньше интервала не сбивает частоту, большее - начинает отсчет
+// заново
+static void rate_ctrl_advance(rate_ctrl_t *rc, int64_t now_us) {
+    int64_t interval = 1000000 / rc->limit_hz;
+    rc->next_us = now_us - rc->next_us < interval ? rc->next_us + interval : now_us + interval;
+}
+
+bool rate_ctrl_admit(rate_ctrl_t *rc, int64_t now_us) {
+    rc->stats.offered++;
+    rc->period_offered++;
+    if (rc->held) {
+        rc->held = false;
+        rc->stats.decimated++;
+    }
+    if (rc->limit_hz == 0) {
+        return true;
+    }
+    if (now_us < rc->next_us) {
+        rc->held = true;
+        return false;
+    }
+    rate_ctrl_advance(rc, now_us);
+    return true;
+}
+
+bool rate_ctrl_release(rate_ctrl_t *rc, int64_t now_us) {
+    if (!rc->held || (rc->limit_hz && now_us < rc->next_us)) {
+        return false;
+    }
+    rc->held = false;
+    // Предел мог быть снят, пока сообщение ждало
+    if (rc->limit_hz) {
+        rate_ctrl_advance(rc, now_us);
+    }
+    return true;
+}
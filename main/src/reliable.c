@@ -0,0 +1,240 @@
+#include <string.h>
+#include "reliable.h"
+
+#define SLOT_MASK (RELIABLE_QUEUE_LEN - 1)
+
+_Static_assert((RELIABLE_QUEUE_LEN & SLOT_MASK) == 0 && RELIABLE_QUEUE_LEN <= 32,
+               "Длина очереди должна быть степенью двойки не больше 32");
+
+// Начальный тайм-аут до первого измерения RTT
+#define RELIABLE_INITIAL_RTO_US 100000
+
+static inline reliable_slot_t *slot_of(reliable_link_t *link, uint8_t seq) {
+    return &link->slots[seq & SLOT_MASK];
+}
+
+static uint32_t clamp_rto(const reliable_link_t *link, uint32_t rto) {
+    if (rto < link->config.rto_min_us) return link->config.rto_min_us;
+    if (rto > link->config.rto_max_us) return link->config.rto_max_us;
+    return rto;
+}
+
+// Оценка RTT по Джекобсону-Карелсу (RFC 6298): srtt += (r - srtt)/8, rttvar += (|r - srtt| - rttvar)/4
+static void update_rtt(reliable_link_t *link, uint32_t sample) {
+    if (!link->rtt_valid) {
+        link->srtt_us = sample;
+        link->rttvar_us = sample / 2;
+        link->rtt_valid = true;
+    } else {
+        uint32_t err = sample > link->srtt_us ? sample - link->srtt_us : link->srtt_us - sample;
+        link->rttvar_us = (3 * link->rttvar_us + err) / 4;
+        link->srtt_us = (7 * link->srtt_us + sample) / 8;
+    }
+    link->rto_us = clamp_rto(link, link->srtt_us + 4 * link->rttvar_us);
+    link->stats.srtt_us = link->srtt_us;
+    link->stats.rto_us = link->rto_us;
+}
+
+static void transmit(reliable_link_t *link, uint8_t seq, int64_t now_us) {
+    reliable_slot_t *slot = slot_of(link, seq);
+    uint8_t packet[RELIABLE_DATA_HEADER + RELIABLE_MAX_FRAME];
+
+    packet[0] = RELIABLE_DATA_MAGIC;
+    packet[1] = link->epoch;
+    packet[2] = seq;
+    packet[3] = link->tx_base;
+    memcpy(packet + RELIABLE_DATA_HEADER, slot->data, slot->len);
+
+    if (!slot->sent) {
+        slot->sent = true;
+        slot->first_sent_us = now_us;
+        slot->rto_us = link->rto_us;
+    }
+    slot->sent_us = now_us;
+    slot->deadline_us = now_us + slot->rto_us;
+
+    link->send(packet, RELIABLE_DATA_HEADER + slot->len, link->user_ctx);
+}
+
+// Сдвигает начало окна за подтвержденные кадры и передает кадры, вошедшие в окно
+static void advance_window(reliable_link_t *link, int64_t now_us) {
+    while (link->tx_base != link->tx_next && slot_of(link, link->tx_base)->done) {
+        link->tx_base++;
+    }
+    for (uint8_t seq = link->tx_base;
+         seq != link->tx_next && (uint8_t)(seq - link->tx_base) < link->config.window; seq++) {
+        reliable_slot_t *slot = slot_of(link, seq);
+        if (!slot->sent && !slot->done) {
+            transmit(link, seq, now_us);
+        }
+    }
+}
+
+void reliable_init(reliable_link_t *link, const reliable_config_t *config, uint8_t epoch,
+                   reliable_send_fn_t send, void *user_ctx) {
+    memset(link, 0, sizeof(*link));
+    link->config = *config;
+    if (link->config.window == 0 || link->config.window > RELIABLE_MAX_WINDOW) {
+        link->config.window = RELIABLE_MAX_WINDOW;
+    }
+    if (link->config.rto_max_us < link->config.rto_min_us) {
+        link->config.rto_max_us = link->config.rto_min_us;
+    }
+    link->epoch = epoch ? epoch : 1;
+    link->send = send;
+    link->user_ctx = user_ctx;
+    link->rto_us = clamp_rto(link, RELIABLE_INITIAL_RTO_US);
+    link->stats.rto_us = link->rto_us;
+    latency_hist_reset(&link->stats.ack_time_us);
+}
+
+uint8_t reliable_pending(const reliable_link_t *link) {
+    return (uint8_t)(link->tx_next - link->tx_base);
+}
+
+reliable_status_t reliable_send(reliable_link_t *link, const uint8_t *frame, size_t len, int64_t now_us) {
+    if (!link || !frame || len == 0 || len > RELIABLE_MAX_FRAME) {
+        return RELIABLE_INVALID;
+    }
+    if (reliable_pending(link) >= RELIABLE_QUEUE_LEN) {
+        link->stats.rejected++;
+        return RELIABLE_FULL;
+    }
+
+    reliable_slot_t *slot = slot_of(link, link->tx_next);
+    memcpy(slot->data, frame, len);
+    slot->len = (uint8_t)len;
+    slot->retries = 0;
+    slot->sent = false;
+    slot->done = false;
+    link->tx_next++;
+    link->stats.sent++;
+
+    advance_window(link, now_us);
+    return RELIABLE_OK;
+}
+
+bool reliable_is_link_frame(const uint8_t *data, size_t len) {
+    return data && ((len > RELIABLE_DATA_HEADER && data[0] == RELIABLE_DATA_MAGIC) ||
+                    (len == RELIABLE_ACK_SIZE && data[0] == RELIABLE_ACK_MAGIC));
+}
+
+void reliable_rx_init(reliable_rx_t *rx) {
+    memset(rx, 0, sizeof(*rx));
+}
+
+static void fill_ack(const reliable_rx_t *rx, uint8_t ack[RELIABLE_ACK_SIZE]) {
+    ack[0] = RELIABLE_ACK_MAGIC;
+    ack[1] = rx->epoch;
+    ack[2] = rx->next;
+    ack[3] = rx->bitmap & 0xFF;
+    ack[4] = (rx->bitmap >> 8) & 0xFF;
+    ack[5] = (rx->bitmap >> 16) & 0xFF;
+    ack[6] = rx->bitmap >> 24;
+}
+
+// Сдвигает окно приема, пока первый номер в нем уже принят
+static void rx_normalize(reliable_rx_t *rx) {
+    while (rx->bitmap & 1) {
+        rx->bitmap >>= 1;
+        rx->next++;
+    }
+}
+
+reliable_rx_status_t reliable_rx_data(reliable_rx_t *rx, const uint8_t *data, size_t len,
+                                      const uint8_t **frame, size_t *frame_len,
+                                      uint8_t ack[RELIABLE_ACK_SIZE]) {
+    uint8_t epoch = data[1];
+    uint8_t seq = data[2];
+    uint8_t base = data[3];
+
+    // Новый сеанс отправителя (первый кадр или перезагрузка партнера)
+    if (!rx->synced || epoch != rx->epoch) {
+        rx->synced = true;
+        rx->epoch = epoch;
+        rx->next = base;
+        rx->bitmap = 0;
+    }
+
+    // Отправитель больше не ждет кадров до base: пропущенные уже не придут
+    while ((uint8_t)(base - rx->next) < 128 && rx->next != base) {
+        rx->bitmap >>= 1;
+        rx->next++;
+    }
+    rx_normalize(rx);
+
+    // Окно отправителя не больше RELIABLE_MAX_WINDOW от base, поэтому номер
+    // на 32..127 впереди означает сбой нумерации: кадр учитывается отдельно,
+    // а подтверждение сообщает отправителю, что принято на самом деле
+    reliable_rx_status_t status;
+    uint8_t dist = (uint8_t)(seq - rx->next);
+    if (dist >= 128 || (dist < 32 && (rx->bitmap & (1u << dist)))) {
+        rx->duplicates++;
+        status = RELIABLE_RX_DUPLICATE;
+    } else if (dist >= 32) {
+        rx->out_of_window++;
+        status = RELIABLE_RX_OUT_OF_WINDOW;
+    } else {
+        rx->bitmap |= 1u << dist;
+        rx_normalize(rx);
+        rx->delivered++;
+        *frame = data + RELIABLE_DATA_HEADER;
+        *frame_len = len - RELIABLE_DATA_HEADER;
+        status = RELIABLE_RX_DELIVER;
+    }
+    // Подтверждение отправляется и на дубликат: предыдущее могло потеряться
+    fill_ack(rx, ack);
+    return status;
+}
+
+void reliable_on_ack(reliable_link_t *link, const uint8_t *data, size_t len, int64_t now_us) {
+    if (!link || len != RELIABLE_ACK_SIZE || data[0] != RELIABLE_ACK_MAGIC || data[1] != link->epoch) {
+        return;
+    }
+    uint8_t cum = data[2];
+    uint32_t bitmap = (uint32_t)data[3] | ((uint32_t)data[4] << 8) |
+                      ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 24);
+
+    for (uint8_t seq = link->tx_base; seq != link->tx_next; seq++) {
+        reliable_slot_t *slot = slot_of(link, seq);
+        if (slot->done || !slot->sent) {
+            continue;
+        }
+        uint8_t before = (uint8_t)(cum - seq);
+        uint8_t after = (uint8_t)(seq - cum);
+        bool acked = (before >= 1 && before < 128) || (after < 32 && (bitmap & (1u << after)));
+        if (!acked) {
+            continue;
+        }
+        slot->done = true;
+        link->stats.acked++;
+        latency_hist_record(&link->stats.ack_time_us, now_us - slot->first_sent_us);
+        // Алгоритм Карна: RTT измеряется только по кадрам без повторов
+        if (slot->retries == 0) {
+            update_rtt(link, (uint32_t)(now_us - slot->sent_us));
+        }
+    }
+    advance_window(link, now_us);
+}
+
+void reliable_poll(reliable_link_t *link, int64_t now_us) {
+    if (!link) return;
+
+    for (uint8_t seq = link->tx_base; seq != link->tx_next; seq++) {
+        reliable_slot_t *slot = slot_of(link, seq);
+        if (slot->done || !slot->sent || now_us < slot->deadline_us) {
+            continue;
+        }
+        if (slot->retries >= link->config.max_retries) {
+            slot->done = true;
+            link->stats.failed++;
+            continue;
+        }
+        slot->retries++;
+        link->stats.retransmits++;
+        // Экспоненциальное увеличение тайм-аута для кадра, потерянного повторно
+        slot->rto_us = clamp_rto(link, slot->rto_us * 2);
+        transmit(link, seq, now_us);
+    }
+    advance_window(link, now_us);
+}
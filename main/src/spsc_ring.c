@@ -0,0 +1,53 @@
+#include "spsc_ring.h"
+
+int spsc_ring_init(spsc_ring_t *ring, void *storage, size_t elem_size, uint32_t capacity) {
+    if (!ring || !storage || elem_size == 0 || capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return -1;
+    }
+    
+    ring->storage = storage;
+    ring->elem_size = elem_size;
+    ring->mask = capacity - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    return 0;
+}
+
+void *spsc_ring_acquire(spsc_ring_t *ring) {
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    
+    if (head - tail > ring->mask) {
+        return NULL;
+    }
+    return ring->storage + (size_t)(head & ring->mask) * ring->elem_size;
+}
+
+uint32_t spsc_ring_publish(spsc_ring_t *ring) {
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    
+    // Данные элемента должны стать видимы потребителю раньше новой позиции записи
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return head - tail;
+}
+
+void *spsc_ring_peek(spsc_ring_t *ring) {
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    
+    if (head == tail) {
+        return NULL;
+    }
+    return ring->storage + (size_t)(tail & ring->mask) * ring->elem_size;
+}
+
+void spsc_ring_release(spsc_ring_t *ring) {
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t spsc_ring_count(const spsc_ring_t *ring) {
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    return head - tail;
+}
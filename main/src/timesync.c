@@ -0,0 +1,229 @@
+#include <string.h>
+#include <stdlib.h>
+#include "timesync.h"
+#include "drone_msg_view.h"
+
+static void put_le64(uint8_t *p, int64_t v) {
+    drone_msg_put_le32(p, (uint32_t)v);
+    drone_msg_put_le32(p + 4, (uint32_t)((uint64_t)v >> 32));
+}
+
+static int64_t get_le64(const uint8_t *p) {
+    return (int64_t)((uint64_t)drone_msg_le32(p + 4) << 32 | drone_msg_le32(p));
+}
+
+void timesync_init(timesync_t *ts, bool reference, int64_t holdover_us) {
+    if (!ts) return;
+    memset(ts, 0, sizeof(*ts));
+    ts->reference = reference;
+    ts->stratum = reference ? 0 : TIMESYNC_STRATUM_NONE;
+    ts->holdover_us = holdover_us;
+}
+
+bool timesync_is_sync_frame(const uint8_t *data, size_t len) {
+    return data && len >= 2 && data[0] == TIMESYNC_MAGIC &&
+           (data[1] == TIMESYNC_OP_PING || data[1] == TIMESYNC_OP_PONG);
+}
+
+int64_t timesync_now(const timesync_t *ts, int64_t local_us) {
+    if (ts->reference || !ts->has_model) {
+        return local_us;
+    }
+    return local_us + ts->base_offset_us + (local_us - ts->base_local_us) * ts->drift_ppb / 1000000000;
+}
+
+void timesync_expire(timesync_t *ts, int64_t local_us) {
+    if (ts->reference || !ts->has_server || local_us - ts->last_sample_us <= ts->holdover_us) {
+        return;
+    }
+    // Смещение, уход часов и точки ухода сохраняются: общее время продолжает
+    // идти по модели, а после возобновления ответов уход уточняется по
+    // точкам до и после перерыва. Окно обменов начинается заново, чтобы
+    // смещение взялось по свежим обменам
+    ts->has_server = false;
+    ts->stratum = TIMESYNC_STRATUM_NONE;
+    ts->sample_count = 0;
+    ts->sample_next = 0;
+    ts->stats.lost_sync++;
+}
+
+size_t timesync_ping(timesync_t *ts, int64_t local_us, uint8_t *out) {
+    if (ts->reference) {
+        return 0;
+    }
+    timesync_expire(ts, local_us);
+    ts->ping_seq++;
+    ts->ping_t1 = local_us;
+    out[0] = TIMESYNC_MAGIC;
+    out[1] = TIMESYNC_OP_PING;
+    out[2] = ts->ping_seq;
+    put_le64(out + 3, local_us);
+    ts->stats.pings++;
+    return TIMESYNC_PING_SIZE;
+}
+
+size_t timesync_answer(timesync_t *ts, const uint8_t *frame, size_t len, int64_t rx_local_us,
+                       int64_t tx_local_us, uint8_t *out) {
+    if (!frame || len != TIMESYNC_PING_SIZE || frame[0] != TIMESYNC_MAGIC || frame[1] != TIMESYNC_OP_PING ||
+        !timesync_synced(ts)) {
+        return 0;
+    }
+    out[0] = TIMESYNC_MAGIC;
+    out[1] = TIMESYNC_OP_PONG;
+    out[2] = frame[2];
+    out[3] = ts->stratum;
+    memcpy(out + 4, frame + 3, 8);
+    put_le64(out + 12, timesync_now(ts, rx_local_us));
+    put_le64(out + 20, timesync_now(ts, tx_local_us));
+    ts->stats.answered++;
+    return TIMESYNC_PONG_SIZE;
+}
+
+// Уход часов - наклон прямой, проведенной по точкам методом наименьших
+// квадратов. Вызывается раз в несколько секунд, поэтому в double
+static void estimate_drift(timesync_t *ts) {
+    if (ts->point_count < 2) {
+        return;
+    }
+    const timesync_sample_t *origin = &ts->points[0];
+    double mean_x = 0;
+    double mean_y = 0;
+    for (int i = 0; i < ts->point_count; i++) {
+        mean_x += (double)(ts->points[i].local_us - origin->local_us);
+        mean_y += (double)(ts->points[i].offset_us - origin->offset_us);
+    }
+    mean_x /= ts->point_count;
+    mean_y /= ts->point_count;
+
+    double sxx = 0;
+    double sxy = 0;
+    for (int i = 0; i < ts->point_count; i++) {
+        double dx = (double)(ts->points[i].local_us - origin->local_us) - mean_x;
+        double dy = (double)(ts->points[i].offset_us - origin->offset_us) - mean_y;
+        sxx += dx * dx;
+        sxy += dx * dy;
+    }
+    if (sxx <= 0) {
+        return;
+    }
+    double ppb = sxy / sxx * 1e9;
+    if (ppb > TIMESYNC_DRIFT_MAX_PPB) ppb = TIMESYNC_DRIFT_MAX_PPB;
+    if (ppb < -TIMESYNC_DRIFT_MAX_PPB) ppb = -TIMESYNC_DRIFT_MAX_PPB;
+    ts->drift_ppb = (int32_t)ppb;
+}
+
+// Смещение берется по обмену окна с наименьшей задержкой. Он же становится
+// точкой оценки ухода часов, если с предыдущей точки прошло достаточно времени
+static void update_model(timesync_t *ts) {
+    const timesync_sample_t *best = &ts->samples[0];
+    for (int i = 1; i < ts->sample_count; i++) {
+        if (ts->samples[i].delay_us < best->delay_us) {
+            best = &ts->samples[i];
+        }
+    }
+    if (ts->sample_count > 1 && best->local_us <= ts->base_local_us) {
+        return;
+    }
+    ts->has_model = true;
+    ts->base_local_us = best->local_us;
+    ts->base_offset_us = best->offset_us;
+    ts->base_delay_us = best->delay_us;
+
+    const timesync_sample_t *last = ts->point_count ?
+        &ts->points[(ts->point_next + TIMESYNC_POINTS - 1) % TIMESYNC_POINTS] : NULL;
+    if (last && best->local_us - last->local_us < TIMESYNC_POINT_SPACING_US) {
+        return;
+    }
+    ts->points[ts->point_next] = *best;
+    ts->point_next = (ts->point_next + 1) % TIMESYNC_POINTS;
+    if (ts->point_count < TIMESYNC_POINTS) {
+        ts->point_count++;
+    }
+    // Точки в порядке времени: самая старая - первая
+    if (ts->point_count == TIMESYNC_POINTS && ts->point_next != 0) {
+        timesync_sample_t ordered[TIMESYNC_POINTS];
+        for (int i = 0; i < TIMESYNC_POINTS; i++) {
+            ordered[i] = ts->points[(ts->point_next + i) % TIMESYNC_POINTS];
+        }
+        memcpy(ts->points, ordered, sizeof(ordered));
+        ts->point_next = 0;
+    }
+    estimate_drift(ts);
+}
+
+bool timesync_on_pong(timesync_t *ts, const uint8_t *mac, const uint8_t *frame, size_t len, int64_t rx_local_us) {
+    if (!ts || !mac || !frame || len != TIMESYNC_PONG_SIZE || frame[0] != TIMESYNC_MAGIC ||
+        frame[1] != TIMESYNC_OP_PONG || ts->reference) {
+        return false;
+    }
+    uint8_t stratum = frame[3];
+    int64_t t1 = get_le64(frame + 4);
+    int64_t t2 = get_le64(frame + 12);
+    int64_t t3 = get_le64(frame + 20);
+    int64_t t4 = rx_local_us;
+    int64_t delay = (t4 - t1) - (t3 - t2);
+
+    // Ответ на последний запрос от узла ближе к эталону, чем этот узел
+    if (frame[2] != ts->ping_seq || t1 != ts->ping_t1 || stratum >= TIMESYNC_STRATUM_NONE - 1 ||
+        t3 < t2 || delay < 0) {
+        ts->stats.rejected++;
+        return false;
+    }
+    timesync_expire(ts, t4);
+    if (ts->has_server && memcmp(mac, ts->server, sizeof(ts->server)) != 0) {
+        if (stratum >= ts->server_stratum) {
+            ts->stats.rejected++;
+            return false;
+        }
+        // Узел ближе к эталону: окно начинается заново, уход часов остается
+        ts->sample_count = 0;
+        ts->sample_next = 0;
+    }
+    int64_t offset = ((t2 - t1) + (t3 - t4)) / 2;
+    if (timesync_stale(ts) && llabs(offset - (timesync_now(ts, t4) - t4)) > TIMESYNC_STEP_US) {
+        // Часы эталона переставлены (перезапуск): точки ухода до перерыва не годятся
+        ts->point_count = 0;
+        ts->point_next = 0;
+    }
+    ts->has_server = true;
+    memcpy(ts->server, mac, sizeof(ts->server));
+    ts->server_stratum = stratum;
+    ts->stratum = stratum + 1;
+    ts->last_sample_us = t4;
+    ts->ping_t1 = INT64_MIN;
+
+    ts->samples[ts->sample_next] = (timesync_sample_t){
+        .local_us = t4,
+        .offset_us = offset,
+        .delay_us = delay,
+    };
+    ts->sample_next = (ts->sample_next + 1) % TIMESYNC_SAMPLES;
+    if (ts->sample_count < TIMESYNC_SAMPLES) {
+        ts->sample_count++;
+    }
+    ts->stats.samples++;
+    update_model(ts);
+    return true;
+}
+
+size_t timesync_stamp(uint32_t stamp_us, const uint8_t *frame, size_t len, uint8_t *out, size_t cap) {
+    if (!frame || len + TIMESYNC_STAMP_HEADER > cap) {
+        return 0;
+    }
+    memmove(out + TIMESYNC_STAMP_HEADER, frame, len);
+    out[0] = TIMESYNC_MAGIC;
+    out[1] = TIMESYNC_OP_STAMP;
+    drone_msg_put_le32(out + 2, stamp_us);
+    return len + TIMESYNC_STAMP_HEADER;
+}
+
+bool timesync_unstamp(const uint8_t **frame, size_t *len, uint32_t *stamp_us) {
+    const uint8_t *data = *frame;
+    if (!data || *len <= TIMESYNC_STAMP_HEADER || data[0] != TIMESYNC_MAGIC || data[1] != TIMESYNC_OP_STAMP) {
+        return false;
+    }
+    *stamp_us = drone_msg_le32(data + 2);
+    *frame = data + TIMESYNC_STAMP_HEADER;
+    *len -= TIMESYNC_STAMP_HEADER;
+    return true;
+}
@@ -0,0 +1,10 @@
+#include "transport.h"
+#include "sdkconfig.h"
+
+const transport_t *transport_get(void) {
+#if CONFIG_BRIDGE_TRANSPORT_MESH
+    return &transport_mesh;
+#else
+    return &transport_espnow;
+#endif
+}
@@ -0,0 +1,311 @@
+#include <string.h>
+#include "tx_sched.h"
+#include "drone_message.h"
+#include "aggregator.h"
+#include "reliable.h"
+#include "fragment.h"
+#include "flightrec.h"
+#include "timesync.h"
+
+// Квант взвешенного обслуживания на единицу веса: MTU ESP-NOW, чтобы за
+// один раунд класс с весом 1 мог передать хотя бы один пакет
+#define TX_SCHED_QUANTUM 250
+
+static inline bool is_weighted(int cls) {
+    return cls >= TX_CLASS_FIRST_WEIGHTED;
+}
+
+static tx_class_t frame_class(const uint8_t *frame, size_t len) {
+    if (len == 0) {
+        return TX_CLASS_BULK;
+    }
+    switch (frame[0]) {
+        case MSG_TYPE_ALERT:
+            return TX_CLASS_ALERT;
+        case MSG_TYPE_COMMAND:
+        case MSG_TYPE_ACK:
+        case RELIABLE_ACK_MAGIC:
+            return TX_CLASS_CONTROL;
+        case MSG_TYPE_TELEMETRY:
+            return TX_CLASS_TELEMETRY;
+        case FRAGMENT_MAGIC:
+            // Фрагмент несет первый байт исходного кадра
+            return len > 1 ? frame_class(frame + 1, 1) : TX_CLASS_BULK;
+        case RELIABLE_DATA_MAGIC:
+            return len > RELIABLE_DATA_HEADER ?
+                frame_class(frame + RELIABLE_DATA_HEADER, len - RELIABLE_DATA_HEADER) : TX_CLASS_BULK;
+        case FLIGHTREC_MAGIC:
+            // Запрос чтения журнала - команда, ответ на него - фоновые данные
+            return flightrec_parse_request(frame, len, NULL) ? TX_CLASS_CONTROL : TX_CLASS_BULK;
+        case TIMESYNC_MAGIC:
+            // Кадр с меткой времени - класс исходного кадра. Запросы и ответы
+            // синхронизации не ждут телеметрию: очередь искажает задержку
+            if (len > TIMESYNC_STAMP_HEADER && frame[1] == TIMESYNC_OP_STAMP) {
+                return frame_class(frame + TIMESYNC_STAMP_HEADER, len - TIMESYNC_STAMP_HEADER);
+            }
+            return TX_CLASS_CONTROL;
+        default:
+            return TX_CLASS_BULK;
+    }
+}
+
+static void container_class_cb(const uint8_t *frame, size_t len, void *user_ctx) {
+    tx_class_t *cls = user_ctx;
+    tx_class_t frame_cls = frame_class(frame, len);
+    if (frame_cls < *cls) {
+        *cls = frame_cls;
+    }
+}
+
+tx_class_t tx_class_of(const uint8_t *packet, size_t len) {
+    if (!packet) {
+        return TX_CLASS_BULK;
+    }
+    if (aggregator_is_container(packet, len)) {
+        tx_class_t cls = TX_CLASS_BULK;
+        if (aggregator_unpack(packet, len, container_class_cb, &cls) < 0) {
+            return TX_CLASS_BULK;
+        }
+        return cls;
+    }
+    return frame_class(packet, len);
+}
+
+bool tx_evictable(const uint8_t *packet, size_t len) {
+    if (fragment_is_fragment(packet, len)) {
+        return false;
+    }
+    // Ответ на запрос чтения журнала не повторяется: вытесненный пакет
+    // оставил бы пропуск в прочитанном интервале
+    return !(len > 0 && packet[0] == FLIGHTREC_MAGIC && !flightrec_parse_request(packet, len, NULL));
+}
+
+void tx_sched_init(tx_sched_t *sched, const tx_sched_config_t *config) {
+    memset(sched, 0, sizeof(*sched));
+    sched->config = *config;
+    if (sched->config.capacity == 0 || sched->config.capacity > TX_SCHED_MAX_SLOTS) {
+        sched->config.capacity = TX_SCHED_MAX_SLOTS;
+    }
+    if (sched->config.reserve >= sched->config.capacity) {
+        sched->config.reserve = sched->config.capacity - 1;
+    }
+    for (int cls = TX_CLASS_FIRST_WEIGHTED; cls < TX_CLASS_COUNT; cls++) {
+        if (sched->config.weight[cls] == 0) {
+            sched->config.weight[cls] = 1;
+        }
+        latency_hist_reset(&sched->stats[cls].queue_delay_us);
+    }
+    for (int cls = 0; cls < TX_CLASS_FIRST_WEIGHTED; cls++) {
+        latency_hist_reset(&sched->stats[cls].queue_delay_us);
+    }
+    for (int i = 0; i < sched->config.capacity; i++) {
+        sched->free_slots[i] = i;
+    }
+    sched->free_count = sched->config.capacity;
+    sched->drr_class = TX_CLASS_FIRST_WEIGHTED;
+    sched->selected = -1;
+}
+
+static inline uint8_t slot_at(const tx_sched_t *sched, int cls, int pos) {
+    return sched->order[cls][(sched->head[cls] + pos) % TX_SCHED_MAX_SLOTS];
+}
+
+// Удаляет пакет с позиции pos очереди класса: следующие пакеты сдвигаются
+// на его место. Возвращает слот пакета
+static uint8_t remove_at(tx_sched_t *sched, int cls, int pos) {
+    uint8_t *order = sched->order[cls];
+    uint8_t slot = slot_at(sched, cls, pos);
+    if (pos == 0) {
+        sched->head[cls] = (sched->head[cls] + 1) % TX_SCHED_MAX_SLOTS;
+    } else {
+        for (int j = pos; j + 1 < sched->count[cls]; j++) {
+            order[(sched->head[cls] + j) % TX_SCHED_MAX_SLOTS] =
+                order[(sched->head[cls] + j + 1) % TX_SCHED_MAX_SLOTS];
+        }
+    }
+    sched->count[cls]--;
+    return slot;
+}
+
+// Удаляет самый старый вытесняемый пакет наименее приоритетного
+// вытесняемого класса, не выше min_cls по приоритету. Невытесняемые пакеты
+// пропускаются
+static bool evict(tx_sched_t *sched, int min_cls) {
+    for (int cls = TX_CLASS_COUNT - 1; cls >= min_cls; cls--) {
+        for (int i = 0; i < sched->count[cls]; i++) {
+            if (sched->pinned[slot_at(sched, cls, i)]) {
+                continue;
+            }
+            uint8_t slot = remove_at(sched, cls, i);
+            sched->weighted_count--;
+            sched->free_slots[sched->free_count++] = slot;
+            sched->stats[cls].dropped++;
+            sched->stats[cls].depth = sched->count[cls];
+            sched->selected = -1;
+            return true;
+        }
+    }
+    return false;
+}
+
+int tx_sched_push(tx_sched_t *sched, tx_class_t cls, uint16_t len, bool evictable, int64_t now_us,
+                  bool *dropped) {
+    if (dropped) {
+        *dropped = false;
+    }
+    if ((unsigned)cls >= TX_CLASS_COUNT) {
+        cls = TX_CLASS_BULK;
+    }
+    bool pin = !evictable && is_weighted(cls);
+    if (pin && sched->pinned_count >= (sched->config.capacity - sched->config.reserve) / 2) {
+        sched->stats[cls].rejected++;
+        return -1;
+    }
+
+    bool need_evict = sched->free_count == 0 ||
+        (is_weighted(cls) && sched->weighted_count >= sched->config.capacity - sched->config.reserve);
+    if (need_evict) {
+        int min_cls = is_weighted(cls) ? cls : TX_CLASS_FIRST_WEIGHTED;
+        if (!evict(sched, min_cls)) {
+            sched->stats[cls].rejected++;
+            return -1;
+        }
+        if (dropped) {
+            *dropped = true;
+        }
+    }
+
+    uint8_t slot = sched->free_slots[--sched->free_count];
+    sched->len[slot] = len;
+    sched->enqueued_us[slot] = now_us;
+    sched->pinned[slot] = pin;
+    if (pin) {
+        sched->pinned_count++;
+    }
+    sched->order[cls][(sched->head[cls] + sched->count[cls]) % TX_SCHED_MAX_SLOTS] = slot;
+    sched->count[cls]++;
+    if (is_weighted(cls)) {
+        sched->weighted_count++;
+    }
+    sched->stats[cls].enqueued++;
+    sched->stats[cls].depth = sched->count[cls];
+    return slot;
+}
+
+uint32_t tx_sched_room(const tx_sched_t *sched, tx_class_t cls, bool evictable) {
+    if ((unsigned)cls >= TX_CLASS_COUNT) {
+        cls = TX_CLASS_BULK;
+    }
+    // Каждый пакет занимает свободный слот или вытесняет вытесняемый пакет
+    int min_cls = is_weighted(cls) ? cls : TX_CLASS_FIRST_WEIGHTED;
+    uint32_t evictable_count = 0;
+    for (int c = min_cls; c < TX_CLASS_COUNT; c++) {
+        for (int pos = 0; pos < sched->count[c]; pos++) {
+            evictable_count += !sched->pinned[slot_at(sched, c, pos)];
+        }
+    }
+    int free_room = sched->free_count;
+    if (is_weighted(cls)) {
+        int weighted_room = sched->config.capacity - sched->config.reserve - sched->weighted_count;
+        free_room = weighted_room < free_room ? weighted_room : free_room;
+    }
+    uint32_t room = (free_room > 0 ? (uint32_t)free_room : 0) + evictable_count;
+    if (!evictable && is_weighted(cls)) {
+        int pinned_room = (sched->config.capacity - sched->config.reserve) / 2 - sched->pinned_count;
+        if (pinned_room < 0) {
+            pinned_room = 0;
+        }
+        room = room < (uint32_t)pinned_room ? room : (uint32_t)pinned_room;
+    }
+    return room;
+}
+
+// Позиция самого старого подходящего пакета в очереди класса или -1
+static int find_eligible(const tx_sched_t *sched, int cls, tx_sched_eligible_fn eligible, void *ctx) {
+    for (int pos = 0; pos < sched->count[cls]; pos++) {
+        if (!eligible || eligible(slot_at(sched, cls, pos), ctx)) {
+            return pos;
+        }
+    }
+    return -1;
+}
+
+static int select_at(tx_sched_t *sched, int cls, int pos) {
+    sched->selected = cls;
+    sched->selected_pos = pos;
+    return slot_at(sched, cls, pos);
+}
+
+int tx_sched_peek(tx_sched_t *sched) {
+    return tx_sched_peek_eligible(sched, NULL, NULL);
+}
+
+int tx_sched_peek_eligible(tx_sched_t *sched, tx_sched_eligible_fn eligible, void *ctx) {
+    // Строгий приоритет
+    for (int cls = 0; cls < TX_CLASS_FIRST_WEIGHTED; cls++) {
+        int pos = find_eligible(sched, cls, eligible, ctx);
+        if (pos >= 0) {
+            return select_at(sched, cls, pos);
+        }
+    }
+    if (sched->weighted_count == 0) {
+        sched->selected = -1;
+        return -1;
+    }
+
+    // Deficit round robin: при переходе к классу его дефицит пополняется
+    // квантом по весу, класс обслуживается, пока дефицит покрывает пакет.
+    // Класс без подходящих пакетов пропускается с сохранением дефицита
+    const int weighted = TX_CLASS_COUNT - TX_CLASS_FIRST_WEIGHTED;
+    for (int visits = 0; visits <= 2 * weighted; visits++) {
+        int cls = sched->drr_class;
+        int pos = find_eligible(sched, cls, eligible, ctx);
+        if (pos >= 0 && sched->deficit[cls] >= sched->len[slot_at(sched, cls, pos)]) {
+            return select_at(sched, cls, pos);
+        }
+        if (sched->count[cls] == 0) {
+            sched->deficit[cls] = 0;
+        }
+        int next = cls + 1 < TX_CLASS_COUNT ? cls + 1 : TX_CLASS_FIRST_WEIGHTED;
+        sched->drr_class = next;
+        if (find_eligible(sched, next, eligible, ctx) >= 0) {
+            sched->deficit[next] += sched->config.weight[next] * TX_SCHED_QUANTUM;
+        }
+    }
+    sched->selected = -1;
+    return -1;
+}
+
+int tx_sched_pop(tx_sched_t *sched, int64_t now_us) {
+    int cls = sched->selected;
+    if (cls < 0 || sched->selected_pos >= sched->count[cls]) {
+        return -1;
+    }
+    uint8_t slot = remove_at(sched, cls, sched->selected_pos);
+    if (is_weighted(cls)) {
+        sched->weighted_count--;
+        sched->deficit[cls] -= sched->len[slot];
+    }
+    if (sched->pinned[slot]) {
+        sched->pinned[slot] = false;
+        sched->pinned_count--;
+    }
+    sched->stats[cls].depth = sched->count[cls];
+    latency_hist_record(&sched->stats[cls].queue_delay_us, now_us - sched->enqueued_us[slot]);
+    sched->selected = -1;
+    return slot;
+}
+
+void tx_sched_release(tx_sched_t *sched, int slot) {
+    if (slot >= 0 && slot < sched->config.capacity && sched->free_count < sched->config.capacity) {
+        sched->free_slots[sched->free_count++] = slot;
+    }
+}
+
+uint32_t tx_sched_depth(const tx_sched_t *sched) {
+    uint32_t depth = 0;
+    for (int cls = 0; cls < TX_CLASS_COUNT; cls++) {
+        depth += sched->count[cls];
+    }
+    return depth;
+}
@@ -1,48 +1,119 @@
 #include <string.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "driver/uart.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
 #include "uart_handler.h"
+#include "drone_message.h"
+#include "drone_msg_view.h"
+#include "dlog.h"
+#include "metrics.h"
 
 #define UART_TAG "UART_HANDLER"
 
-// Маркеры начала и конца пакета
-#define START_MARKER_1 0xAA
-#define START_MARKER_2 0x55
-#define END_MARKER_1   0x55
-#define END_MARKER_2   0xAA
+_Static_assert(UART_RX_BUF_SIZE > UART_FIFO_LEN, "Буфер приема драйвера должен быть больше FIFO");
+#if CONFIG_BRIDGE_UART_FLOW_CTRL
+_Static_assert(CONFIG_BRIDGE_UART_RTS_THRESHOLD > CONFIG_BRIDGE_UART_RX_FULL_THRESHOLD,
+               "RTS должен сниматься только при задержке обработчика прерывания");
+#endif
 
-// Состояния конечного автомата для приема данных
+// Повторы кадров согласования и число ошибок кадра до возврата к начальной скорости
+#define BAUD_REQUEST_INTERVAL_MS 200
+#define BAUD_REQUEST_ATTEMPTS    5
+#define BAUD_CHECK_INTERVAL_MS   50
+#define BAUD_CHECK_ATTEMPTS      5
+#define BAUD_LOST_FRAME_ERRORS   16
+
+// Контекст разбора кадров: хранит недоразобранные байты между вызовами
+static frame_parser_t uart_parser;
+static uint32_t reported_overflows = 0;
+
+// Очередь событий драйвера UART
+static QueueHandle_t uart_event_queue = NULL;
+
+// Кадр передается тремя вызовами uart_write_bytes, а скорость меняется
+// только после передачи начатого кадра
+static StaticSemaphore_t tx_mutex_buf;
+static SemaphoreHandle_t tx_mutex = NULL;
+
+// Время приема байтов в кольцевом буфере разборщика: по отметке на каждое
+// чтение из драйвера. end - позиция за последним байтом чтения (в счете
+// ring_head), time - время события UART_DATA, после которого прочитаны байты.
+// Кадр получает время чтения, в котором пришел его первый байт
+#define UART_RX_MARKS 16
+
+typedef struct {
+    uint32_t end;
+    int64_t time;
+} uart_rx_mark_t;
+
+static uart_rx_mark_t rx_marks[UART_RX_MARKS];
+static uint32_t rx_marks_head = 0;
+static uint32_t rx_marks_tail = 0;
+// Время события UART_DATA, байты которого еще не прочитаны (0 - событий нет)
+static int64_t rx_event_time = 0;
+
+static uart_stats_t stats;
+
+// Состояние согласования скорости. Изменяется только задачей, вызывающей
+// uart_receive_data
 typedef enum {
-    WAIT_START_1,    // Ожидаем первого маркера начала
-    WAIT_START_2,    // Ожидаем второго маркера начала
-    RECEIVING_DATA,  // Прием данных
-    WAIT_END_1,      // Ожидаем первого маркера конца
-    WAIT_END_2       // Ожидаем второго маркера конца
-} receive_state_t;
-
-// Буферы для приема данных
-static uint8_t data_buffer[UART_BUF_SIZE];
-static int data_index = 0;
-static receive_state_t receive_state = WAIT_START_1;
+    BAUD_IDLE,                     // Согласование не выполняется
+    BAUD_LINK_WAIT,                // Ожидание первого кадра от контроллера
+    BAUD_REQUEST,                  // Передан запрос, ожидание ответа
+    BAUD_CHECK                     // Скорость изменена, ожидание проверки
+} baud_state_t;
 
-int uart_init(int baud_rate) {
+static baud_state_t baud_state = BAUD_IDLE;
+static uint32_t baud_target = 0;
+static int baud_attempts = 0;
+static TickType_t baud_deadline = 0;
+static uint32_t frame_errors_since_frame = 0;
+
+// Общие настройки порта моста и порта проверки пропускной способности
+static void uart_configure(uart_port_t port, uint32_t baud_rate, QueueHandle_t *event_queue) {
     uart_config_t uart_config = {
         .baud_rate = baud_rate,
         .data_bits = UART_DATA_8_BITS,
         .parity    = UART_PARITY_DISABLE,
         .stop_bits = UART_STOP_BITS_1,
+#if CONFIG_BRIDGE_UART_FLOW_CTRL
+        .flow_ctrl = UART_HW_FLOWCTRL_CTS_RTS,
+        .rx_flow_ctrl_thresh = CONFIG_BRIDGE_UART_RTS_THRESHOLD,
+#else
         .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+#endif
         .source_clk = UART_SCLK_APB,
     };
     
+    ESP_ERROR_CHECK(uart_driver_install(port, UART_RX_BUF_SIZE, UART_TX_BUF_SIZE,
+                                        UART_EVENT_QUEUE_LEN, event_queue, 0));
+    ESP_ERROR_CHECK(uart_param_config(port, &uart_config));
+    
+    // Событие UART_DATA приходит после короткой паузы на линии, а не по заполнению FIFO
+    ESP_ERROR_CHECK(uart_set_rx_timeout(port, UART_RX_TIMEOUT_SYMBOLS));
+    // При высокой скорости FIFO нужно освобождать раньше, чем он заполнится
+    ESP_ERROR_CHECK(uart_set_rx_full_threshold(port, CONFIG_BRIDGE_UART_RX_FULL_THRESHOLD));
+}
+
+int uart_init(int baud_rate) {
     ESP_LOGI(UART_TAG, "Инициализация UART для полетного контроллера, baud_rate=%d", baud_rate);
     
-    ESP_ERROR_CHECK(uart_driver_install(UART_PORT, UART_BUF_SIZE * 2, UART_BUF_SIZE * 2, 0, NULL, 0));
-    ESP_ERROR_CHECK(uart_param_config(UART_PORT, &uart_config));
+    tx_mutex = xSemaphoreCreateMutexStatic(&tx_mutex_buf);
+    uart_configure(UART_PORT, baud_rate, &uart_event_queue);
+#if CONFIG_BRIDGE_UART_FLOW_CTRL
+    ESP_ERROR_CHECK(uart_set_pin(UART_PORT, UART_TX_PIN, UART_RX_PIN, UART_RTS_PIN, UART_CTS_PIN));
+#else
     ESP_ERROR_CHECK(uart_set_pin(UART_PORT, UART_TX_PIN, UART_RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
+#endif
+    
+    frame_parser_init(&uart_parser, UART_FRAME_MODE);
+    stats.baud_rate = baud_rate;
     
     return 0;
 }
@@ -54,112 +125,411 @@ int uart_send_data(const uint8_t *data, size_t len) {
         return -1;
     }
     
-    // Отправляем маркер начала
-    uint8_t start_marker_1 = START_MARKER_1;
-    uint8_t start_marker_2 = START_MARKER_2;
-    uart_write_bytes(UART_PORT, (const char*)&start_marker_1, 1);
-    uart_write_bytes(UART_PORT, (const char*)&start_marker_2, 1);
+    if (len > FRAME_PARSER_MAX_FRAME) {
+        ESP_LOGE(UART_TAG, "Слишком длинный кадр для отправки: %d > %d", len, FRAME_PARSER_MAX_FRAME);
+        return -1;
+    }
+    
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    
+    // Отправляем заголовок кадра (маркер начала или синхрослово с длиной)
+    uint8_t header[FRAME_LEN_HEADER_SIZE];
+    size_t header_len = frame_encode_header(UART_FRAME_MODE, len, header);
+    uart_write_bytes(UART_PORT, (const char*)header, header_len);
     
     // Отправляем данные
     int sent = uart_write_bytes(UART_PORT, (const char*)data, len);
     
     if (sent < 0) {
+        xSemaphoreGive(tx_mutex);
         ESP_LOGE(UART_TAG, "Ошибка при отправке данных по UART");
         return -1;
     }
     
-    // Отправляем маркер конца
-    uint8_t end_marker_1 = END_MARKER_1;
-    uint8_t end_marker_2 = END_MARKER_2;
-    uart_write_bytes(UART_PORT, (const char*)&end_marker_1, 1);
-    uart_write_bytes(UART_PORT, (const char*)&end_marker_2, 1);
+    // Отправляем завершение кадра: маркер конца или CRC данных
+    uint8_t trailer[FRAME_LEN_TRAILER_SIZE];
+    size_t trailer_len = frame_encode_trailer(UART_FRAME_MODE, data, len, trailer);
+    uart_write_bytes(UART_PORT, (const char*)trailer, trailer_len);
+    
+    xSemaphoreGive(tx_mutex);
     
     ESP_LOGD(UART_TAG, "Отправлено %d байт по UART", sent);
     return sent;
 }
 
-int uart_receive_data(uint8_t *output_buffer, size_t max_len) {
-    if (!output_buffer || max_len == 0) {
-        ESP_LOGE(UART_TAG, "Неверные параметры для приема данных по UART");
-        return -1;
+// Переносит накопленные драйвером байты в кольцевой буфер разборщика без блокировки
+static int uart_fill_parser(void) {
+    int total = 0;
+    
+    while (1) {
+        size_t buffered = 0;
+        uart_get_buffered_data_len(UART_PORT, &buffered);
+        
+        size_t contiguous;
+        uint8_t *dst = frame_parser_write_ptr(&uart_parser, &contiguous);
+        if (buffered == 0 || contiguous == 0) {
+            break;
+        }
+        
+        int len = uart_read_bytes(UART_PORT, dst, buffered < contiguous ? buffered : contiguous, 0);
+        if (len <= 0) {
+            break;
+        }
+        frame_parser_commit(&uart_parser, len);
+        total += len;
     }
     
-    uint8_t temp_buffer[UART_BUF_SIZE];
-    int len = uart_read_bytes(UART_PORT, temp_buffer, sizeof(temp_buffer), 0);
+    if (total > 0) {
+        int64_t stamp = rx_event_time ? rx_event_time : esp_timer_get_time();
+        if (rx_marks_head - rx_marks_tail == UART_RX_MARKS) {
+            // Отметки кончились: чтение добавляется к последнему
+            rx_marks[(rx_marks_head - 1) % UART_RX_MARKS].end = uart_parser.ring_head;
+        } else {
+            rx_marks[rx_marks_head % UART_RX_MARKS] = (uart_rx_mark_t){uart_parser.ring_head, stamp};
+            rx_marks_head++;
+        }
+        stats.bytes += total;
+        ESP_LOGD(UART_TAG, "Прочитано %d байт из UART", total);
+    }
+    // Событие без новых байтов: данные забрало предыдущее чтение
+    rx_event_time = 0;
+    return total;
+}
+
+// Время чтения, в котором пришел байт в позиции pos. Отметки более ранних
+// чтений больше не нужны: кадры выдаются по порядку
+static int64_t uart_rx_time(uint32_t pos) {
+    while (rx_marks_head - rx_marks_tail > 1 &&
+           (int32_t)(rx_marks[rx_marks_tail % UART_RX_MARKS].end - pos) <= 0) {
+        rx_marks_tail++;
+    }
+    if (rx_marks_head == rx_marks_tail) {
+        return esp_timer_get_time();
+    }
+    return rx_marks[rx_marks_tail % UART_RX_MARKS].time;
+}
+
+static void uart_reset_rx(void) {
+    uart_flush_input(UART_PORT);
+    xQueueReset(uart_event_queue);
+    frame_parser_reset(&uart_parser);
+    rx_marks_tail = rx_marks_head;
+    rx_event_time = 0;
+}
+
+static void baud_send(uart_baud_op_t op, uint32_t baud) {
+    uint8_t frame[UART_BAUD_FRAME_SIZE] = {UART_BAUD_MAGIC, op};
+    drone_msg_put_le32(frame + 2, baud);
+    uart_send_data(frame, sizeof(frame));
+}
+
+// Меняет скорость после передачи уже начатых кадров. Данные, принятые на
+// прежней скорости, отбрасываются
+static void baud_apply(uint32_t baud) {
+    xSemaphoreTake(tx_mutex, portMAX_DELAY);
+    uart_wait_tx_done(UART_PORT, pdMS_TO_TICKS(100));
+    uart_set_baudrate(UART_PORT, baud);
+    xSemaphoreGive(tx_mutex);
     
-    if (len <= 0) {
-        return 0;
+    uart_reset_rx();
+    stats.baud_rate = baud;
+    frame_errors_since_frame = 0;
+}
+
+static void baud_start(baud_state_t state) {
+    baud_state = state;
+    baud_attempts = 0;
+    baud_deadline = xTaskGetTickCount();
+}
+
+// Срок ожидания ответа истек: повтор кадра или отказ от согласования
+static void baud_timeout(void) {
+    if (baud_state == BAUD_REQUEST) {
+        if (baud_attempts++ < BAUD_REQUEST_ATTEMPTS) {
+            baud_send(UART_BAUD_REQUEST, baud_target);
+            baud_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(BAUD_REQUEST_INTERVAL_MS);
+            return;
+        }
+        ESP_LOGW(UART_TAG, "Контроллер не поддерживает согласование, скорость %d", UART_BAUD_RATE);
+    } else {
+        if (baud_attempts++ < BAUD_CHECK_ATTEMPTS) {
+            baud_send(UART_BAUD_CHECK, stats.baud_rate);
+            baud_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(BAUD_CHECK_INTERVAL_MS);
+            return;
+        }
+        DLOGW(DLOG_UART_BAUD_FALLBACK, stats.baud_rate, UART_BAUD_RATE);
+        baud_apply(UART_BAUD_RATE);
+    }
+    baud_state = BAUD_IDLE;
+}
+
+// Кадр согласования распознается, только если это ответ, которого мост
+// ждет в текущем состоянии. В остальное время 6-байтовый кадр с первым
+// байтом UART_BAUD_MAGIC - обычные данные полетного контроллера
+static bool baud_is_reply(const uint8_t *frame, size_t len) {
+    if (len != UART_BAUD_FRAME_SIZE || frame[0] != UART_BAUD_MAGIC) {
+        return false;
     }
+    return (baud_state == BAUD_REQUEST && frame[1] == UART_BAUD_ACCEPT) ||
+           (baud_state == BAUD_CHECK && frame[1] == UART_BAUD_CHECK_ACK &&
+            drone_msg_le32(frame + 2) == stats.baud_rate);
+}
+
+static void baud_handle_frame(const uint8_t *frame) {
+    uint8_t op = frame[1];
+    uint32_t baud = drone_msg_le32(frame + 2);
     
-    ESP_LOGD(UART_TAG, "Прочитано %d байт из UART", len);
+    if (op == UART_BAUD_ACCEPT && baud_state == BAUD_REQUEST) {
+        // Контроллер может принять меньшую скорость, чем предложена
+        if (baud <= stats.baud_rate || baud > baud_target) {
+            ESP_LOGW(UART_TAG, "Контроллер отказался от скорости %" PRIu32 " (ответ %" PRIu32 ")", baud_target, baud);
+            baud_state = BAUD_IDLE;
+            return;
+        }
+        baud_apply(baud);
+        baud_start(BAUD_CHECK);
+    } else if (op == UART_BAUD_CHECK_ACK) {
+        ESP_LOGI(UART_TAG, "Скорость UART изменена: %" PRIu32, baud);
+        baud_state = BAUD_IDLE;
+    }
+}
+
+void uart_negotiate_baud(uint32_t target_baud) {
+#if UART_PORT_IS_CONSOLE
+    // Консоль выводит журнал на начальной скорости: после смены скорости
+    // журнал становится нечитаемым, а его строки на высокой скорости
+    // портят кадры контроллера
+    ESP_LOGW(UART_TAG, "UART%d занят консолью, скорость %d не меняется", UART_PORT, UART_BAUD_RATE);
+    baud_state = BAUD_IDLE;
+#else
+    baud_target = target_baud;
+    baud_state = target_baud > UART_BAUD_RATE ? BAUD_LINK_WAIT : BAUD_IDLE;
+#endif
+}
+
+// Ошибки кадра на повышенной скорости без принятых кадров означают, что
+// контроллер перезапустился на начальной скорости
+static void uart_frame_error(void) {
+    stats.frame_errors++;
+    if (stats.baud_rate != UART_BAUD_RATE && baud_state == BAUD_IDLE &&
+        ++frame_errors_since_frame >= BAUD_LOST_FRAME_ERRORS) {
+        DLOGW(DLOG_UART_BAUD_LOST, stats.baud_rate, UART_BAUD_RATE);
+        baud_apply(UART_BAUD_RATE);
+        baud_state = BAUD_LINK_WAIT;
+    }
+}
+
+int uart_receive_data(uint8_t *output_buffer, size_t max_len, int64_t *rx_time, TickType_t ticks_to_wait) {
+    if (!output_buffer || max_len == 0 || !uart_event_queue) {
+        ESP_LOGE(UART_TAG, "Неверные параметры для приема данных по UART");
+        return -1;
+    }
+    
+    TimeOut_t timeout;
+    vTaskSetTimeOutState(&timeout);
     
-    for (int i = 0; i < len; i++) {
-        uint8_t byte = temp_buffer[i];
+    uart_event_t event;
+    while (1) {
+        // Сначала выдаем кадры, оставшиеся от предыдущих чтений
+        const uint8_t *frame;
+        size_t frame_len;
+        int has_frame = frame_parser_next(&uart_parser, &frame, &frame_len);
+        
+        if (uart_parser.overflows != reported_overflows) {
+            DLOGW(DLOG_UART_PARSER_OVF, uart_parser.overflows);
+            metrics_add(METRIC_UART_OVERFLOWS, uart_parser.overflows - reported_overflows);
+            reported_overflows = uart_parser.overflows;
+            stats.parser_overflows = uart_parser.overflows;
+        }
         
-        switch (receive_state) {
-            case WAIT_START_1:
-                if (byte == START_MARKER_1) {
-                    receive_state = WAIT_START_2;
-                    ESP_LOGD(UART_TAG, "Получен первый маркер начала");
+        if (has_frame && baud_is_reply(frame, frame_len)) {
+            frame_errors_since_frame = 0;
+            baud_handle_frame(frame);
+            continue;
+        }
+        
+        if (has_frame) {
+            ESP_LOGD(UART_TAG, "Пакет завершен (%d байт)", frame_len);
+            frame_errors_since_frame = 0;
+            if (baud_state == BAUD_LINK_WAIT) {
+                baud_start(BAUD_REQUEST);
+            }
+            if (frame_len > max_len) {
+                DLOGW(DLOG_UART_OUT_TOO_SMALL, frame_len, max_len);
+                return -1;
+            }
+            memcpy(output_buffer, frame, frame_len);
+            if (rx_time) {
+                *rx_time = uart_rx_time(uart_parser.frame_start);
+            }
+            stats.frames++;
+            metrics_inc(METRIC_UART_RX_FRAMES);
+            return frame_len;
+        }
+        
+        if (uart_fill_parser() > 0) {
+            continue;
+        }
+        
+        // Во время согласования ожидание ограничено сроком ответа контроллера
+        TickType_t wait = ticks_to_wait;
+        if (baud_state == BAUD_REQUEST || baud_state == BAUD_CHECK) {
+            TickType_t left = baud_deadline - xTaskGetTickCount();
+            if ((int32_t)left <= 0) {
+                baud_timeout();
+                continue;
+            }
+            if (left < wait) {
+                wait = left;
+            }
+        }
+        
+        if (xQueueReceive(uart_event_queue, &event, wait) != pdTRUE) {
+            if (wait == ticks_to_wait) {
+                return 0;
+            }
+            event.type = UART_EVENT_MAX;
+        }
+        
+        switch (event.type) {
+            case UART_DATA:
+                // Данные заберет uart_fill_parser на следующей итерации. Время
+                // ставится по первому событию: задача могла проснуться позже
+                if (!rx_event_time) {
+                    rx_event_time = esp_timer_get_time();
                 }
                 break;
-                
-            case WAIT_START_2:
-                if (byte == START_MARKER_2) {
-                    receive_state = RECEIVING_DATA;
-                    data_index = 0;
-                    ESP_LOGD(UART_TAG, "Получен второй маркер начала, начинаем прием данных");
+            
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                DLOGW(DLOG_UART_DRIVER_OVF, event.type);
+                metrics_inc(METRIC_UART_OVERFLOWS);
+                if (event.type == UART_FIFO_OVF) {
+                    stats.fifo_overflows++;
                 } else {
-                    receive_state = WAIT_START_1;
-                    ESP_LOGW(UART_TAG, "Ожидался второй маркер начала, получено: 0x%02x", byte);
+                    stats.buffer_overflows++;
                 }
+                uart_reset_rx();
                 break;
-                
-            case RECEIVING_DATA:
-                if (byte == END_MARKER_1) {
-                    receive_state = WAIT_END_1;
-                    ESP_LOGD(UART_TAG, "Получен первый маркер конца");
-                } else {
-                    if (data_index < UART_BUF_SIZE) {
-                        data_buffer[data_index++] = byte;
-                    } else {
-                        receive_state = WAIT_START_1;
-                        ESP_LOGW(UART_TAG, "Переполнение буфера данных");
-                    }
-                }
+            
+            case UART_FRAME_ERR:
+                uart_frame_error();
                 break;
-                
-            case WAIT_END_1:
-                if (byte == END_MARKER_2) {
-                    ESP_LOGD(UART_TAG, "Получен второй маркер конца, пакет завершен (%d байт)", data_index);
-                    
-                    if (data_index <= max_len) {
-                        memcpy(output_buffer, data_buffer, data_index);
-                        receive_state = WAIT_START_1;
-                        return data_index;
-                    } else {
-                        ESP_LOGW(UART_TAG, "Выходной буфер слишком мал: %d > %d", data_index, max_len);
-                        receive_state = WAIT_START_1;
-                        return -1;
-                    }
-                } else {
-                    if (data_index < UART_BUF_SIZE - 1) {
-                        data_buffer[data_index++] = END_MARKER_1;
-                        data_buffer[data_index++] = byte;
-                        receive_state = RECEIVING_DATA;
-                    } else {
-                        receive_state = WAIT_START_1;
-                        ESP_LOGW(UART_TAG, "Переполнение буфера при добавлении маркера");
-                    }
-                }
+            
+            case UART_EVENT_MAX:
+                // Истек срок ответа при согласовании скорости
                 break;
-                
-            case WAIT_END_2:
-                receive_state = WAIT_START_1;
-                ESP_LOGW(UART_TAG, "Неожиданное состояние WAIT_END_2");
+            
+            default:
+                ESP_LOGD(UART_TAG, "Событие UART: %d", event.type);
                 break;
         }
+        
+        if (xTaskCheckForTimeOut(&timeout, &ticks_to_wait) == pdTRUE) {
+            ticks_to_wait = 0;
+        }
     }
+}
+
+void uart_get_stats(uart_stats_t *stats_out) {
+    *stats_out = stats;
+}
+
+#ifdef TEST_BUILD
+
+typedef struct {
+    uart_port_t port;
+    volatile bool stop;
+    uint32_t frames_sent;
+    TaskHandle_t owner;
+} loopback_writer_t;
+
+// Передает кадры размера сообщения дрона, пока не будет выставлен stop
+static void loopback_writer_task(void *arg) {
+    loopback_writer_t *writer = arg;
+    uint8_t frame[FRAME_LEN_HEADER_SIZE + EXPECTED_DRONE_MSG_SIZE + 2];
+    size_t len = frame_encode_header(UART_FRAME_MODE, EXPECTED_DRONE_MSG_SIZE, frame);
+    for (int i = 0; i < EXPECTED_DRONE_MSG_SIZE; i++) {
+        // Данные без маркеров, чтобы кадр не обрезался в формате с маркерами
+        frame[len + i] = (uint8_t)(i * 7);
+    }
+    len += frame_encode_trailer(UART_FRAME_MODE, frame + len, EXPECTED_DRONE_MSG_SIZE,
+                                frame + len + EXPECTED_DRONE_MSG_SIZE);
+    len += EXPECTED_DRONE_MSG_SIZE;
     
-    return 0;
-}
\ No newline at end of file
+    while (!writer->stop) {
+        uart_write_bytes(writer->port, (const char *)frame, len);
+        writer->frames_sent++;
+    }
+    xTaskNotifyGive(writer->owner);
+    vTaskDelete(NULL);
+}
+
+void uart_loopback_test(uart_port_t port, uint32_t baud, uint32_t duration_ms, uart_loopback_result_t *result) {
+    static frame_parser_t parser;
+    QueueHandle_t events;
+    memset(result, 0, sizeof(*result));
+    result->baud_rate = baud;
+    
+    uart_configure(port, baud, &events);
+    uart_set_loop_back(port, true);
+    frame_parser_init(&parser, UART_FRAME_MODE);
+    
+    loopback_writer_t writer = {.port = port, .owner = xTaskGetCurrentTaskHandle()};
+    xTaskCreate(loopback_writer_task, "uart_loopback", 2048, &writer, 4, NULL);
+    
+    int64_t start = esp_timer_get_time();
+    int64_t end = start + (int64_t)duration_ms * 1000;
+    uint32_t bytes = 0;
+    uart_event_t event;
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        if (now >= end && !writer.stop) {
+            writer.stop = true;
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            uart_wait_tx_done(port, pdMS_TO_TICKS(100));
+        }
+        if (xQueueReceive(events, &event, pdMS_TO_TICKS(10)) != pdTRUE) {
+            if (writer.stop) {
+                break;
+            }
+            continue;
+        }
+        if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+            result->overruns++;
+            uart_flush_input(port);
+            xQueueReset(events);
+            continue;
+        }
+        
+        size_t contiguous;
+        uint8_t *dst;
+        size_t buffered = 0;
+        uart_get_buffered_data_len(port, &buffered);
+        while (buffered > 0 && (dst = frame_parser_write_ptr(&parser, &contiguous)) != NULL && contiguous > 0) {
+            int len = uart_read_bytes(port, dst, buffered < contiguous ? buffered : contiguous, 0);
+            if (len <= 0) {
+                break;
+            }
+            frame_parser_commit(&parser, len);
+            bytes += len;
+            buffered -= len;
+            
+            const uint8_t *frame;
+            size_t frame_len;
+            while (frame_parser_next(&parser, &frame, &frame_len)) {
+                result->frames_received++;
+            }
+        }
+    }
+    
+    int64_t elapsed = esp_timer_get_time() - start;
+    result->frames_sent = writer.frames_sent;
+    result->overruns += parser.overflows;
+    result->bytes_per_s = elapsed > 0 ? (uint32_t)((int64_t)bytes * 1000000 / elapsed) : 0;
+    
+    uart_set_loop_back(port, false);
+    uart_driver_delete(port);
+}
+
+#endif /* TEST_BUILD */